@@ -2,6 +2,10 @@
 
 #include "benchmark.h"
 
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
+
 static double last_time;
 
 #define max_slots 10
@@ -60,3 +64,22 @@ void benchmark_slot_printall(void) {
             printf(" ==> (s: %d) Elapsed: %.4f\n", c, slot_accum[c]);
     }
 }
+
+
+// Peak resident memory of the process in bytes (0 if unavailable)
+uint64_t benchmark_get_peak_rss(void) {
+#ifndef _WIN32
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+    #ifdef __APPLE__
+        return (uint64_t)usage.ru_maxrss;        // bytes
+    #else
+        return (uint64_t)usage.ru_maxrss * 1024; // kilobytes
+    #endif
+#else
+    return 0;
+#endif
+}
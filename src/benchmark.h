@@ -7,6 +7,7 @@
 // #include <sys/resource.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 
 double get_time(void);
 void benchmark_start(void);
@@ -18,4 +19,6 @@ void benchmark_slot_update(int slot);
 void benchmark_slot_print(int slot);
 void benchmark_slot_printall(void);
 
+uint64_t benchmark_get_peak_rss(void);
+
 #endif
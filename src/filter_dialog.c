@@ -30,6 +30,17 @@
 #include "lib_tilemap.h"
 #include "tilemap_overlay.h"
 #include "tilemap_export.h"
+#include "tilemap_layers.h"
+#include "tilemap_store.h"
+#include "tilemap_hash.h"
+#include "tilemap_batch.h"
+#include "tilemap_compare.h"
+#include "tilemap_subpal.h"
+#include "tilemap_window.h"
+#include "tilemap_rooms.h"
+#include "tilemap_metatile.h"
+#include "tilemap_sprites.h"
+#include "tilemap_grid.h"
 
 #include "benchmark.h"
 
@@ -42,6 +53,7 @@ static int dialog_scaled_preview_check_resize(GtkWidget *, gint, gint, gint);
 
 static void dialog_source_image_free_and_reset(void);
 static void dialog_source_image_initialize(void);
+static void dialog_source_tile_major_update(void);
 
 static gint dialog_source_image_load(GimpDrawable * drawable);
 static gint dialog_source_colormap_load(GimpDrawable * drawable);
@@ -55,7 +67,23 @@ static void on_setting_tilesize_spinbutton_changed(GtkSpinButton *, gint);
 static void on_setting_overlay_checkbutton_changed(GtkToggleButton *, gpointer);
 static void on_setting_finalbpp_combo_changed(GtkComboBox *, gpointer);
 static void on_setting_flattened_image_checkbutton_changed(GtkToggleButton *, gpointer);
+static void on_setting_all_layers_checkbutton_changed(GtkToggleButton *, gpointer);
 static void on_setting_checkflip_checkbutton_changed(GtkToggleButton *, gpointer);
+static void on_setting_refstorage_checkbutton_changed(GtkToggleButton *, gpointer);
+static void on_setting_map_rle_checkbutton_changed(GtkToggleButton *, gpointer);
+static void on_setting_reduce_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_budget_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_hash_combo_changed(GtkComboBox *, gpointer);
+static void on_action_hash_bench_button_clicked(GtkButton *, gpointer);
+static void on_setting_engine_combo_changed(GtkComboBox *, gpointer);
+static void on_setting_subpal_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_window_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_rooms_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_metatile_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_sprite_mode_checkbutton_changed(GtkToggleButton *, gpointer);
+static void on_setting_grid_spinbutton_changed(GtkSpinButton *, gpointer);
+static void on_setting_base_combo_changed(GtkComboBox *, gpointer);
+static void on_action_engine_bench_button_clicked(GtkButton *, gpointer);
 static void on_setting_maptoclipboard_type_combo_changed(GtkComboBox *, gpointer);
 static void on_setting_setting_maptoclipboard_prefix_entry_changed(GtkEntry *, gpointer);
 
@@ -69,12 +97,17 @@ static void dialog_ui_update(void);
 int dialog_calc_dest_bpp(int);
 
 static void info_display_update(void);
+static void layer_info_display_update(void);
+static void rooms_info_display_update(void);
+static void sprites_info_display_update(void);
 
 static void tilemap_copy_map_to_clipboard(void);
 
 gboolean preview_scaled_update(GtkWidget *, GdkEvent *, GtkWidget *);
 
-static void tilemap_calculate(void);
+static void dialog_base_image_update(void);
+static void tilemap_calculate(gint32 drawable_id);
+static gint tilemap_calculate_all_layers(gint32 drawable_id);
 
 static void tilemap_render_overlay(void);
 
@@ -98,6 +131,9 @@ static GtkWidget * preview_scaled;
 static GtkWidget * scaled_preview_window;
 static GtkWidget * tile_info_display;
 static GtkWidget * memory_info_display;
+static GtkWidget * layer_info_display;
+static GtkWidget * rooms_info_display;
+static GtkWidget * sprites_info_display;
 static GtkWidget * mouse_hover_display;
 
 
@@ -106,6 +142,7 @@ static GtkWidget * setting_scale_label;
 static GtkWidget * setting_scale_spinbutton;
 
 static GtkWidget * setting_flattened_image_checkbutton;
+static GtkWidget * setting_all_layers_checkbutton;
 
 static GtkWidget * setting_overlay_grid_checkbutton;
 static GtkWidget * setting_overlay_tileids_checkbutton;
@@ -122,6 +159,44 @@ static GtkWidget * setting_tilesize_height_spinbutton;
 static GtkWidget * setting_checkflip_checkbutton;
 static GtkWidget * setting_checkrotation_checkbutton;
 
+static GtkWidget * setting_refstorage_checkbutton;
+static GtkWidget * setting_map_rle_checkbutton;
+
+static GtkWidget * setting_reduce_label;
+static GtkWidget * setting_reduce_spinbutton;
+static GtkWidget * setting_budget_label;
+static GtkWidget * setting_budget_spinbutton;
+static GtkWidget * setting_hash_label;
+static GtkWidget * setting_hash_combo;
+static GtkWidget * action_hash_bench_button;
+static GtkWidget * setting_engine_label;
+static GtkWidget * setting_engine_combo;
+static GtkWidget * setting_subpal_label;
+static GtkWidget * setting_subpal_count_spinbutton;
+static GtkWidget * setting_subpal_colors_spinbutton;
+
+static GtkWidget * setting_window_label;
+static GtkWidget * setting_window_width_spinbutton;
+static GtkWidget * setting_window_height_spinbutton;
+
+static GtkWidget * setting_rooms_label;
+static GtkWidget * setting_rooms_width_spinbutton;
+static GtkWidget * setting_rooms_height_spinbutton;
+
+static GtkWidget * setting_metatile_label;
+static GtkWidget * setting_metatile_width_spinbutton;
+static GtkWidget * setting_metatile_height_spinbutton;
+
+static GtkWidget * setting_sprite_mode_checkbutton;
+
+static GtkWidget * setting_grid_label;
+static GtkWidget * setting_grid_margin_spinbutton;
+static GtkWidget * setting_grid_spacing_spinbutton;
+
+static GtkWidget * setting_base_label;
+static GtkWidget * setting_base_combo;
+static GtkWidget * action_engine_bench_button;
+
 static GtkWidget * action_maptoclipboard_button;
 
 static PluginTileMapVals dialog_settings;
@@ -130,6 +205,7 @@ static PluginTileMapVals dialog_settings;
 // TODO: move these out of global scope?
 static image_data      app_image;
 static color_data      app_colors;
+static tile_major_image app_tile_major; // app_image in tile-major order for processing (may be empty)
 
 static gint32          image_id;
 
@@ -148,6 +224,17 @@ gint tilemap_dialog_show (GimpDrawable *drawable)
 
     GtkWidget * setting_tilesize_hbox;
 
+    GtkWidget * setting_reduce_hbox;
+    GtkWidget * setting_budget_hbox;
+    GtkWidget * setting_hash_hbox;
+    GtkWidget * setting_engine_hbox;
+    GtkWidget * setting_subpal_hbox;
+    GtkWidget * setting_window_hbox;
+    GtkWidget * setting_rooms_hbox;
+    GtkWidget * setting_metatile_hbox;
+    GtkWidget * setting_grid_hbox;
+    GtkWidget * setting_base_hbox;
+
     GtkWidget * setting_finalbpp_label;
     GtkWidget * setting_finalbpp_hbox;
 
@@ -297,6 +384,148 @@ gint tilemap_dialog_show (GimpDrawable *drawable)
         // Checkbox for whether to sample the source image as a single layer or flattened
         setting_flattened_image_checkbutton = gtk_check_button_new_with_label("Flattened Image");
 
+        // Checkbox for building one map per visible layer against a shared tile set
+        setting_all_layers_checkbutton = gtk_check_button_new_with_label("All Visible Layers");
+
+        // Checkbox for whether tiles reference source image pixels instead of keeping copies
+        setting_refstorage_checkbutton = gtk_check_button_new_with_label("Reference Source Pixels");
+
+        // Checkbox for storing the map as run-length rows (kept only when smaller)
+        setting_map_rle_checkbutton = gtk_check_button_new_with_label("RLE Compress Map");
+
+        // Target tile count, merges similar tiles when the unique count is higher (0 = off)
+        setting_reduce_label = gtk_label_new ("Max Tiles (0=off): " );
+        gtk_misc_set_alignment(GTK_MISC(setting_reduce_label), 0.0f, 0.5f); // Left-align
+        setting_reduce_spinbutton = gtk_spin_button_new_with_range(0,TILES_MAX_DEFAULT,1); // Min/Max/Step
+
+        setting_reduce_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_reduce_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_reduce_hbox), setting_reduce_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_reduce_hbox), setting_reduce_spinbutton, FALSE, FALSE, 0);
+
+        // Memory budget in MB, tile pixels spill to a temp file beyond it (0 = off)
+        setting_budget_label = gtk_label_new ("Mem Budget MB (0=off): " );
+        gtk_misc_set_alignment(GTK_MISC(setting_budget_label), 0.0f, 0.5f); // Left-align
+        setting_budget_spinbutton = gtk_spin_button_new_with_range(0,MEMORY_BUDGET_MB_MAX,64); // Min/Max/Step
+
+        setting_budget_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_budget_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_budget_hbox), setting_budget_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_budget_hbox), setting_budget_spinbutton, FALSE, FALSE, 0);
+
+        // Tile hash backend (Auto picks from CPU features), plus a
+        // button to compare all of them on the current image
+        setting_hash_label = gtk_label_new ("Hash: " );
+        gtk_misc_set_alignment(GTK_MISC(setting_hash_label), 0.0f, 0.5f); // Left-align
+        setting_hash_combo = gtk_combo_box_text_new ();
+
+        for (idx = TILE_HASH_AUTO; idx < TILE_HASH_LAST; idx++)
+            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(setting_hash_combo), tile_hash_get_name(idx));
+        gtk_combo_box_set_active(GTK_COMBO_BOX(setting_hash_combo), TILE_HASH_AUTO);
+
+        action_hash_bench_button = gtk_button_new_with_label("Bench");
+
+        setting_hash_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_hash_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_hash_hbox), setting_hash_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_hash_hbox), setting_hash_combo, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_hash_hbox), action_hash_bench_button, FALSE, FALSE, 0);
+
+        // Dedupe engine (per cell lookup or sort based batch), plus a
+        // button to compare them on the current image
+        setting_engine_label = gtk_label_new ("Engine: " );
+        gtk_misc_set_alignment(GTK_MISC(setting_engine_label), 0.0f, 0.5f); // Left-align
+        setting_engine_combo = gtk_combo_box_text_new ();
+
+        for (idx = TILE_ENGINE_INCREMENTAL; idx < TILE_ENGINE_LAST; idx++)
+            gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(setting_engine_combo), tilemap_engine_get_name(idx));
+        gtk_combo_box_set_active(GTK_COMBO_BOX(setting_engine_combo), TILE_ENGINE_INCREMENTAL);
+
+        action_engine_bench_button = gtk_button_new_with_label("Bench");
+
+        setting_engine_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_engine_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_engine_hbox), setting_engine_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_engine_hbox), setting_engine_combo, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_engine_hbox), action_engine_bench_button, FALSE, FALSE, 0);
+
+        // Sub-palettes on the target (count x colors), tiles get assigned to them (0 = off)
+        setting_subpal_label = gtk_label_new ("Sub-Pals (0=off): " );
+        gtk_misc_set_alignment(GTK_MISC(setting_subpal_label), 0.0f, 0.5f); // Left-align
+        setting_subpal_count_spinbutton  = gtk_spin_button_new_with_range(0,SUBPAL_COUNT_MAX,1); // Min/Max/Step
+        setting_subpal_colors_spinbutton = gtk_spin_button_new_with_range(2,COLOR_DATA_PAL_MAX_COUNT,1); // Min/Max/Step
+
+        setting_subpal_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_subpal_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_subpal_hbox), setting_subpal_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_subpal_hbox), setting_subpal_count_spinbutton, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_subpal_hbox), setting_subpal_colors_spinbutton, FALSE, FALSE, 0);
+
+        // Scrolling viewport (width x height in tiles) for the peak tiles on screen (0 = off)
+        setting_window_label = gtk_label_new ("View (0=off): " );
+        gtk_misc_set_alignment(GTK_MISC(setting_window_label), 0.0f, 0.5f); // Left-align
+        setting_window_width_spinbutton  = gtk_spin_button_new_with_range(0,WINDOW_VIEW_MAX,1); // Min/Max/Step
+        setting_window_height_spinbutton = gtk_spin_button_new_with_range(1,WINDOW_VIEW_MAX,1); // Min/Max/Step
+
+        setting_window_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_window_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_window_hbox), setting_window_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_window_hbox), setting_window_width_spinbutton, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_window_hbox), setting_window_height_spinbutton, FALSE, FALSE, 0);
+
+        // Room size (width x height in tiles), each room gets its own tile set (0 = off)
+        setting_rooms_label = gtk_label_new ("Rooms (0=off): " );
+        gtk_misc_set_alignment(GTK_MISC(setting_rooms_label), 0.0f, 0.5f); // Left-align
+        setting_rooms_width_spinbutton  = gtk_spin_button_new_with_range(0,ROOMS_SIZE_MAX,1); // Min/Max/Step
+        setting_rooms_height_spinbutton = gtk_spin_button_new_with_range(1,ROOMS_SIZE_MAX,1); // Min/Max/Step
+
+        setting_rooms_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_rooms_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_rooms_hbox), setting_rooms_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_rooms_hbox), setting_rooms_width_spinbutton, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_rooms_hbox), setting_rooms_height_spinbutton, FALSE, FALSE, 0);
+
+        // Metatile size (width x height in tiles), second dedupe over blocks of map entries (0 = off)
+        setting_metatile_label = gtk_label_new ("Metatiles (0=off): " );
+        gtk_misc_set_alignment(GTK_MISC(setting_metatile_label), 0.0f, 0.5f); // Left-align
+        setting_metatile_width_spinbutton  = gtk_spin_button_new_with_range(0,METATILE_SIZE_MAX,1); // Min/Max/Step
+        setting_metatile_height_spinbutton = gtk_spin_button_new_with_range(1,METATILE_SIZE_MAX,1); // Min/Max/Step
+
+        setting_metatile_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_metatile_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_metatile_hbox), setting_metatile_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_metatile_hbox), setting_metatile_width_spinbutton, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_metatile_hbox), setting_metatile_height_spinbutton, FALSE, FALSE, 0);
+
+        // Sprite sheet mode: find sprites by their opaque pixels instead of splitting into tiles
+        setting_sprite_mode_checkbutton = gtk_check_button_new_with_label("Sprite Sheet Mode");
+
+        // Tile sheet margin and spacing in pixels (0 / 0 = tiles packed edge to edge)
+        setting_grid_label = gtk_label_new ("Margin / Spacing: " );
+        gtk_misc_set_alignment(GTK_MISC(setting_grid_label), 0.0f, 0.5f); // Left-align
+        setting_grid_margin_spinbutton  = gtk_spin_button_new_with_range(0,GRID_SIZE_MAX,1); // Min/Max/Step
+        setting_grid_spacing_spinbutton = gtk_spin_button_new_with_range(0,GRID_SIZE_MAX,1); // Min/Max/Step
+
+        setting_grid_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_grid_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_grid_hbox), setting_grid_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_grid_hbox), setting_grid_margin_spinbutton, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_grid_hbox), setting_grid_spacing_spinbutton, FALSE, FALSE, 0);
+
+        // Locked base tile set: any open layer, its tiles keep IDs 0..n-1 in every map
+        setting_base_label = gtk_label_new ("Base Tile Set: " );
+        gtk_misc_set_alignment(GTK_MISC(setting_base_label), 0.0f, 0.5f); // Left-align
+        setting_base_combo = gimp_layer_combo_box_new(NULL, NULL);
+        gimp_int_combo_box_prepend(GIMP_INT_COMBO_BOX(setting_base_combo),
+                                   GIMP_INT_STORE_VALUE, BASE_DRAWABLE_NONE,
+                                   GIMP_INT_STORE_LABEL, "None",
+                                   -1);
+
+        setting_base_hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 3);
+        gtk_container_set_border_width (GTK_CONTAINER (setting_base_hbox), 3);
+        gtk_box_pack_start (GTK_BOX (setting_base_hbox), setting_base_label, FALSE, FALSE, 0);
+        gtk_box_pack_start (GTK_BOX (setting_base_hbox), setting_base_combo, FALSE, FALSE, 0);
+
     // Info readout/display area
     tile_info_display = gtk_label_new (NULL);
     gtk_label_set_markup(GTK_LABEL(tile_info_display),
@@ -313,6 +542,18 @@ gint tilemap_dialog_show (GimpDrawable *drawable)
     gtk_misc_set_alignment(GTK_MISC(memory_info_display), 1.0f, 0.0f);
     gtk_label_set_justify(GTK_LABEL(memory_info_display), GTK_JUSTIFY_RIGHT);
 
+    // Per-layer statistics (only filled in for All Visible Layers mode)
+    layer_info_display = gtk_label_new (NULL);
+    gtk_misc_set_alignment(GTK_MISC(layer_info_display), 0.0f, 0.0f);
+
+    // Per-room statistics (only filled in when the map is split into rooms)
+    rooms_info_display = gtk_label_new (NULL);
+    gtk_misc_set_alignment(GTK_MISC(rooms_info_display), 0.0f, 0.0f);
+
+    // Sprite counts (only filled in for Sprite Sheet Mode)
+    sprites_info_display = gtk_label_new (NULL);
+    gtk_misc_set_alignment(GTK_MISC(sprites_info_display), 0.0f, 0.0f);
+
         // Combo box to customize the final bits-per-pixel of the tile data
         setting_finalbpp_label = gtk_label_new("Bits-per-pixel: ");
         gtk_misc_set_alignment(GTK_MISC(setting_finalbpp_label), 1.0, 0.5f);
@@ -389,12 +630,38 @@ gint tilemap_dialog_show (GimpDrawable *drawable)
         gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_checkflip_checkbutton,       2, 3, 3, 4);
 //        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_checkrotation_checkbutton,   2, 3, 4, 5);
         gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_flattened_image_checkbutton,   2, 3, 4, 5);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_refstorage_checkbutton,        2, 3, 5, 6);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_reduce_hbox,                   2, 3, 6, 7);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_all_layers_checkbutton,        2, 3, 7, 8);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_budget_hbox,                   2, 3, 8, 9);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_map_rle_checkbutton,           2, 3, 9, 10);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_hash_hbox,                     2, 3, 10, 11);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_engine_hbox,                   2, 3, 11, 12);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_subpal_hbox,                   2, 3, 12, 13);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_window_hbox,                   2, 3, 13, 14);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_rooms_hbox,                    2, 3, 14, 15);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_metatile_hbox,                 2, 3, 15, 16);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_sprite_mode_checkbutton,       2, 3, 16, 17);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_grid_hbox,                     2, 3, 17, 18);
+        gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_base_hbox,                     2, 3, 18, 19);
 
     gtk_table_attach_defaults (GTK_TABLE (setting_table), tile_info_display,        3, 4, 0, 4);  // Vertical Column
     gtk_table_attach_defaults (GTK_TABLE (setting_table), memory_info_display,      4, 5, 0, 4);  // Vertical Column
     gtk_table_attach_defaults (GTK_TABLE (setting_table), setting_finalbpp_hbox,    4, 5, 4, 5);  // Bottom right
 
 
+    // Attach per-layer info below the table
+    gtk_box_pack_start (GTK_BOX (main_vbox), layer_info_display, FALSE, FALSE, 0);
+    gtk_widget_show (layer_info_display);
+
+    // Attach per-room info below that
+    gtk_box_pack_start (GTK_BOX (main_vbox), rooms_info_display, FALSE, FALSE, 0);
+    gtk_widget_show (rooms_info_display);
+
+    // Attach sprite info below that
+    gtk_box_pack_start (GTK_BOX (main_vbox), sprites_info_display, FALSE, FALSE, 0);
+    gtk_widget_show (sprites_info_display);
+
     // Attach mouse hover info area to bottom of main vbox (below table)
     gtk_box_pack_start (GTK_BOX (main_vbox), mouse_hover_frame, FALSE, FALSE, 0);
 
@@ -489,6 +756,41 @@ void dialog_settings_apply_to_ui(void) {
     gtk_entry_set_text(GTK_ENTRY(setting_maptoclipboard_prefix_entry), dialog_settings.maptoclipboard_prefix_str );
 
     gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(setting_flattened_image_checkbutton), dialog_settings.flattened_image);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(setting_all_layers_checkbutton),      dialog_settings.all_layers);
+
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(setting_refstorage_checkbutton),
+                                 (dialog_settings.tile_storage_mode == TILE_STORAGE_REFERENCE));
+
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_reduce_spinbutton),          dialog_settings.reduce_tile_target);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_budget_spinbutton),          dialog_settings.memory_budget_mb);
+
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(setting_map_rle_checkbutton),         dialog_settings.map_rle);
+
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_subpal_count_spinbutton),    dialog_settings.subpal_count);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_subpal_colors_spinbutton),   dialog_settings.subpal_colors);
+
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_window_width_spinbutton),    dialog_settings.window_width);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_window_height_spinbutton),   dialog_settings.window_height);
+
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_rooms_width_spinbutton),     dialog_settings.room_width);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_rooms_height_spinbutton),    dialog_settings.room_height);
+
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_metatile_width_spinbutton),  dialog_settings.metatile_width);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_metatile_height_spinbutton), dialog_settings.metatile_height);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(setting_sprite_mode_checkbutton),     dialog_settings.sprite_mode);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_grid_margin_spinbutton),  dialog_settings.grid_margin);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(setting_grid_spacing_spinbutton), dialog_settings.grid_spacing);
+
+    // Layer may be gone since the settings were saved, fall back to none
+    if ((dialog_settings.base_drawable_id == BASE_DRAWABLE_NONE) || !gimp_item_is_valid(dialog_settings.base_drawable_id))
+        dialog_settings.base_drawable_id = BASE_DRAWABLE_NONE;
+    gimp_int_combo_box_set_active(GIMP_INT_COMBO_BOX(setting_base_combo), dialog_settings.base_drawable_id);
+
+    if ((dialog_settings.hash_backend >= TILE_HASH_AUTO) && (dialog_settings.hash_backend < TILE_HASH_LAST))
+        gtk_combo_box_set_active(GTK_COMBO_BOX(setting_hash_combo), dialog_settings.hash_backend);
+
+    if ((dialog_settings.dedupe_engine >= TILE_ENGINE_INCREMENTAL) && (dialog_settings.dedupe_engine < TILE_ENGINE_LAST))
+        gtk_combo_box_set_active(GTK_COMBO_BOX(setting_engine_combo), dialog_settings.dedupe_engine);
 
 
     gtk_combo_box_set_active(GTK_COMBO_BOX(setting_finalbpp_combo), 0);
@@ -558,6 +860,77 @@ void dialog_settings_connect_signals(GimpDrawable *drawable) {
     g_signal_connect(G_OBJECT(setting_flattened_image_checkbutton), "toggled",
                       G_CALLBACK(on_setting_flattened_image_checkbutton_changed), NULL);
 
+    g_signal_connect(G_OBJECT(setting_all_layers_checkbutton), "toggled",
+                      G_CALLBACK(on_setting_all_layers_checkbutton_changed), NULL);
+
+    // Tile pixel storage mode
+    g_signal_connect(G_OBJECT(setting_refstorage_checkbutton), "toggled",
+                      G_CALLBACK(on_setting_refstorage_checkbutton_changed), NULL);
+
+    // Map storage
+    g_signal_connect(G_OBJECT(setting_map_rle_checkbutton), "toggled",
+                      G_CALLBACK(on_setting_map_rle_checkbutton_changed), NULL);
+
+    // Tile set reduction target
+    g_signal_connect (setting_reduce_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_reduce_spinbutton_changed), NULL);
+
+    // Memory budget
+    g_signal_connect (setting_budget_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_budget_spinbutton_changed), NULL);
+
+    // Hash backend
+    g_signal_connect (setting_hash_combo, "changed",
+                      G_CALLBACK (on_setting_hash_combo_changed), NULL);
+
+    g_signal_connect (action_hash_bench_button, "clicked",
+                      G_CALLBACK (on_action_hash_bench_button_clicked), NULL);
+
+    // Dedupe engine
+    g_signal_connect (setting_engine_combo, "changed",
+                      G_CALLBACK (on_setting_engine_combo_changed), NULL);
+
+    g_signal_connect (action_engine_bench_button, "clicked",
+                      G_CALLBACK (on_action_engine_bench_button_clicked), NULL);
+
+    // Sub-palettes
+    g_signal_connect (setting_subpal_count_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_subpal_spinbutton_changed), NULL);
+    g_signal_connect (setting_subpal_colors_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_subpal_spinbutton_changed), NULL);
+
+    // Viewport residency
+    g_signal_connect (setting_window_width_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_window_spinbutton_changed), NULL);
+    g_signal_connect (setting_window_height_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_window_spinbutton_changed), NULL);
+
+    // Rooms
+    g_signal_connect (setting_rooms_width_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_rooms_spinbutton_changed), NULL);
+    g_signal_connect (setting_rooms_height_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_rooms_spinbutton_changed), NULL);
+
+    // Metatiles
+    g_signal_connect (setting_metatile_width_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_metatile_spinbutton_changed), NULL);
+    g_signal_connect (setting_metatile_height_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_metatile_spinbutton_changed), NULL);
+
+    // Sprite sheet mode
+    g_signal_connect(G_OBJECT(setting_sprite_mode_checkbutton), "toggled",
+                      G_CALLBACK(on_setting_sprite_mode_checkbutton_changed), NULL);
+
+    // Tile sheet margin / spacing
+    g_signal_connect (setting_grid_margin_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_grid_spinbutton_changed), NULL);
+    g_signal_connect (setting_grid_spacing_spinbutton, "value-changed",
+                      G_CALLBACK (on_setting_grid_spinbutton_changed), NULL);
+
+    // Locked base tile set
+    g_signal_connect (setting_base_combo, "changed",
+                      G_CALLBACK (on_setting_base_combo_changed), NULL);
+
     g_signal_connect (setting_maptoclipboard_type_combo, "changed",
                       G_CALLBACK (on_setting_maptoclipboard_type_combo_changed), NULL);
 
@@ -585,6 +958,70 @@ void dialog_settings_connect_signals(GimpDrawable *drawable) {
                               G_CALLBACK(tilemap_dialog_processing_run), drawable);
 
 
+    // Tile pixel storage mode
+    g_signal_connect_swapped (setting_refstorage_checkbutton, "toggled",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Map storage
+    g_signal_connect_swapped (setting_map_rle_checkbutton, "toggled",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Tile set reduction target
+    g_signal_connect_swapped (setting_reduce_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Memory budget
+    g_signal_connect_swapped (setting_budget_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Hash backend
+    g_signal_connect_swapped (setting_hash_combo, "changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Dedupe engine
+    g_signal_connect_swapped (setting_engine_combo, "changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+    g_signal_connect_swapped (action_engine_bench_button, "clicked",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Sub-palettes
+    g_signal_connect_swapped (setting_subpal_count_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+    g_signal_connect_swapped (setting_subpal_colors_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Viewport residency
+    g_signal_connect_swapped (setting_window_width_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+    g_signal_connect_swapped (setting_window_height_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Rooms
+    g_signal_connect_swapped (setting_rooms_width_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+    g_signal_connect_swapped (setting_rooms_height_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Metatiles
+    g_signal_connect_swapped (setting_metatile_width_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+    g_signal_connect_swapped (setting_metatile_height_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Sprite sheet mode
+    g_signal_connect_swapped (setting_sprite_mode_checkbutton, "toggled",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Tile sheet margin / spacing
+    g_signal_connect_swapped (setting_grid_margin_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+    g_signal_connect_swapped (setting_grid_spacing_spinbutton, "value-changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
+    // Locked base tile set
+    g_signal_connect_swapped (setting_base_combo, "changed",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
     // Overlay options
     g_signal_connect_swapped (setting_overlay_grid_checkbutton, "toggled",
                               G_CALLBACK(tilemap_dialog_processing_run), drawable);
@@ -595,6 +1032,10 @@ void dialog_settings_connect_signals(GimpDrawable *drawable) {
     g_signal_connect_swapped (setting_flattened_image_checkbutton, "toggled",
                               G_CALLBACK(tilemap_dialog_processing_run), drawable);
 
+    // All visible layers vs single source
+    g_signal_connect_swapped (setting_all_layers_checkbutton, "toggled",
+                              G_CALLBACK(tilemap_dialog_processing_run), drawable);
+
     // Mouse clicks on the preview image itself
     g_signal_connect_swapped (scaled_preview_window, "button-press-event",
                               G_CALLBACK(tilemap_dialog_processing_run), drawable);
@@ -722,6 +1163,17 @@ static void on_setting_flattened_image_checkbutton_changed(GtkToggleButton * p_t
 }
 
 
+static void on_setting_all_layers_checkbutton_changed(GtkToggleButton * p_togglebutton, gpointer callback_data) {
+
+    dialog_settings.all_layers = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(setting_all_layers_checkbutton));
+
+    // Preview switches between flattened and current layer, reload and redraw everything
+    dialog_source_image_free_and_reset();
+    scaled_output_invalidate();
+    tilemap_recalc_invalidate();
+}
+
+
 static void on_setting_checkflip_checkbutton_changed(GtkToggleButton * p_togglebutton, gpointer callback_data) {
 
     dialog_settings.check_flip = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(setting_checkflip_checkbutton));
@@ -730,6 +1182,153 @@ static void on_setting_checkflip_checkbutton_changed(GtkToggleButton * p_toggleb
 }
 
 
+static void on_setting_refstorage_checkbutton_changed(GtkToggleButton * p_togglebutton, gpointer callback_data) {
+
+    if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(setting_refstorage_checkbutton)))
+        dialog_settings.tile_storage_mode = TILE_STORAGE_REFERENCE;
+    else
+        dialog_settings.tile_storage_mode = TILE_STORAGE_COPY;
+
+    tilemap_recalc_invalidate();
+}
+
+
+static void on_setting_map_rle_checkbutton_changed(GtkToggleButton * p_togglebutton, gpointer callback_data) {
+
+    dialog_settings.map_rle = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(setting_map_rle_checkbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+static void on_setting_reduce_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.reduce_tile_target = gtk_spin_button_get_value_as_int(spinbutton);
+
+    tilemap_recalc_invalidate();
+}
+
+
+static void on_setting_budget_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.memory_budget_mb = gtk_spin_button_get_value_as_int(spinbutton);
+
+    tilemap_recalc_invalidate();
+}
+
+
+static void on_setting_hash_combo_changed(GtkComboBox * combo, gpointer callback_data) {
+
+    dialog_settings.hash_backend = gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
+
+    tilemap_recalc_invalidate();
+}
+
+
+// Compare hash backends on the current source image (results go to the console)
+static void on_action_hash_bench_button_clicked(GtkButton * button, gpointer callback_data) {
+
+    if (app_image.p_img_data == NULL)
+        return;
+
+    tilemap_compare_hashes(&app_image, dialog_settings.tile_width, dialog_settings.tile_height);
+}
+
+
+static void on_setting_engine_combo_changed(GtkComboBox * combo, gpointer callback_data) {
+
+    dialog_settings.dedupe_engine = gtk_combo_box_get_active(GTK_COMBO_BOX(combo));
+
+    tilemap_recalc_invalidate();
+}
+
+
+// Compare dedupe engines on the current source image (results go to the console)
+//
+// * Reprocesses on the default context, so the preview gets
+//   recalculated afterward (second "clicked" handler)
+static void on_action_engine_bench_button_clicked(GtkButton * button, gpointer callback_data) {
+
+    if (app_image.p_img_data == NULL)
+        return;
+
+    tilemap_compare_engines(&app_image, dialog_settings.tile_width, dialog_settings.tile_height,
+                            dialog_settings.check_flip);
+    tilemap_recalc_invalidate();
+}
+
+
+// Sub-palette count or size changed (shared by both spin buttons)
+static void on_setting_subpal_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.subpal_count  = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_subpal_count_spinbutton));
+    dialog_settings.subpal_colors = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_subpal_colors_spinbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+// Viewport width or height changed (shared by both spin buttons)
+static void on_setting_window_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.window_width  = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_window_width_spinbutton));
+    dialog_settings.window_height = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_window_height_spinbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+// Room width or height changed (shared by both spin buttons)
+static void on_setting_rooms_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.room_width  = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_rooms_width_spinbutton));
+    dialog_settings.room_height = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_rooms_height_spinbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+// Metatile width or height changed (shared by both spin buttons)
+static void on_setting_metatile_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.metatile_width  = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_metatile_width_spinbutton));
+    dialog_settings.metatile_height = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_metatile_height_spinbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+static void on_setting_sprite_mode_checkbutton_changed(GtkToggleButton * p_togglebutton, gpointer callback_data) {
+
+    dialog_settings.sprite_mode = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(setting_sprite_mode_checkbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+// Tile sheet margin or spacing changed (shared by both spin buttons)
+static void on_setting_grid_spinbutton_changed(GtkSpinButton * spinbutton, gpointer callback_data) {
+
+    dialog_settings.grid_margin  = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_grid_margin_spinbutton));
+    dialog_settings.grid_spacing = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(setting_grid_spacing_spinbutton));
+
+    tilemap_recalc_invalidate();
+}
+
+
+static void on_setting_base_combo_changed(GtkComboBox * combo, gpointer callback_data) {
+
+    gint drawable_id;
+
+    if (gimp_int_combo_box_get_active(GIMP_INT_COMBO_BOX(combo), &drawable_id))
+        dialog_settings.base_drawable_id = drawable_id;
+    else
+        dialog_settings.base_drawable_id = BASE_DRAWABLE_NONE;
+
+    tilemap_recalc_invalidate();
+}
+
+
 static void on_action_maptoclipboard_button_clicked(GtkButton * button, gpointer callback_data) {
     tilemap_copy_map_to_clipboard();
 }
@@ -872,10 +1471,11 @@ void tilemap_dialog_processing_run(GimpDrawable *drawable, GimpPreview  *preview
 
         // ====== CALCULATE TILE MAP & TILES ======
         if (tilemap_recalc_needed()) {
-            tilemap_calculate();
-
+            // Color map is needed during processing for tile set reduction
             tilemap_color_data_set(&app_colors);
 
+            tilemap_calculate(drawable->drawable_id);
+
             // Queue a tile map overlay redraw since the tile map info changed
             overlay_redraw_invalidate();
         }
@@ -1014,10 +1614,41 @@ static void dialog_source_image_free_and_reset(void) {
 
     app_image.p_img_data = NULL;
 
+    // Copy is only valid for the image it was built from
+    tile_major_free(&app_tile_major);
+
     app_colors.color_count = 0;
 }
 
 
+// Keep the tile-major copy of the source image in step with the current
+// tile size. Skipped when the processing settings don't gain from it, or
+// a second copy of the image would push past the memory budget, processing
+// then reads the row-major image directly
+static void dialog_source_tile_major_update(void) {
+
+    uint64_t budget_bytes;
+
+    if (!tilemap_tile_major_wanted(&app_image, dialog_settings.tile_width, dialog_settings.tile_height)) {
+        tile_major_free(&app_tile_major);
+        return;
+    }
+
+    if (tile_major_matches(&app_tile_major, &app_image, dialog_settings.tile_width, dialog_settings.tile_height))
+        return;
+
+    budget_bytes = (uint64_t)dialog_settings.memory_budget_mb * 1024 * 1024;
+
+    if ((budget_bytes != TILE_STORE_BUDGET_NONE)
+        && (((2 * app_image.size) + (2 * scaled_info_get()->size_bytes)) > budget_bytes)) {
+        tile_major_free(&app_tile_major);
+        return;
+    }
+
+    tile_major_build(&app_tile_major, &app_image, dialog_settings.tile_width, dialog_settings.tile_height);
+}
+
+
 // TODO: move this and above into a separate file
 static gint dialog_source_image_load(GimpDrawable * drawable_layer) {
 
@@ -1030,13 +1661,14 @@ static gint dialog_source_image_load(GimpDrawable * drawable_layer) {
     GimpDrawable * source_drawable;
     size_t         alloc_size;
 
-    printf("Source Image: Loading (flattened=%d)...\n", dialog_settings.flattened_image);
+    printf("Source Image: Loading (flattened=%d, all layers=%d)...\n", dialog_settings.flattened_image, dialog_settings.all_layers);
 
     temp_image_id = 0;
 
     // SOURCE IMAGE: Use either layer passed to the plugin, or a
     //               flattened copy of the entire image (default)
-    if (dialog_settings.flattened_image) {
+    //               All-layers mode always previews the layer passed in
+    if (dialog_settings.flattened_image && !dialog_settings.all_layers) {
         // Make a copy of the current image, merge all layers, then retrieve the drawable
         temp_image_id         = gimp_image_duplicate(image_id);
         temp_flattened_layer  = gimp_image_merge_visible_layers(temp_image_id, GIMP_CLIP_TO_IMAGE);
@@ -1062,14 +1694,14 @@ static gint dialog_source_image_load(GimpDrawable * drawable_layer) {
     // Determine the array size for the app's image then allocate it
     app_image.width      = width;
     app_image.height     = height;
-    app_image.size       = app_image.width * app_image.height * app_image.bytes_per_pixel;
+    app_image.size       = (uint64_t)app_image.width * app_image.height * app_image.bytes_per_pixel;
 
     // Source image buffer allocated with 32 bit alignment
     // app_image.p_img_data = (uint8_t *) g_new (guint32, app_image.width * app_image.height);
 
     // aligned_alloc expects SIZE to be a multiple of ALIGNMENT, so pad with a couple bytes if needed
     alloc_size = app_image.size + (app_image.size % sizeof(uint32_t));
-    printf(" (allocating %zu bytes %" PRId32 " %zu) \n", alloc_size, app_image.size, (app_image.size % sizeof(uint32_t)));
+    printf(" (allocating %zu bytes %" PRIu64 " %zu) \n", alloc_size, app_image.size, (app_image.size % sizeof(uint32_t)));
 
     app_image.p_img_data = (uint8_t *)aligned_alloc(sizeof(uint32_t), app_image.size);
 
@@ -1140,9 +1772,62 @@ static gint dialog_source_colormap_load(GimpDrawable * drawable) {
 
 
 
+// Hand the selected base tile set layer to the library when the selection changed
+//
+// * Pixels are only fetched once per selection, the library keeps a private
+//   copy and rebuilds its index only when the pixels or tile format change
+// * Any layer of any open image works, it must match the source bit depth
+static void dialog_base_image_update(void) {
+
+    static gint32  base_loaded_id = BASE_DRAWABLE_NONE;
+    GimpDrawable * base_drawable;
+    GimpPixelRgn   base_rgn;
+    image_data     base_img;
+
+    if (dialog_settings.base_drawable_id == base_loaded_id)
+        return;
+
+    base_loaded_id = dialog_settings.base_drawable_id;
+
+    if ((base_loaded_id == BASE_DRAWABLE_NONE) || !gimp_item_is_valid(base_loaded_id)) {
+        tilemap_base_set(NULL);
+        return;
+    }
+
+    base_drawable = gimp_drawable_get(base_loaded_id);
+
+    base_img.bytes_per_pixel = base_drawable->bpp;
+    base_img.width           = base_drawable->width;
+    base_img.height          = base_drawable->height;
+    base_img.size            = (uint64_t)base_img.width * base_img.height * base_img.bytes_per_pixel;
+    base_img.p_img_data      = (uint8_t *)malloc(base_img.size);
+
+    if (base_img.p_img_data) {
+        gimp_pixel_rgn_init (&base_rgn,
+                             base_drawable,
+                             0, 0,
+                             base_img.width, base_img.height,
+                             FALSE, FALSE);
+
+        gimp_pixel_rgn_get_rect (&base_rgn,
+                                 (guchar *) base_img.p_img_data,
+                                 0, 0, base_img.width, base_img.height);
+
+        if (!tilemap_base_set(&base_img))
+            printf("Base: Loading layer %d -> FAILED\n", base_loaded_id);
+
+        free(base_img.p_img_data);
+    }
+    else
+        tilemap_base_set(NULL);
+
+    gimp_drawable_detach(base_drawable);
+}
+
+
 // TODO: variable tile size (push down via app settings?)
 //  gint image_id, gint drawable_id, gint image_mode)
-void tilemap_calculate(void) {
+void tilemap_calculate(gint32 drawable_id) {
 
     gint status;
 
@@ -1150,10 +1835,42 @@ void tilemap_calculate(void) {
 
     if (tilemap_recalc_needed()) {
         // printf("Tilemap: Starting Recalc: tilemap_recalc_needed() = %d\n\n", tilemap_recalc_needed());
-        status = tilemap_export_process(&app_image,
-                                        dialog_settings.tile_width,
-                                        dialog_settings.tile_height,
-                                        dialog_settings.check_flip);
+        tilemap_storage_mode_set(dialog_settings.tile_storage_mode);
+        tilemap_reduce_target_set(dialog_settings.reduce_tile_target);
+        tilemap_map_rle_set(dialog_settings.map_rle);
+        tilemap_hash_backend_set(dialog_settings.hash_backend);
+        tilemap_dedupe_engine_set(dialog_settings.dedupe_engine);
+        tilemap_subpal_set(dialog_settings.subpal_count, dialog_settings.subpal_colors);
+        tilemap_window_set(dialog_settings.window_width, dialog_settings.window_height);
+        tilemap_rooms_set(dialog_settings.room_width, dialog_settings.room_height);
+        tilemap_metatile_set(dialog_settings.metatile_width, dialog_settings.metatile_height);
+        tilemap_grid_set(dialog_settings.grid_margin, dialog_settings.grid_spacing);
+        dialog_base_image_update();
+
+        // Tile size may have changed since the source image was loaded
+        dialog_source_tile_major_update();
+        tilemap_tile_major_set(&app_tile_major);
+
+        // Source image (and its tile-major copy) and both preview buffers count against the budget
+        tilemap_memory_budget_set((uint64_t)dialog_settings.memory_budget_mb * 1024 * 1024,
+                                  app_image.size + app_tile_major.img.size + (2 * scaled_info_get()->size_bytes));
+
+        if (dialog_settings.sprite_mode) {
+            // Sprites replace the tile set and map, the all layers setting doesn't apply
+            tilemap_layers_free();
+
+            status = tilemap_sprites_process(&app_image, dialog_settings.check_flip);
+        }
+        else if (dialog_settings.all_layers)
+            status = tilemap_calculate_all_layers(drawable_id);
+        else {
+            tilemap_layers_free();
+
+            status = tilemap_export_process(&app_image,
+                                            dialog_settings.tile_width,
+                                            dialog_settings.tile_height,
+                                            dialog_settings.check_flip);
+        }
 
         // TODO: warn/notify on failure (invalid tile size, etc)
       if (!status)
@@ -1167,12 +1884,246 @@ void tilemap_calculate(void) {
 }
 
 
+// Build a map for every visible layer against one shared tile set
+//
+// * Layers are fetched from GIMP here (bottom to top, so the background
+//   gets the lowest tile IDs) while the tilemap_layers worker thread
+//   hashes and registers the layers fetched so far
+// * Layers must match the size and bit depth of the previewed layer,
+//   others are skipped. Layer offsets are ignored.
+// * The previewed layer's map becomes the main map
+static gint tilemap_calculate_all_layers(gint32 drawable_id) {
+
+    gint         * p_layer_ids;
+    gint           num_layers;
+    gint           idx;
+    gchar        * p_layer_name;
+    GimpDrawable * layer_drawable;
+    GimpPixelRgn   layer_rgn;
+    image_data     layer_img;
+
+    if (app_image.p_img_data == NULL)
+        return FALSE;
+
+    if (!tilemap_layers_begin(&app_image,
+                              dialog_settings.tile_width,
+                              dialog_settings.tile_height,
+                              dialog_settings.check_flip))
+        return FALSE;
+
+    p_layer_ids = gimp_image_get_layers(image_id, &num_layers);
+
+    for (idx = num_layers - 1; idx >= 0; idx--) {
+
+        if (!gimp_item_get_visible(p_layer_ids[idx]) || gimp_item_is_group(p_layer_ids[idx]))
+            continue;
+
+        layer_drawable = gimp_drawable_get(p_layer_ids[idx]);
+
+        if ((layer_drawable->width  == app_image.width) &&
+            (layer_drawable->height == app_image.height) &&
+            (layer_drawable->bpp    == app_image.bytes_per_pixel)) {
+
+            layer_img.bytes_per_pixel = layer_drawable->bpp;
+            layer_img.width           = layer_drawable->width;
+            layer_img.height          = layer_drawable->height;
+            layer_img.size            = (uint64_t)layer_img.width * layer_img.height * layer_img.bytes_per_pixel;
+            layer_img.p_img_data      = (uint8_t *)aligned_alloc(sizeof(uint32_t),
+                                                     layer_img.size + (layer_img.size % sizeof(uint32_t)));
+
+            if (layer_img.p_img_data) {
+                gimp_pixel_rgn_init (&layer_rgn,
+                                     layer_drawable,
+                                     0, 0,
+                                     layer_img.width, layer_img.height,
+                                     FALSE, FALSE);
+
+                gimp_pixel_rgn_get_rect (&layer_rgn,
+                                         (guchar *) layer_img.p_img_data,
+                                         0, 0, layer_img.width, layer_img.height);
+
+                // Hand the layer to the worker, then go fetch the next one
+                p_layer_name = gimp_item_get_name(p_layer_ids[idx]);
+                tilemap_layers_submit(&layer_img, p_layer_ids[idx], p_layer_name);
+                g_free(p_layer_name);
+            }
+        }
+        else
+            printf("Layers: Skipping layer %d (size or bit depth differs from preview)\n", p_layer_ids[idx]);
+
+        gimp_drawable_detach(layer_drawable);
+    }
+
+    g_free(p_layer_ids);
+
+    return tilemap_layers_finish(drawable_id);
+}
+
+
 static void dialog_ui_update(void) {
 
     // If Tilemap calculation succeeded, enable copy-to-clipboard button, otherwise disable
     gtk_widget_set_sensitive(action_maptoclipboard_button, (tilemap_recalc_needed() == FALSE));
 
     info_display_update();
+    layer_info_display_update();
+    rooms_info_display_update();
+    sprites_info_display_update();
+}
+
+
+static void layer_info_display_update(void) {
+
+    uint32_t         idx;
+    layer_map_data * p_layer;
+    GString        * p_info_str;
+    gchar          * p_line_str;
+
+    if (!dialog_settings.all_layers || tilemap_recalc_needed() || (tilemap_layers_get_count() == 0)) {
+        gtk_label_set_markup(GTK_LABEL(layer_info_display), "");
+        return;
+    }
+
+    p_info_str = g_string_new("<b>Layers</b>  (shared tile set)\n<span font_family='monospace'>");
+
+    for (idx = 0; idx < tilemap_layers_get_count(); idx++) {
+
+        p_layer = tilemap_layers_get(idx);
+
+        // Layer names are user text, so escape them for markup
+        p_line_str = g_markup_printf_escaped("%-20.20s  Used Tiles:%5d   New Tiles:%5d   Map:%4d x %-4d\n",
+                                             p_layer->name,
+                                             p_layer->tiles_used,
+                                             p_layer->tiles_new,
+                                             p_layer->map.width_in_tiles, p_layer->map.height_in_tiles);
+        g_string_append(p_info_str, p_line_str);
+        g_free(p_line_str);
+    }
+
+    g_string_append(p_info_str, "</span>");
+
+    gtk_label_set_markup(GTK_LABEL(layer_info_display), p_info_str->str);
+    g_string_free(p_info_str, TRUE);
+}
+
+
+#define ROOMS_INFO_LINES_MAX 8
+
+// Room and its size in bytes, for listing the largest rooms first
+typedef struct {
+    guint32 index;
+    uint64_t size_bytes;
+} room_info_entry;
+
+
+static gint room_info_entry_compare(gconstpointer p_a, gconstpointer p_b, gpointer user_data) {
+
+    const room_info_entry * p_entry_a = p_a;
+    const room_info_entry * p_entry_b = p_b;
+
+    // Largest first, then in map order
+    if (p_entry_a->size_bytes != p_entry_b->size_bytes)
+        return (p_entry_a->size_bytes < p_entry_b->size_bytes) ? 1 : -1;
+
+    return (p_entry_a->index > p_entry_b->index) - (p_entry_a->index < p_entry_b->index);
+}
+
+
+// Largest rooms first (tile set + map bytes), so the ones
+// over budget show up without scrolling through every room
+static void rooms_info_display_update(void) {
+
+    tile_rooms_data * p_rooms;
+    tile_set_data   * p_tile_set;
+    tile_room_data  * p_room;
+    room_info_entry * p_entries;
+    GString         * p_info_str;
+    gchar           * p_line_str;
+    guint32           idx;
+    gint              final_bitsperpixel;
+
+    p_rooms    = tilemap_get_rooms();
+    p_tile_set = tilemap_get_tile_set();
+
+    if (tilemap_recalc_needed() || (p_rooms->count == 0)) {
+        gtk_label_set_markup(GTK_LABEL(rooms_info_display), "");
+        return;
+    }
+
+    // Same bits-per-pixel as the memory info
+    if (dialog_settings.finalbpp == 0)
+        final_bitsperpixel = p_tile_set->tile_bytes_per_pixel * 8;
+    else
+        final_bitsperpixel = dialog_settings.finalbpp;
+
+    p_entries = g_new(room_info_entry, p_rooms->count);
+
+    for (idx = 0; idx < p_rooms->count; idx++) {
+        p_room = &p_rooms->p_rooms[idx];
+
+        // Local map uses u8 entries when the room has few enough tiles, otherwise u16
+        p_entries[idx].index      = idx;
+        p_entries[idx].size_bytes = (((uint64_t)p_tile_set->tile_width * p_tile_set->tile_height
+                                      * final_bitsperpixel * p_room->tile_count) / 8)
+                                    + ((uint64_t)p_room->width * p_room->height
+                                       * ((p_room->tile_count > 255) ? sizeof(uint16_t) : sizeof(uint8_t)));
+    }
+
+    g_qsort_with_data(p_entries, p_rooms->count, sizeof(room_info_entry), room_info_entry_compare, NULL);
+
+    p_info_str = g_string_new(NULL);
+    g_string_append_printf(p_info_str,
+                           "<b>Rooms</b>  (%d x %d tiles, %d rooms, %d tiles shared between rooms)\n"
+                           "<span font_family='monospace'>",
+                           p_rooms->room_width, p_rooms->room_height, p_rooms->count, p_rooms->tiles_shared);
+
+    for (idx = 0; (idx < p_rooms->count) && (idx < ROOMS_INFO_LINES_MAX); idx++) {
+
+        p_room = &p_rooms->p_rooms[p_entries[idx].index];
+
+        p_line_str = g_markup_printf_escaped("Room %3d,%-3d  Tiles:%5d   Shared:%5d   Bytes:%'8" PRIu64 "\n",
+                                             p_room->x / p_rooms->room_width, p_room->y / p_rooms->room_height,
+                                             p_room->tile_count,
+                                             p_room->tiles_shared,
+                                             p_entries[idx].size_bytes);
+        g_string_append(p_info_str, p_line_str);
+        g_free(p_line_str);
+    }
+
+    if (p_rooms->count > ROOMS_INFO_LINES_MAX)
+        g_string_append_printf(p_info_str, "... %d smaller rooms\n", p_rooms->count - ROOMS_INFO_LINES_MAX);
+
+    g_string_append(p_info_str, "</span>");
+
+    gtk_label_set_markup(GTK_LABEL(rooms_info_display), p_info_str->str);
+    g_string_free(p_info_str, TRUE);
+    g_free(p_entries);
+}
+
+
+
+// Unique sprites, placements and the pixel bytes of the unique set
+static void sprites_info_display_update(void) {
+
+    tile_sprites_data * p_sprites;
+
+    p_sprites = tilemap_get_sprites();
+
+    if (tilemap_recalc_needed() || !dialog_settings.sprite_mode) {
+        gtk_label_set_markup(GTK_LABEL(sprites_info_display), "");
+        return;
+    }
+
+    gtk_label_set_markup(GTK_LABEL(sprites_info_display),
+         g_markup_printf_escaped(
+            "<b>Sprites</b>\n"
+            "<span font_family='monospace'>"
+                "Placed: %6d   Unique: %6d   Pixel Bytes: %'8zu"
+            "</span>"
+            ,
+            p_sprites->placement_count,
+            p_sprites->count,
+            p_sprites->pixels_size));
 }
 
 
@@ -1185,6 +2136,11 @@ static void info_display_update(void) {
 
     gint final_bitsperpixel;
     gint tilemap_storage_size;
+    gint tile_colors_max;
+    gchar subpal_str[16];
+    gchar window_str[16];
+    gchar metatile_str[16];
+    guint32 c;
 
     // TODO: FIXME: implement better handling for valid map data (tilemap_is_valid()?)
     // TODO: maybe display "no valid data" when no valid tile map calculated (or maybe not, since it's less startling when comparing tile sizes)
@@ -1204,6 +2160,38 @@ static void info_display_update(void) {
             final_bitsperpixel = dialog_settings.finalbpp;
 
 
+        // Most colors used by any one tile (sub-palette size needed)
+        tile_colors_max = 0;
+        for (c = 0; c < p_tile_set->tile_count; c++)
+            if (p_tile_set->tiles[c].stats.color_count > tile_colors_max)
+                tile_colors_max = p_tile_set->tiles[c].stats.color_count;
+
+
+        // Sub-palettes used / available, "!" when the tiles don't fit
+        if (p_tile_set->subpal.count_max == 0)
+            g_snprintf(subpal_str, sizeof(subpal_str), "off");
+        else
+            g_snprintf(subpal_str, sizeof(subpal_str), "%s%d/%d",
+                       ((p_tile_set->subpal.count > p_tile_set->subpal.count_max) || p_tile_set->subpal.tiles_unfit) ? "!" : "",
+                       p_tile_set->subpal.count, p_tile_set->subpal.count_max);
+
+
+        // Most unique tiles in any viewport sized window (location shown in the overlay)
+        if (p_map->window.view_width == WINDOW_VIEW_NONE)
+            g_snprintf(window_str, sizeof(window_str), "off");
+        else
+            g_snprintf(window_str, sizeof(window_str), "%d", p_map->window.peak_count);
+
+
+        // Unique metatiles, "n/a" when the map isn't a multiple of the block size
+        if (p_map->metatiles.block_width == METATILE_SIZE_NONE)
+            g_snprintf(metatile_str, sizeof(metatile_str), "off");
+        else if (!p_map->metatiles.p_map)
+            g_snprintf(metatile_str, sizeof(metatile_str), "n/a");
+        else
+            g_snprintf(metatile_str, sizeof(metatile_str), "%d", p_map->metatiles.count);
+
+
         // Use u8 for tilemap array when possible, otherwise u16
         if (p_tile_set->tile_count > 255) // || (p_map->width_in_tiles > 255) || (p_map->height_in_tiles > 255))
             tilemap_storage_size = sizeof(uint16_t);
@@ -1220,13 +2208,25 @@ static void info_display_update(void) {
                     "\n"
                     "Map # Tiles:   %4d\n"
                     "Unique # Tiles:%4d\n"
+                    "Locked # Tiles:%4d\n"
+                    "Merged # Tiles:%4d\n"
+                    "Max Colors:    %4d\n"
+                    "Sub-Palettes:%6s\n"
+                    "Peak in View:%6s\n"
+                    "Metatiles:   %6s\n"
                 "</span>"
                  ,
                  p_map->tile_width,     p_map->tile_height,
                  p_map->width_in_tiles, p_map->height_in_tiles,
                  p_map->map_width,      p_map->map_height,
                  (p_map->width_in_tiles * p_map->height_in_tiles),
-                 p_tile_set->tile_count));
+                 p_tile_set->tile_count,
+                 p_tile_set->tile_count_locked,
+                 (p_tile_set->tile_count_unreduced) ? (p_tile_set->tile_count_unreduced - p_tile_set->tile_count) : 0,
+                 tile_colors_max,
+                 subpal_str,
+                 window_str,
+                 metatile_str));
 
         gtk_label_set_markup(GTK_LABEL(memory_info_display),
              g_markup_printf_escaped(
@@ -1235,8 +2235,11 @@ static void info_display_update(void) {
                    "Tile: %'6d\n"
                    "Tile Set: %'6d\n"
                    "Map Entry: %'6d\n"
-                   "Map Total: %'6d\n"
-                   "Map + Tiles: %'6d"
+                   "Map Total: %'6" PRIu64 "\n"
+                   "Map + Tiles: %'6" PRIu64 "\n"
+                   "Map RAM: %'6" PRIu64 " (RLE %'" PRIu64 ")\n"
+                   "Spilled: %'6" PRIu64 "\n"
+                   "Peak RSS: %'6" PRIu64
                 "</span>"
                 ,
                 // Tile Bytes
@@ -1245,10 +2248,16 @@ static void info_display_update(void) {
                 ((p_map->tile_width * p_map->tile_height) * final_bitsperpixel * p_tile_set->tile_count) / 8,  // / 8 bits per byte
                 // Tile Map Var Size & Tile Map Bytes
                 tilemap_storage_size,
-                (p_map->width_in_tiles * p_map->height_in_tiles) * tilemap_storage_size,
+                ((uint64_t)p_map->width_in_tiles * p_map->height_in_tiles) * tilemap_storage_size,
                 // Total Bytes
                 (((p_map->tile_width * p_map->tile_height) * final_bitsperpixel * p_tile_set->tile_count) / 8)  // / 8 bits per byte
-                 + ((p_map->width_in_tiles * p_map->height_in_tiles) * tilemap_storage_size)
+                 + (((uint64_t)p_map->width_in_tiles * p_map->height_in_tiles) * tilemap_storage_size),
+                // In-memory map: flat packed size vs run-length rows
+                tilemap_map_get_flat_size_bytes(p_map),
+                p_map->rle_size_bytes,
+                // Tile pixels spilled to disk and peak resident memory of the plug-in
+                tile_store_get_spilled_bytes(&p_tile_set->store),
+                benchmark_get_peak_rss()
                  ));
     } // end: if (tilemap_recalc_needed() == FALSE) {
     else {
@@ -1258,7 +2267,7 @@ static void info_display_update(void) {
         // Padding at the end of the printout to keep widget text height constant
         gtk_label_set_markup(GTK_LABEL(memory_info_display),
             g_markup_printf_escaped("<b>Memory Info (in bytes)</b>\n"
-                                    "<span font_family='monospace'>\n\n\n\n\n\n</span>"));
+                                    "<span font_family='monospace'>\n\n\n\n\n\n\n\n\n\n\n</span>"));
 
     }
 
@@ -1277,6 +2286,10 @@ static void tilemap_copy_map_to_clipboard(void) {
     char            * map_text_str;
     uint32_t        map_text_len;
 
+    uint32_t         layer_idx, layer_count;
+    layer_map_data * p_layer;
+    gchar            layer_prefix_str[MAP_PREFIX_MAX_LEN + 16];
+
 
     if (tilemap_recalc_needed() == FALSE) {
 
@@ -1287,23 +2300,67 @@ static void tilemap_copy_map_to_clipboard(void) {
             p_map      = tilemap_get_map();
             p_tile_set = tilemap_get_tile_set();
 
-            switch (dialog_settings.maptoclipboard_type) {
-                case EXPORT_COPY_TYPE_C:
-                    map_text_len = tilemap_export_c_source_to_string(map_text_str,
-                                                                     TILEMAP_MAX_STR,
-                                                                     dialog_settings.maptoclipboard_prefix_str,
-                                                                     p_map,
-                                                                     p_tile_set);
-                    break;
+            // All-layers mode exports every layer's map, each with its own prefix
+            layer_count = (dialog_settings.all_layers) ? tilemap_layers_get_count() : 0;
+
+            // Sprite sheet mode exports the sprite list and placements instead of a map
+            if (dialog_settings.sprite_mode)
+                layer_count = 0;
+
+            map_text_len = 0;
+            layer_idx    = 0;
 
-                case EXPORT_COPY_TYPE_ASM_RGBDS:
-                    map_text_len = tilemap_export_asm_rgbds_source_to_string(map_text_str,
-                                                                     TILEMAP_MAX_STR,
-                                                                     dialog_settings.maptoclipboard_prefix_str,
-                                                                     p_map,
-                                                                     p_tile_set);
+            do {
+                if (layer_count) {
+                    p_layer = tilemap_layers_get(layer_idx);
+                    p_map   = &p_layer->map;
+                    snprintf(layer_prefix_str, sizeof(layer_prefix_str), "%s_layer%d",
+                             dialog_settings.maptoclipboard_prefix_str, layer_idx);
+                }
+                else
+                    snprintf(layer_prefix_str, sizeof(layer_prefix_str), "%s",
+                             dialog_settings.maptoclipboard_prefix_str);
+
+                if (map_text_len >= TILEMAP_MAX_STR)
                     break;
-            }
+
+                if (dialog_settings.sprite_mode) {
+                    if (dialog_settings.maptoclipboard_type == EXPORT_COPY_TYPE_ASM_RGBDS)
+                        map_text_len += tilemap_export_asm_rgbds_sprites_to_string(map_text_str + map_text_len,
+                                                                                   TILEMAP_MAX_STR - map_text_len,
+                                                                                   layer_prefix_str,
+                                                                                   tilemap_get_sprites());
+                    else
+                        map_text_len += tilemap_export_c_sprites_to_string(map_text_str + map_text_len,
+                                                                           TILEMAP_MAX_STR - map_text_len,
+                                                                           layer_prefix_str,
+                                                                           tilemap_get_sprites());
+                }
+                else {
+                    switch (dialog_settings.maptoclipboard_type) {
+                        case EXPORT_COPY_TYPE_C:
+                            map_text_len += tilemap_export_c_source_to_string(map_text_str + map_text_len,
+                                                                              TILEMAP_MAX_STR - map_text_len,
+                                                                              layer_prefix_str,
+                                                                              p_map,
+                                                                              p_tile_set);
+                            break;
+
+                        case EXPORT_COPY_TYPE_ASM_RGBDS:
+                            map_text_len += tilemap_export_asm_rgbds_source_to_string(map_text_str + map_text_len,
+                                                                              TILEMAP_MAX_STR - map_text_len,
+                                                                              layer_prefix_str,
+                                                                              p_map,
+                                                                              p_tile_set);
+                            break;
+                    }
+                }
+
+                layer_idx++;
+            } while (layer_idx < layer_count);
+
+            if (map_text_len > TILEMAP_MAX_STR)
+                map_text_len = TILEMAP_MAX_STR - 1; // Output was cropped
 
 
             if (map_text_len) {
@@ -1327,8 +2384,17 @@ static void tilemap_render_overlay(void) {
     p_map      = tilemap_get_map();
     p_tile_set = tilemap_get_tile_set();
 
-    if (p_tile_set->tile_count > 0)
-        tilemap_overlay_apply(p_map->size, p_map->tile_id_list);
+    // Error list is only present when the tile set was reduced
+    tilemap_overlay_set_error_list(p_map->tile_error_list, p_map->tile_error_max);
+
+    // Heat strips are only present when the viewport analysis ran
+    tilemap_overlay_set_window((p_map->window.view_width != WINDOW_VIEW_NONE) ? &p_map->window : NULL);
+
+    // Overlay draws packed tiles only, not a margin / spacing layout
+    if (tile_grid_is_set(&p_map->grid))
+        printf("Overlay: Render -> skipped for margin / spacing grid\n");
+    else if (p_tile_set->tile_count > 0)
+        tilemap_overlay_apply(p_map);
     else
         printf("Overlay: Render tilenums -> NO TILES FOUND!\n");
 }
@@ -1373,16 +2439,18 @@ static void tilemap_preview_highlight_tiles_on_mouseclick(gint x, gint y, GtkAll
             if (p_tile_set->tile_count > 0) {
 
                 // Get position on tile map and relevant info for tile
-                map_tile_x = (img_x / scaled_output->scale_factor) / p_map->tile_width;
-                map_tile_y = (img_y / scaled_output->scale_factor) / p_map->tile_height;
+                // (nothing to highlight over the margin or spacing between tiles)
+                if (tile_grid_find_cell(p_map, img_x / scaled_output->scale_factor, img_y / scaled_output->scale_factor,
+                                        &map_tile_x, &map_tile_y)) {
 
-                map_tile_idx = map_tile_x + (map_tile_y * p_map->width_in_tiles );
+                    map_tile_idx = map_tile_x + (map_tile_y * p_map->width_in_tiles );
 
-                tile_id = p_map->tile_id_list[map_tile_idx];
+                    tile_id = tilemap_map_get_id(p_map, map_tile_idx);
 
-                tilemap_overlay_set_highlight_tile(tile_id);
+                    tilemap_overlay_set_highlight_tile(tile_id);
 
-                overlay_redraw_invalidate();
+                    overlay_redraw_invalidate();
+                }
             }
 
         } else {
@@ -1432,15 +2500,17 @@ static void tilemap_preview_display_tilenum_on_mouseover(gint x, gint y, GtkAllo
         if ((img_x >= 0) && (img_x < scaled_output->width) &&
             (img_y >= 0) && (img_y < scaled_output->height)) {
 
-            if (p_tile_set->tile_count > 0) {
+            if ((p_tile_set->tile_count > 0)
+                && !tile_grid_find_cell(p_map, img_x / scaled_output->scale_factor, img_y / scaled_output->scale_factor,
+                                        &map_tile_x, &map_tile_y))
+                gtk_label_set_markup(GTK_LABEL(mouse_hover_display),
+                     g_markup_printf_escaped("  ( Margin / spacing, not part of a tile )" ) );
+            else if (p_tile_set->tile_count > 0) {
 
                 // Get position on tile map and relevant info for tile
-                map_tile_x = (img_x / scaled_output->scale_factor) / p_map->tile_width;
-                map_tile_y = (img_y / scaled_output->scale_factor) / p_map->tile_height;
-
                 map_tile_idx = map_tile_x + (map_tile_y * p_map->width_in_tiles );
 
-                tile_id = p_map->tile_id_list[map_tile_idx];
+                tile_id = tilemap_map_get_id(p_map, map_tile_idx);
 
                 scale_output_get_rgb_at_xy(img_x, img_y, &r, &g, &b);
 
@@ -1448,16 +2518,21 @@ static void tilemap_preview_display_tilenum_on_mouseover(gint x, gint y, GtkAllo
                             g_markup_printf_escaped(" x,y: (%4d ,%-4d)"
                                                     "     Map Tile x,y: (%4d , %-4d)"
                                                     "     Map Tile #: %-8d"
-                                                    "    Tile ID: %d %s (%d uses)"
+                                                    "    Tile ID: %d %s (%d uses, %d colors%s, pal %d)"
                                                     "       RGB(%d,%d,%d)"
+                                                    "    Merge Error: %d"
                                                     , img_x / scaled_output->scale_factor
                                                     , img_y / scaled_output->scale_factor
                                                     , map_tile_x, map_tile_y
                                                     , map_tile_idx
                                                     , tile_id
-                                                    , tile_flip_str[p_map->tile_attribs_list[map_tile_idx]]
+                                                    , tile_flip_str[tilemap_map_get_attribs(p_map, map_tile_idx)]
                                                     , p_tile_set->tiles[tile_id].map_entry_count
+                                                    , p_tile_set->tiles[tile_id].stats.color_count
+                                                    , (p_tile_set->tiles[tile_id].stats.flags & TILE_STATS_TRANSPARENT) ? " + transparent" : ""
+                                                    , p_tile_set->tiles[tile_id].sub_palette
                                                     , r, g, b
+                                                    , (p_map->tile_error_list) ? p_map->tile_error_list[map_tile_idx] : 0
                                                     ) );
             }
             else gtk_label_set_markup(GTK_LABEL(mouse_hover_display),
@@ -1475,4 +2550,5 @@ static void tilemap_preview_display_tilenum_on_mouseover(gint x, gint y, GtkAllo
 void dialog_free_resources(void) {
 
     dialog_source_image_free_and_reset();
+    tilemap_layers_free();
 }
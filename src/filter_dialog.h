@@ -16,6 +16,8 @@
 
     #define MAP_PREFIX_MAX_LEN 50
 
+    #define MEMORY_BUDGET_MB_MAX 65536
+
     #define ARRAY_LEN(x)  (int)(sizeof(x) / sizeof((x)[0]))
 
 
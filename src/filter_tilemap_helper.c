@@ -20,6 +20,7 @@
 #include "filter_dialog.h"
 #include "scale.h"
 #include "lib_tilemap.h"
+#include "tilemap_pool.h"
 #include "filter_image.h"
 
 
@@ -27,6 +28,9 @@ const char PLUG_IN_PROCEDURE[] = "filter-tilemap-proc";
 const char PLUG_IN_ROLE[]      = "gimp-tilemap-helper";
 const char PLUG_IN_BINARY[]    = "plugin-gimp-tilemap-helper";
 
+// Built base tile set index, kept for the rest of the GIMP session
+const char PLUG_IN_BASE_INDEX_DATA[] = "filter-tilemap-proc-base-index";
+
 
 // Predeclare entrypoints
 static void query(void);
@@ -57,6 +61,25 @@ static PluginTileMapVals plugin_config_vals =
   0,  // gint check_flip;
   0,  // gint maptoclipboard_type;
   "map", // gchar maptoclipboard_prefix_str[MAP_PREFIX_MAX_LEN + 1];
+  1,  // gint tile_storage_mode; (TILE_STORAGE_REFERENCE)
+  0,  // gint reduce_tile_target; (REDUCE_TARGET_NONE)
+  0,  // gint all_layers;
+  0,  // gint memory_budget_mb; (TILE_STORE_BUDGET_NONE)
+  0,  // gint map_rle;
+  0,  // gint hash_backend; (TILE_HASH_AUTO)
+  0,  // gint dedupe_engine; (TILE_ENGINE_INCREMENTAL)
+  0,  // gint subpal_count; (SUBPAL_COUNT_NONE)
+  4,  // gint subpal_colors; (SUBPAL_COLORS_DEFAULT)
+  0,  // gint window_width; (WINDOW_VIEW_NONE)
+  18, // gint window_height; (WINDOW_VIEW_HEIGHT_DEFAULT)
+  0,  // gint room_width; (ROOMS_SIZE_NONE)
+  18, // gint room_height; (ROOMS_HEIGHT_DEFAULT)
+  0,  // gint metatile_width; (METATILE_SIZE_NONE)
+  2,  // gint metatile_height; (METATILE_HEIGHT_DEFAULT)
+  0,  // gint sprite_mode; (SPRITES_NONE)
+  0,  // gint grid_margin; (GRID_MARGIN_NONE)
+  0,  // gint grid_spacing; (GRID_SPACING_NONE)
+  -1, // gint base_drawable_id; (BASE_DRAWABLE_NONE)
 };
 
 
@@ -98,6 +121,39 @@ static void query(void)
 
 
 
+// Hand a base tile set index saved earlier in this GIMP session back to the library
+//
+// * The library checks it against the base image and tile format before use
+//   and rebuilds it if anything changed, so a stale index is harmless
+static void base_index_restore(void) {
+
+    gint       size_bytes;
+    uint8_t  * p_data;
+
+    size_bytes = gimp_get_data_size(PLUG_IN_BASE_INDEX_DATA);
+    if (size_bytes <= 0)
+        return;
+
+    p_data = g_malloc(size_bytes);
+    if (gimp_get_data(PLUG_IN_BASE_INDEX_DATA, p_data))
+        tilemap_base_index_set(p_data, size_bytes);
+    g_free(p_data);
+}
+
+
+// Keep the library's built base tile set index for later runs in this GIMP session
+static void base_index_save(void) {
+
+    const uint8_t * p_data;
+    size_t          size_bytes;
+
+    p_data = tilemap_base_index_get(&size_bytes);
+    if (p_data)
+        gimp_set_data(PLUG_IN_BASE_INDEX_DATA, p_data, size_bytes);
+}
+
+
+
 // Create deduplicated tileset if requested when the user closed the dialog
 static void handle_tileset_create(gint * nreturn_vals, GimpParam * return_values) {
 
@@ -161,6 +217,9 @@ printf("================================= Filter Main: run mode=%d  image_id = %
     scale_init();
     tilemap_dialog_imageid_set(image_id);
 
+    // Worker threads shared by all processing stages for this session
+    tilemap_pool_init(TILEMAP_POOL_THREADS_AUTO);
+
 
     switch (run_mode) {
         case GIMP_RUN_INTERACTIVE:
@@ -178,15 +237,23 @@ printf("================================= Filter Main: run mode=%d  image_id = %
             // Set settings/config in dialog
             tilemap_dialog_settings_set(&plugin_config_vals);
 
+            // Reuse the base tile set index built by an earlier run, if any
+            base_index_restore();
+
             //  Open the dialog
             dialog_response = tilemap_dialog_show (drawable);
 
+            // Keep the (possibly new) base tile set index for later runs
+            base_index_save();
+
             // Handle response from dialog (which button the user pressed)
             switch (dialog_response) {
                 case GTK_RESPONSE_CANCEL: // Do nothing, exit
+                                          tilemap_pool_shutdown();
                                           return;
 
                 case GTK_RESPONSE_APPLY:  handle_tileset_create(nreturn_vals, return_values);
+                                          tilemap_pool_shutdown();
                                           return; // No more to do, exit plugin
 
                 case GTK_RESPONSE_OK:     // Shim reponse.. continue below (TODO: move "keep settings" handling up here)
@@ -281,6 +348,7 @@ printf("================================= Filter Main: run mode=%d  image_id = %
 
     dialog_free_resources();
     tilemap_free_resources();
+    tilemap_pool_shutdown();
 }
 
 
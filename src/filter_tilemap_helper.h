@@ -7,6 +7,8 @@
 
     #define MAP_PREFIX_MAX_LEN 50
 
+    #define BASE_DRAWABLE_NONE -1  // No base tile set layer selected
+
     typedef struct
     {
         gint  tile_width;
@@ -26,6 +28,44 @@
 
         gchar maptoclipboard_prefix_str[MAP_PREFIX_MAX_LEN + 1];
 
+        gint  tile_storage_mode;
+
+        gint  reduce_tile_target;
+
+        gint  all_layers;
+
+        gint  memory_budget_mb;
+
+        gint  map_rle;
+
+        gint  hash_backend;
+
+        gint  dedupe_engine;
+
+        gint  subpal_count;
+
+        gint  subpal_colors;
+
+        gint  window_width;
+
+        gint  window_height;
+
+        gint  room_width;
+
+        gint  room_height;
+
+        gint  metatile_width;
+
+        gint  metatile_height;
+
+        gint  sprite_mode;
+
+        gint  grid_margin;
+
+        gint  grid_spacing;
+
+        gint  base_drawable_id;
+
     //  gint  offset_x;
     //  gint  offset_y;
 
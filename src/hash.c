@@ -6,8 +6,17 @@
 // https://softwareengineering.stackexchange.com/questions/49550/which-hashing-algorithm-is-best-for-uniqueness-and-speed
 
 #include <stdio.h>
+#include <string.h>
 #include "hash.h"
 
+#ifdef HASH_HAVE_CRC32C
+    #include <nmmintrin.h>
+#endif
+
+#ifdef HASH_HAVE_AVX2
+    #include <immintrin.h>
+#endif
+
 
  // Arbitrary key 4 x uint32_t
 static uint32_t xtea_key[4] = {0x3326D2BB, 0x86F7E7BB, 0xD1A4C2D5, 0x5C9E8974};
@@ -204,3 +213,421 @@ uint32_t MurmurHash2 ( const void * key, int len, uint32_t seed )
 }
 
 
+
+// Wide multiply-mix 64 bit hash (same construction as wyhash)
+//
+// * Folds 16 bytes per step with one 64 x 64 -> 128 bit multiply,
+//   xoring the high and low halves of the product
+// * len: is u8count, no alignment requirement
+//
+#define MULMIX_P0 0xa0761d6478bd642fULL
+#define MULMIX_P1 0xe7037ed1a0b428dbULL
+#define MULMIX_P2 0x8ebc6af09c88c6e3ULL
+
+static inline uint64_t mulmix_mum(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    // 64 x 64 -> 128 from 32 bit halves
+    uint64_t ha = a >> 32, la = (uint32_t)a;
+    uint64_t hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t  = rl + (rm0 << 32);
+    uint64_t lo = t + (rm1 << 32);
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return lo ^ hi;
+#endif
+}
+
+uint64_t mulmix64_hash(const void * key, uint32_t len, uint64_t seed)
+{
+    const uint8_t * data = (const uint8_t *)key;
+    uint32_t        n    = len;
+    uint64_t        h    = seed ^ MULMIX_P0;
+    uint64_t        a, b;
+
+    while (n >= 16) {
+        memcpy(&a, data,     sizeof(a));
+        memcpy(&b, data + 8, sizeof(b));
+        h = mulmix_mum(a ^ MULMIX_P1, b ^ h);
+        data += 16;
+        n    -= 16;
+    }
+
+    // Last 0..15 bytes, zero padded
+    a = 0;
+    b = 0;
+    if (n > 8) {
+        memcpy(&a, data, 8);
+        memcpy(&b, data + 8, n - 8);
+    }
+    else
+        memcpy(&a, data, n);
+
+    h = mulmix_mum(a ^ MULMIX_P1, b ^ h);
+
+    return mulmix_mum(h ^ MULMIX_P2, (uint64_t)len ^ MULMIX_P0);
+}
+
+
+
+// Returns true if the CPU has the SSE4.2 crc32 instruction
+int hash_cpu_has_crc32c(void)
+{
+#ifdef HASH_HAVE_CRC32C
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+
+
+// CRC32C (Castagnoli) hash using the SSE4.2 crc32 instruction
+//
+// * Two 32 bit lanes make up the 64 bit result: a CRC of the data
+//   and a CRC of the data multiplied by an odd constant, so the
+//   lanes aren't an affine function of each other like two plain
+//   CRCs with different seeds would be
+// * len: is u8count
+// * Only call when hash_cpu_has_crc32c() returns true
+//
+#ifdef HASH_HAVE_CRC32C
+__attribute__((target("sse4.2")))
+uint64_t crc32c_hash(const void * key, uint32_t len, uint32_t seed)
+{
+    const uint8_t * data = (const uint8_t *)key;
+    uint64_t        crc_a = seed;
+    uint64_t        crc_b = ~seed;
+    uint64_t        k;
+
+    while (len >= 8) {
+        memcpy(&k, data, sizeof(k));
+        crc_a = _mm_crc32_u64(crc_a, k);
+        crc_b = _mm_crc32_u64(crc_b, k * 0x9E3779B97F4A7C15ULL);
+        data += 8;
+        len  -= 8;
+    }
+
+    while (len) {
+        crc_a = _mm_crc32_u8((uint32_t)crc_a, *data);
+        crc_b = _mm_crc32_u8((uint32_t)crc_b, (uint8_t)(*data * 0x9D));
+        data++;
+        len--;
+    }
+
+    return (crc_a << 32) | (uint32_t)crc_b;
+}
+#else
+uint64_t crc32c_hash(const void * key, uint32_t len, uint32_t seed)
+{
+    // Not available on this platform, never selected
+    return 0;
+}
+#endif
+
+
+
+// CRC32C hashes of several blocks at once
+//
+// * Block "n" is "rows" rows of row_bytes each, starting at
+//   p_src + (n * lane_step) with src_stride bytes between rows
+//   (e.g. the tiles along one row of an image)
+// * Each result matches crc32c_hash() of the block's rows
+//   copied end to end, with the same seed
+// * row_bytes must be a multiple of 8 (no tail bytes)
+// * CRC32C_LANES blocks are hashed word by word in turn, so the
+//   crc32 and multiply latency of one block hides behind the
+//   others (a single block only has its own two lanes)
+// * Only call when hash_cpu_has_crc32c() returns true
+//
+#ifdef HASH_HAVE_CRC32C
+__attribute__((target("sse4.2")))
+void crc32c_hash_strided(const uint8_t * p_src, uint32_t src_stride,
+                         uint32_t lane_step, uint32_t lane_count,
+                         uint32_t row_bytes, uint32_t rows,
+                         uint32_t seed, uint64_t * p_hashes)
+{
+    const uint8_t * p_row;
+    const uint8_t * p_word;
+    uint64_t        a0, a1, a2, a3;
+    uint64_t        b0, b1, b2, b3;
+    uint64_t        k0, k1, k2, k3;
+    uint32_t        n, y, x;
+
+    // Full groups, spelled out so all eight crc chains stay in registers
+    for (n = 0; (n + CRC32C_LANES) <= lane_count; n += CRC32C_LANES) {
+
+        a0 = a1 = a2 = a3 = seed;
+        b0 = b1 = b2 = b3 = ~seed;
+
+        for (y = 0; y < rows; y++) {
+            p_row = p_src + ((size_t)y * src_stride) + ((size_t)n * lane_step);
+
+            for (x = 0; x < row_bytes; x += 8) {
+                p_word = p_row + x;
+                memcpy(&k0, p_word,                           sizeof(k0));
+                memcpy(&k1, p_word + lane_step,               sizeof(k1));
+                memcpy(&k2, p_word + ((size_t)lane_step * 2), sizeof(k2));
+                memcpy(&k3, p_word + ((size_t)lane_step * 3), sizeof(k3));
+
+                a0 = _mm_crc32_u64(a0, k0);
+                a1 = _mm_crc32_u64(a1, k1);
+                a2 = _mm_crc32_u64(a2, k2);
+                a3 = _mm_crc32_u64(a3, k3);
+                b0 = _mm_crc32_u64(b0, k0 * 0x9E3779B97F4A7C15ULL);
+                b1 = _mm_crc32_u64(b1, k1 * 0x9E3779B97F4A7C15ULL);
+                b2 = _mm_crc32_u64(b2, k2 * 0x9E3779B97F4A7C15ULL);
+                b3 = _mm_crc32_u64(b3, k3 * 0x9E3779B97F4A7C15ULL);
+            }
+        }
+
+        p_hashes[n]     = (a0 << 32) | (uint32_t)b0;
+        p_hashes[n + 1] = (a1 << 32) | (uint32_t)b1;
+        p_hashes[n + 2] = (a2 << 32) | (uint32_t)b2;
+        p_hashes[n + 3] = (a3 << 32) | (uint32_t)b3;
+    }
+
+    // Leftover blocks one at a time
+    for (; n < lane_count; n++) {
+
+        a0 = seed;
+        b0 = ~seed;
+
+        for (y = 0; y < rows; y++) {
+            p_row = p_src + ((size_t)y * src_stride) + ((size_t)n * lane_step);
+
+            for (x = 0; x < row_bytes; x += 8) {
+                memcpy(&k0, p_row + x, sizeof(k0));
+                a0 = _mm_crc32_u64(a0, k0);
+                b0 = _mm_crc32_u64(b0, k0 * 0x9E3779B97F4A7C15ULL);
+            }
+        }
+
+        p_hashes[n] = (a0 << 32) | (uint32_t)b0;
+    }
+}
+#else
+void crc32c_hash_strided(const uint8_t * p_src, uint32_t src_stride,
+                         uint32_t lane_step, uint32_t lane_count,
+                         uint32_t row_bytes, uint32_t rows,
+                         uint32_t seed, uint64_t * p_hashes)
+{
+    // Not available on this platform, never selected
+}
+#endif
+
+
+
+// Returns true if the CPU (and OS) support AVX2
+int hash_cpu_has_avx2(void)
+{
+#ifdef HASH_HAVE_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+
+
+// MurmurHash2 of up to MURMUR2_LANES_MAX blocks at once
+//
+// * Block "n" is "rows" rows of row_bytes each, starting at
+//   p_src + (n * lane_step) with src_stride bytes between rows
+//   (e.g. the tiles along one row of an image)
+// * Each result matches MurmurHash2() of the block's rows
+//   copied end to end, with the same seed
+// * row_bytes must be a multiple of 4 (no tail bytes)
+// * Blocks are split into groups of 8 lanes (one vector each).
+//   Groups are mixed word by word in turn, so the multiply
+//   latency of one group hides behind the others.
+// * Only call when hash_cpu_has_avx2() returns true
+//
+#ifdef HASH_HAVE_AVX2
+
+#define MURMUR2_LANES_GROUPS (MURMUR2_LANES_MAX / 8)
+
+// How a row of 8 blocks gets turned into one vector per 32 bit word
+enum murmur2_lanes_layouts {
+    MURMUR2_LOAD_GATHER  = 0, // Any width, also partial groups
+    MURMUR2_LOAD_WORDS_2 = 2, // 8 byte rows, blocks packed end to end
+    MURMUR2_LOAD_WORDS_4 = 4, // 16 byte rows
+    MURMUR2_LOAD_WORDS_8 = 8  // Rows a multiple of 32 bytes, 8 x 8 transpose per 32 bytes
+};
+
+
+__attribute__((target("avx2")))
+static inline __m256i murmur2_lanes_mix(__m256i h, __m256i k, __m256i m)
+{
+    k = _mm256_mullo_epi32(k, m);
+    k = _mm256_xor_si256(k, _mm256_srli_epi32(k, 24));
+    k = _mm256_mullo_epi32(k, m);
+
+    return _mm256_xor_si256(_mm256_mullo_epi32(h, m), k);
+}
+
+
+__attribute__((target("avx2")))
+static inline __m256i murmur2_lanes_load2(const uint8_t * p_lo, const uint8_t * p_hi)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p_lo)),
+                                   _mm_loadu_si128((const __m128i *)p_hi), 1);
+}
+
+
+// Load the next "layout" words (one, for gather) of 8 blocks
+// starting at p_src, one vector per word
+__attribute__((target("avx2")))
+static inline void murmur2_lanes_load(__m256i * p_words, const uint8_t * p_src, uint32_t lane_step,
+                                      int layout, __m256i offset, __m256i mask)
+{
+    __m256i  r[8], t[8], u[8];
+    uint32_t c;
+
+    switch (layout) {
+
+        case MURMUR2_LOAD_WORDS_2:
+            // [b0 b1 | b4 b5] and [b2 b3 | b6 b7], 2 words each
+            r[0] = murmur2_lanes_load2(p_src,      p_src + 32);
+            r[1] = murmur2_lanes_load2(p_src + 16, p_src + 48);
+            r[0] = _mm256_shuffle_epi32(r[0], _MM_SHUFFLE(3, 1, 2, 0));
+            r[1] = _mm256_shuffle_epi32(r[1], _MM_SHUFFLE(3, 1, 2, 0));
+            p_words[0] = _mm256_unpacklo_epi64(r[0], r[1]);
+            p_words[1] = _mm256_unpackhi_epi64(r[0], r[1]);
+            break;
+
+        case MURMUR2_LOAD_WORDS_4:
+            // Block n and n + 4 share a vector, then a 4 x 4 transpose per half
+            for (c = 0; c < 4; c++)
+                r[c] = murmur2_lanes_load2(p_src + (c * lane_step), p_src + ((c + 4) * lane_step));
+            t[0] = _mm256_unpacklo_epi32(r[0], r[1]);
+            t[1] = _mm256_unpackhi_epi32(r[0], r[1]);
+            t[2] = _mm256_unpacklo_epi32(r[2], r[3]);
+            t[3] = _mm256_unpackhi_epi32(r[2], r[3]);
+            p_words[0] = _mm256_unpacklo_epi64(t[0], t[2]);
+            p_words[1] = _mm256_unpackhi_epi64(t[0], t[2]);
+            p_words[2] = _mm256_unpacklo_epi64(t[1], t[3]);
+            p_words[3] = _mm256_unpackhi_epi64(t[1], t[3]);
+            break;
+
+        case MURMUR2_LOAD_WORDS_8:
+            for (c = 0; c < 8; c++)
+                r[c] = _mm256_loadu_si256((const __m256i *)(p_src + (c * lane_step)));
+
+            for (c = 0; c < 8; c += 2) {
+                t[c    ] = _mm256_unpacklo_epi32(r[c], r[c + 1]);
+                t[c + 1] = _mm256_unpackhi_epi32(r[c], r[c + 1]);
+            }
+            for (c = 0; c < 8; c += 4) {
+                u[c    ] = _mm256_unpacklo_epi64(t[c    ], t[c + 2]);
+                u[c + 1] = _mm256_unpackhi_epi64(t[c    ], t[c + 2]);
+                u[c + 2] = _mm256_unpacklo_epi64(t[c + 1], t[c + 3]);
+                u[c + 3] = _mm256_unpackhi_epi64(t[c + 1], t[c + 3]);
+            }
+
+            // u[0..3] hold words 0..3 (low half) and 4..7 (high half) of blocks 0..3
+            for (c = 0; c < 4; c++) {
+                p_words[c    ] = _mm256_permute2x128_si256(u[c], u[c + 4], 0x20);
+                p_words[c + 4] = _mm256_permute2x128_si256(u[c], u[c + 4], 0x31);
+            }
+            break;
+
+        default:
+            // Lanes outside the mask never load (their blocks may not exist)
+            p_words[0] = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)p_src, offset, mask, 1);
+            break;
+    }
+}
+
+
+__attribute__((target("avx2")))
+void MurmurHash2_lanes_strided(const uint8_t * p_src, uint32_t src_stride,
+                               uint32_t lane_step, uint32_t lane_count,
+                               uint32_t row_bytes, uint32_t rows,
+                               uint32_t seed, uint32_t * p_hashes)
+{
+    const __m256i m      = _mm256_set1_epi32(0x5bd1e995);
+    const __m256i lanes  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i offset = _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int)lane_step));
+    __m256i       mask[MURMUR2_LANES_GROUPS];
+    __m256i       h0, h1, h2, h3;
+    __m256i       words[MURMUR2_LANES_GROUPS][8];
+    uint32_t      out[MURMUR2_LANES_MAX];
+    uint32_t      y, x, w, g;
+    uint32_t      chunk_bytes;
+    int           layout;
+    const uint8_t * p_row;
+
+    if (lane_count > MURMUR2_LANES_MAX)
+        lane_count = MURMUR2_LANES_MAX;
+
+    // (groups with no lanes left just load nothing)
+    for (g = 0; g < MURMUR2_LANES_GROUPS; g++)
+        mask[g] = _mm256_cmpgt_epi32(_mm256_set1_epi32((int)lane_count - (int)(g * 8)), lanes);
+
+    h0 = _mm256_set1_epi32((int)(seed ^ (row_bytes * rows)));
+    h1 = h0;
+    h2 = h0;
+    h3 = h0;
+
+    // Direct loads need every block present
+    layout = MURMUR2_LOAD_GATHER;
+    if (lane_count == MURMUR2_LANES_MAX) {
+        if ((row_bytes % 32) == 0)
+            layout = MURMUR2_LOAD_WORDS_8;
+        else if (row_bytes == 16)
+            layout = MURMUR2_LOAD_WORDS_4;
+        else if ((row_bytes == 8) && (lane_step == 8))
+            layout = MURMUR2_LOAD_WORDS_2;
+    }
+    chunk_bytes = (layout == MURMUR2_LOAD_GATHER) ? 4 : (layout * 4);
+
+    for (y = 0; y < rows; y++) {
+
+        p_row = p_src + ((size_t)y * src_stride);
+
+        for (x = 0; x < row_bytes; x += chunk_bytes) {
+
+            for (g = 0; g < MURMUR2_LANES_GROUPS; g++)
+                murmur2_lanes_load(words[g], p_row + ((size_t)lane_step * 8 * g) + x, lane_step, layout, offset, mask[g]);
+
+            // Hashes stay in registers, one dependency chain per group
+            for (w = 0; w < (chunk_bytes / 4); w++) {
+                h0 = murmur2_lanes_mix(h0, words[0][w], m);
+                h1 = murmur2_lanes_mix(h1, words[1][w], m);
+                h2 = murmur2_lanes_mix(h2, words[2][w], m);
+                h3 = murmur2_lanes_mix(h3, words[3][w], m);
+            }
+        }
+    }
+
+    _mm256_storeu_si256((__m256i *)&out[ 0], h0);
+    _mm256_storeu_si256((__m256i *)&out[ 8], h1);
+    _mm256_storeu_si256((__m256i *)&out[16], h2);
+    _mm256_storeu_si256((__m256i *)&out[24], h3);
+
+    // Final mix of all lanes
+    for (g = 0; g < MURMUR2_LANES_GROUPS; g++) {
+        h0 = _mm256_loadu_si256((const __m256i *)&out[g * 8]);
+        h0 = _mm256_xor_si256(h0, _mm256_srli_epi32(h0, 13));
+        h0 = _mm256_mullo_epi32(h0, m);
+        h0 = _mm256_xor_si256(h0, _mm256_srli_epi32(h0, 15));
+        _mm256_storeu_si256((__m256i *)&out[g * 8], h0);
+    }
+
+    memcpy(p_hashes, out, lane_count * sizeof(uint32_t));
+}
+#else
+void MurmurHash2_lanes_strided(const uint8_t * p_src, uint32_t src_stride,
+                               uint32_t lane_step, uint32_t lane_count,
+                               uint32_t row_bytes, uint32_t rows,
+                               uint32_t seed, uint32_t * p_hashes)
+{
+    // Not available on this platform, never selected
+}
+#endif
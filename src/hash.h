@@ -5,4 +5,35 @@
 uint64_t xtea_hash(uint32_t u32count, uint32_t * p_source_data);
 uint64_t xtea_hash_u32(uint32_t u32count, uint32_t * p_source_data);
 
-uint32_t MurmurHash2 ( const void * key, int len, uint32_t seed);
\ No newline at end of file
+uint32_t MurmurHash2 ( const void * key, int len, uint32_t seed);
+
+uint64_t mulmix64_hash(const void * key, uint32_t len, uint64_t seed);
+
+// Hardware CRC32C needs GCC/Clang on x86-64 (enabled per
+// function, so the rest of the build doesn't require SSE4.2)
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+    #define HASH_HAVE_CRC32C
+#endif
+
+#define CRC32C_LANES 4 // Blocks hashed in turn by crc32c_hash_strided()
+
+int      hash_cpu_has_crc32c(void);
+uint64_t crc32c_hash(const void * key, uint32_t len, uint32_t seed);
+void     crc32c_hash_strided(const uint8_t * p_src, uint32_t src_stride,
+                             uint32_t lane_step, uint32_t lane_count,
+                             uint32_t row_bytes, uint32_t rows,
+                             uint32_t seed, uint64_t * p_hashes);
+
+// MurmurHash2 of several equally sized blocks at once, one per
+// AVX2 vector lane (same GCC/Clang on x86-64 requirement as above)
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+    #define HASH_HAVE_AVX2
+#endif
+
+#define MURMUR2_LANES_MAX 32 // Four vectors of 8 lanes, interleaved
+
+int      hash_cpu_has_avx2(void);
+void     MurmurHash2_lanes_strided(const uint8_t * p_src, uint32_t src_stride,
+                                   uint32_t lane_step, uint32_t lane_count,
+                                   uint32_t row_bytes, uint32_t rows,
+                                   uint32_t seed, uint32_t * p_hashes);
\ No newline at end of file
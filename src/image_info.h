@@ -12,9 +12,9 @@
 
     typedef struct {
         uint8_t    bytes_per_pixel;
-        uint16_t   width;
-        uint16_t   height;
-        uint32_t   size;  // size in bytes
+        uint32_t   width;
+        uint32_t   height;
+        uint64_t   size;  // size in bytes (can exceed 4GB for very large images)
         uint8_t  * p_img_data;
     } image_data;
 
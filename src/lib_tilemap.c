@@ -3,183 +3,878 @@
 //
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 
 #include "lib_tilemap.h"
 #include "tilemap_tiles.h"
-
-#include "hash.h"
+#include "tilemap_reduce.h"
+#include "tilemap_store.h"
+#include "tilemap_rle.h"
+#include "tilemap_hash.h"
+#include "tilemap_directkey.h"
+#include "tilemap_batch.h"
+#include "tilemap_index.h"
+#include "tilemap_packed.h"
+#include "tilemap_subpal.h"
+#include "tilemap_window.h"
+#include "tilemap_rooms.h"
+#include "tilemap_metatile.h"
+#include "tilemap_sprites.h"
+#include "tilemap_grid.h"
+#include "tilemap_base.h"
+#include "tilemap_layers.h"
 
 #include "benchmark.h"
 
-// Globals
-tile_map_data tile_map;
-tile_set_data tile_set;
-color_data    colormap;
+// Default context, used by the tilemap_*() functions that don't take one
+// (zero initialized: copy storage, no reduction, no RLE, no memory budget, auto hash, incremental engine)
+static tilemap_ctx ctx_default;
+
+static void tilemap_ctx_free_tile_set(tilemap_ctx * p_ctx);
+static void tilemap_tile_set_dkey_configure(tile_set_data * p_tile_set, uint16_t color_count);
+static tile_major_image * tilemap_ctx_get_tile_major(tilemap_ctx * p_ctx, image_data * p_src_img, tile_map_data * p_map);
+static int32_t tilemap_tile_set_index_add(tile_index * p_index, tile_set_data * p_tile_set, uint32_t tile_id, uint16_t search_mask);
+static tile_map_entry tilemap_tile_set_index_entry(tile_index * p_index, uint32_t slot);
+
+
+
+// Allocate a new, empty context with default settings
+// (release with tilemap_ctx_destroy())
+tilemap_ctx * tilemap_ctx_create(void) {
+
+    tilemap_ctx * p_ctx;
+
+    p_ctx = calloc(1, sizeof(tilemap_ctx));
+    if (p_ctx) {
+        p_ctx->storage_mode        = TILE_STORAGE_COPY;
+        p_ctx->reduce_target_count = REDUCE_TARGET_NONE;
+        p_ctx->map_rle_enabled     = false;
+        p_ctx->hash_backend        = TILE_HASH_AUTO;
+        p_ctx->packing_mode        = TILE_PACKING_AUTO;
+        p_ctx->subpal_count        = SUBPAL_COUNT_NONE;
+        p_ctx->subpal_colors       = SUBPAL_COLORS_DEFAULT;
+        p_ctx->window_width        = WINDOW_VIEW_NONE;
+        p_ctx->window_height       = WINDOW_VIEW_HEIGHT_DEFAULT;
+        p_ctx->room_width          = ROOMS_SIZE_NONE;
+        p_ctx->room_height         = ROOMS_HEIGHT_DEFAULT;
+        p_ctx->metatile_width      = METATILE_SIZE_NONE;
+        p_ctx->metatile_height     = METATILE_HEIGHT_DEFAULT;
+        p_ctx->needs_recalc        = true;
+    }
 
-int tilemap_needs_recalc;
+    return p_ctx;
+}
 
-void tilemap_free_tile_set(void);
-void tile_calc_alternate_hashes(tile_data *, tile_data []);
-void tile_flip_x(tile_data * p_src_tile, tile_data * p_dst_tile);
-void tile_flip_y(tile_data * p_src_tile, tile_data * p_dst_tile);
 
-static int32_t check_dimensions_valid(image_data * p_src_img, int tile_width, int tile_height);
+void tilemap_ctx_destroy(tilemap_ctx * p_ctx) {
 
-void tilemap_recalc_invalidate(void) {
+    if (!p_ctx || (p_ctx == &ctx_default))
+        return;
+
+    tilemap_ctx_layers_free(p_ctx);
+    tilemap_ctx_free_resources(p_ctx);
+    tilemap_base_free(&p_ctx->base);
+    free(p_ctx);
+}
+
+
+tilemap_ctx * tilemap_ctx_get_default(void) {
+    return &ctx_default;
+}
+
+
+void tilemap_ctx_recalc_invalidate(tilemap_ctx * p_ctx) {
 
     printf("Tilemap: recalc invalidated\n");
-    tilemap_needs_recalc = true;
-    tilemap_free_tile_set(); // Free tiles in set since they will get overwritten
+    p_ctx->needs_recalc = true;
+    tilemap_ctx_free_tile_set(p_ctx); // Free tiles in set since they will get overwritten
 
 }
 
 
-void tilemap_recalc_clear_flag(void) {
+void tilemap_ctx_recalc_clear_flag(tilemap_ctx * p_ctx) {
     printf("Tilemap: recalc flag cleared\n");
-    tilemap_needs_recalc = false;
+    p_ctx->needs_recalc = false;
+}
+
+
+int tilemap_ctx_recalc_needed(tilemap_ctx * p_ctx) {
+    return p_ctx->needs_recalc;
 }
 
 
-int tilemap_recalc_needed(void) {
-    return tilemap_needs_recalc;
+// Set the tile count the tile set should get reduced to
+// after processing (REDUCE_TARGET_NONE to disable)
+void tilemap_ctx_reduce_target_set(tilemap_ctx * p_ctx, uint32_t target_count_new) {
+    p_ctx->reduce_target_count = target_count_new;
 }
 
 
-// TODO: some mixing of global and locals. Simplify code
-int tilemap_initialize(image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask) {
+// Store finished maps as run-length rows when that is smaller
+// Takes effect on the next processing run
+void tilemap_ctx_map_rle_set(tilemap_ctx * p_ctx, int rle_enabled_new) {
+    p_ctx->map_rle_enabled = rle_enabled_new;
+}
+
+
+// Select the tile hash function (enum tile_hash_backends)
+// Takes effect on the next tile set initialize
+void tilemap_ctx_hash_backend_set(tilemap_ctx * p_ctx, uint8_t hash_backend_new) {
+
+    if (hash_backend_new < TILE_HASH_LAST)
+        p_ctx->hash_backend = hash_backend_new;
+}
+
+
+// Select the dedupe engine (enum tile_dedupe_engines)
+// Takes effect on the next processing run
+void tilemap_ctx_dedupe_engine_set(tilemap_ctx * p_ctx, uint8_t engine_new) {
+
+    if (engine_new < TILE_ENGINE_LAST)
+        p_ctx->dedupe_engine = engine_new;
+}
+
+
+// Select when low color indexed tiles get bit-packed (enum tile_packing_modes)
+// Takes effect on the next tile set initialize
+void tilemap_ctx_packing_set(tilemap_ctx * p_ctx, uint8_t packing_mode_new) {
+
+    if (packing_mode_new < TILE_PACKING_LAST)
+        p_ctx->packing_mode = packing_mode_new;
+}
+
+
+// Read tiles from a tile-major copy of the source image (NULL for none)
+//
+// * Only used while it matches the image and tile size being processed,
+//   otherwise processing reads the row-major image as usual
+// * The caller keeps ownership and must clear or rebuild it when the source changes
+void tilemap_ctx_tile_major_set(tilemap_ctx * p_ctx, tile_major_image * p_tile_major) {
+    p_ctx->p_tile_major = p_tile_major;
+}
+
+
+// Whether a tile-major copy of the source image speeds up processing
+// with the current settings, so callers can skip building one
+//
+// * Only the incremental engine with small (direct key) tiles gains,
+//   with flip search or without: it reads every tile one at a time.
+//   Larger tiles get their rows hashed in place by the row kernels,
+//   where the copy costs more than it saves (bulk engines as well)
+// * Not with a margin or spacing, processing doesn't use the copy then
+int32_t tilemap_ctx_tile_major_wanted(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height) {
+
+    return ((p_ctx->dedupe_engine == TILE_ENGINE_INCREMENTAL) && !tile_grid_is_set(&p_ctx->grid)
+            && (((uint32_t)tile_width * tile_height * p_src_img->bytes_per_pixel) <= TILE_DKEY_BYTES_MAX));
+}
+
+
+// Assign tiles to count sub-palettes of colors each after processing
+// (SUBPAL_COUNT_NONE to disable). Takes effect on the next processing run
+void tilemap_ctx_subpal_set(tilemap_ctx * p_ctx, uint16_t count_new, uint16_t colors_new) {
+    p_ctx->subpal_count  = count_new;
+    p_ctx->subpal_colors = colors_new;
+}
+
+
+// Find the peak unique tiles of any width x height tile window
+// on the map after processing (WINDOW_VIEW_NONE to disable).
+// Takes effect on the next processing run
+void tilemap_ctx_window_set(tilemap_ctx * p_ctx, uint16_t width_new, uint16_t height_new) {
+    p_ctx->window_width  = width_new;
+    p_ctx->window_height = height_new;
+}
+
+
+// Split the map into width x height tile rooms with their own
+// tile sets after processing (ROOMS_SIZE_NONE to disable).
+// Takes effect on the next processing run
+void tilemap_ctx_rooms_set(tilemap_ctx * p_ctx, uint16_t width_new, uint16_t height_new) {
+    p_ctx->room_width  = width_new;
+    p_ctx->room_height = height_new;
+}
+
+
+// Dedupe width x height tile blocks of the map into a metatile
+// table and map after processing (METATILE_SIZE_NONE to disable).
+// Takes effect on the next processing run
+void tilemap_ctx_metatile_set(tilemap_ctx * p_ctx, uint16_t width_new, uint16_t height_new) {
+    p_ctx->metatile_width  = width_new;
+    p_ctx->metatile_height = height_new;
+}
+
+
+// Read tiles from a sheet with a margin around and spacing between
+// them, in pixels (both GRID_*_NONE for packed tiles, see tilemap_grid.c).
+// Takes effect on the next processing run
+void tilemap_ctx_grid_set(tilemap_ctx * p_ctx, uint16_t margin_new, uint16_t spacing_new) {
+    p_ctx->grid.margin  = margin_new;
+    p_ctx->grid.spacing = spacing_new;
+}
+
+
+// Map against a locked base tile set image (NULL for none, see tilemap_base.c)
+//
+// * The image gets copied, its tiles become IDs 0 .. n-1 of every
+//   tile set initialized afterwards and only new tiles get appended
+// * Must match the source bit depth and be a multiple of the tile size
+// * The index built from it is kept until the image changes
+// Takes effect on the next processing run
+//
+// Returns false if the copy can't be allocated (no base then)
+int32_t tilemap_ctx_base_set(tilemap_ctx * p_ctx, image_data * p_img) {
+
+    return tilemap_base_set_image(&p_ctx->base, p_img);
+}
+
+
+// Built base index, to keep it beyond the context (NULL if none is built yet)
+//
+// * Pass it back with tilemap_ctx_base_index_set() to skip indexing
+//   the same base image again, e.g. in a later run in the same session
+const uint8_t * tilemap_ctx_base_index_get(tilemap_ctx * p_ctx, size_t * p_size) {
+
+    *p_size = p_ctx->base.index_size;
+    return p_ctx->base.p_index;
+}
+
+
+// Take a copy of a base index from tilemap_ctx_base_index_get()
+//
+// * Used when it matches the base image and tile format, otherwise
+//   the index gets built again as usual
+// * Returns false if it isn't a valid index
+int32_t tilemap_ctx_base_index_set(tilemap_ctx * p_ctx, const uint8_t * p_index, size_t size_bytes) {
+
+    return tilemap_base_index_import(&p_ctx->base, p_index, size_bytes);
+}
+
+
+// Limit resident memory, tile pixels beyond the limit spill to a mapped temp file
+//
+// * budget_bytes: total budget (TILE_STORE_BUDGET_NONE to disable)
+// * external_bytes: memory the caller already holds against the budget
+//   (source image, preview buffers, etc), leaving the rest for tile pixels
+// Takes effect for tiles registered after the call
+void tilemap_ctx_memory_budget_set(tilemap_ctx * p_ctx, uint64_t budget_bytes, uint64_t external_bytes) {
+
+    if (budget_bytes == TILE_STORE_BUDGET_NONE)
+        tile_store_budget_set(&p_ctx->tile_set.store, TILE_STORE_BUDGET_NONE);
+    else if (budget_bytes > external_bytes)
+        tile_store_budget_set(&p_ctx->tile_set.store, budget_bytes - external_bytes);
+    else
+        tile_store_budget_set(&p_ctx->tile_set.store, 1); // Already over budget, spill everything
+}
+
+
+// Select how registered tiles store their pixels (enum tile_storage_modes)
+// Takes effect on the next tilemap_initialize()
+void tilemap_ctx_storage_mode_set(tilemap_ctx * p_ctx, uint8_t storage_mode_new) {
+
+    if (storage_mode_new < TILE_STORAGE_LAST)
+        p_ctx->storage_mode = storage_mode_new;
+}
+
+
+int32_t tilemap_ctx_initialize(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask) {
 
     printf("Tilemap: tilemap_initialize\n");
-    // Tile Map
-    tile_map.map_width   = p_src_img->width;
-    tile_map.map_height  = p_src_img->height;
 
-    tile_map.tile_width  = tile_width;
-    tile_map.tile_height = tile_height;
+    // Release any map (or sprite sheet result) left over from a previous run
+    tilemap_map_free(&p_ctx->tile_map);
+    tilemap_sprites_free(&p_ctx->sprites);
 
-    tile_map.width_in_tiles  = tile_map.map_width  / tile_map.tile_width;
-    tile_map.height_in_tiles = tile_map.map_height / tile_map.tile_height;
+    if (!tilemap_map_initialize(&p_ctx->tile_map, p_src_img, tile_width, tile_height, &p_ctx->grid, search_mask))
+        return (false);
+
+    tilemap_ctx_tile_set_initialize(p_ctx, p_src_img, tile_width, tile_height, search_mask);
+
+    // Base tiles go in first, so they get IDs 0 .. n-1
+    if (!tilemap_ctx_base_apply(p_ctx, search_mask))
+        return (false);
+
+    return (true);
+}
+
+
+// Set up an empty tile map sized for a source image
+// (any map can be processed against a context's tile set)
+//
+// * p_grid: where the tiles sit in the image (margin and spacing)
+int32_t tilemap_map_initialize(tile_map_data * p_map, image_data * p_src_img, int tile_width, int tile_height,
+                               tile_grid_data * p_grid, uint16_t search_mask) {
+
+    p_map->tile_width  = tile_width;
+    p_map->tile_height = tile_height;
+    p_map->grid        = *p_grid;
+
+    p_map->width_in_tiles  = tile_grid_get_count(p_src_img->width,  tile_width,  p_grid);
+    p_map->height_in_tiles = tile_grid_get_count(p_src_img->height, tile_height, p_grid);
+
+    p_map->map_width   = p_map->width_in_tiles  * p_map->tile_width;
+    p_map->map_height  = p_map->height_in_tiles * p_map->tile_height;
 
     // Normal orientation search only, no flip x/y by default
-    tile_map.search_mask = search_mask;
+    p_map->search_mask = search_mask;
 
     // Max space required to store Tile Map is
     // width x height in tiles (if every map tile is unique)
-    tile_map.size = (tile_map.width_in_tiles * tile_map.height_in_tiles);
-
-    tile_map.tile_id_list = NULL;
-    tile_map.tile_attribs_list = NULL;
-
-    tile_map.tile_id_list = malloc(tile_map.size * sizeof(uint32_t));
-    if (!tile_map.tile_id_list)
+    p_map->size = (p_map->width_in_tiles * p_map->height_in_tiles);
+
+    p_map->tile_id_list = NULL;
+    p_map->tile_attribs_list = NULL;
+    p_map->tile_error_list = NULL;
+    p_map->tile_error_max  = 0;
+    p_map->p_packed        = NULL;
+    p_map->p_rle_row_index = NULL;
+    p_map->p_rle_run_x     = NULL;
+    p_map->p_rle_run_entry = NULL;
+    p_map->rle_run_count   = 0;
+    p_map->rle_size_bytes  = 0;
+    memset(&p_map->window, 0x00, sizeof(p_map->window));
+    memset(&p_map->metatiles, 0x00, sizeof(p_map->metatiles));
+
+    p_map->tile_id_list = malloc(p_map->size * sizeof(uint32_t));
+    if (!p_map->tile_id_list)
             return(false);
 
-    tile_map.tile_attribs_list = malloc(tile_map.size * sizeof(uint16_t));
-    if (!tile_map.tile_attribs_list)
+    p_map->tile_attribs_list = malloc(p_map->size * sizeof(uint16_t));
+    if (!p_map->tile_attribs_list)
             return(false);
 
+    return (true);
+}
+
+
+// Reset a context's tile set for a given tile size and source image format
+// (search_mask: flips the maps get processed with)
+void tilemap_ctx_tile_set_initialize(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height,
+                                     uint16_t search_mask) {
+
+    tile_set_data * p_tile_set = &p_ctx->tile_set;
+    uint8_t         pack_bits;
+
+    tilemap_ctx_free_tile_set(p_ctx);
+
     // Tile Set
-    tile_set.tile_bytes_per_pixel = p_src_img->bytes_per_pixel;
-    tile_set.tile_width  = tile_width;
-    tile_set.tile_height = tile_height;
-    tile_set.tile_size   = tile_set.tile_width * tile_set.tile_height * tile_set.tile_bytes_per_pixel;
-    tile_set.tile_count  = 0;
+    p_tile_set->tile_bytes_per_pixel = p_src_img->bytes_per_pixel;
+    p_tile_set->tile_width  = tile_width;
+    p_tile_set->tile_height = tile_height;
+    p_tile_set->tile_size   = p_tile_set->tile_width * p_tile_set->tile_height * p_tile_set->tile_bytes_per_pixel;
+    p_tile_set->tile_count  = 0;
+    p_tile_set->tile_count_unreduced = 0;
+    p_tile_set->tile_count_locked    = 0;
+    memset(&p_tile_set->subpal, 0x00, sizeof(p_tile_set->subpal));
+
+    // Reference mode reads tile pixels straight out of the
+    // source image, so it has to outlive the tile set
+    p_tile_set->storage_mode = p_ctx->storage_mode;
+    memcpy(&p_tile_set->src_img, p_src_img, sizeof(image_data));
+    p_tile_set->grid = p_ctx->grid;
+
+    p_tile_set->hash_backend = tile_hash_resolve(p_ctx->hash_backend);
+    printf("Tilemap: Hash backend %s\n", tile_hash_get_name(p_tile_set->hash_backend));
+
+    // Low color indexed tiles can be hashed and stored bit-packed. By default
+    // only where that measures faster:
+    // * Bulk engines with flip search (flipping packed tiles is cheap)
+    // * Incremental engine when unpacked tiles would use 2 bit direct keys,
+    //   which pack every cell anyway
+    // Otherwise packing every cell costs more than the smaller tiles save
+    pack_bits = tile_packed_select_bits(p_tile_set->tile_bytes_per_pixel, p_ctx->colormap.color_count);
+    tile_dkey_configure(&p_tile_set->dkey, p_tile_set->tile_bytes_per_pixel, p_tile_set->tile_size,
+                        p_ctx->colormap.color_count, 0);
+
+    if ((p_ctx->packing_mode == TILE_PACKING_ALWAYS)
+        || ((p_ctx->packing_mode == TILE_PACKING_AUTO)
+            && (((p_ctx->dedupe_engine != TILE_ENGINE_INCREMENTAL) && (search_mask != TILE_FLIP_BITS_NONE))
+                || ((p_ctx->dedupe_engine == TILE_ENGINE_INCREMENTAL) && (p_tile_set->dkey.mode == TILE_DKEY_MODE_2BPP)))))
+        p_tile_set->pack_bits = pack_bits;
+    else
+        p_tile_set->pack_bits = TILE_PACKED_BITS_NONE;
+    if (p_tile_set->pack_bits)
+        printf("Tilemap: Packed tiles %d bpp\n", p_tile_set->pack_bits);
+
+    tilemap_tile_set_dkey_configure(p_tile_set, p_ctx->colormap.color_count);
+
+    tilemap_ctx_recalc_invalidate(p_ctx);
+}
 
-    tilemap_recalc_invalidate();
+
+// Seed a freshly initialized tile set with the locked base tiles, if any
+// (search_mask: flips the maps get processed with)
+//
+// * Packed tiles need every pixel of the base to fit as well,
+//   packing is turned off before any tile gets stored otherwise
+// * Returns false if the base doesn't match the tile size and format
+int32_t tilemap_ctx_base_apply(tilemap_ctx * p_ctx, uint16_t search_mask) {
+
+    tile_set_data * p_tile_set = &p_ctx->tile_set;
+
+    if (!tilemap_base_is_set(&p_ctx->base))
+        return (true);
+
+    if (p_tile_set->pack_bits
+        && (p_ctx->base.src_img.bytes_per_pixel == p_tile_set->tile_bytes_per_pixel)
+        && (!tile_packed_image_fits(&p_ctx->base.src_img, p_tile_set->pack_bits)
+            || (p_tile_set->src_img.p_img_data && !tile_packed_image_fits(&p_tile_set->src_img, p_tile_set->pack_bits)))) {
+        printf("Tilemap: Packed tiles: base or image pixel out of range, using unpacked tiles\n");
+        p_tile_set->pack_bits = TILE_PACKED_BITS_NONE;
+        tilemap_tile_set_dkey_configure(p_tile_set, p_ctx->colormap.color_count);
+    }
+
+    if (!tilemap_base_seed(&p_ctx->base, p_tile_set, search_mask)) {
+        tilemap_ctx_free_tile_set(p_ctx);
+        return (false);
+    }
 
     return (true);
 }
 
 
-unsigned char tilemap_export_process(image_data * p_src_img, int tile_width, int tile_height, int check_flip) {
+// Small enough tiles are matched on their pixels directly
+// (indexed color count decides whether they pack to 2bpp,
+// packed tile sets use the packed tiles)
+static void tilemap_tile_set_dkey_configure(tile_set_data * p_tile_set, uint16_t color_count) {
+
+    tile_dkey_configure(&p_tile_set->dkey, p_tile_set->tile_bytes_per_pixel, p_tile_set->tile_size, color_count,
+                        (p_tile_set->pack_bits)
+                            ? tile_packed_get_size(p_tile_set->tile_width, p_tile_set->tile_height, p_tile_set->pack_bits)
+                            : 0);
+    printf("Tilemap: Direct key dedupe %s\n", tile_dkey_get_name(&p_tile_set->dkey));
+}
+
+
+unsigned char tilemap_ctx_export_process(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height, int check_flip) {
 
     uint16_t search_mask;
 
     if (check_flip) search_mask = TILE_FLIP_BITS_XY;
         else        search_mask = TILE_FLIP_BITS_NONE;
 
-    if ( check_dimensions_valid(p_src_img, tile_width, tile_height) ) {
-        if (!tilemap_initialize(p_src_img, tile_width, tile_height, search_mask)) { // Success, prep for processing
+    if ( tilemap_check_grid_dimensions_valid(p_src_img, tile_width, tile_height, &p_ctx->grid) ) {
+        if (!tilemap_ctx_initialize(p_ctx, p_src_img, tile_width, tile_height, search_mask)) { // Success, prep for processing
             printf("Tilemap: Process: tilemap_initialize: failed\n");
             return (false); // Signal failure and exit
         }
     }
     else {
-        printf("Tilemap: Process: check_dimensions_valid: failed\n" );
+        printf("Tilemap: Process: tilemap_check_dimensions_valid: failed\n" );
+        return (false); // Signal failure and exit
+    }
+
+    if ( ! tilemap_ctx_process_tiles(p_ctx, p_src_img) )
+        return (false); // Signal failure and exit
+
+    // Optionally merge similar tiles down to the target tile budget
+    if ( ! tilemap_reduce_tile_set(&p_ctx->tile_map, &p_ctx->tile_set, &p_ctx->colormap, p_ctx->reduce_target_count) ) {
+        tilemap_ctx_free_resources(p_ctx);
+        return (false); // Signal failure and exit
+    }
+
+    // Tile set is final now, fit the tiles into the target's sub-palettes
+    if ( ! tilemap_subpal_solve(&p_ctx->tile_set, &p_ctx->colormap, p_ctx->subpal_count, p_ctx->subpal_colors) ) {
+        tilemap_ctx_free_resources(p_ctx);
+        return (false); // Signal failure and exit
+    }
+
+    // Map IDs are final now, find the most tiles a scrolling viewport needs at once
+    if ( ! tilemap_window_calc(&p_ctx->tile_map, p_ctx->window_width, p_ctx->window_height) ) {
+        tilemap_ctx_free_resources(p_ctx);
+        return (false); // Signal failure and exit
+    }
+
+    // Per-room tile sets, built from the final map IDs
+    if ( ! tilemap_rooms_calc(&p_ctx->rooms, &p_ctx->tile_map, p_ctx->tile_set.tile_count,
+                              p_ctx->room_width, p_ctx->room_height) ) {
+        tilemap_ctx_free_resources(p_ctx);
+        return (false); // Signal failure and exit
+    }
+
+    // Second level dedupe over blocks of final map entries
+    if ( ! tilemap_metatile_calc(&p_ctx->tile_map, p_ctx->metatile_width, p_ctx->metatile_height) ) {
+        tilemap_ctx_free_resources(p_ctx);
         return (false); // Signal failure and exit
     }
 
-    if ( ! process_tiles(p_src_img) )
+    // Tile count is final now, shrink the map to the narrowest entry width
+    if ( ! tilemap_map_pack(&p_ctx->tile_map, p_ctx->tile_set.tile_count, p_ctx->map_rle_enabled) ) {
+        tilemap_ctx_free_resources(p_ctx);
         return (false); // Signal failure and exit
+    }
 
-    tilemap_recalc_clear_flag();
+    tilemap_ctx_recalc_clear_flag(p_ctx);
     return (true);
 }
 
 
-unsigned char process_tiles(image_data * p_src_img) {
+// Sprite sheet mode: find the sprites of the image by their opaque
+// pixels instead of splitting it into tiles (see tilemap_sprites.c)
+//
+// * Replaces the tile map and tile set, both are left empty
+// * The image doesn't have to be a multiple of any tile size
+unsigned char tilemap_ctx_sprites_process(tilemap_ctx * p_ctx, image_data * p_src_img, int check_flip) {
+
+    tilemap_ctx_free_resources(p_ctx);
+
+    if ( ! tilemap_sprites_calc(&p_ctx->sprites, p_src_img, p_ctx->hash_backend,
+                                (check_flip) ? TILE_FLIP_BITS_XY : TILE_FLIP_BITS_NONE) ) {
+        tilemap_ctx_free_resources(p_ctx);
+        return (false); // Signal failure and exit
+    }
+
+    tilemap_ctx_recalc_clear_flag(p_ctx);
+    return (true);
+}
+
+
+unsigned char tilemap_ctx_process_tiles(tilemap_ctx * p_ctx, image_data * p_src_img) {
+
+    if ( ! tilemap_ctx_process_tiles_to_map(p_ctx, p_src_img, &p_ctx->tile_map) ) {
+        tilemap_ctx_free_resources(p_ctx);
+        return (false);
+    }
+
+    return (true);
+}
+
+
+// Tile-major copy to read a map's tiles from, NULL if the
+// context has none or it doesn't match the image and tile size
+// (tile-major copies are packed, so never with a margin or spacing)
+static tile_major_image * tilemap_ctx_get_tile_major(tilemap_ctx * p_ctx, image_data * p_src_img, tile_map_data * p_map) {
+
+    if (p_ctx->p_tile_major && !tile_grid_is_set(&p_map->grid)
+        && tile_major_matches(p_ctx->p_tile_major, p_src_img, p_map->tile_width, p_map->tile_height))
+        return p_ctx->p_tile_major;
+
+    return NULL;
+}
+
+
+// Index items of a tile set: each registered hash of a tile maps to
+// tile ID * TILE_SET_INDEX_FLIPS + orientation. The index keeps the
+// lowest item per key, which is the match tile_find_match() returns
+// (lowest tile ID, then lowest orientation)
+#define TILE_SET_INDEX_FLIPS  (TILE_FLIP_MAX + 1)
 
-    int         img_x, img_y;
+// Add the hashes of a registered tile to a tile set index
+// (every orientation when flip search is on)
+static int32_t tilemap_tile_set_index_add(tile_index * p_index, tile_set_data * p_tile_set, uint32_t tile_id, uint16_t search_mask) {
+
+    int h, h_range;
+
+    h_range = (search_mask) ? TILE_FLIP_MAX : TILE_FLIP_MIN;
+
+    for (h = TILE_FLIP_MIN; h <= h_range; h++)
+        if (tile_index_insert(p_index, p_tile_set->tiles[tile_id].hash[h],
+                              (tile_id * TILE_SET_INDEX_FLIPS) + h) == TILE_INDEX_NOT_FOUND)
+            return false;
+
+    return true;
+}
+
+
+// Tile and orientation a tile set index slot (or TILE_INDEX_NOT_FOUND) stands for
+static tile_map_entry tilemap_tile_set_index_entry(tile_index * p_index, uint32_t slot) {
+
+    tile_map_entry map_entry;
+    uint32_t       item;
+
+    if (slot == TILE_INDEX_NOT_FOUND)
+        map_entry.id = TILE_ID_NOT_FOUND;
+    else {
+        item = tile_index_get_first(p_index, slot);
+        map_entry.id      = item / TILE_SET_INDEX_FLIPS;
+        map_entry.attribs = tile_flip_bits[item % TILE_SET_INDEX_FLIPS];
+    }
+
+    return map_entry;
+}
+
+
+// Deduplicate the tiles of a source image into a context's tile set,
+// writing tile IDs and attributes into p_map
+// (p_map must be set up with tilemap_map_initialize() first)
+//
+// * On failure only this call's working buffers get released, the tile
+//   set and p_map are left for the caller to clean up (p_map may be a
+//   layer's map rather than the context's own)
+unsigned char tilemap_ctx_process_tiles_to_map(tilemap_ctx * p_ctx, image_data * p_src_img, tile_map_data * p_map) {
 
     tile_data      tile, flip_tiles[2];
     tile_map_entry map_entry;
-    uint32_t       img_buf_offset;
-    int32_t        map_slot;
+    tile_set_data * p_tile_set = &p_ctx->tile_set;
+    tile_index     index;
+    uint32_t       index_capacity;
+    uint32_t     * p_row_slots;
+    uint32_t       row_tile_count;
+    uint32_t       slot;
+    uint32_t       c;
+    tile_hash_func hash_func;
+    tile_hash_row_func row_func;
+    uint64_t     * p_row_hashes;
+    uint8_t      * p_row_packed;
+    int32_t        row_hashed;
+    tile_major_image * p_tm;
+    const uint8_t  * p_pixels;
+    uint32_t       pixel_bytes;
+    int32_t        tile_copied;
+    int32_t        use_dkey;
+    uint8_t        dkeys[TILE_FLIP_MAX + 1][TILE_DKEY_BYTES_MAX];
+    size_t         img_buf_offset;
+    uint32_t       map_slot;
+    uint32_t       map_x, map_y;
+
+    // Packed tiles need every pixel to fit the packed size. The color
+    // count says they do, but don't trust it with the tile set's contents
+    if (p_tile_set->pack_bits && !tile_packed_image_fits(p_src_img, p_tile_set->pack_bits)) {
+        if (p_tile_set->tile_count == 0) {
+            printf("Tilemap: Packed tiles: pixel out of range, using unpacked tiles\n");
+            p_tile_set->pack_bits = TILE_PACKED_BITS_NONE;
+            tilemap_tile_set_dkey_configure(p_tile_set, p_ctx->colormap.color_count);
+        }
+        else {
+            printf("Tilemap: Process: FAIL -> pixel out of range for packed tile set\n");
+            return (false);
+        }
+    }
+
+    // Bulk engines work on the whole map at once
+    if (p_ctx->dedupe_engine != TILE_ENGINE_INCREMENTAL) {
+        if (!tilemap_batch_process(p_tile_set, p_src_img, tilemap_ctx_get_tile_major(p_ctx, p_src_img, p_map),
+                                   p_map, p_ctx->dedupe_engine))
+            return (false);
+        return (true);
+    }
 
 benchmark_slot_resetall();
-printf("Tilemap: Start -> Process..  (flip=%d)  .. ", tile_map.search_mask);
+printf("Tilemap: Start -> Process..  (flip=%d)  .. ", p_map->search_mask);
 benchmark_start();
 
     map_slot = 0;
+    hash_func = tile_hash_get_func(p_tile_set->hash_backend);
+    use_dkey  = tile_dkey_begin(&p_tile_set->dkey, p_tile_set->tile_count, p_map->search_mask);
+    p_tm      = tilemap_ctx_get_tile_major(p_ctx, p_src_img, p_map);
+
+    // Every map row gets hashed before any of its tiles are looked up, so the
+    // index lookups of a row can go in one batch. Backends with a row kernel
+    // hash it in one call (same hashes as hash_func, read straight from the
+    // image). In a tile-major copy a map row is one run of tiles, each hashed
+    // as a single row. Packed tile sets pack the map row into the same layout
+    // first
+    if (p_tile_set->pack_bits)
+        row_func = tile_hash_get_row_func(p_tile_set->hash_backend,
+                                          tile_packed_get_size(p_map->tile_width, p_map->tile_height, p_tile_set->pack_bits));
+    else if (p_tm)
+        row_func = tile_hash_get_row_func(p_tile_set->hash_backend, p_tm->tile_size);
+    else
+        row_func = tile_hash_get_row_func(p_tile_set->hash_backend, p_map->tile_width * p_src_img->bytes_per_pixel);
+    p_row_hashes = malloc(((size_t)p_map->width_in_tiles + 1) * sizeof(uint64_t));
+    p_row_slots  = malloc((size_t)p_map->width_in_tiles * sizeof(uint32_t));
+    p_row_packed = NULL;
+    if (p_tile_set->pack_bits)
+        p_row_packed = malloc((size_t)p_map->width_in_tiles
+                              * tile_packed_get_size(p_map->tile_width, p_map->tile_height, p_tile_set->pack_bits));
+
+    // Hash search index of the tile set, seeded with the tiles already in it
+    // (e.g. base tiles or earlier layers). Room for every tile the set can
+    // still take from this map, in every orientation searched
+    index_capacity = p_tile_set->tile_count
+                     + ((p_map->size < (TILES_MAX_DEFAULT - p_tile_set->tile_count))
+                        ? p_map->size : (TILES_MAX_DEFAULT - p_tile_set->tile_count));
+    if (p_map->search_mask)
+        index_capacity *= TILE_SET_INDEX_FLIPS;
+
+    if (!tile_index_init(&index, index_capacity)) {
+        free(p_row_hashes);
+        free(p_row_slots);
+        free(p_row_packed);
+        printf("Tilemap: Process: FAIL -> Couldn't allocate the tile index\n");
+        return (false);
+    }
+
+    for (c = 0; c < p_tile_set->tile_count; c++)
+        tilemap_tile_set_index_add(&index, p_tile_set, c, p_map->search_mask);
 
     // Use pre-initialized values in from tilemap_initialize()
-    tile_initialize(&tile, &tile_map, &tile_set);
-    tile_initialize(&flip_tiles[0], &tile_map, &tile_set);
-    tile_initialize(&flip_tiles[1], &tile_map, &tile_set);
+    tile_initialize(&tile, p_map, p_tile_set);
+    tile_initialize(&flip_tiles[0], p_map, p_tile_set);
+    tile_initialize(&flip_tiles[1], p_map, p_tile_set);
 
-    if (tile.p_img_raw) {
+    if (tile.p_img_raw && p_row_hashes && p_row_slots && (p_row_packed || !p_tile_set->pack_bits)) {
 
         // Iterate over the map, top -> bottom, left -> right
         img_buf_offset = 0;
 
-        for (img_y = 0; img_y < tile_map.map_height; img_y += tile_map.tile_height) {
-            for (img_x = 0; img_x < tile_map.map_width; img_x += tile_map.tile_width) {
-
-                // Set buffer offset to upper left of current tile
-                img_buf_offset = (img_x + (img_y * tile_map.map_width)) * p_src_img->bytes_per_pixel;
-
-                benchmark_slot_start(0);
-                tile_copy_tile_from_image(p_src_img,
-                                          &tile,
-                                          img_buf_offset);
-                benchmark_slot_update(0);
-
+        for (map_y = 0; map_y < p_map->height_in_tiles; map_y++) {
 
+            // Direct key lookups don't need the hashes
+            row_hashed = false;
+            if (!use_dkey) {
                 benchmark_slot_start(9);
-                // TODO! Don't hash transparent pixels? Have to overwrite second byte?
-                // TODO: BUG? Is this missing the extra tile 32 bit padding bytes?
-                tile.hash[0] = MurmurHash2( tile.p_img_raw, tile.raw_size_bytes, 0xF0A5); // len is u8count
+                if (p_row_packed)
+                    tile_pack_map_row(p_src_img, p_tm, p_map, tile.packed_bits, map_y, p_row_packed);
+
+                if (!row_func) {
+                    // One tile at a time, row-major tiles through the tile buffer
+                    // (new ones get copied again below)
+                    for (map_x = 0; map_x < p_map->width_in_tiles; map_x++) {
+                        if (p_row_packed)
+                            p_pixels = p_row_packed + ((size_t)map_x * tile.encoded_size_bytes);
+                        else if (p_tm)
+                            p_pixels = tile_major_get_tile(p_tm, map_slot + map_x);
+                        else {
+                            tile_copy_tile_from_image(p_src_img, &tile,
+                                                      tile_grid_get_offset(p_src_img, &p_map->grid, p_map->tile_width,
+                                                                           p_map->tile_height, map_x, map_y));
+                            p_pixels = tile.p_img_raw;
+                        }
+                        p_row_hashes[map_x] = hash_func(p_pixels, (p_row_packed) ? tile.encoded_size_bytes
+                                                                                  : tile.raw_size_bytes);
+                    }
+                }
+                else if (p_row_packed)
+                    row_func(p_row_packed, tile.encoded_size_bytes,
+                             tile.encoded_size_bytes, tile.encoded_size_bytes, 1,
+                             p_map->width_in_tiles, p_row_hashes);
+                else if (p_tm)
+                    row_func(tile_major_get_tile(p_tm, map_slot), p_tm->tile_size,
+                             p_tm->tile_size, p_tm->tile_size, 1,
+                             p_map->width_in_tiles, p_row_hashes);
+                else
+                    row_func(p_src_img->p_img_data
+                             + tile_grid_get_offset(p_src_img, &p_map->grid, p_map->tile_width, p_map->tile_height, 0, map_y),
+                             p_src_img->width * p_src_img->bytes_per_pixel,
+                             ((uint32_t)p_map->tile_width + p_map->grid.spacing) * p_src_img->bytes_per_pixel,
+                             p_map->tile_width * p_src_img->bytes_per_pixel, p_map->tile_height,
+                             p_map->width_in_tiles, p_row_hashes);
                 benchmark_slot_update(9);
 
-
+                // Look up the whole row (prefetches ahead), tiles registered
+                // by earlier cells of the row get looked up again below
                 benchmark_slot_start(2);
-                // TODO: search could be optimized with a hash array / partitioning
-                map_entry = tile_find_match(tile.hash[0], &tile_set, tile_map.search_mask);
-                //printf("New Tile: (%3d, %3d) tile_id=%4d, tile_hash[0] = %8lx \n", img_x, img_y, tile_id, tile.hash[0]);
+                tile_index_find_batch(&index, p_row_hashes, p_map->width_in_tiles, p_row_slots);
                 benchmark_slot_update(2);
 
+                row_tile_count = p_tile_set->tile_count;
+                row_hashed     = true;
+            }
+
+            for (map_x = 0; map_x < p_map->width_in_tiles; map_x++) {
+
+                // Set buffer offset to upper left of current tile
+                img_buf_offset = tile_grid_get_offset(p_src_img, &p_map->grid, p_map->tile_width, p_map->tile_height,
+                                                      map_x, map_y);
+
+                // Record map cell in case this becomes the tile's first occurrence
+                tile.src_tile_x = map_x;
+                tile.src_tile_y = map_y;
+
+                // Packed tile sets pack every cell straight out of the image
+                // (hashed rows already are) and work on the packed pixels from
+                // there on. Otherwise tile-major tiles are read in place, and
+                // tiles get copied out of the image, hashed rows only need the
+                // pixels of new tiles (copied below)
+                p_pixels    = NULL;
+                pixel_bytes = tile.raw_size_bytes;
+                tile_copied = false;
+                if (p_tile_set->pack_bits) {
+                    pixel_bytes = tile.encoded_size_bytes;
+                    if (row_hashed)
+                        p_pixels = p_row_packed + ((size_t)map_x * pixel_bytes);
+                    else {
+                        benchmark_slot_start(0);
+                        tile_pack_cell(p_src_img, p_tm, p_map, tile.packed_bits, map_slot, tile.p_img_encoded);
+                        benchmark_slot_update(0);
+                        p_pixels    = tile.p_img_encoded;
+                        tile_copied = true;
+                    }
+                }
+                else if (p_tm)
+                    p_pixels = tile_major_get_tile(p_tm, map_slot);
+                else if (!row_hashed) {
+                    benchmark_slot_start(0);
+                    tile_copy_tile_from_image(p_src_img,
+                                              &tile,
+                                              img_buf_offset);
+                    benchmark_slot_update(0);
+                    p_pixels    = tile.p_img_raw;
+                    tile_copied = true;
+                }
+
+
+                // Small tiles: look up the pixels directly, no hashing.
+                // Falls back to the hash search for good if a pixel
+                // doesn't fit the packed key (all tiles carry hashes)
+                if (use_dkey && !tile_dkey_pack(&p_tile_set->dkey, p_pixels, pixel_bytes, dkeys[0])) {
+                    printf("Tilemap: Direct key: pixel out of range, using hash search\n");
+                    tile_dkey_disable(&p_tile_set->dkey);
+                    use_dkey = false;
+                }
+
+                if (use_dkey) {
+                    benchmark_slot_start(2);
+                    if (!tile_dkey_find(&p_tile_set->dkey, dkeys[0], &map_entry.id, &map_entry.attribs))
+                        map_entry.id = TILE_ID_NOT_FOUND;
+                    benchmark_slot_update(2);
+                }
+                else if (row_hashed) {
+                    benchmark_slot_start(2);
+                    tile.hash[0] = p_row_hashes[map_x];
+                    slot         = p_row_slots[map_x];
+                    if ((slot == TILE_INDEX_NOT_FOUND) && (p_tile_set->tile_count != row_tile_count))
+                        slot = tile_index_find(&index, tile.hash[0]);
+                    map_entry = tilemap_tile_set_index_entry(&index, slot);
+                    benchmark_slot_update(2);
+                }
+                else {
+                    // Direct keys were dropped partway through the row
+                    benchmark_slot_start(9);
+                    // TODO! Don't hash transparent pixels? Have to overwrite second byte?
+                    // TODO: BUG? Is this missing the extra tile 32 bit padding bytes?
+                    tile.hash[0] = hash_func(p_pixels, pixel_bytes);
+                    benchmark_slot_update(9);
+
+                    benchmark_slot_start(2);
+                    map_entry = tilemap_tile_set_index_entry(&index, tile_index_find(&index, tile.hash[0]));
+                    benchmark_slot_update(2);
+                }
+
                 // Tile not found, create a new entry
                 if (map_entry.id == TILE_ID_NOT_FOUND) {
 
+                    if (!tile_copied) {
+                        benchmark_slot_start(0);
+                        if (p_tile_set->pack_bits)
+                            memcpy(tile.p_img_encoded, p_pixels, tile.encoded_size_bytes);
+                        else if (p_tm)
+                            memcpy(tile.p_img_raw, p_pixels, tile.raw_size_bytes);
+                        else
+                            tile_copy_tile_from_image(p_src_img,
+                                                      &tile,
+                                                      img_buf_offset);
+                        benchmark_slot_update(0);
+                    }
+
                     benchmark_slot_start(3);
+                    // New tiles still get hashed, so the set stays usable
+                    // by the hash search
+                    if (use_dkey) {
+                        tile.hash[0] = hash_func(p_pixels, pixel_bytes);
+                        if (p_map->search_mask)
+                            tile_dkey_pack_flips(&p_tile_set->dkey, &tile, flip_tiles, dkeys);
+                    }
+
                     // Calculate remaining hash flip variations
                     // (only for tiles that get registered)
-                    if (tile_map.search_mask)
-                        tile_calc_alternate_hashes(&tile, flip_tiles);
+                    if (p_map->search_mask)
+                        tile_calc_alternate_hashes(&tile, flip_tiles, hash_func);
                     benchmark_slot_update(3);
 
                     benchmark_slot_start(4);
-                    map_entry = tile_register_new(&tile, &tile_set, tile_map.search_mask);
+                    map_entry = tile_register_new(&tile, p_tile_set, p_map->search_mask);
                     benchmark_slot_update(4);
 
                     if (map_entry.id == TILE_ID_OUT_OF_SPACE) {
@@ -187,25 +882,41 @@ benchmark_start();
                         tile_free(&tile);
                         tile_free(&flip_tiles[0]);
                         tile_free(&flip_tiles[1]);
-
-                        tilemap_free_resources();
+                        free(p_row_hashes);
+                        free(p_row_slots);
+                        free(p_row_packed);
+                        tile_index_free(&index);
 
                         printf("Tilemap: Process: FAIL -> Too Many Tiles\n");
                         return (false); // Ran out of tile space, exit
                     }
+
+                    // Sized for every tile the set can take, so this can't fill up
+                    tilemap_tile_set_index_add(&index, p_tile_set, map_entry.id, p_map->search_mask);
+
+                    if (use_dkey && !tile_dkey_add_tile(&p_tile_set->dkey, dkeys, map_entry.id)) {
+                        printf("Tilemap: Direct key: table allocation failed, using hash search\n");
+                        use_dkey = false;
+                    }
                 }
                 else // if (map_entry.id == TILE_ID_NOT_FOUND)
-                    tile_set.tiles[map_entry.id].map_entry_count++; // increment tile in map usage entry count
+                    p_tile_set->tiles[map_entry.id].map_entry_count++; // increment tile in map usage entry count
 
-                tile_map.tile_id_list[map_slot]      = map_entry.id;
-                tile_map.tile_attribs_list[map_slot] = map_entry.attribs;
+                p_map->tile_id_list[map_slot]      = map_entry.id;
+                p_map->tile_attribs_list[map_slot] = map_entry.attribs;
 
                 map_slot++;
             }
         }
 
     } else { // else if (tile.p_img_raw) {
-        tilemap_free_resources();
+        tile_free(&tile);
+        tile_free(&flip_tiles[0]);
+        tile_free(&flip_tiles[1]);
+        free(p_row_hashes);
+        free(p_row_slots);
+        free(p_row_packed);
+        tile_index_free(&index);
         return (false); // Failed to allocate buffer, exit
     }
 
@@ -213,12 +924,16 @@ benchmark_start();
     tile_free(&tile);
     tile_free(&flip_tiles[0]);
     tile_free(&flip_tiles[1]);
+    free(p_row_hashes);
+    free(p_row_slots);
+    free(p_row_packed);
+    tile_index_free(&index);
 
 benchmark_elapsed();
 benchmark_slot_printall();
 
     return (true);
-//    printf("Tilemap: Process: Total Tiles=%d\n", tile_set.tile_count);
+//    printf("Tilemap: Process: Total Tiles=%d\n", p_tile_set->tile_count);
 }
 
 void tile_flip_y(tile_data * p_src_tile, tile_data * p_dst_tile) {
@@ -293,37 +1008,108 @@ void tile_flip_x(tile_data * p_src_tile, tile_data * p_dst_tile) {
 }
 
 
-void tile_calc_alternate_hashes(tile_data * p_tile, tile_data flip_tiles[]) {
+// Pack direct keys for the flip x / y / xy variants of a tile into keys[1..3]
+// (keys[0] must already hold the unflipped tile)
+void tile_dkey_pack_flips(tile_dkey_data * p_dkey, tile_data * p_tile, tile_data flip_tiles[], uint8_t keys[][TILE_DKEY_BYTES_MAX]) {
+
+    // Packed tiles are their own key
+    if (p_tile->packed_bits) {
+        tile_packed_flip_x(p_tile->p_img_encoded, flip_tiles[0].p_img_encoded, p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        tile_dkey_pack(p_dkey, flip_tiles[0].p_img_encoded, flip_tiles[0].encoded_size_bytes, keys[1]);
+
+        tile_packed_flip_y(p_tile->p_img_encoded, flip_tiles[0].p_img_encoded, p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        tile_dkey_pack(p_dkey, flip_tiles[0].p_img_encoded, flip_tiles[0].encoded_size_bytes, keys[2]);
+
+        tile_packed_flip_x(flip_tiles[0].p_img_encoded, flip_tiles[1].p_img_encoded, p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        tile_dkey_pack(p_dkey, flip_tiles[1].p_img_encoded, flip_tiles[1].encoded_size_bytes, keys[3]);
+        return;
+    }
+
+    // Same pixel values as the unflipped tile, so packing can't fail
+    tile_flip_x(p_tile, &flip_tiles[0]);
+    tile_dkey_pack(p_dkey, flip_tiles[0].p_img_raw, flip_tiles[0].raw_size_bytes, keys[1]);
+
+    tile_flip_y(p_tile, &flip_tiles[0]);
+    tile_dkey_pack(p_dkey, flip_tiles[0].p_img_raw, flip_tiles[0].raw_size_bytes, keys[2]);
+
+    tile_flip_x(&flip_tiles[0], &flip_tiles[1]);
+    tile_dkey_pack(p_dkey, flip_tiles[1].p_img_raw, flip_tiles[1].raw_size_bytes, keys[3]);
+}
+
+
+void tile_calc_alternate_hashes(tile_data * p_tile, tile_data flip_tiles[], tile_hash_func hash_func) {
 
     //        if (mask_test & tile_map.search_mask) {
 
+    // Packed tiles get flipped and hashed as packed bytes
+    if (p_tile->packed_bits) {
+        tile_packed_flip_x(p_tile->p_img_encoded, flip_tiles[0].p_img_encoded, p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        p_tile->hash[1] = hash_func(flip_tiles[0].p_img_encoded, flip_tiles[0].encoded_size_bytes);
+
+        tile_packed_flip_y(p_tile->p_img_encoded, flip_tiles[0].p_img_encoded, p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        p_tile->hash[2] = hash_func(flip_tiles[0].p_img_encoded, flip_tiles[0].encoded_size_bytes);
+
+        tile_packed_flip_x(flip_tiles[0].p_img_encoded, flip_tiles[1].p_img_encoded, p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        p_tile->hash[3] = hash_func(flip_tiles[1].p_img_encoded, flip_tiles[1].encoded_size_bytes);
+
+        // Packed pixels stay unflipped as well, see below
+        return;
+    }
+
     // TODO: for now flip X and flip Y are joined together, so always check each permutation
 
     // Check for X flip (new copy of data)
     tile_flip_x(p_tile, &flip_tiles[0]);
-    p_tile->hash[1] = MurmurHash2( flip_tiles[0].p_img_raw, flip_tiles[0].raw_size_bytes, 0xF0A5); // len is u8count
+    p_tile->hash[1] = hash_func(flip_tiles[0].p_img_raw, flip_tiles[0].raw_size_bytes);
 
     // Check for Y flip (new copy of data)
     tile_flip_y(p_tile, &flip_tiles[0]);
-    p_tile->hash[2] = MurmurHash2( flip_tiles[0].p_img_raw, flip_tiles[0].raw_size_bytes, 0xF0A5); // len is u8count
+    p_tile->hash[2] = hash_func(flip_tiles[0].p_img_raw, flip_tiles[0].raw_size_bytes);
 
     // Check for X-Y flip (re-use data from previous Y flip -> second flip tile)
     tile_flip_x(&flip_tiles[0], &flip_tiles[1]);
-    p_tile->hash[3] = MurmurHash2( flip_tiles[1].p_img_raw, flip_tiles[1].raw_size_bytes, 0xF0A5); // len is u8count
+    p_tile->hash[3] = hash_func(flip_tiles[1].p_img_raw, flip_tiles[1].raw_size_bytes);
+
+    // The tile's own pixels are left unflipped, so copied tiles
+    // store the same pixels reference storage reads from the source
+}
+
+
+
+int32_t tilemap_check_dimensions_valid(image_data * p_src_img, int tile_width, int tile_height) {
 
-    // TODO: POSSIBLE BUG? why is the  x + y flipped output copied on top of the original source tile?
-    memcpy(p_tile->p_img_raw, flip_tiles[1].p_img_raw, flip_tiles[1].raw_size_bytes);
+    tile_grid_data grid_packed = {GRID_MARGIN_NONE, GRID_SPACING_NONE};
+
+    return tilemap_check_grid_dimensions_valid(p_src_img, tile_width, tile_height, &grid_packed);
 }
 
 
+// Same, for tiles laid out with a margin and spacing (see tilemap_grid.c)
+//
+// * Packed tiles: image dimensions must be exact multiples of tile size
+// * Margin or spacing: any size that holds at least one tile, pixels
+//   right of / below the last whole tile are ignored
+int32_t tilemap_check_grid_dimensions_valid(image_data * p_src_img, int tile_width, int tile_height,
+                                            tile_grid_data * p_grid) {
 
-static int32_t check_dimensions_valid(image_data * p_src_img, int tile_width, int tile_height) {
+    uint64_t width_in_tiles, height_in_tiles;
 
     // TODO: propagate error up to user dialog
 
-    // Image dimensions must be exact multiples of tile size
-    if ( ((p_src_img->width % tile_width) != 0) ||
-         ((p_src_img->height % tile_height ) != 0))
+    if ((tile_width < 1) || (tile_height < 1)
+        || (p_grid->margin > GRID_SIZE_MAX) || (p_grid->spacing > GRID_SIZE_MAX))
+        return false; // Fail
+
+    width_in_tiles  = tile_grid_get_count(p_src_img->width,  tile_width,  p_grid);
+    height_in_tiles = tile_grid_get_count(p_src_img->height, tile_height, p_grid);
+
+    if (!tile_grid_is_set(p_grid)
+        && (((p_src_img->width % tile_width) != 0) || ((p_src_img->height % tile_height) != 0)))
+        return false; // Fail
+    else if ((width_in_tiles == 0) || (height_in_tiles == 0))
+        return false; // Fail
+    // Map entry count must fit the 32 bit map size
+    else if ((width_in_tiles * height_in_tiles) > UINT32_MAX)
         return false; // Fail
     else
         return true;  // Success
@@ -331,52 +1117,331 @@ static int32_t check_dimensions_valid(image_data * p_src_img, int tile_width, in
 
 
 
-void tilemap_free_tile_set(void) {
+static void tilemap_ctx_free_tile_set(tilemap_ctx * p_ctx) {
         int c;
+        tile_set_data * p_tile_set = &p_ctx->tile_set;
 
     // Free all the tile set data
-    for (c = 0; c < tile_set.tile_count; c++) {
+    for (c = 0; c < p_tile_set->tile_count; c++)
+        tile_release_pixels(p_tile_set, &p_tile_set->tiles[c]);
 
-        if (tile_set.tiles[c].p_img_encoded)
-            free(tile_set.tiles[c].p_img_encoded);
-        tile_set.tiles[c].p_img_encoded = NULL;
+    p_tile_set->tile_count  = 0;
+    p_tile_set->tile_count_locked = 0;
 
-        if (tile_set.tiles[c].p_img_raw)
-            free(tile_set.tiles[c].p_img_raw);
-        tile_set.tiles[c].p_img_raw = NULL;
-    }
+    // Drops the spill file (if any) along with the tiles it held
+    tile_store_release(&p_tile_set->store);
 
-    tile_set.tile_count  = 0;
+    tile_dkey_release(&p_tile_set->dkey);
 }
 
-void tilemap_free_resources(void) {
 
-    tilemap_free_tile_set();
+void tilemap_ctx_free_resources(tilemap_ctx * p_ctx) {
+
+    tilemap_ctx_free_tile_set(p_ctx);
 
     // Free tile map data
-    if (tile_map.tile_id_list) {
-        free(tile_map.tile_id_list);
-        tile_map.tile_id_list = NULL;
+    tilemap_map_free(&p_ctx->tile_map);
+    tilemap_rooms_free(&p_ctx->rooms);
+    tilemap_sprites_free(&p_ctx->sprites);
+}
+
+
+void tilemap_map_free(tile_map_data * p_map) {
+
+    if (p_map->tile_id_list) {
+        free(p_map->tile_id_list);
+        p_map->tile_id_list = NULL;
+    }
+
+    if (p_map->tile_attribs_list) {
+        free(p_map->tile_attribs_list);
+        p_map->tile_attribs_list = NULL;
+    }
+
+    if (p_map->tile_error_list) {
+        free(p_map->tile_error_list);
+        p_map->tile_error_list = NULL;
+    }
+
+    if (p_map->p_packed) {
+        free(p_map->p_packed);
+        p_map->p_packed = NULL;
+    }
+
+    tilemap_rle_free(p_map);
+    tilemap_window_free(&p_map->window);
+    tilemap_metatile_free(&p_map->metatiles);
+}
+
+
+
+// Convert a processed map to packed storage and release the id/attribs lists
+//
+// * Entry width is 8, 16 or 32 bits, picked from the tile count
+// * When flip checking is on, flip bits get folded in above the tile ID
+//   (TILES_MAX_DEFAULT keeps ID + flip bits well within 32 bits)
+// * Must be called once the tile count is final (after any reduction)
+// * rle_enabled: also convert to run-length rows when that is smaller
+int32_t tilemap_map_pack(tile_map_data * p_map, uint32_t tile_count, int rle_enabled) {
+
+    uint32_t c;
+    uint32_t entry;
+    uint8_t  id_bits, flip_bits;
+
+    if (p_map->p_packed || p_map->p_rle_run_x)
+        return true; // Already packed
+
+    if (!(p_map->tile_id_list && p_map->tile_attribs_list))
+        return false;
+
+    // Bits needed for the highest tile ID (at least 1)
+    id_bits = 1;
+    while ((id_bits < 32) && (tile_count > ((uint32_t)1 << id_bits)))
+        id_bits++;
+
+    flip_bits = (p_map->search_mask != TILE_FLIP_BITS_NONE) ? 2 : 0; // TILE_FLIP_MASK
+
+    if ((id_bits + flip_bits) <= 8)
+        p_map->packed_entry_bytes = sizeof(uint8_t);
+    else if ((id_bits + flip_bits) <= 16)
+        p_map->packed_entry_bytes = sizeof(uint16_t);
+    else
+        p_map->packed_entry_bytes = sizeof(uint32_t);
+
+    p_map->packed_flip_shift = id_bits;
+    p_map->packed_id_mask    = (id_bits < 32) ? (((uint32_t)1 << id_bits) - 1) : 0xFFFFFFFF;
+
+    p_map->p_packed = malloc((size_t)p_map->size * p_map->packed_entry_bytes);
+    if (!p_map->p_packed)
+        return false;
+
+    for (c = 0; c < p_map->size; c++) {
+
+        entry = p_map->tile_id_list[c];
+        if (flip_bits)
+            entry |= (uint32_t)(p_map->tile_attribs_list[c] & TILE_FLIP_MASK) << id_bits;
+
+        switch (p_map->packed_entry_bytes) {
+            case sizeof(uint8_t):  ((uint8_t  *)p_map->p_packed)[c] = entry; break;
+            case sizeof(uint16_t): ((uint16_t *)p_map->p_packed)[c] = entry; break;
+            default:               ((uint32_t *)p_map->p_packed)[c] = entry; break;
+        }
+    }
+
+    printf("Tilemap: Packed map to %d bit entries (%d bit IDs, flip bits %s)\n",
+           p_map->packed_entry_bytes * 8, id_bits, (flip_bits) ? "folded in" : "off");
+
+    free(p_map->tile_id_list);
+    p_map->tile_id_list = NULL;
+
+    free(p_map->tile_attribs_list);
+    p_map->tile_attribs_list = NULL;
+
+    // Optionally compress further into run-length rows,
+    // otherwise just measure the RLE size for reporting
+    if (rle_enabled)
+        return tilemap_rle_encode(p_map);
+
+    tilemap_rle_measure(p_map);
+    return true;
+}
+
+
+
+// Packed entry word for a map index (packed or RLE maps only)
+uint32_t tilemap_map_get_entry(tile_map_data * p_map, uint32_t index) {
+
+    if (p_map->p_rle_run_x)
+        return tilemap_rle_get_entry(p_map, index);
+
+    switch (p_map->packed_entry_bytes) {
+        case sizeof(uint8_t):  return ((uint8_t  *)p_map->p_packed)[index];
+        case sizeof(uint16_t): return ((uint16_t *)p_map->p_packed)[index];
+        default:               return ((uint32_t *)p_map->p_packed)[index];
+    }
+}
+
+
+// Flip bits of a packed entry word
+static inline uint16_t map_entry_attribs(tile_map_data * p_map, uint32_t entry) {
+
+    if (p_map->packed_flip_shift >= 32)
+        return TILE_FLIP_BITS_NONE;
+    return (entry >> p_map->packed_flip_shift) & TILE_FLIP_MASK;
+}
+
+
+// Tile ID of a map entry, works for any map storage form
+uint32_t tilemap_map_get_id(tile_map_data * p_map, uint32_t index) {
+
+    if (p_map->p_packed || p_map->p_rle_run_x)
+        return tilemap_map_get_entry(p_map, index) & p_map->packed_id_mask;
+    else
+        return p_map->tile_id_list[index];
+}
+
+
+// Tile attributes (flip bits) of a map entry, works for any map storage form
+uint16_t tilemap_map_get_attribs(tile_map_data * p_map, uint32_t index) {
+
+    if (p_map->p_packed || p_map->p_rle_run_x)
+        return map_entry_attribs(p_map, tilemap_map_get_entry(p_map, index));
+    else
+        return p_map->tile_attribs_list[index];
+}
+
+
+// Bytes used by the map entries in their current storage
+uint64_t tilemap_map_get_size_bytes(tile_map_data * p_map) {
+
+    if (p_map->p_rle_run_x)
+        return tilemap_rle_get_size_bytes(p_map);
+    else if (p_map->p_packed)
+        return (uint64_t)p_map->size * p_map->packed_entry_bytes;
+    else
+        return (uint64_t)p_map->size * (sizeof(uint32_t) + sizeof(uint16_t));
+}
+
+
+// Bytes the map entries use (or would use) as flat packed entries
+uint64_t tilemap_map_get_flat_size_bytes(tile_map_data * p_map) {
+
+    if (p_map->p_packed || p_map->p_rle_run_x)
+        return (uint64_t)p_map->size * p_map->packed_entry_bytes;
+    else
+        return tilemap_map_get_size_bytes(p_map);
+}
+
+
+// Duplicate a packed (or RLE) map, p_dst_map gets its own buffers
+int32_t tilemap_map_copy(tile_map_data * p_dst_map, tile_map_data * p_src_map) {
+
+    memcpy(p_dst_map, p_src_map, sizeof(tile_map_data));
+    p_dst_map->tile_id_list      = NULL;
+    p_dst_map->tile_attribs_list = NULL;
+    p_dst_map->tile_error_list   = NULL;
+    p_dst_map->p_packed          = NULL;
+    p_dst_map->p_rle_row_index   = NULL;
+    p_dst_map->p_rle_run_x       = NULL;
+    p_dst_map->p_rle_run_entry   = NULL;
+
+    if (!tilemap_window_copy(&p_dst_map->window, &p_src_map->window))
+        return false;
+
+    if (!tilemap_metatile_copy(&p_dst_map->metatiles, &p_src_map->metatiles))
+        return false;
+
+    // Reduction error per entry (for the overlay), if the map was reduced
+    if (p_src_map->tile_error_list) {
+        p_dst_map->tile_error_list = malloc(p_src_map->size * sizeof(uint32_t));
+        if (!p_dst_map->tile_error_list)
+            return false;
+
+        memcpy(p_dst_map->tile_error_list, p_src_map->tile_error_list, p_src_map->size * sizeof(uint32_t));
+    }
+
+    if (p_src_map->p_rle_run_x)
+        return tilemap_rle_copy(p_dst_map, p_src_map);
+
+    if (!p_src_map->p_packed)
+        return false;
+
+    p_dst_map->p_packed = malloc(tilemap_map_get_size_bytes(p_src_map));
+    if (!p_dst_map->p_packed)
+        return false;
+
+    memcpy(p_dst_map->p_packed, p_src_map->p_packed, tilemap_map_get_size_bytes(p_src_map));
+    return true;
+}
+
+
+// Start reading a map sequentially from the first entry
+void tilemap_map_iter_init(tile_map_iter * p_iter, tile_map_data * p_map) {
+
+    p_iter->p_map = p_map;
+    p_iter->index = 0;
+    p_iter->x     = 0;
+    p_iter->y     = 0;
+    p_iter->run   = 0;
+}
+
+
+// Read the current entry and advance, RLE maps are decoded
+// run by run instead of searching for every entry
+void tilemap_map_iter_next(tile_map_iter * p_iter, uint32_t * p_id, uint16_t * p_attribs) {
+
+    tile_map_data * p_map;
+    uint32_t        entry;
+
+    p_map = p_iter->p_map;
+
+    if (p_map->p_rle_run_x) {
+
+        if (p_iter->x == 0)
+            p_iter->run = p_map->p_rle_row_index[p_iter->y];
+        else if (((p_iter->run + 1) < p_map->p_rle_row_index[p_iter->y + 1]) &&
+                 (p_map->p_rle_run_x[p_iter->run + 1] == p_iter->x))
+            p_iter->run++;
+
+        entry    = p_map->p_rle_run_entry[p_iter->run];
+        *p_id      = entry & p_map->packed_id_mask;
+        *p_attribs = map_entry_attribs(p_map, entry);
+    }
+    else {
+        *p_id      = tilemap_map_get_id(p_map, p_iter->index);
+        *p_attribs = tilemap_map_get_attribs(p_map, p_iter->index);
     }
 
-    if (tile_map.tile_attribs_list) {
-        free(tile_map.tile_attribs_list);
-        tile_map.tile_id_list = NULL;
+    p_iter->index++;
+    if (++p_iter->x == p_map->width_in_tiles) {
+        p_iter->x = 0;
+        p_iter->y++;
     }
+}
+
 
+
+// Tile IDs of every entry of a packed (or RLE) map, row-major
+// (caller frees the returned list, NULL if out of memory)
+uint32_t * tilemap_map_decode_ids(tile_map_data * p_map) {
+
+    tile_map_iter iter;
+    uint32_t    * p_ids;
+    uint32_t      c;
+    uint16_t      attribs;
+
+    p_ids = malloc((size_t)p_map->size * sizeof(uint32_t));
+    if (!p_ids)
+        return NULL;
+
+    tilemap_map_iter_init(&iter, p_map);
+    for (c = 0; c < p_map->size; c++)
+        tilemap_map_iter_next(&iter, &p_ids[c], &attribs);
+
+    return p_ids;
 }
 
 
 
 
-tile_map_data * tilemap_get_map(void) {
-    return (&tile_map);
+tile_map_data * tilemap_ctx_get_map(tilemap_ctx * p_ctx) {
+    return (&p_ctx->tile_map);
+}
+
+
+
+tile_set_data * tilemap_ctx_get_tile_set(tilemap_ctx * p_ctx) {
+    return (&p_ctx->tile_set);
 }
 
 
+tile_rooms_data * tilemap_ctx_get_rooms(tilemap_ctx * p_ctx) {
+    return (&p_ctx->rooms);
+}
 
-tile_set_data * tilemap_get_tile_set(void) {
-    return (&tile_set);
+
+tile_sprites_data * tilemap_ctx_get_sprites(tilemap_ctx * p_ctx) {
+    return (&p_ctx->sprites);
 }
 
 
@@ -385,16 +1450,18 @@ tile_set_data * tilemap_get_tile_set(void) {
 //
 // Returns an image which is a composite of all the
 // tiles in a tile map, in order.
-int32_t tilemap_get_image_of_deduped_tile_set(image_data * p_img) {
+int32_t tilemap_ctx_get_image_of_deduped_tile_set(tilemap_ctx * p_ctx, image_data * p_img) {
 
-    uint32_t c;
-    uint32_t img_offset;
+    uint32_t  c;
+    size_t    img_offset;
+    tile_view view;
+    tile_set_data * p_tile_set = &p_ctx->tile_set;
 
     // Set up image to store deduplicated tile set
-    p_img->width  = tile_map.tile_width;
-    p_img->height = tile_map.tile_height * tile_set.tile_count;
-    p_img->size   = tile_set.tile_size   * tile_set.tile_count;
-    p_img->bytes_per_pixel = tile_set.tile_bytes_per_pixel;
+    p_img->width  = p_ctx->tile_map.tile_width;
+    p_img->height = p_ctx->tile_map.tile_height * p_tile_set->tile_count;
+    p_img->size   = (uint64_t)p_tile_set->tile_size * p_tile_set->tile_count;
+    p_img->bytes_per_pixel = p_tile_set->tile_bytes_per_pixel;
 
     // printf("== COPY TILES INTO COMPOSITE BUF %d x %d, total size=%d\n", p_img->width, p_img->height, p_img->size);
 
@@ -405,21 +1472,18 @@ int32_t tilemap_get_image_of_deduped_tile_set(image_data * p_img) {
 
         img_offset = 0;
 
-        for (c = 0; c < tile_set.tile_count; c++) {
+        for (c = 0; c < p_tile_set->tile_count; c++) {
 
-            if (tile_set.tiles[c].p_img_raw) {
-                // Copy from the tile's raw image buffer (indexed)
-                // into the composite image
-                memcpy(p_img->p_img_data + img_offset,
-                       tile_set.tiles[c].p_img_raw,
-                       tile_set.tile_size);
+            // Materialize the tile's pixels (from either its private
+            // buffer or the source image) into the composite image
+            tile_get_view(p_tile_set, c, &view);
 
-                // tile_print_buffer_raw(tile_set.tiles[c]); // TODO: remove
-            }
+            if (view.p_data)
+                tile_view_copy_to_buffer(&view, p_img->p_img_data + img_offset);
             else
                 return false;
 
-            img_offset += tile_set.tile_size;
+            img_offset += p_tile_set->tile_size;
         }
     }
     else
@@ -429,12 +1493,109 @@ int32_t tilemap_get_image_of_deduped_tile_set(image_data * p_img) {
 }
 
 
+// Returns a view of a registered tile's pixels without copying them
+int32_t tilemap_ctx_get_tile_view(tilemap_ctx * p_ctx, uint32_t tile_id, tile_view * p_view) {
+
+    if (tile_id >= p_ctx->tile_set.tile_count)
+        return false;
+
+    tile_get_view(&p_ctx->tile_set, tile_id, p_view);
+
+    return (p_view->p_data != NULL);
+}
+
+
 // Set local indexed color map for later retrieval
-void tilemap_color_data_set(color_data * p_color_data) {
-    memcpy(&colormap, p_color_data, sizeof(color_data));
+void tilemap_ctx_color_data_set(tilemap_ctx * p_ctx, color_data * p_color_data) {
+    memcpy(&p_ctx->colormap, p_color_data, sizeof(color_data));
 }
 
 // Return pointer to locally stored indexed color map
-color_data * tilemap_color_data_get(void) {
-    return &colormap;
+color_data * tilemap_ctx_color_data_get(tilemap_ctx * p_ctx) {
+    return &p_ctx->colormap;
+}
+
+
+
+// ========================
+//
+// Default context wrappers
+//
+// The original single-context API, each call
+// operates on the built-in default context
+//
+// ========================
+
+void tilemap_recalc_invalidate(void)  { tilemap_ctx_recalc_invalidate(&ctx_default); }
+void tilemap_recalc_clear_flag(void)  { tilemap_ctx_recalc_clear_flag(&ctx_default); }
+int  tilemap_recalc_needed(void)      { return tilemap_ctx_recalc_needed(&ctx_default); }
+
+void tilemap_storage_mode_set(uint8_t storage_mode_new)   { tilemap_ctx_storage_mode_set(&ctx_default, storage_mode_new); }
+void tilemap_reduce_target_set(uint32_t target_count_new) { tilemap_ctx_reduce_target_set(&ctx_default, target_count_new); }
+void tilemap_map_rle_set(int rle_enabled_new)             { tilemap_ctx_map_rle_set(&ctx_default, rle_enabled_new); }
+void tilemap_hash_backend_set(uint8_t hash_backend_new)   { tilemap_ctx_hash_backend_set(&ctx_default, hash_backend_new); }
+void tilemap_dedupe_engine_set(uint8_t engine_new)         { tilemap_ctx_dedupe_engine_set(&ctx_default, engine_new); }
+void tilemap_packing_set(uint8_t packing_mode_new)         { tilemap_ctx_packing_set(&ctx_default, packing_mode_new); }
+void tilemap_tile_major_set(tile_major_image * p_tile_major) { tilemap_ctx_tile_major_set(&ctx_default, p_tile_major); }
+void tilemap_subpal_set(uint16_t count_new, uint16_t colors_new) { tilemap_ctx_subpal_set(&ctx_default, count_new, colors_new); }
+void tilemap_window_set(uint16_t width_new, uint16_t height_new)  { tilemap_ctx_window_set(&ctx_default, width_new, height_new); }
+void tilemap_rooms_set(uint16_t width_new, uint16_t height_new)   { tilemap_ctx_rooms_set(&ctx_default, width_new, height_new); }
+void tilemap_metatile_set(uint16_t width_new, uint16_t height_new) { tilemap_ctx_metatile_set(&ctx_default, width_new, height_new); }
+void tilemap_grid_set(uint16_t margin_new, uint16_t spacing_new) { tilemap_ctx_grid_set(&ctx_default, margin_new, spacing_new); }
+int32_t tilemap_base_set(image_data * p_img) { return tilemap_ctx_base_set(&ctx_default, p_img); }
+const uint8_t * tilemap_base_index_get(size_t * p_size) { return tilemap_ctx_base_index_get(&ctx_default, p_size); }
+int32_t tilemap_base_index_set(const uint8_t * p_index, size_t size_bytes) { return tilemap_ctx_base_index_set(&ctx_default, p_index, size_bytes); }
+
+void tilemap_memory_budget_set(uint64_t budget_bytes, uint64_t external_bytes) {
+    tilemap_ctx_memory_budget_set(&ctx_default, budget_bytes, external_bytes);
+}
+
+int32_t tilemap_tile_major_wanted(image_data * p_src_img, int tile_width, int tile_height) {
+    return tilemap_ctx_tile_major_wanted(&ctx_default, p_src_img, tile_width, tile_height);
+}
+
+
+void tilemap_free_resources(void) {
+    tilemap_ctx_free_resources(&ctx_default);
+}
+
+unsigned char process_tiles(image_data * p_src_img) {
+    return tilemap_ctx_process_tiles(&ctx_default, p_src_img);
+}
+
+unsigned char process_tiles_to_map(image_data * p_src_img, tile_map_data * p_map) {
+    return tilemap_ctx_process_tiles_to_map(&ctx_default, p_src_img, p_map);
+}
+
+unsigned char tilemap_export_process(image_data * p_src_img, int tile_width, int tile_height, int check_flip) {
+    return tilemap_ctx_export_process(&ctx_default, p_src_img, tile_width, tile_height, check_flip);
+}
+
+unsigned char tilemap_sprites_process(image_data * p_src_img, int check_flip) {
+    return tilemap_ctx_sprites_process(&ctx_default, p_src_img, check_flip);
+}
+
+int32_t tilemap_initialize(image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask) {
+    return tilemap_ctx_initialize(&ctx_default, p_src_img, tile_width, tile_height, search_mask);
+}
+
+void tilemap_tile_set_initialize(image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask) {
+    tilemap_ctx_tile_set_initialize(&ctx_default, p_src_img, tile_width, tile_height, search_mask);
+}
+
+
+tile_map_data * tilemap_get_map(void)      { return tilemap_ctx_get_map(&ctx_default); }
+tile_set_data * tilemap_get_tile_set(void) { return tilemap_ctx_get_tile_set(&ctx_default); }
+tile_rooms_data * tilemap_get_rooms(void)  { return tilemap_ctx_get_rooms(&ctx_default); }
+tile_sprites_data * tilemap_get_sprites(void)  { return tilemap_ctx_get_sprites(&ctx_default); }
+
+void         tilemap_color_data_set(color_data * p_color_data) { tilemap_ctx_color_data_set(&ctx_default, p_color_data); }
+color_data * tilemap_color_data_get(void)                      { return tilemap_ctx_color_data_get(&ctx_default); }
+
+int32_t tilemap_get_image_of_deduped_tile_set(image_data * p_img) {
+    return tilemap_ctx_get_image_of_deduped_tile_set(&ctx_default, p_img);
+}
+
+int32_t tilemap_get_tile_view(uint32_t tile_id, tile_view * p_view) {
+    return tilemap_ctx_get_tile_view(&ctx_default, tile_id, p_view);
 }
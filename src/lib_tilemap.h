@@ -5,8 +5,13 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "image_info.h"
+#include "tilemap_store.h"
+#include "tilemap_directkey.h"
+#include "tilemap_tilemajor.h"
+#include "tilemap_stats.h"
 
 #ifndef LIB_TILEMAP_HEADER
 #define LIB_TILEMAP_HEADER
@@ -39,6 +44,16 @@
     #define TILE_FLIP_MIN_FLIP  1
     #define TILE_FLIP_MAX       3
 
+    // Tile Set pixel storage modes
+    enum tile_storage_modes {
+        TILE_STORAGE_COPY      = 0, // Each registered tile keeps a private copy of its pixels
+        TILE_STORAGE_REFERENCE = 1, // Tiles point at their first occurrence in the source image
+        TILE_STORAGE_LAST
+    };
+
+    #define TILE_SUBPAL_SLOTS_MAX  64    // Most sub-palettes a solution can use
+    #define TILE_SUBPAL_UNFIT      0xFF  // tile_data.sub_palette: tile has too many colors for one sub-palette
+
     // Tile Map Entry records
     typedef struct {
         uint32_t id; // if TILES_MAX_DEFAULT > 255, this must be larger than uint8_t
@@ -46,21 +61,118 @@
     } tile_map_entry;
 
 
+    // Peak unique tiles of any viewport sized window on a map (see tilemap_window.c)
+    typedef struct {
+        uint16_t   view_width;    // Viewport in tiles, clipped to the map (0 = not analyzed)
+        uint16_t   view_height;
+        uint32_t   positions_x;   // Window positions across / down the map
+        uint32_t   positions_y;
+        uint32_t   peak_count;    // Most unique tiles in one window
+        uint32_t   peak_x;        // Upper left map cell of the (first) peak window
+        uint32_t   peak_y;
+        uint32_t * p_heat_x;      // Most unique tiles of any window starting in each column (positions_x entries)
+        uint32_t * p_heat_y;      // Most unique tiles of any window starting in each row (positions_y entries)
+    } tile_window_data;
+
+
+    // Metatiles: unique blocks of map entries (see tilemap_metatile.c)
+    typedef struct {
+        uint16_t   block_width;       // Tiles per metatile (0 = not built)
+        uint16_t   block_height;
+        uint32_t   width_in_blocks;   // Metatile map size (0 when the map isn't a multiple of the block size)
+        uint32_t   height_in_blocks;
+        uint32_t   count;             // Unique metatiles
+        uint8_t    key_bits;          // Bits per entry of the exact block keys, 0 if blocks were hashed
+        uint32_t * p_table_ids;       // Tile IDs of each metatile, row-major (count x block_width x block_height)
+        uint16_t * p_table_attribs;   // Attribs (flip bits) of each metatile entry, same layout
+        uint32_t * p_map;             // Metatile ID of each block, row-major
+    } tile_metatile_data;
+
+
+    // Unique sprite found on a sprite sheet (see tilemap_sprites.c)
+    typedef struct {
+        uint32_t   width;             // Bounding box in pixels
+        uint32_t   height;
+        uint32_t   pixel_count;       // Opaque pixels
+        uint32_t   use_count;         // Placements using this sprite
+        uint32_t   first_placement;   // Placement the pixels were taken from
+        size_t     offset;            // Start of the cropped pixels in p_pixels
+    } tile_sprite_data;
+
+    // Sprite instance on the sheet
+    typedef struct {
+        uint32_t   x;                 // Upper left of the bounding box in pixels
+        uint32_t   y;
+        uint32_t   sprite_id;
+        uint16_t   attribs;           // Flip bits to apply to the unique sprite to get this instance
+    } tile_sprite_placement;
+
+    // Sprite sheet mode: unique sprite list and placement table
+    typedef struct {
+        uint8_t    bytes_per_pixel;
+        uint16_t   search_mask;
+        uint32_t   count;             // Unique sprites
+        uint32_t   placement_count;   // Sprites found on the sheet, in scan order of their top row
+        uint32_t   run_count;         // Opaque pixel runs the labelling worked on
+        tile_sprite_data      * p_sprites;
+        tile_sprite_placement * p_placements;
+        uint8_t  * p_pixels;          // Cropped pixels of each unique sprite, transparent outside the sprite
+        size_t     pixels_size;
+    } tile_sprites_data;
+
+
+    // Layout of the tiles on a tile sheet (see tilemap_grid.c)
+    typedef struct {
+        uint16_t   margin;            // Pixels left of the first column and above the first row of tiles
+        uint16_t   spacing;           // Pixels between neighbouring tiles, both 0 for tightly packed tiles
+    } tile_grid_data;
+
+
     // Tile Map
     typedef struct {
-        uint16_t width_in_tiles;
-        uint16_t height_in_tiles;
+        uint32_t width_in_tiles;
+        uint32_t height_in_tiles;
         uint16_t tile_width;
         uint16_t tile_height;
-        uint16_t map_width;
-        uint16_t map_height;
-        uint32_t size;
+        uint32_t map_width;  // width_in_tiles x tile_width (margin and spacing not included)
+        uint32_t map_height;
+        tile_grid_data grid; // Where the tiles sit in the source image
+        uint32_t size; // Entry count (width_in_tiles x height_in_tiles)
         uint32_t * tile_id_list; // if TILES_MAX_DEFAULT > 255, this must be larger than uint8_t
         uint16_t * tile_attribs_list;
+        uint32_t * tile_error_list; // Per entry error vs. original tile after reduction (NULL if not reduced)
+        uint32_t   tile_error_max;
         uint16_t search_mask;
+
+        // Packed map (see tilemap_map_pack()), replaces the id and attribs
+        // lists once processing is done. Read entries via tilemap_map_get_id/attribs()
+        uint8_t  * p_packed;
+        uint8_t    packed_entry_bytes; // 1, 2 or 4 bytes per entry
+        uint8_t    packed_flip_shift;  // Flip bits are stored above the ID starting at this bit
+        uint32_t   packed_id_mask;
+
+        // Optional run-length rows (see tilemap_rle.c), replace the
+        // packed entries when smaller. Entries are packed words.
+        uint32_t * p_rle_row_index;    // First run of each row, height_in_tiles + 1 entries
+        uint32_t * p_rle_run_x;        // Starting column of each run
+        uint32_t * p_rle_run_entry;    // Packed entry of each run
+        uint32_t   rle_run_count;
+        uint64_t   rle_size_bytes;     // Size of the RLE form (set even when it wasn't kept)
+
+        tile_window_data window;       // Viewport residency, set after processing when enabled
+        tile_metatile_data metatiles;  // Second level map of tile blocks, set after processing when enabled
     } tile_map_data;
 
 
+    // Sequential reader for map entries (any storage form)
+    typedef struct {
+        tile_map_data * p_map;
+        uint32_t        index;
+        uint32_t        x, y;
+        uint32_t        run;
+    } tile_map_iter;
+
+
     // Individual Tile from Tile Set
     typedef struct {
         uint64_t  hash[4]; // 4 hash calcs: normal, flip-x, flip-y, flip-xy
@@ -68,12 +180,106 @@
         uint16_t  raw_width;
         uint16_t  raw_height;
         uint32_t  raw_size_bytes;     // size in bytes // TODO
-        uint32_t  encoded_size_bytes; // size in bytes
+        uint32_t  encoded_size_bytes; // size in bytes of p_img_encoded
+        uint8_t   packed_bits;        // Bits per pixel of p_img_encoded, 0 if not packed
         uint32_t  map_entry_count;
+        uint32_t  reduce_error; // Largest error of any tile merged into this one
+        uint32_t  src_tile_x; // Map cell where the tile first occurred
+        uint32_t  src_tile_y; // (pixel source for TILE_STORAGE_REFERENCE)
+        tile_stats stats;     // Colors used, transparency, uniformity (see tilemap_stats.c)
+        uint8_t   sub_palette;  // Sub-palette the tile uses (see tilemap_subpal.c), TILE_SUBPAL_UNFIT if none
         uint8_t * p_img_raw;
-        uint8_t * p_img_encoded;
+        uint8_t * p_img_encoded;      // Bit-packed pixels (see tilemap_packed.c), replaces p_img_raw when set
     } tile_data;
 
+
+    // Read-only, stride-aware view of a tile's pixels
+    // (may point into a private tile buffer or into the source image)
+    typedef struct {
+        uint8_t * p_data;          // Upper left pixel of the tile
+        size_t    row_stride;      // Bytes from the start of one tile row to the next
+        uint16_t  width;
+        uint16_t  height;
+        uint8_t   bytes_per_pixel;
+        uint8_t   packed_bits;     // Non-zero: p_data is bit-packed at this many bits per pixel
+                                   // (row_stride is in packed bytes), unpack via tile_view_copy_to_buffer()
+    } tile_view;
+
+    // Sub-palette assignment of a tile set (see tilemap_subpal.c)
+    typedef struct {
+        uint16_t count_max;   // Sub-palettes available on the target (0 = not solved)
+        uint16_t colors_max;  // Colors per sub-palette
+        uint16_t count;       // Sub-palettes used, more than count_max when the tiles don't fit
+        uint32_t tiles_unfit; // Tiles with more than colors_max colors
+        uint64_t colors[TILE_SUBPAL_SLOTS_MAX][4]; // Colormap indices of each sub-palette (bit n = index n)
+    } tile_subpal_data;
+
+    // One room of a map split into fixed size rooms (see tilemap_rooms.c)
+    typedef struct {
+        uint32_t x;             // Upper left map cell
+        uint32_t y;
+        uint16_t width;         // In tiles, rooms along the right and bottom edges can be smaller
+        uint16_t height;
+        uint32_t tile_count;    // Local tile set size
+        uint32_t tiles_shared;  // Local tiles that other rooms use too
+        uint32_t offset;        // First entry of the room in p_tile_ids and p_cell_ids
+    } tile_room_data;
+
+    // Map split into rooms, each with a local tile set and map
+    typedef struct {
+        uint16_t room_width;       // Room size in tiles (0 = not split)
+        uint16_t room_height;
+        uint32_t rooms_x;          // Rooms across / down the map
+        uint32_t rooms_y;
+        uint32_t count;
+        uint32_t tile_count;       // Global tiles (entries in p_room_refs)
+        uint32_t tiles_shared;     // Global tiles used by more than one room
+        uint32_t tile_count_max;   // Largest local tile set
+        tile_room_data * p_rooms;
+        uint32_t * p_tile_ids;     // Global tile ID of each local tile (room offset + local ID)
+        uint16_t * p_cell_ids;     // Local tile ID of each room cell, row-major in the room (room offset + cell)
+        uint32_t * p_room_refs;    // Rooms using each global tile
+    } tile_rooms_data;
+
+    // Locked base tile set every map starts out with (see tilemap_base.c)
+    typedef struct {
+        image_data src_img;        // Private copy of the base tile set image (p_img_data NULL = no base)
+        uint64_t   src_checksum;   // Of src_img, ties a built index to it
+        uint8_t  * p_index;        // Built index: hashes, stats and pixels of every base tile (NULL = none yet)
+        size_t     index_size;     // In bytes
+    } tile_base_data;
+
+    #define LAYERS_MAX          32
+    #define LAYER_NAME_MAX_LEN  31
+
+    // One tile map per layer, all built against the shared tile set (see tilemap_layers.c)
+    typedef struct {
+        int32_t        layer_id;
+        char           name[LAYER_NAME_MAX_LEN + 1];
+        image_data     img;         // Layer pixels (owned, released once the map is built)
+        tile_map_data  map;
+        uint32_t       tiles_new;   // Tiles first registered by this layer
+        uint32_t       tiles_used;  // Unique tiles referenced by this layer's map
+        int32_t        status;
+    } layer_map_data;
+
+    // All-layers run: the per-layer maps and the worker building them
+    typedef struct {
+        layer_map_data  layers[LAYERS_MAX];
+        uint32_t        count;          // Submitted (caller's thread)
+        uint32_t        done;           // Processed (worker thread)
+        int             closed;         // No more layers will be submitted
+        int             failed;
+        image_data      format;         // Size and bit depth every layer must match
+        int             tile_width;
+        int             tile_height;
+        uint16_t        search_mask;
+        pthread_t       worker;
+        int             worker_running;
+        pthread_mutex_t lock;           // Guards count, done and closed while the worker runs
+        pthread_cond_t  cond;
+    } tile_layers_data;
+
     // Tile Set (composed of individual tiles)
     typedef struct {
         uint8_t  tile_bytes_per_pixel; // TODO: convert me to tiles[n].raw_bytes_per_pixel, raw_width, raw_height
@@ -81,28 +287,162 @@
         uint16_t tile_height;
         uint32_t tile_size;  // size in bytes
         uint32_t tile_count;
+        uint32_t tile_count_unreduced; // Unique tile count before reduction (0 if not reduced)
+        uint32_t tile_count_locked;    // Leading tiles from the base tile set, reduction keeps them (0 if none)
+        uint8_t  storage_mode; // enum tile_storage_modes
+        uint8_t  hash_backend; // enum tile_hash_backends, resolved (every tile hash uses it)
+        uint8_t  pack_bits;    // Tiles are hashed and stored bit-packed at this many bits per pixel (0 = off)
+        image_data src_img;    // Source image descriptor, used by TILE_STORAGE_REFERENCE
+        tile_grid_data grid;   // Tile layout in src_img, used by TILE_STORAGE_REFERENCE
+        tile_store_data store; // Pixel buffers of the tiles (and memory budget)
+        tile_dkey_data  dkey;  // Exact-match key table for small tiles (see tilemap_directkey.c)
+        tile_subpal_data subpal; // Sub-palette assignment, set after processing
         tile_data tiles[TILES_MAX_DEFAULT];
     } tile_set_data;
 
 
+    // Processing context: a tile map, the tile set it indexes into and
+    // the settings used to build them. Separate contexts share no state,
+    // so they can be processed at the same time (one context at a time
+    // per thread). Create with tilemap_ctx_create().
+    //
+    // The tilemap_*() calls without a context argument
+    // operate on a built-in default context.
+    typedef struct {
+        tile_map_data tile_map;
+        tile_set_data tile_set;
+        color_data    colormap;
+
+        int           needs_recalc;
+        uint8_t       storage_mode;        // enum tile_storage_modes
+        uint32_t      reduce_target_count; // REDUCE_TARGET_NONE to disable
+        int           map_rle_enabled;
+        uint8_t       hash_backend;        // enum tile_hash_backends (TILE_HASH_AUTO by default)
+        uint8_t       dedupe_engine;       // enum tile_dedupe_engines (TILE_ENGINE_INCREMENTAL by default)
+        uint8_t       packing_mode;        // enum tile_packing_modes (TILE_PACKING_AUTO by default)
+        uint16_t      subpal_count;        // Sub-palettes to assign tiles to (SUBPAL_COUNT_NONE to disable)
+        uint16_t      subpal_colors;       // Colors per sub-palette
+        uint16_t      window_width;        // Viewport for residency analysis in tiles (WINDOW_VIEW_NONE to disable)
+        uint16_t      window_height;
+        uint16_t      metatile_width;      // Metatile size in tiles (METATILE_SIZE_NONE to disable)
+        uint16_t      metatile_height;
+        uint16_t      room_width;          // Room size in tiles for the per-room tile sets (ROOMS_SIZE_NONE to disable)
+        uint16_t      room_height;
+        tile_grid_data grid;               // Tile sheet margin and spacing in pixels (0, 0 for packed tiles)
+        tile_rooms_data rooms;             // Per-room tile sets of the map, set after processing when enabled
+        tile_sprites_data sprites;         // Sprite sheet mode result (see tilemap_ctx_sprites_process())
+        tile_base_data base;               // Locked base tile set, seeded into the tile set on initialize
+        tile_layers_data layers;           // All-layers run state (see tilemap_ctx_layers_begin())
+        tile_major_image * p_tile_major;   // Tile-major copy of the source image (optional, not owned)
+    } tilemap_ctx;
+
+
+    tilemap_ctx * tilemap_ctx_create(void);
+    void          tilemap_ctx_destroy(tilemap_ctx * p_ctx);
+    tilemap_ctx * tilemap_ctx_get_default(void);
+
+    void tilemap_ctx_recalc_invalidate(tilemap_ctx * p_ctx);
+    void tilemap_ctx_recalc_clear_flag(tilemap_ctx * p_ctx);
+    int  tilemap_ctx_recalc_needed(tilemap_ctx * p_ctx);
+
+    void tilemap_ctx_storage_mode_set(tilemap_ctx * p_ctx, uint8_t);
+    void tilemap_ctx_reduce_target_set(tilemap_ctx * p_ctx, uint32_t);
+    void tilemap_ctx_memory_budget_set(tilemap_ctx * p_ctx, uint64_t, uint64_t);
+    void tilemap_ctx_map_rle_set(tilemap_ctx * p_ctx, int);
+    void tilemap_ctx_hash_backend_set(tilemap_ctx * p_ctx, uint8_t);
+    void tilemap_ctx_dedupe_engine_set(tilemap_ctx * p_ctx, uint8_t);
+    void tilemap_ctx_packing_set(tilemap_ctx * p_ctx, uint8_t);
+    void tilemap_ctx_tile_major_set(tilemap_ctx * p_ctx, tile_major_image *);
+    int32_t tilemap_ctx_tile_major_wanted(tilemap_ctx * p_ctx, image_data *, int, int);
+    void tilemap_ctx_subpal_set(tilemap_ctx * p_ctx, uint16_t, uint16_t);
+    void tilemap_ctx_window_set(tilemap_ctx * p_ctx, uint16_t, uint16_t);
+    void tilemap_ctx_rooms_set(tilemap_ctx * p_ctx, uint16_t, uint16_t);
+    void tilemap_ctx_metatile_set(tilemap_ctx * p_ctx, uint16_t, uint16_t);
+    void tilemap_ctx_grid_set(tilemap_ctx * p_ctx, uint16_t, uint16_t);
+    int32_t tilemap_ctx_base_set(tilemap_ctx * p_ctx, image_data *);
+    int32_t tilemap_ctx_base_apply(tilemap_ctx * p_ctx, uint16_t search_mask);
+    const uint8_t * tilemap_ctx_base_index_get(tilemap_ctx * p_ctx, size_t * p_size);
+    int32_t tilemap_ctx_base_index_set(tilemap_ctx * p_ctx, const uint8_t *, size_t);
+
+    void           tilemap_ctx_free_resources(tilemap_ctx * p_ctx);
+    unsigned char  tilemap_ctx_process_tiles(tilemap_ctx * p_ctx, image_data * p_src_img);
+    unsigned char  tilemap_ctx_process_tiles_to_map(tilemap_ctx * p_ctx, image_data * p_src_img, tile_map_data * p_map);
+    unsigned char  tilemap_ctx_export_process(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height, int check_flip);
+    unsigned char  tilemap_ctx_sprites_process(tilemap_ctx * p_ctx, image_data * p_src_img, int check_flip);
+    int32_t        tilemap_ctx_initialize(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask);
+    void           tilemap_ctx_tile_set_initialize(tilemap_ctx * p_ctx, image_data * p_src_img, int tile_width, int tile_height,
+                                                   uint16_t search_mask);
+
+    tile_map_data * tilemap_ctx_get_map(tilemap_ctx * p_ctx);
+    tile_set_data * tilemap_ctx_get_tile_set(tilemap_ctx * p_ctx);
+    tile_rooms_data * tilemap_ctx_get_rooms(tilemap_ctx * p_ctx);
+    tile_sprites_data * tilemap_ctx_get_sprites(tilemap_ctx * p_ctx);
+
+    void         tilemap_ctx_color_data_set(tilemap_ctx * p_ctx, color_data * p_color_data);
+    color_data * tilemap_ctx_color_data_get(tilemap_ctx * p_ctx);
+
+    int32_t tilemap_ctx_get_image_of_deduped_tile_set(tilemap_ctx * p_ctx, image_data * p_img);
+    int32_t tilemap_ctx_get_tile_view(tilemap_ctx * p_ctx, uint32_t tile_id, tile_view * p_view);
+
+
+    // Default context
     void tilemap_recalc_invalidate(void);
     void tilemap_recalc_clear_flag(void);
     int tilemap_recalc_needed(void);
 
     void tilemap_search_mask_set(uint16_t);
+    void tilemap_storage_mode_set(uint8_t);
+    void tilemap_reduce_target_set(uint32_t);
+    void tilemap_memory_budget_set(uint64_t, uint64_t);
+    void tilemap_map_rle_set(int);
+    void tilemap_hash_backend_set(uint8_t);
+    void tilemap_dedupe_engine_set(uint8_t);
+    void tilemap_packing_set(uint8_t);
+    void tilemap_tile_major_set(tile_major_image *);
+    int32_t tilemap_tile_major_wanted(image_data *, int, int);
+    void tilemap_subpal_set(uint16_t, uint16_t);
+    void tilemap_window_set(uint16_t, uint16_t);
+    void tilemap_rooms_set(uint16_t, uint16_t);
+    void tilemap_metatile_set(uint16_t, uint16_t);
+    void tilemap_grid_set(uint16_t, uint16_t);
+    int32_t tilemap_base_set(image_data *);
+    const uint8_t * tilemap_base_index_get(size_t * p_size);
+    int32_t tilemap_base_index_set(const uint8_t *, size_t);
 
     void           tilemap_free_resources(void);
     unsigned char  process_tiles(image_data * p_src_img);
+    unsigned char  process_tiles_to_map(image_data * p_src_img, tile_map_data * p_map);
     unsigned char  tilemap_export_process(image_data * p_src_img, int tile_width, int tile_height, int check_flip);
+    unsigned char  tilemap_sprites_process(image_data * p_src_img, int check_flip);
     int32_t        tilemap_initialize(image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask);
+    int32_t        tilemap_map_initialize(tile_map_data * p_map, image_data * p_src_img, int tile_width, int tile_height,
+                                          tile_grid_data * p_grid, uint16_t search_mask);
+    void           tilemap_tile_set_initialize(image_data * p_src_img, int tile_width, int tile_height, uint16_t search_mask);
+    void           tilemap_map_free(tile_map_data * p_map);
+    int32_t        tilemap_map_pack(tile_map_data * p_map, uint32_t tile_count, int rle_enabled);
+    uint32_t       tilemap_map_get_id(tile_map_data * p_map, uint32_t index);
+    uint16_t       tilemap_map_get_attribs(tile_map_data * p_map, uint32_t index);
+    uint32_t       tilemap_map_get_entry(tile_map_data * p_map, uint32_t index);
+    uint64_t       tilemap_map_get_size_bytes(tile_map_data * p_map);
+    uint64_t       tilemap_map_get_flat_size_bytes(tile_map_data * p_map);
+    int32_t        tilemap_map_copy(tile_map_data * p_dst_map, tile_map_data * p_src_map);
+    void           tilemap_map_iter_init(tile_map_iter * p_iter, tile_map_data * p_map);
+    void           tilemap_map_iter_next(tile_map_iter * p_iter, uint32_t * p_id, uint16_t * p_attribs);
+    uint32_t *     tilemap_map_decode_ids(tile_map_data * p_map);
+    int32_t        tilemap_check_dimensions_valid(image_data * p_src_img, int tile_width, int tile_height);
+    int32_t        tilemap_check_grid_dimensions_valid(image_data * p_src_img, int tile_width, int tile_height,
+                                                       tile_grid_data * p_grid);
 
     tile_map_data * tilemap_get_map(void);
     tile_set_data * tilemap_get_tile_set(void);
+    tile_rooms_data * tilemap_get_rooms(void);
+    tile_sprites_data * tilemap_get_sprites(void);
 
     void         tilemap_color_data_set(color_data * p_color_data);
     color_data * tilemap_color_data_get(void);
 
     int32_t tilemap_get_image_of_deduped_tile_set(image_data * p_img);
+    int32_t tilemap_get_tile_view(uint32_t tile_id, tile_view * p_view);
 
 #endif // LIB_TILEMAP_HEADER
 
@@ -15,17 +15,35 @@
 
 #include "scale.h"
 #include "scaler_nearestneighbor.h"
+#include "tilemap_pool.h"
 #include "benchmark.h"
 
-static scaled_output_info scaled_output;
-static gint scale_factor;
+// Default scaler state, used by the calls that don't take a context
+static scale_ctx scale_default;
+
+
+// One scale_ctx_apply() call, split into bands of source
+// rows that run on the thread pool (rows scale independently)
+typedef struct {
+    uint8_t * p_srcbuf;
+    uint8_t * p_destbuf;
+    gint      bpp;
+    gint      width, height;
+    gint      scale_factor;
+    uint8_t * p_cmap_buf;
+    gint      cmap_num_colors;
+    gint      dest_bpp;
+} scale_band_job;
+
+
+static void scale_band_task(void * p_arg, uint32_t band, uint32_t worker);
 
 
 // Returns scale factor (2, 3, etc) of a scaler
 //
-gint scale_factor_get(void) {
+gint scale_ctx_factor_get(scale_ctx * p_ctx) {
 
-    return (scale_factor);
+    return (p_ctx->scale_factor);
 }
 
 
@@ -34,17 +52,17 @@ gint scale_factor_get(void) {
 //
 // scaler_index: desired scaler (from the enum scaler_list)
 //
-void scale_factor_set(gint scale_factor_new) {
+void scale_ctx_factor_set(scale_ctx * p_ctx, gint scale_factor_new) {
 
     // Update local scale factor setting
-    scale_factor = scale_factor_new;
+    p_ctx->scale_factor = scale_factor_new;
 
     // Enforce min/max bounds
-    if      (scale_factor < SCALE_FACTOR_MIN)
-             scale_factor = SCALE_FACTOR_MIN;
+    if      (p_ctx->scale_factor < SCALE_FACTOR_MIN)
+             p_ctx->scale_factor = SCALE_FACTOR_MIN;
 
-    else if (scale_factor > SCALE_FACTOR_MAX)
-             scale_factor = SCALE_FACTOR_MAX;
+    else if (p_ctx->scale_factor > SCALE_FACTOR_MAX)
+             p_ctx->scale_factor = SCALE_FACTOR_MAX;
 }
 
 
@@ -57,8 +75,8 @@ void scale_factor_set(gint scale_factor_new) {
 //
 // Used to assist with output caching
 //
-scaled_output_info * scaled_info_get(void) {
-    return &scaled_output;
+scaled_output_info * scale_ctx_info_get(scale_ctx * p_ctx) {
+    return &p_ctx->scaled_output;
 }
 
 
@@ -68,10 +86,10 @@ scaled_output_info * scaled_info_get(void) {
 //
 // Used to clear output caching and trigger a redraw
 //
-void scaled_output_invalidate(void) {
+void scale_ctx_output_invalidate(scale_ctx * p_ctx) {
 
     printf("Scale: Invalidated\n");
-    scaled_output.valid_image = FALSE;
+    p_ctx->scaled_output.valid_image = FALSE;
 }
 
 
@@ -82,22 +100,22 @@ void scaled_output_invalidate(void) {
 //
 // Used to assist with output caching
 //
-gint scaled_output_check_reapply_scale(void) {
+gint scale_ctx_output_check_reapply_scale(scale_ctx * p_ctx) {
 
     // If either the scale factor changed or there is no valid
     // image rendered at the moment, then signal TRUE to indicate
     // scaling should be re-applied
 
     // printf("Scale: Check Reapply -> scale cached/new (%d/%d), valid=%d\n",
-    //         scaled_output.scale_factor, scale_factor,
-    //         scaled_output.valid_image);
+    //         p_ctx->scaled_output.scale_factor, p_ctx->scale_factor,
+    //         p_ctx->scaled_output.valid_image);
 
-    if ((scaled_output.scale_factor != scale_factor) ||
-        (scaled_output.valid_image == FALSE)) {
+    if ((p_ctx->scaled_output.scale_factor != p_ctx->scale_factor) ||
+        (p_ctx->scaled_output.valid_image == FALSE)) {
 
         printf("Scale: Check Reapply -> *Required = YES* : scale cached/new (%d/%d), valid=%d\n",
-               scaled_output.scale_factor, scale_factor,
-               scaled_output.valid_image);
+               p_ctx->scaled_output.scale_factor, p_ctx->scale_factor,
+               p_ctx->scaled_output.valid_image);
 
         return TRUE;
     }
@@ -110,56 +128,56 @@ gint scaled_output_check_reapply_scale(void) {
 //
 // Update output buffer size and re-allocate if needed
 //
-void scaled_output_check_reallocate(gint bpp_new, gint width_new, gint height_new)
+void scale_ctx_output_check_reallocate(scale_ctx * p_ctx, gint bpp_new, gint width_new, gint height_new)
 {
 
     size_t alloc_size;
 
-    printf("Scale: Check Realloc : (%d/%d) (%d/%d) (%d/%d) (%d/%d) (%"PRId32"/%d)..  ",
-        scaled_output.bpp          , bpp_new,
-        scaled_output.width        , width_new  * scale_factor,
-        scaled_output.height       , height_new * scale_factor,
-        scaled_output.scale_factor , scale_factor,
-        scaled_output.size_bytes   , (width_new  * scale_factor) * (height_new * scale_factor) * bpp_new);
+    printf("Scale: Check Realloc : (%d/%d) (%d/%d) (%d/%d) (%d/%d) (%"PRIu64"/%"PRIu64")..  ",
+        p_ctx->scaled_output.bpp          , bpp_new,
+        p_ctx->scaled_output.width        , width_new  * p_ctx->scale_factor,
+        p_ctx->scaled_output.height       , height_new * p_ctx->scale_factor,
+        p_ctx->scaled_output.scale_factor , p_ctx->scale_factor,
+        p_ctx->scaled_output.size_bytes   , (uint64_t)(width_new  * p_ctx->scale_factor) * (height_new * p_ctx->scale_factor) * bpp_new);
 
-    if ((scale_factor                != scaled_output.scale_factor) ||
-        ((width_new  * scale_factor) != scaled_output.width) ||
-        ((height_new * scale_factor) != scaled_output.height) ||
-        (bpp_new                    != scaled_output.bpp) ||
-        (scaled_output.p_scaledbuf == NULL) ||
-        (scaled_output.p_overlaybuf == NULL)) {
+    if ((p_ctx->scale_factor                != p_ctx->scaled_output.scale_factor) ||
+        ((width_new  * p_ctx->scale_factor) != p_ctx->scaled_output.width) ||
+        ((height_new * p_ctx->scale_factor) != p_ctx->scaled_output.height) ||
+        (bpp_new                            != p_ctx->scaled_output.bpp) ||
+        (p_ctx->scaled_output.p_scaledbuf == NULL) ||
+        (p_ctx->scaled_output.p_overlaybuf == NULL)) {
 
         // Update the buffer size and re-allocate.
-        scaled_output.bpp          = bpp_new;
-        scaled_output.width        = width_new  * scale_factor;
-        scaled_output.height       = height_new * scale_factor;
-        scaled_output.scale_factor = scale_factor;
-        scaled_output.size_bytes  = scaled_output.width * scaled_output.height * scaled_output.bpp;
-
-        if (scaled_output.p_scaledbuf) {
-            free(scaled_output.p_scaledbuf);
-            scaled_output.p_scaledbuf = NULL;
+        p_ctx->scaled_output.bpp          = bpp_new;
+        p_ctx->scaled_output.width        = width_new  * p_ctx->scale_factor;
+        p_ctx->scaled_output.height       = height_new * p_ctx->scale_factor;
+        p_ctx->scaled_output.scale_factor = p_ctx->scale_factor;
+        p_ctx->scaled_output.size_bytes   = (uint64_t)p_ctx->scaled_output.width * p_ctx->scaled_output.height * p_ctx->scaled_output.bpp;
+
+        if (p_ctx->scaled_output.p_scaledbuf) {
+            free(p_ctx->scaled_output.p_scaledbuf);
+            p_ctx->scaled_output.p_scaledbuf = NULL;
         }
 
-        if (scaled_output.p_overlaybuf) {
-            free(scaled_output.p_overlaybuf);
-            scaled_output.p_overlaybuf = NULL;
+        if (p_ctx->scaled_output.p_overlaybuf) {
+            free(p_ctx->scaled_output.p_overlaybuf);
+            p_ctx->scaled_output.p_overlaybuf = NULL;
         }
 
         // Allocate a working buffer to copy the source image into, 32 bit aligned
         // aligned_alloc expects SIZE to be a multiple of ALIGNMENT, so pad with a couple bytes if needed
-        alloc_size = scaled_output.size_bytes + (scaled_output.size_bytes % sizeof(uint32_t));
-        printf(" (allocating %zu bytes %" PRId32 " %zu) \n", alloc_size, scaled_output.size_bytes, (scaled_output.size_bytes % sizeof(uint32_t)));
+        alloc_size = p_ctx->scaled_output.size_bytes + (p_ctx->scaled_output.size_bytes % sizeof(uint32_t));
+        printf(" (allocating %zu bytes %" PRIu64 " %zu) \n", alloc_size, p_ctx->scaled_output.size_bytes, (p_ctx->scaled_output.size_bytes % sizeof(uint32_t)));
 
-        scaled_output.p_scaledbuf  = (uint8_t *)aligned_alloc(sizeof(uint32_t), alloc_size);
-        scaled_output.p_overlaybuf = (uint8_t *)aligned_alloc(sizeof(uint32_t), alloc_size);
+        p_ctx->scaled_output.p_scaledbuf  = (uint8_t *)aligned_alloc(sizeof(uint32_t), alloc_size);
+        p_ctx->scaled_output.p_overlaybuf = (uint8_t *)aligned_alloc(sizeof(uint32_t), alloc_size);
         // g_new allocation here is in u32, so no need to multiply by * BYTE_SIZE_RGBA_4BPP
         // Use matching g_free()
-        // scaled_output.p_scaledbuf  = (uint8_t *) g_new (guint32, scaled_output.width * scaled_output.height);
-        // scaled_output.p_overlaybuf = (uint8_t *) g_new (guint32, scaled_output.width * scaled_output.height);
+        // p_ctx->scaled_output.p_scaledbuf  = (uint8_t *) g_new (guint32, p_ctx->scaled_output.width * p_ctx->scaled_output.height);
+        // p_ctx->scaled_output.p_overlaybuf = (uint8_t *) g_new (guint32, p_ctx->scaled_output.width * p_ctx->scaled_output.height);
 
         // Invalidate the image
-        scaled_output.valid_image = FALSE;
+        p_ctx->scaled_output.valid_image = FALSE;
 
         printf("Reallocated. Valid (scaled image) -> to 0 (false)\n");
     }
@@ -172,31 +190,77 @@ void scaled_output_check_reallocate(gint bpp_new, gint width_new, gint height_ne
 //
 // Initialize rendered output shared structure
 //
-void scaled_output_init(void)
+void scale_ctx_output_init(scale_ctx * p_ctx)
 {
-      scaled_output.p_scaledbuf  = NULL;
-      scaled_output.p_overlaybuf = NULL;
-      scaled_output.width        = 0;
-      scaled_output.height       = 0;
-      scaled_output.x            = 0;
-      scaled_output.y            = 0;
-      scaled_output.scale_factor = 0;
-      scaled_output.size_bytes   = 0;
-      scaled_output.bpp          = 0;
-      scaled_output.valid_image  = FALSE;
+      p_ctx->scaled_output.p_scaledbuf  = NULL;
+      p_ctx->scaled_output.p_overlaybuf = NULL;
+      p_ctx->scaled_output.width        = 0;
+      p_ctx->scaled_output.height       = 0;
+      p_ctx->scaled_output.x            = 0;
+      p_ctx->scaled_output.y            = 0;
+      p_ctx->scaled_output.scale_factor = 0;
+      p_ctx->scaled_output.size_bytes   = 0;
+      p_ctx->scaled_output.bpp          = 0;
+      p_ctx->scaled_output.valid_image  = FALSE;
 }
 
 
-void scale_output_get_rgb_at_xy(int x, int y, uint8_t * p_r, uint8_t * p_g, uint8_t * p_b) {
-    uint32_t offset;
+void scale_ctx_output_get_rgb_at_xy(scale_ctx * p_ctx, int x, int y, uint8_t * p_r, uint8_t * p_g, uint8_t * p_b) {
+    uint64_t offset;
 
-    offset = ((y * scaled_output.width) + x) * scaled_output.bpp;
-    if ((offset + 2) >= scaled_output.size_bytes)
+    offset = (((uint64_t)y * p_ctx->scaled_output.width) + x) * p_ctx->scaled_output.bpp;
+    if ((offset + 2) >= p_ctx->scaled_output.size_bytes)
         return; // beyond range of image buffer
 
-    *p_r = *(scaled_output.p_scaledbuf + offset);
-    *p_g = *(scaled_output.p_scaledbuf + offset + 1);
-    *p_b = *(scaled_output.p_scaledbuf + offset + 2);
+    *p_r = *(p_ctx->scaled_output.p_scaledbuf + offset);
+    *p_g = *(p_ctx->scaled_output.p_scaledbuf + offset + 1);
+    *p_b = *(p_ctx->scaled_output.p_scaledbuf + offset + 2);
+}
+
+
+// Pool task: scale one band of source rows
+static void scale_band_task(void * p_arg, uint32_t band, uint32_t worker) {
+
+    scale_band_job * p_job;
+    gint             y, rows;
+    size_t           src_offset, dest_row_pixels;
+
+    p_job = (scale_band_job *)p_arg;
+
+    y    = band * SCALE_ROWS_PER_BAND;
+    rows = p_job->height - y;
+    if (rows > SCALE_ROWS_PER_BAND)
+        rows = SCALE_ROWS_PER_BAND;
+
+    // (64 bit math, large images exceed 4GB)
+    src_offset      = (size_t)y * p_job->width * p_job->bpp;
+    dest_row_pixels = (size_t)y * p_job->scale_factor * p_job->width * p_job->scale_factor;
+
+    switch(p_job->bpp) {
+        case BPP_RGB:
+            scaler_nearest_bpp_rgb(p_job->p_srcbuf + src_offset,
+                                   p_job->p_destbuf + (dest_row_pixels * BPP_RGB),
+                                   p_job->width, rows,
+                                   p_job->scale_factor, p_job->bpp);
+            break;
+
+        case BPP_RGBA:
+            scaler_nearest_bpp_rgba((uint32_t*)(p_job->p_srcbuf + src_offset),
+                                    (uint32_t*)p_job->p_destbuf + dest_row_pixels,
+                                    p_job->width, rows,
+                                    p_job->scale_factor, p_job->bpp);
+            break;
+
+        case BPP_INDEXED:
+        case BPP_INDEXEDA:
+            scaler_nearest_bpp_indexed(p_job->p_srcbuf + src_offset,
+                                       p_job->p_destbuf + (dest_row_pixels * p_job->dest_bpp),
+                                       p_job->width, rows,
+                                       p_job->scale_factor, p_job->bpp,
+                                       p_job->p_cmap_buf, p_job->cmap_num_colors,
+                                       p_job->dest_bpp);
+            break;
+    }
 }
 
 
@@ -205,55 +269,62 @@ void scale_output_get_rgb_at_xy(int x, int y, uint8_t * p_r, uint8_t * p_g, uint
 // Calls selected scaler function
 // Updates valid_image to assist with caching
 //
-void scale_apply(uint8_t * p_srcbuf, uint8_t * p_destbuf,
-                 gint bpp,
-                 gint width, gint height,
-                 uint8_t * p_cmap_buf, gint cmap_num_colors,
-                 gint dest_bpp) {
+void scale_ctx_apply(scale_ctx * p_ctx,
+                     uint8_t * p_srcbuf, uint8_t * p_destbuf,
+                     gint bpp,
+                     gint width, gint height,
+                     uint8_t * p_cmap_buf, gint cmap_num_colors,
+                     gint dest_bpp) {
+
+    scale_band_job job;
+    uint32_t       band_count;
 
     if ((p_srcbuf == NULL) || (p_destbuf == NULL))
         return;
 
-printf("Scale: Scaling image now: %dx, bpp=%d, valid image = %d\n", scale_factor, bpp, scaled_output.valid_image);
+printf("Scale: Scaling image now: %dx, bpp=%d, valid image = %d\n", p_ctx->scale_factor, bpp, p_ctx->scaled_output.valid_image);
+
+    if (p_ctx->scale_factor) {
+
+        job.p_srcbuf        = p_srcbuf;
+        job.p_destbuf       = p_destbuf;
+        job.bpp             = bpp;
+        job.width           = width;
+        job.height          = height;
+        job.scale_factor    = p_ctx->scale_factor;
+        job.p_cmap_buf      = p_cmap_buf;
+        job.cmap_num_colors = cmap_num_colors;
+        job.dest_bpp        = dest_bpp;
 
-    if (scale_factor) {
+        band_count = (height + (SCALE_ROWS_PER_BAND - 1)) / SCALE_ROWS_PER_BAND;
 
+        // Upscale by a factor of N from source (sp) to dest (dp)
         switch(bpp) {
             case BPP_RGB:
-                // Upscale by a factor of N from source (sp) to dest (dp)
                 printf("Scale: Start -> RGB  ");
-                benchmark_start();
-                scaler_nearest_bpp_rgb(p_srcbuf, p_destbuf,
-                                       width, height,
-                                       scale_factor, bpp);
-                benchmark_elapsed();
                 break;
 
             case BPP_RGBA:
-                // Upscale by a factor of N from source (sp) to dest (dp)
                 printf("Scale: Start -> RGBA  ");
-                benchmark_start();
-                scaler_nearest_bpp_rgba((uint32_t*)p_srcbuf, (uint32_t*)p_destbuf,
-                                       width, height,
-                                       scale_factor, bpp);
-                benchmark_elapsed();
                 break;
 
             case BPP_INDEXED:
             case BPP_INDEXEDA:
-                // Upscale by a factor of N from source (sp) to dest (dp)
                 printf("Scale: Start -> INDEXED/A  ");
-                benchmark_start();
-                scaler_nearest_bpp_indexed(p_srcbuf, p_destbuf,
-                                           width, height,
-                                           scale_factor, bpp,
-                                           p_cmap_buf, cmap_num_colors,
-                                           dest_bpp);
-                benchmark_elapsed();
-                                break;
+                break;
+
+            default:
+                band_count = 0; // Unsupported, leave output as is
+                break;
+        }
+
+        if (band_count) {
+            benchmark_start();
+            tilemap_pool_run(band_count, scale_band_task, &job);
+            benchmark_elapsed();
         }
 
-        scaled_output.valid_image = TRUE;
+        p_ctx->scaled_output.valid_image = TRUE;
 
     }
 }
@@ -266,16 +337,16 @@ printf("Scale: Scaling image now: %dx, bpp=%d, valid image = %d\n", scale_factor
 // Should be called only at the very
 // end of the plugin shutdown (not on dialog close)
 //
-void scale_release_resources(void) {
+void scale_ctx_release_resources(scale_ctx * p_ctx) {
 
-    if (scaled_output.p_scaledbuf)
-        free(scaled_output.p_scaledbuf);
-    scaled_output.p_scaledbuf = NULL;
+    if (p_ctx->scaled_output.p_scaledbuf)
+        free(p_ctx->scaled_output.p_scaledbuf);
+    p_ctx->scaled_output.p_scaledbuf = NULL;
 
 
-    if (scaled_output.p_overlaybuf)
-        free(scaled_output.p_overlaybuf);
-    scaled_output.p_overlaybuf = NULL;
+    if (p_ctx->scaled_output.p_overlaybuf)
+        free(p_ctx->scaled_output.p_overlaybuf);
+    p_ctx->scaled_output.p_overlaybuf = NULL;
 }
 
 
@@ -284,11 +355,47 @@ void scale_release_resources(void) {
 // Populate the shared list of available scalers with their names
 // calling functions and scale factors.
 //
-void scale_init(void) {
+void scale_ctx_init(scale_ctx * p_ctx) {
 
-    scaled_output_init();
+    scale_ctx_output_init(p_ctx);
 
     // Now set the default scaler
-    scale_factor = SCALE_FACTOR_DEFAULT;
+    p_ctx->scale_factor = SCALE_FACTOR_DEFAULT;
  }
 
+
+
+// ========================
+//
+// Default scaler wrappers
+//
+// ========================
+
+gint scale_factor_get(void)                  { return scale_ctx_factor_get(&scale_default); }
+void scale_factor_set(gint scale_factor_new) { scale_ctx_factor_set(&scale_default, scale_factor_new); }
+
+void scale_init(void)              { scale_ctx_init(&scale_default); }
+void scale_release_resources(void) { scale_ctx_release_resources(&scale_default); }
+
+void scale_apply(uint8_t * p_srcbuf, uint8_t * p_destbuf,
+                 gint bpp,
+                 gint width, gint height,
+                 uint8_t * p_cmap_buf, gint cmap_num_colors,
+                 gint dest_bpp) {
+    scale_ctx_apply(&scale_default, p_srcbuf, p_destbuf, bpp, width, height,
+                    p_cmap_buf, cmap_num_colors, dest_bpp);
+}
+
+void scale_output_get_rgb_at_xy(int x, int y, uint8_t * p_r, uint8_t * p_g, uint8_t * p_b) {
+    scale_ctx_output_get_rgb_at_xy(&scale_default, x, y, p_r, p_g, p_b);
+}
+
+scaled_output_info * scaled_info_get(void)  { return scale_ctx_info_get(&scale_default); }
+void scaled_output_invalidate(void)         { scale_ctx_output_invalidate(&scale_default); }
+gint scaled_output_check_reapply_scale(void) { return scale_ctx_output_check_reapply_scale(&scale_default); }
+
+void scaled_output_check_reallocate(gint bpp_new, gint width_new, gint height_new) {
+    scale_ctx_output_check_reallocate(&scale_default, bpp_new, width_new, height_new);
+}
+
+void scaled_output_init(void) { scale_ctx_output_init(&scale_default); }
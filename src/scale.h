@@ -29,18 +29,43 @@
     #define SCALE_BPP_MIN     1
     #define SCALE_BPP_MAX     4
 
+    #define SCALE_ROWS_PER_BAND 16  // Source rows per thread pool task
+
     typedef struct {
         int       x,y;
         int       width, height;
         int       scale_factor;
         int       bpp;
-        uint32_t  size_bytes; // scaledbuf_size;
+        uint64_t  size_bytes; // scaledbuf_size;
         int       valid_image;
 
         uint8_t * p_scaledbuf;
         uint8_t * p_overlaybuf;
     } scaled_output_info;
 
+    // Scaler state for one output (the calls without
+    // a context use a built-in default one)
+    typedef struct {
+        scaled_output_info scaled_output;
+        gint               scale_factor;
+    } scale_ctx;
+
+    gint scale_ctx_factor_get(scale_ctx * p_ctx);
+    void scale_ctx_factor_set(scale_ctx * p_ctx, gint);
+
+    void scale_ctx_init(scale_ctx * p_ctx);
+    void scale_ctx_release_resources(scale_ctx * p_ctx);
+    void scale_ctx_apply(scale_ctx * p_ctx, uint8_t *, uint8_t *, gint, gint, gint, uint8_t *, gint, gint);
+
+    void scale_ctx_output_get_rgb_at_xy(scale_ctx * p_ctx, int, int, uint8_t *, uint8_t *, uint8_t *);
+
+    scaled_output_info * scale_ctx_info_get(scale_ctx * p_ctx);
+    void scale_ctx_output_invalidate(scale_ctx * p_ctx);
+    gint scale_ctx_output_check_reapply_scale(scale_ctx * p_ctx);
+    void scale_ctx_output_check_reallocate(scale_ctx * p_ctx, gint, gint, gint);
+
+    void scale_ctx_output_init(scale_ctx * p_ctx);
+
     gint scale_factor_get(void);
     void scale_factor_set(gint);
 
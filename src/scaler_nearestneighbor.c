@@ -37,7 +37,7 @@ void scaler_nearest_bpp_rgb(uint8_t * sp, uint8_t * dp,
 
     if (scale_factor == 1) {
         // Quick 1:1 copy if scale factor is 1x
-        memcpy(dp, sp, Xres * Yres * src_bpp);
+        memcpy(dp, sp, (size_t)Xres * Yres * src_bpp);
     }
     else {
         line_width_scaled_bpp = (Xres * scale_factor * src_bpp);
@@ -91,7 +91,7 @@ void scaler_nearest_bpp_rgba(uint32_t * sp, uint32_t * dp,
 
     if (scale_factor == 1) {
         // Quick 1:1 copy if scale factor is 1x
-        memcpy(dp, sp, Xres * Yres * src_bpp);
+        memcpy(dp, sp, (size_t)Xres * Yres * src_bpp);
     }
     else {
         // Pre-calculate length of upscaled scanline
@@ -0,0 +1,477 @@
+//
+// tilemap_base.c
+//
+
+// ========================
+//
+// Locked base tile set.
+//
+// Tiles shared by every screen of a game (fonts, UI
+// frames) have to keep the same IDs in every map. A base
+// tile set image, e.g. a saved tile set export, gets loaded
+// into the tile set as IDs 0 .. n-1 before a map is
+// processed. Its tiles are read row by row, left to right,
+// so a tile strip keeps its top to bottom order.
+//
+// Processing finds base tiles like any other registered
+// tile and only appends the tiles the base doesn't have.
+// Reduction never merges base tiles away (see
+// tilemap_reduce.c), so the locked range stays intact.
+//
+// Indexing the base means copying (or packing) every tile,
+// hashing it in all four orientations and collecting its
+// stats. The result is kept as one flat block:
+//
+//   header | entry (hashes, stats) x n | pixels x n
+//
+// so seeding a tile set from it is a copy, and the block
+// can be handed out and taken back later (the plug-in keeps
+// it for the GIMP session). The header records the tile
+// format and a checksum of the base image, an index that
+// doesn't match either is built again.
+//
+// Duplicate tiles in the base keep their IDs, matches
+// resolve to the lowest one.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_base.h"
+#include "tilemap_tiles.h"
+#include "tilemap_hash.h"
+#include "tilemap_packed.h"
+#include "tilemap_store.h"
+#include "tilemap_stats.h"
+#include "tilemap_grid.h"
+#include "tilemap_directkey.h"
+
+#include "benchmark.h"
+
+
+#define BASE_CHECKSUM_MULT    0x9E3779B97F4A7C15ULL
+
+
+// Start of a built index, followed by the entries, then the pixels
+typedef struct {
+    uint32_t magic;            // BASE_INDEX_MAGIC
+    uint32_t tile_count;
+    uint64_t src_checksum;     // Base image the index was built from
+    uint32_t tile_bytes;       // Pixel bytes per tile (bit-packed size for packed tile sets)
+    uint16_t tile_width;
+    uint16_t tile_height;
+    uint8_t  bytes_per_pixel;
+    uint8_t  hash_backend;     // Resolved, hashes only match tile sets using the same one
+    uint8_t  pack_bits;
+    uint8_t  reserved;
+} base_index_header;
+
+// Per tile part of the index
+typedef struct {
+    uint64_t   hash[4];        // Normal, flip-x, flip-y, flip-xy
+    tile_stats stats;
+} base_index_entry;
+
+
+static uint64_t base_image_checksum(image_data * p_img);
+static size_t   base_index_get_size(uint32_t tile_count, uint32_t tile_bytes);
+static uint32_t base_tile_get_bytes(tile_set_data * p_tile_set);
+static int32_t  base_index_matches(tile_base_data * p_base, tile_set_data * p_tile_set);
+static int32_t  base_index_build(tile_base_data * p_base, tile_set_data * p_tile_set);
+static void     base_dkey_add(tile_set_data * p_tile_set, uint16_t search_mask);
+
+
+
+// Size plus a hash of every row, ties an index to the image it was built from
+static uint64_t base_image_checksum(image_data * p_img) {
+
+    tile_hash_func hash_func;
+    uint64_t       sum;
+    uint32_t       y, row_bytes;
+
+    hash_func = tile_hash_get_func(TILE_HASH_MULMIX64);
+    row_bytes = p_img->width * p_img->bytes_per_pixel;
+
+    sum = ((uint64_t)p_img->width << 32) ^ ((uint64_t)p_img->height << 8) ^ p_img->bytes_per_pixel;
+
+    for (y = 0; y < p_img->height; y++)
+        sum = (sum * BASE_CHECKSUM_MULT) ^ hash_func(p_img->p_img_data + ((size_t)y * row_bytes), row_bytes);
+
+    return sum;
+}
+
+
+static size_t base_index_get_size(uint32_t tile_count, uint32_t tile_bytes) {
+
+    return sizeof(base_index_header) + ((size_t)tile_count * (sizeof(base_index_entry) + tile_bytes));
+}
+
+
+// Pixel bytes the tile set stores per tile
+static uint32_t base_tile_get_bytes(tile_set_data * p_tile_set) {
+
+    if (p_tile_set->pack_bits)
+        return tile_packed_get_size(p_tile_set->tile_width, p_tile_set->tile_height, p_tile_set->pack_bits);
+    else
+        return p_tile_set->tile_size;
+}
+
+
+
+int32_t tilemap_base_is_set(tile_base_data * p_base) {
+
+    return (p_base->src_img.p_img_data != NULL);
+}
+
+
+// Use a copy of p_img as the base tile set (NULL or no pixels: no base)
+//
+// * A built index is kept, seeding checks whether it
+//   still belongs to the image (same pixels) and tile set
+// * Returns false if the copy can't be allocated, there is no base then
+int32_t tilemap_base_set_image(tile_base_data * p_base, image_data * p_img) {
+
+    if (p_base->src_img.p_img_data)
+        free(p_base->src_img.p_img_data);
+
+    memset(&p_base->src_img, 0x00, sizeof(image_data));
+    p_base->src_checksum = 0;
+
+    if (!p_img || !p_img->p_img_data)
+        return true;
+
+    memcpy(&p_base->src_img, p_img, sizeof(image_data));
+    p_base->src_img.p_img_data = malloc(p_img->size);
+
+    if (!p_base->src_img.p_img_data) {
+        memset(&p_base->src_img, 0x00, sizeof(image_data));
+        return false;
+    }
+
+    memcpy(p_base->src_img.p_img_data, p_img->p_img_data, p_img->size);
+    p_base->src_checksum = base_image_checksum(&p_base->src_img);
+
+    return true;
+}
+
+
+void tilemap_base_free(tile_base_data * p_base) {
+
+    if (p_base->src_img.p_img_data)
+        free(p_base->src_img.p_img_data);
+
+    if (p_base->p_index)
+        free(p_base->p_index);
+
+    memset(p_base, 0x00, sizeof(tile_base_data));
+}
+
+
+
+// True if the index was built from the base image for this tile format
+static int32_t base_index_matches(tile_base_data * p_base, tile_set_data * p_tile_set) {
+
+    base_index_header * p_hdr;
+
+    p_hdr = (base_index_header *)p_base->p_index;
+
+    return (p_hdr
+            && (p_hdr->src_checksum    == p_base->src_checksum)
+            && (p_hdr->tile_width      == p_tile_set->tile_width)
+            && (p_hdr->tile_height     == p_tile_set->tile_height)
+            && (p_hdr->bytes_per_pixel == p_tile_set->tile_bytes_per_pixel)
+            && (p_hdr->hash_backend    == p_tile_set->hash_backend)
+            && (p_hdr->pack_bits       == p_tile_set->pack_bits)
+            && (p_hdr->tile_bytes      == base_tile_get_bytes(p_tile_set)));
+}
+
+
+// Copy, hash and collect the stats of every tile of the base image
+// into a new index, in the tile set's format
+//
+// * Returns false if the image doesn't fit the tile set format
+//   or there isn't enough memory (no index then)
+static int32_t base_index_build(tile_base_data * p_base, tile_set_data * p_tile_set) {
+
+    image_data        * p_img;
+    tile_map_data       cells; // Only the tile size and layout of the base image are used
+    tile_data           tile, flip_tiles[2];
+    tile_hash_func      hash_func;
+    base_index_header * p_hdr;
+    base_index_entry  * p_entry;
+    uint8_t           * p_pixels;
+    uint32_t            tile_bytes, c;
+    int32_t             status;
+
+    p_img = &p_base->src_img;
+
+    if ((p_img->bytes_per_pixel != p_tile_set->tile_bytes_per_pixel)
+        || !tilemap_check_dimensions_valid(p_img, p_tile_set->tile_width, p_tile_set->tile_height)) {
+        printf("Base: FAIL -> base image doesn't match the tile size or format\n");
+        return false;
+    }
+
+    if (p_tile_set->pack_bits && !tile_packed_image_fits(p_img, p_tile_set->pack_bits)) {
+        printf("Base: FAIL -> pixel out of range for packed tile set\n");
+        return false;
+    }
+
+    memset(&cells, 0x00, sizeof(cells));
+    cells.tile_width      = p_tile_set->tile_width;
+    cells.tile_height     = p_tile_set->tile_height;
+    cells.width_in_tiles  = p_img->width  / p_tile_set->tile_width;
+    cells.height_in_tiles = p_img->height / p_tile_set->tile_height;
+    cells.size            = cells.width_in_tiles * cells.height_in_tiles;
+
+    if (cells.size > TILES_MAX_DEFAULT) {
+        printf("Base: FAIL -> %d tiles, more than a tile set holds\n", cells.size);
+        return false;
+    }
+
+    tile_bytes = base_tile_get_bytes(p_tile_set);
+    hash_func  = tile_hash_get_func(p_tile_set->hash_backend);
+
+    p_hdr = malloc(base_index_get_size(cells.size, tile_bytes));
+
+    tile_initialize(&tile, &cells, p_tile_set);
+    tile_initialize(&flip_tiles[0], &cells, p_tile_set);
+    tile_initialize(&flip_tiles[1], &cells, p_tile_set);
+
+    status = (p_hdr && tile.p_img_raw && flip_tiles[0].p_img_raw && flip_tiles[1].p_img_raw);
+
+    if (status) {
+        memset(p_hdr, 0x00, sizeof(base_index_header));
+        p_hdr->magic           = BASE_INDEX_MAGIC;
+        p_hdr->tile_count      = cells.size;
+        p_hdr->src_checksum    = p_base->src_checksum;
+        p_hdr->tile_bytes      = tile_bytes;
+        p_hdr->tile_width      = p_tile_set->tile_width;
+        p_hdr->tile_height     = p_tile_set->tile_height;
+        p_hdr->bytes_per_pixel = p_tile_set->tile_bytes_per_pixel;
+        p_hdr->hash_backend    = p_tile_set->hash_backend;
+        p_hdr->pack_bits       = p_tile_set->pack_bits;
+
+        p_entry  = (base_index_entry *)(p_hdr + 1);
+        p_pixels = (uint8_t *)(p_entry + cells.size);
+
+        for (c = 0; c < cells.size; c++, p_entry++, p_pixels += tile_bytes) {
+
+            if (p_tile_set->pack_bits) {
+                tile_pack_cell(p_img, NULL, &cells, tile.packed_bits, c, tile.p_img_encoded);
+                memcpy(p_pixels, tile.p_img_encoded, tile_bytes);
+            }
+            else {
+                tile_copy_tile_from_image(p_img, &tile,
+                                          tile_grid_get_offset(p_img, &cells.grid, cells.tile_width, cells.tile_height,
+                                                               c % cells.width_in_tiles, c / cells.width_in_tiles));
+                memcpy(p_pixels, tile.p_img_raw, tile_bytes);
+            }
+
+            tile.hash[0] = hash_func(p_pixels, tile_bytes);
+            tile_stats_calc(&p_entry->stats, p_pixels, cells.tile_width, cells.tile_height,
+                            p_tile_set->tile_bytes_per_pixel, p_tile_set->pack_bits);
+
+            // All orientations, so one index serves searches with and without flips
+            tile_calc_alternate_hashes(&tile, flip_tiles, hash_func);
+            memcpy(p_entry->hash, tile.hash, sizeof(p_entry->hash));
+        }
+
+        if (p_base->p_index)
+            free(p_base->p_index);
+
+        p_base->p_index    = (uint8_t *)p_hdr;
+        p_base->index_size = base_index_get_size(cells.size, tile_bytes);
+    }
+    else {
+        free(p_hdr);
+        printf("Base: FAIL -> could not allocate the index\n");
+    }
+
+    tile_free(&tile);
+    tile_free(&flip_tiles[0]);
+    tile_free(&flip_tiles[1]);
+
+    return status;
+}
+
+
+
+// Index the locked tiles in a fresh direct key table
+// (direct keys turn off if a tile doesn't fit them, the hash search still works)
+static void base_dkey_add(tile_set_data * p_tile_set, uint16_t search_mask) {
+
+    tile_map_data  cells;
+    tile_data      tile, flip_tiles[2];
+    tile_data    * p_tile;
+    uint8_t        keys[TILE_FLIP_MAX + 1][TILE_DKEY_BYTES_MAX];
+    uint8_t      * p_pixels;
+    uint32_t       tile_bytes, c;
+
+    if (!tile_dkey_begin(&p_tile_set->dkey, 0, search_mask))
+        return;
+
+    memset(&cells, 0x00, sizeof(cells));
+    cells.tile_width  = p_tile_set->tile_width;
+    cells.tile_height = p_tile_set->tile_height;
+
+    tile_initialize(&tile, &cells, p_tile_set);
+    tile_initialize(&flip_tiles[0], &cells, p_tile_set);
+    tile_initialize(&flip_tiles[1], &cells, p_tile_set);
+
+    if (tile.p_img_raw && flip_tiles[0].p_img_raw && flip_tiles[1].p_img_raw) {
+
+        tile_bytes = base_tile_get_bytes(p_tile_set);
+
+        for (c = 0; c < p_tile_set->tile_count; c++) {
+
+            p_tile   = &p_tile_set->tiles[c];
+            p_pixels = (p_tile->p_img_encoded) ? p_tile->p_img_encoded : p_tile->p_img_raw;
+
+            if (!tile_dkey_pack(&p_tile_set->dkey, p_pixels, tile_bytes, keys[0])) {
+                printf("Base: Direct key: pixel out of range, using hash search\n");
+                tile_dkey_disable(&p_tile_set->dkey);
+                break;
+            }
+
+            // Flip keys come from a working copy, flipping needs the tile buffers
+            if (search_mask) {
+                memcpy((tile.packed_bits) ? tile.p_img_encoded : tile.p_img_raw, p_pixels, tile_bytes);
+                tile_dkey_pack_flips(&p_tile_set->dkey, &tile, flip_tiles, keys);
+            }
+
+            if (!tile_dkey_add_tile(&p_tile_set->dkey, keys, c)) {
+                printf("Base: Direct key: table allocation failed, using hash search\n");
+                break;
+            }
+        }
+    }
+    else
+        tile_dkey_disable(&p_tile_set->dkey);
+
+    tile_free(&tile);
+    tile_free(&flip_tiles[0]);
+    tile_free(&flip_tiles[1]);
+}
+
+
+
+// Load the base tiles into an empty tile set as IDs 0 .. n-1 and lock them
+//
+// * Builds the index first, unless the current one belongs
+//   to the base image and matches the tile set format
+// * Base tiles start out unused (map_entry_count 0) and always keep
+//   private pixels, even in TILE_STORAGE_REFERENCE (they aren't
+//   in the source image). src_tile_x/y are cells of the base image
+// * search_mask: flips the map gets searched with, for the direct keys
+//
+// Returns false if the base doesn't fit the tile set or memory runs out
+int32_t tilemap_base_seed(tile_base_data * p_base, tile_set_data * p_tile_set, uint16_t search_mask) {
+
+    base_index_header * p_hdr;
+    base_index_entry  * p_entry;
+    uint8_t           * p_pixels;
+    tile_data         * p_tile;
+    uint32_t            c, base_width_in_tiles;
+
+    if (!tilemap_base_is_set(p_base))
+        return true;
+
+printf("Base: Start -> Seed..  ");
+benchmark_start();
+
+    if (base_index_matches(p_base, p_tile_set))
+        printf("(index reused)  ");
+    else if (base_index_build(p_base, p_tile_set))
+        printf("(index built)  ");
+    else
+        return false;
+
+    p_hdr    = (base_index_header *)p_base->p_index;
+    p_entry  = (base_index_entry *)(p_hdr + 1);
+    p_pixels = (uint8_t *)(p_entry + p_hdr->tile_count);
+
+    base_width_in_tiles = p_base->src_img.width / p_tile_set->tile_width;
+
+    for (c = 0; c < p_hdr->tile_count; c++, p_entry++, p_pixels += p_hdr->tile_bytes) {
+
+        p_tile = &p_tile_set->tiles[c];
+
+        memcpy(p_tile->hash, p_entry->hash, sizeof(p_tile->hash));
+        p_tile->stats               = p_entry->stats;
+        p_tile->raw_bytes_per_pixel = p_tile_set->tile_bytes_per_pixel;
+        p_tile->raw_width           = p_tile_set->tile_width;
+        p_tile->raw_height          = p_tile_set->tile_height;
+        p_tile->raw_size_bytes      = p_tile_set->tile_size;
+        p_tile->packed_bits         = p_tile_set->pack_bits;
+        p_tile->encoded_size_bytes  = (p_tile_set->pack_bits) ? p_hdr->tile_bytes : 0;
+        p_tile->map_entry_count     = 0;
+        p_tile->reduce_error        = 0;
+        p_tile->src_tile_x          = c % base_width_in_tiles;
+        p_tile->src_tile_y          = c / base_width_in_tiles;
+        p_tile->sub_palette         = 0;
+        p_tile->p_img_raw           = NULL;
+        p_tile->p_img_encoded       = NULL;
+
+        if (p_tile_set->pack_bits)
+            p_tile->p_img_encoded = tile_store_alloc(&p_tile_set->store, p_hdr->tile_bytes);
+        else
+            p_tile->p_img_raw     = tile_store_alloc(&p_tile_set->store, p_hdr->tile_bytes);
+
+        if (!p_tile->p_img_encoded && !p_tile->p_img_raw) {
+            printf("Base: FAIL -> could not allocate tile %d\n", c);
+            p_tile_set->tile_count = c; // Release the ones stored so far with the tile set
+            return false;
+        }
+
+        memcpy((p_tile->p_img_encoded) ? p_tile->p_img_encoded : p_tile->p_img_raw, p_pixels, p_hdr->tile_bytes);
+    }
+
+    p_tile_set->tile_count        = p_hdr->tile_count;
+    p_tile_set->tile_count_locked = p_hdr->tile_count;
+
+    base_dkey_add(p_tile_set, search_mask);
+
+benchmark_elapsed();
+    printf("Base: %d locked tiles\n", p_tile_set->tile_count_locked);
+
+    return true;
+}
+
+
+
+// Take a copy of an index handed out earlier (see tilemap_ctx_base_index_get())
+//
+// * Only checked for being a complete index here, whether it belongs
+//   to the base image and tile set format gets checked when seeding
+// * Returns false (keeping the current index) if it isn't
+int32_t tilemap_base_index_import(tile_base_data * p_base, const uint8_t * p_data, size_t size_bytes) {
+
+    base_index_header   hdr;
+    uint8_t           * p_index;
+
+    if (!p_data || (size_bytes < sizeof(base_index_header)))
+        return false;
+
+    memcpy(&hdr, p_data, sizeof(base_index_header));
+
+    if ((hdr.magic != BASE_INDEX_MAGIC) || (hdr.tile_count > TILES_MAX_DEFAULT)
+        || (base_index_get_size(hdr.tile_count, hdr.tile_bytes) != size_bytes))
+        return false;
+
+    p_index = malloc(size_bytes);
+    if (!p_index)
+        return false;
+
+    memcpy(p_index, p_data, size_bytes);
+
+    if (p_base->p_index)
+        free(p_base->p_index);
+
+    p_base->p_index    = p_index;
+    p_base->index_size = size_bytes;
+
+    return true;
+}
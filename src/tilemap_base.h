@@ -0,0 +1,22 @@
+//
+// tilemap_base.h
+//
+
+#ifndef __TILEMAP_BASE_H_
+#define __TILEMAP_BASE_H_
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    #include "lib_tilemap.h"
+
+    #define BASE_INDEX_MAGIC            0x31424D54  // "TMB1", start of a built base index
+
+    int32_t tilemap_base_is_set(tile_base_data * p_base);
+    int32_t tilemap_base_set_image(tile_base_data * p_base, image_data * p_img);
+    void    tilemap_base_free(tile_base_data * p_base);
+
+    int32_t tilemap_base_seed(tile_base_data * p_base, tile_set_data * p_tile_set, uint16_t search_mask);
+    int32_t tilemap_base_index_import(tile_base_data * p_base, const uint8_t * p_data, size_t size_bytes);
+
+#endif
@@ -0,0 +1,538 @@
+//
+// tilemap_batch.c
+//
+
+// ========================
+//
+// Bulk dedupe engines.
+//
+// Instead of hashing and looking up one map cell at a
+// time, all cells get hashed up front on the thread pool,
+// then grouped by key to find the first cell of every
+// group. A final pass in map order registers each group's
+// first cell and points the rest of the group at it.
+//
+// Grouping is done one of two ways:
+//
+// * Sort: workers write a (key, cell index) array, a
+//   radix sort brings equal keys together and one scan
+//   over it finds the groups. Workers don't share any
+//   mutable state, they only write to their own cells.
+// * Concurrent: workers insert keys straight into a
+//   shared lock-free index (tilemap_index.c), which
+//   tracks the first cell of each key.
+//
+// Either way tile IDs come out in first occurrence order,
+// the same as the incremental engine.
+//
+// With flip search on, the key is the smallest of the
+// four orientation hashes, so a tile and its flips share
+// a key. Flip bits are then resolved against the hashes
+// of the registered tile.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "tilemap_batch.h"
+#include "tilemap_tiles.h"
+#include "tilemap_hash.h"
+#include "tilemap_index.h"
+#include "tilemap_pool.h"
+#include "tilemap_packed.h"
+#include "tilemap_grid.h"
+
+#include "benchmark.h"
+
+
+#define BATCH_RADIX_BUCKETS  (1 << BATCH_RADIX_BITS)
+#define BATCH_RADIX_PASSES   (64 / BATCH_RADIX_BITS)
+
+
+// Sort key + map cell it came from
+typedef struct {
+    uint64_t key;
+    uint32_t cell;
+} batch_entry;
+
+
+// Per-worker buffers for hashing
+typedef struct {
+    tile_data       tile;
+    tile_data       flip_tiles[2];
+    uint64_t      * p_row_keys;  // Concurrent: keys of one map row, inserted as a batch
+    uint8_t       * p_row_packed; // Packed tile sets: packed tiles of one map row, back to back
+} batch_hash_scratch;
+
+
+// Shared state for the hashing tasks
+typedef struct {
+    tile_set_data * p_tile_set;
+    tile_map_data * p_map;
+    image_data    * p_src_img;
+    tile_major_image * p_tm;    // Tile-major copy of p_src_img, NULL to read the image
+    tile_hash_func  hash_func;
+    tile_hash_row_func row_func; // NULL if the backend has no row kernel
+
+    batch_entry   * p_entries;  // Sort: one per map cell, in map order
+    tile_index    * p_index;    // Concurrent: shared index of keys
+    uint32_t      * p_slots;    // Concurrent: index slot of each map cell
+    uint64_t      * p_hash;     // Unflipped hash of each map cell
+
+    batch_hash_scratch * p_scratch; // One per pool worker
+    uint32_t        failed;     // Set if the index filled up, updated atomically
+} batch_hash_job;
+
+
+static const char * tile_engine_names[TILE_ENGINE_LAST] = {
+    "Incremental",
+    "Sort",
+    "Concurrent"
+};
+
+
+static void     batch_copy_tile(image_data * p_src_img, tile_major_image * p_tm, tile_map_data * p_map,
+                                tile_data * p_tile, uint32_t cell);
+static void     batch_hash_task(void * p_arg, uint32_t band, uint32_t worker);
+static int32_t  batch_hash_cells(batch_hash_job * p_job);
+static int32_t  batch_radix_sort(batch_entry ** pp_entries, uint32_t count);
+static uint16_t batch_flip_attribs(tile_data * p_tile, uint64_t hash, uint16_t search_mask);
+
+
+
+const char * tilemap_engine_get_name(uint8_t engine) {
+
+    if (engine < TILE_ENGINE_LAST)
+        return tile_engine_names[engine];
+    else
+        return "Unknown";
+}
+
+
+
+// Copy a map cell's tile out of the tile-major copy (if any) or the image
+//
+// * Packed tiles only get their packed pixels filled in
+static void batch_copy_tile(image_data * p_src_img, tile_major_image * p_tm, tile_map_data * p_map,
+                            tile_data * p_tile, uint32_t cell) {
+
+    size_t img_buf_offset;
+
+    if (p_tile->packed_bits) {
+        tile_pack_cell(p_src_img, p_tm, p_map, p_tile->packed_bits, cell, p_tile->p_img_encoded);
+        return;
+    }
+    else if (p_tm) {
+        memcpy(p_tile->p_img_raw, tile_major_get_tile(p_tm, cell), p_tile->raw_size_bytes);
+        return;
+    }
+
+    img_buf_offset = tile_grid_get_offset(p_src_img, &p_map->grid, p_map->tile_width, p_map->tile_height,
+                                          cell % p_map->width_in_tiles, cell / p_map->width_in_tiles);
+
+    tile_copy_tile_from_image(p_src_img, p_tile, img_buf_offset);
+}
+
+
+
+// Pool task: hash every cell in one band of map rows
+//
+// * Concurrent: a whole row of keys is hashed first, then inserted
+//   as a batch so the index lookups can be prefetched
+// * With a row kernel the unflipped hashes of a row come straight
+//   from the image, tiles are only copied out for the flip hashes
+// * Tiles in a tile-major copy are hashed in place
+// * Packed tile sets pack a whole row of cells up front and hash
+//   the packed tiles (with the row kernel if there is one)
+static void batch_hash_task(void * p_arg, uint32_t band, uint32_t worker) {
+
+    batch_hash_job * p_job;
+    tile_data      * p_tile;
+    tile_data      * p_flip_tiles;
+    uint8_t        * p_row_packed;
+    uint32_t         row, row_end;
+    uint32_t         map_x, cell;
+    uint16_t         h;
+    uint64_t         key;
+
+    p_job        = (batch_hash_job *)p_arg;
+    p_tile       = &p_job->p_scratch[worker].tile;
+    p_flip_tiles =  p_job->p_scratch[worker].flip_tiles;
+
+    row     = band * BATCH_ROWS_PER_JOB;
+    row_end = row + BATCH_ROWS_PER_JOB;
+    if (row_end > p_job->p_map->height_in_tiles)
+        row_end = p_job->p_map->height_in_tiles;
+
+    for (; row < row_end; row++) {
+
+        cell = row * p_job->p_map->width_in_tiles;
+
+        p_row_packed = NULL;
+        if (p_tile->packed_bits) {
+            p_row_packed = p_job->p_scratch[worker].p_row_packed;
+            tile_pack_map_row(p_job->p_src_img, p_job->p_tm, p_job->p_map, p_tile->packed_bits, row, p_row_packed);
+
+            if (p_job->row_func)
+                p_job->row_func(p_row_packed, p_tile->encoded_size_bytes,
+                                p_tile->encoded_size_bytes, p_tile->encoded_size_bytes, 1,
+                                p_job->p_map->width_in_tiles, &p_job->p_hash[cell]);
+        }
+        else if (p_job->row_func && p_job->p_tm)
+            p_job->row_func(tile_major_get_tile(p_job->p_tm, cell), p_job->p_tm->tile_size,
+                            p_job->p_tm->tile_size, p_job->p_tm->tile_size, 1,
+                            p_job->p_map->width_in_tiles, &p_job->p_hash[cell]);
+        else if (p_job->row_func)
+            p_job->row_func(p_job->p_src_img->p_img_data
+                            + tile_grid_get_offset(p_job->p_src_img, &p_job->p_map->grid,
+                                                   p_job->p_map->tile_width, p_job->p_map->tile_height, 0, row),
+                            p_job->p_src_img->width * p_job->p_src_img->bytes_per_pixel,
+                            ((uint32_t)p_job->p_map->tile_width + p_job->p_map->grid.spacing) * p_job->p_src_img->bytes_per_pixel,
+                            p_job->p_map->tile_width * p_job->p_src_img->bytes_per_pixel, p_job->p_map->tile_height,
+                            p_job->p_map->width_in_tiles, &p_job->p_hash[cell]);
+
+        for (map_x = 0; map_x < p_job->p_map->width_in_tiles; map_x++, cell++) {
+
+            if (p_job->row_func)
+                p_tile->hash[0] = p_job->p_hash[cell];
+            else if (p_row_packed)
+                p_tile->hash[0] = p_job->hash_func(p_row_packed + ((size_t)map_x * p_tile->encoded_size_bytes),
+                                                   p_tile->encoded_size_bytes);
+            else if (p_job->p_tm)
+                p_tile->hash[0] = p_job->hash_func(tile_major_get_tile(p_job->p_tm, cell), p_tile->raw_size_bytes);
+            else {
+                batch_copy_tile(p_job->p_src_img, NULL, p_job->p_map, p_tile, cell);
+                p_tile->hash[0] = p_job->hash_func(p_tile->p_img_raw, p_tile->raw_size_bytes);
+            }
+            key = p_tile->hash[0];
+
+            // Flipped variants of a tile all sort under the same key
+            if (p_job->p_map->search_mask) {
+                if (p_row_packed)
+                    memcpy(p_tile->p_img_encoded, p_row_packed + ((size_t)map_x * p_tile->encoded_size_bytes),
+                           p_tile->encoded_size_bytes);
+                else if (p_job->row_func || p_job->p_tm)
+                    batch_copy_tile(p_job->p_src_img, p_job->p_tm, p_job->p_map, p_tile, cell);
+                tile_calc_alternate_hashes(p_tile, p_flip_tiles, p_job->hash_func);
+                for (h = TILE_FLIP_MIN_FLIP; h <= TILE_FLIP_MAX; h++)
+                    if (p_tile->hash[h] < key)
+                        key = p_tile->hash[h];
+            }
+
+            p_job->p_hash[cell] = p_tile->hash[0];
+
+            if (p_job->p_index)
+                p_job->p_scratch[worker].p_row_keys[map_x] = key;
+            else {
+                p_job->p_entries[cell].key  = key;
+                p_job->p_entries[cell].cell = cell;
+            }
+        }
+
+        if (p_job->p_index) {
+            cell = row * p_job->p_map->width_in_tiles;
+
+            if (!tile_index_insert_batch(p_job->p_index, p_job->p_scratch[worker].p_row_keys,
+                                         p_job->p_map->width_in_tiles, cell, &p_job->p_slots[cell]))
+                __atomic_store_n(&p_job->failed, true, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+
+static int32_t batch_hash_cells(batch_hash_job * p_job) {
+
+    uint32_t   worker_count, c;
+    uint32_t   threads;
+
+    p_job->failed = false;
+
+    worker_count     = tilemap_pool_get_worker_count();
+    p_job->p_scratch = calloc(worker_count, sizeof(batch_hash_scratch));
+    if (!p_job->p_scratch)
+        return false;
+
+    for (c = 0; c < worker_count; c++) {
+        tile_initialize(&p_job->p_scratch[c].tile,          p_job->p_map, p_job->p_tile_set);
+        tile_initialize(&p_job->p_scratch[c].flip_tiles[0], p_job->p_map, p_job->p_tile_set);
+        tile_initialize(&p_job->p_scratch[c].flip_tiles[1], p_job->p_map, p_job->p_tile_set);
+
+        if (p_job->p_index)
+            p_job->p_scratch[c].p_row_keys = malloc((size_t)p_job->p_map->width_in_tiles * sizeof(uint64_t));
+        if (p_job->p_tile_set->pack_bits)
+            p_job->p_scratch[c].p_row_packed = malloc((size_t)p_job->p_map->width_in_tiles
+                                                      * p_job->p_scratch[c].tile.encoded_size_bytes);
+
+        if (!(p_job->p_scratch[c].tile.p_img_raw
+              && p_job->p_scratch[c].flip_tiles[0].p_img_raw
+              && p_job->p_scratch[c].flip_tiles[1].p_img_raw)
+            || (p_job->p_index && !p_job->p_scratch[c].p_row_keys)
+            || (p_job->p_tile_set->pack_bits && !p_job->p_scratch[c].p_row_packed))
+            p_job->failed = true;
+    }
+
+    threads = 0;
+    if (!p_job->failed)
+        threads = tilemap_pool_run((p_job->p_map->height_in_tiles + (BATCH_ROWS_PER_JOB - 1)) / BATCH_ROWS_PER_JOB,
+                                   batch_hash_task, p_job);
+
+    for (c = 0; c < worker_count; c++) {
+        tile_free(&p_job->p_scratch[c].tile);
+        tile_free(&p_job->p_scratch[c].flip_tiles[0]);
+        tile_free(&p_job->p_scratch[c].flip_tiles[1]);
+        free(p_job->p_scratch[c].p_row_keys);
+        free(p_job->p_scratch[c].p_row_packed);
+    }
+    free(p_job->p_scratch);
+    p_job->p_scratch = NULL;
+
+    printf("Batch: Hashed %" PRIu32 " cells, %d threads\n", p_job->p_map->size, threads);
+
+    return !p_job->failed;
+}
+
+
+
+// Stable LSD radix sort on the 64 bit key
+//
+// * Stable, so cells within a group stay in map order
+// * Passes where every key has the same digit are skipped
+// * *pp_entries may be swapped for the scratch buffer, the
+//   buffer that isn't returned gets freed
+static int32_t batch_radix_sort(batch_entry ** pp_entries, uint32_t count) {
+
+    uint32_t      (* p_hist)[BATCH_RADIX_BUCKETS];
+    uint32_t        c, pass, digit, sum, n;
+    batch_entry   * p_src;
+    batch_entry   * p_dst;
+    batch_entry   * p_swap;
+
+    if (count < 2)
+        return true;
+
+    p_src  = *pp_entries;
+    p_dst  = malloc((size_t)count * sizeof(batch_entry));
+    p_hist = calloc(BATCH_RADIX_PASSES, sizeof(*p_hist));
+
+    if (!(p_dst && p_hist)) {
+        free(p_dst);
+        free(p_hist);
+        return false;
+    }
+
+    // Histograms for all digits in one pass
+    for (c = 0; c < count; c++)
+        for (pass = 0; pass < BATCH_RADIX_PASSES; pass++)
+            p_hist[pass][(p_src[c].key >> (pass * BATCH_RADIX_BITS)) & (BATCH_RADIX_BUCKETS - 1)]++;
+
+    for (pass = 0; pass < BATCH_RADIX_PASSES; pass++) {
+
+        // All keys share this digit, order wouldn't change
+        if (p_hist[pass][(p_src[0].key >> (pass * BATCH_RADIX_BITS)) & (BATCH_RADIX_BUCKETS - 1)] == count)
+            continue;
+
+        // Counts -> starting offsets
+        sum = 0;
+        for (digit = 0; digit < BATCH_RADIX_BUCKETS; digit++) {
+            n = p_hist[pass][digit];
+            p_hist[pass][digit] = sum;
+            sum += n;
+        }
+
+        for (c = 0; c < count; c++)
+            p_dst[ p_hist[pass][(p_src[c].key >> (pass * BATCH_RADIX_BITS)) & (BATCH_RADIX_BUCKETS - 1)]++ ] = p_src[c];
+
+        p_swap = p_src;
+        p_src  = p_dst;
+        p_dst  = p_swap;
+    }
+
+    free(p_dst);
+    free(p_hist);
+    *pp_entries = p_src;
+
+    return true;
+}
+
+
+
+// Flip bits that turn a registered tile into a cell with the given hash
+// (lowest matching orientation, same as tile_find_match())
+static uint16_t batch_flip_attribs(tile_data * p_tile, uint64_t hash, uint16_t search_mask) {
+
+    int h;
+
+    if (search_mask)
+        for (h = TILE_FLIP_MIN; h <= TILE_FLIP_MAX; h++)
+            if (p_tile->hash[h] == hash)
+                return tile_flip_bits[h];
+
+    return TILE_FLIP_BITS_NONE;
+}
+
+
+
+// Deduplicate the tiles of a source image into a tile set with a bulk engine
+// (TILE_ENGINE_SORT or TILE_ENGINE_CONCURRENT), writing tile IDs and
+// attributes into p_map
+//
+// * Tiles already in the set (e.g. from other layers) are matched as well
+// * p_tm: tile-major copy of p_src_img to read tiles from, or NULL
+// * Returns false on allocation failure or when the tile set is full,
+//   the caller releases the tile set and map
+int32_t tilemap_batch_process(tile_set_data * p_tile_set, image_data * p_src_img, tile_major_image * p_tm,
+                              tile_map_data * p_map, uint8_t engine) {
+
+    batch_hash_job job;
+    tile_index     index;
+    tile_data      tile, flip_tiles[2];
+    tile_map_entry map_entry;
+    tile_hash_func hash_func;
+    uint32_t     * p_first;
+    uint32_t       c, run_start;
+    uint32_t       cell, first;
+    uint32_t       tile_count_start;
+    int32_t        status;
+
+benchmark_slot_resetall();
+printf("Tilemap: Start -> Batch Process (%s)..  (flip=%d)  .. ", tilemap_engine_get_name(engine), p_map->search_mask);
+benchmark_start();
+
+    hash_func        = tile_hash_get_func(p_tile_set->hash_backend);
+    tile_count_start = p_tile_set->tile_count;
+
+    job.p_tile_set = p_tile_set;
+    job.p_map      = p_map;
+    job.p_src_img  = p_src_img;
+    job.p_tm       = p_tm;
+    job.hash_func  = hash_func;
+    if (p_tile_set->pack_bits)
+        job.row_func = tile_hash_get_row_func(p_tile_set->hash_backend,
+                                              tile_packed_get_size(p_map->tile_width, p_map->tile_height, p_tile_set->pack_bits));
+    else if (p_tm)
+        job.row_func = tile_hash_get_row_func(p_tile_set->hash_backend, p_tm->tile_size);
+    else
+        job.row_func = tile_hash_get_row_func(p_tile_set->hash_backend, p_map->tile_width * p_src_img->bytes_per_pixel);
+    job.p_entries  = NULL;
+    job.p_index    = NULL;
+    job.p_slots    = NULL;
+    job.p_hash     = malloc((size_t)p_map->size * sizeof(uint64_t));
+    p_first        = malloc((size_t)p_map->size * sizeof(uint32_t));
+
+    if (engine == TILE_ENGINE_CONCURRENT) {
+        // Every cell could be a different tile
+        if (tile_index_init(&index, p_map->size))
+            job.p_index = &index;
+        job.p_slots = malloc((size_t)p_map->size * sizeof(uint32_t));
+    }
+    else
+        job.p_entries = malloc((size_t)p_map->size * sizeof(batch_entry));
+
+    tile_initialize(&tile, p_map, p_tile_set);
+    tile_initialize(&flip_tiles[0], p_map, p_tile_set);
+    tile_initialize(&flip_tiles[1], p_map, p_tile_set);
+
+    status = ((job.p_entries || (job.p_index && job.p_slots)) && job.p_hash && p_first
+              && tile.p_img_raw && flip_tiles[0].p_img_raw && flip_tiles[1].p_img_raw);
+
+    // Hash all cells (parallel)
+    if (status) {
+        benchmark_slot_start(0);
+        status = batch_hash_cells(&job);
+        benchmark_slot_update(0);
+    }
+
+    // Bring equal keys together
+    if (status && job.p_entries) {
+        benchmark_slot_start(1);
+        status = batch_radix_sort(&job.p_entries, p_map->size);
+        benchmark_slot_update(1);
+    }
+
+    if (status) {
+
+        // Every cell gets the first cell of its group
+        benchmark_slot_start(2);
+        if (job.p_index) {
+            // Index already tracked it per key
+            for (cell = 0; cell < p_map->size; cell++)
+                p_first[cell] = tile_index_get_first(job.p_index, job.p_slots[cell]);
+        }
+        else {
+            // Sort is stable, so that's the first entry of each run
+            for (run_start = 0; run_start < p_map->size; run_start = c)
+                for (c = run_start; (c < p_map->size) && (job.p_entries[c].key == job.p_entries[run_start].key); c++)
+                    p_first[ job.p_entries[c].cell ] = job.p_entries[run_start].cell;
+        }
+        benchmark_slot_update(2);
+
+
+        // Assign IDs in map order, so they come out in first occurrence order
+        benchmark_slot_start(3);
+        for (cell = 0; cell < p_map->size; cell++) {
+
+            first = p_first[cell];
+
+            if (first == cell) {
+
+                map_entry.id = TILE_ID_NOT_FOUND;
+
+                // Group might match a tile registered by an earlier map
+                if (tile_count_start)
+                    map_entry = tile_find_match(job.p_hash[cell], p_tile_set, p_map->search_mask);
+
+                if (map_entry.id == (uint32_t)TILE_ID_NOT_FOUND) {
+
+                    tile.src_tile_x = cell % p_map->width_in_tiles;
+                    tile.src_tile_y = cell / p_map->width_in_tiles;
+
+                    batch_copy_tile(p_src_img, p_tm, p_map, &tile, cell);
+                    tile.hash[0] = job.p_hash[cell];
+
+                    if (p_map->search_mask)
+                        tile_calc_alternate_hashes(&tile, flip_tiles, hash_func);
+
+                    map_entry = tile_register_new(&tile, p_tile_set, p_map->search_mask);
+
+                    if (map_entry.id == (uint32_t)TILE_ID_OUT_OF_SPACE) {
+                        printf("Tilemap: Batch Process: FAIL -> Too Many Tiles\n");
+                        status = false;
+                        break;
+                    }
+                }
+                else
+                    p_tile_set->tiles[map_entry.id].map_entry_count++;
+            }
+            else {
+                map_entry.id      = p_map->tile_id_list[first];
+                map_entry.attribs = batch_flip_attribs(&p_tile_set->tiles[map_entry.id], job.p_hash[cell], p_map->search_mask);
+
+                p_tile_set->tiles[map_entry.id].map_entry_count++;
+            }
+
+            p_map->tile_id_list[cell]      = map_entry.id;
+            p_map->tile_attribs_list[cell] = map_entry.attribs;
+        }
+        benchmark_slot_update(3);
+    }
+
+    free(job.p_entries);
+    free(job.p_slots);
+    free(job.p_hash);
+    if (job.p_index)
+        tile_index_free(job.p_index);
+    free(p_first);
+
+    tile_free(&tile);
+    tile_free(&flip_tiles[0]);
+    tile_free(&flip_tiles[1]);
+
+benchmark_elapsed();
+benchmark_slot_printall();
+
+    return status;
+}
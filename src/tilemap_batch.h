@@ -0,0 +1,27 @@
+//
+// tilemap_batch.h
+//
+
+#ifndef __TILEMAP_BATCH_H_
+#define __TILEMAP_BATCH_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define BATCH_ROWS_PER_JOB    4     // Map rows a worker claims at a time while hashing
+    #define BATCH_RADIX_BITS      8     // Radix sort digit size (8 passes over a 64 bit key)
+
+    // Tile dedupe engines (settings value)
+    enum tile_dedupe_engines {
+        TILE_ENGINE_INCREMENTAL = 0, // Hash and look up one cell at a time
+        TILE_ENGINE_SORT        = 1, // Hash all cells in parallel, radix sort, then assign IDs
+        TILE_ENGINE_CONCURRENT  = 2, // Hash all cells in parallel into a shared lock-free index
+        TILE_ENGINE_LAST
+    };
+
+    int32_t      tilemap_batch_process(tile_set_data * p_tile_set, image_data * p_src_img, tile_major_image * p_tm,
+                                       tile_map_data * p_map, uint8_t engine);
+    const char * tilemap_engine_get_name(uint8_t engine);
+
+#endif
@@ -0,0 +1,2259 @@
+//
+// tilemap_benchmark.c
+//
+
+// ========================
+//
+// Stand-alone stress benchmarks for the tile map library
+// (no GIMP required). Build with "make benchmark".
+//
+// Not part of the plug-in, only built by the benchmark
+// target (the comparisons the dialog runs live in
+// tilemap_compare.c). The main() entry point is only
+// compiled in when TILEMAP_BENCHMARK_MAIN is defined.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "lib_tilemap.h"
+#include "tilemap_benchmark.h"
+#include "tilemap_compare.h"
+#include "tilemap_hash.h"
+#include "tilemap_batch.h"
+#include "tilemap_index.h"
+#include "tilemap_packed.h"
+#include "tilemap_subpal.h"
+#include "tilemap_window.h"
+#include "tilemap_rooms.h"
+#include "tilemap_metatile.h"
+#include "tilemap_sprites.h"
+#include "tilemap_grid.h"
+#include "tilemap_reduce.h"
+#include "tilemap_tiles.h"
+
+#include "benchmark.h"
+
+
+
+// Fill an image with a tiled pattern that contains
+// (up to) unique_count distinct tiles, scattered pseudo-randomly
+static void benchmark_fill_image(image_data * p_img, int tile_width, int tile_height, uint32_t unique_count) {
+
+    uint32_t  x, y;
+    uint32_t  tile_x, tile_y;
+    uint32_t  pattern;
+    uint8_t   bpp;
+    uint8_t * p_pix;
+
+    bpp   = p_img->bytes_per_pixel;
+    p_pix = p_img->p_img_data;
+
+    for (y = 0; y < p_img->height; y++) {
+
+        tile_y = y / tile_height;
+
+        for (x = 0; x < p_img->width; x++) {
+
+            tile_x = x / tile_width;
+
+            // Pattern for this map cell, then a pixel value from the
+            // pattern and the position inside the tile
+            pattern = ((tile_x * 2654435761u) ^ (tile_y * 40503u)) % unique_count;
+
+            memset(p_pix, (uint8_t)(pattern + ((x % tile_width) * (y % tile_height))), bpp);
+            *p_pix = (uint8_t)(pattern >> 8); // Keep patterns > 255 distinct
+
+            p_pix += bpp;
+        }
+    }
+}
+
+
+
+// Run the full dedupe pass over a synthetic image of the
+// given size and report throughput
+//
+// * Exercises the 64 bit size / offset paths, a 32k x 32k RGBA
+//   image is 4GB which doesn't fit in 32 bit sizes
+int32_t tilemap_benchmark_large_map(uint32_t width, uint32_t height, uint8_t bytes_per_pixel,
+                                    int tile_size, uint32_t unique_count) {
+
+    image_data img;
+    double     time_start, time_fill, time_process;
+    int32_t    status;
+
+    img.width           = width;
+    img.height          = height;
+    img.bytes_per_pixel = bytes_per_pixel;
+    img.size            = (uint64_t)width * height * bytes_per_pixel;
+
+    printf("Benchmark: Large map %" PRIu32 " x %" PRIu32 " @ %d bpp, %d x %d tiles, %" PRIu32 " unique (%" PRIu64 " MB)\n",
+           width, height, bytes_per_pixel, tile_size, tile_size, unique_count, img.size >> 20);
+
+    if (img.size != (size_t)img.size) {
+        printf("Benchmark: Image too large for this platform\n");
+        return false;
+    }
+
+    img.p_img_data = malloc(img.size);
+    if (!img.p_img_data) {
+        printf("Benchmark: Failed to allocate %" PRIu64 " bytes\n", img.size);
+        return false;
+    }
+
+    time_start = get_time();
+    benchmark_fill_image(&img, tile_size, tile_size, unique_count);
+    time_fill = get_time() - time_start;
+
+    time_start = get_time();
+    status = tilemap_export_process(&img, tile_size, tile_size, false);
+    time_process = get_time() - time_start;
+
+    if (status)
+        printf("Benchmark: Map %" PRIu32 " x %" PRIu32 " tiles (%" PRIu32 " entries), %" PRIu32 " unique tiles\n",
+               tilemap_get_map()->width_in_tiles, tilemap_get_map()->height_in_tiles,
+               tilemap_get_map()->size, tilemap_get_tile_set()->tile_count);
+    else
+        printf("Benchmark: Processing failed\n");
+
+    printf("Benchmark: Fill %.3f sec, Process %.3f sec -> %.1f MB/sec, %.1f M tiles/sec\n",
+           time_fill, time_process,
+           (time_process > 0) ? (img.size / (1024.0 * 1024.0)) / time_process : 0.0,
+           (time_process > 0) ? ((img.size / ((uint64_t)tile_size * tile_size * bytes_per_pixel)) / 1e6) / time_process : 0.0);
+
+    printf("Benchmark: Peak RSS %" PRIu64 " MB\n", benchmark_get_peak_rss() >> 20);
+
+    tilemap_free_resources();
+    free(img.p_img_data);
+
+    return status;
+}
+
+
+
+// Compare end-to-end processing of the row-major image with
+// processing a tile-major copy of it, for each dedupe engine,
+// and check both give the same map
+//
+// * The copy is built once (cold, including allocation) and then
+//   again before each engine's run (warm, buffer reused), the way
+//   the dialog keeps it across recalculations
+// * Runs on the default context, leaves it on the incremental
+//   engine, without a tile-major copy and without a tile set afterward
+int32_t tilemap_benchmark_layout(image_data * p_img, int tile_width, int tile_height, int check_flip) {
+
+    tile_major_image tile_major;
+    uint32_t   c;
+    uint32_t   entry_count;
+    uint32_t   mismatches;
+    uint32_t * p_entries_ref;
+    uint8_t    engine;
+    int32_t    status;
+    double     time_start, time_row_major, time_build, time_tile_major;
+
+    if ( ! tilemap_check_dimensions_valid(p_img, tile_width, tile_height) ) {
+        printf("Layout Benchmark: image size must be a multiple of the tile size\n");
+        return false;
+    }
+
+    entry_count   = (p_img->width / tile_width) * (p_img->height / tile_height);
+    p_entries_ref = malloc((size_t)entry_count * sizeof(uint32_t));
+    memset(&tile_major, 0x00, sizeof(tile_major));
+
+    if (!p_entries_ref) {
+        printf("Layout Benchmark: Failed to allocate buffers for %" PRIu32 " entries\n", entry_count);
+        return false;
+    }
+
+    printf("Layout Benchmark: %" PRIu32 " x %" PRIu32 " image, %d x %d tiles (%" PRIu32 " entries), flip %s\n",
+           p_img->width, p_img->height, tile_width, tile_height, entry_count, check_flip ? "on" : "off");
+
+    time_start = get_time();
+    status     = tile_major_build(&tile_major, p_img, tile_width, tile_height);
+    time_build = get_time() - time_start;
+
+    if (!status) {
+        printf("Layout Benchmark: Failed to build the tile-major copy\n");
+        free(p_entries_ref);
+        return false;
+    }
+
+    printf("Layout Benchmark: Transpose (cold) %8.3f sec  %7.1f MB/sec\n", time_build,
+           (time_build > 0) ? (p_img->size / (1024.0 * 1024.0)) / time_build : 0.0);
+
+    for (engine = TILE_ENGINE_INCREMENTAL; (engine < TILE_ENGINE_LAST) && status; engine++) {
+
+        tilemap_dedupe_engine_set(engine);
+
+        // Row-major
+        tilemap_tile_major_set(NULL);
+
+        time_start = get_time();
+        status = tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+        time_row_major = get_time() - time_start;
+
+        for (c = 0; status && (c < entry_count); c++)
+            p_entries_ref[c] = tilemap_map_get_entry(tilemap_get_map(), c);
+
+        // Tile-major, transposed again so the copy's timing matches a tile size change
+        tilemap_tile_major_set(&tile_major);
+
+        time_start = get_time();
+        status = status && tile_major_build(&tile_major, p_img, tile_width, tile_height);
+        time_build = get_time() - time_start;
+
+        time_start = get_time();
+        status = status && tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+        time_tile_major = get_time() - time_start;
+
+        if (!status) {
+            printf("Layout Benchmark: %-12s processing failed\n", tilemap_engine_get_name(engine));
+            break;
+        }
+
+        mismatches = 0;
+        for (c = 0; c < entry_count; c++)
+            if (p_entries_ref[c] != tilemap_map_get_entry(tilemap_get_map(), c))
+                mismatches++;
+
+        // Whether the plug-in builds the copy for these settings
+        printf("Layout Benchmark: %-12s row-major %8.3f sec, tile-major %8.3f sec (%.2fx), + transpose %.3f sec (%.2fx), %" PRIu32 " map mismatches, copy %s\n",
+               tilemap_engine_get_name(engine), time_row_major, time_tile_major,
+               (time_tile_major > 0) ? time_row_major / time_tile_major : 0.0,
+               time_build,
+               ((time_tile_major + time_build) > 0) ? time_row_major / (time_tile_major + time_build) : 0.0,
+               mismatches,
+               tilemap_tile_major_wanted(p_img, tile_width, tile_height) ? "built" : "skipped");
+    }
+
+    tilemap_tile_major_set(NULL);
+    tile_major_free(&tile_major);
+    tilemap_dedupe_engine_set(TILE_ENGINE_INCREMENTAL);
+    tilemap_free_resources();
+    free(p_entries_ref);
+
+    return status;
+}
+
+
+
+// Compare processing a packed image with processing the same
+// tiles laid out with a margin and spacing between them (read in
+// place through the grid), for each dedupe engine and tile storage
+// mode, and check both give the same map and tile set image
+//
+// * Margin and spacing pixels are filled with noise, so any of
+//   them leaking into a tile changes its hash
+// * Runs on the default context, leaves it on the incremental
+//   engine, copy storage, no grid and without a tile set afterward
+int32_t tilemap_benchmark_grid(image_data * p_img, int tile_width, int tile_height, int check_flip,
+                               uint16_t margin, uint16_t spacing) {
+
+    image_data spaced_img;
+    image_data packed_set, spaced_set;
+    uint32_t   c, x, y;
+    uint32_t   width_in_tiles, height_in_tiles;
+    uint32_t   entry_count;
+    uint32_t   mismatches, tile_count_ref;
+    uint32_t * p_entries_ref;
+    uint32_t   rng;
+    size_t     row_bytes;
+    uint8_t    engine, storage_mode;
+    int32_t    status;
+    double     time_start, time_packed, time_spaced;
+    tile_grid_data grid_none = { GRID_MARGIN_NONE, GRID_SPACING_NONE };
+    tile_grid_data grid      = { margin, spacing };
+
+    if ( ! tilemap_check_dimensions_valid(p_img, tile_width, tile_height) ) {
+        printf("Grid Benchmark: image size must be a multiple of the tile size\n");
+        return false;
+    }
+
+    width_in_tiles  = p_img->width  / tile_width;
+    height_in_tiles = p_img->height / tile_height;
+    entry_count     = width_in_tiles * height_in_tiles;
+    row_bytes       = (size_t)tile_width * p_img->bytes_per_pixel;
+
+    spaced_img.width           = (margin * 2) + (width_in_tiles  * (tile_width  + spacing)) - spacing;
+    spaced_img.height          = (margin * 2) + (height_in_tiles * (tile_height + spacing)) - spacing;
+    spaced_img.bytes_per_pixel = p_img->bytes_per_pixel;
+    spaced_img.size            = (uint64_t)spaced_img.width * spaced_img.height * spaced_img.bytes_per_pixel;
+    spaced_img.p_img_data      = malloc(spaced_img.size);
+
+    p_entries_ref = malloc((size_t)entry_count * sizeof(uint32_t));
+    packed_set.p_img_data = NULL;
+    spaced_set.p_img_data = NULL;
+
+    if (!spaced_img.p_img_data || !p_entries_ref) {
+        printf("Grid Benchmark: Failed to allocate buffers for %" PRIu32 " entries\n", entry_count);
+        free(spaced_img.p_img_data);
+        free(p_entries_ref);
+        return false;
+    }
+
+    // Noise everywhere, then the tiles on top of it
+    rng = 0x9E3779B9u;
+    for (c = 0; c < spaced_img.size; c++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        spaced_img.p_img_data[c] = (uint8_t)rng;
+    }
+
+    for (y = 0; y < height_in_tiles; y++)
+        for (x = 0; x < width_in_tiles; x++)
+            for (c = 0; c < (uint32_t)tile_height; c++)
+                memcpy(spaced_img.p_img_data + tile_grid_get_offset(&spaced_img, &grid, tile_width, tile_height, x, y)
+                                             + ((size_t)c * spaced_img.width * spaced_img.bytes_per_pixel),
+                       p_img->p_img_data + tile_grid_get_offset(p_img, &grid_none, tile_width, tile_height, x, y)
+                                         + ((size_t)c * p_img->width * p_img->bytes_per_pixel),
+                       row_bytes);
+
+    printf("Grid Benchmark: %" PRIu32 " x %" PRIu32 " image, %d x %d tiles (%" PRIu32 " entries), margin %d, spacing %d, flip %s\n",
+           p_img->width, p_img->height, tile_width, tile_height, entry_count, margin, spacing, check_flip ? "on" : "off");
+
+    status = true;
+    for (storage_mode = TILE_STORAGE_COPY; (storage_mode < TILE_STORAGE_LAST) && status; storage_mode++) {
+        for (engine = TILE_ENGINE_INCREMENTAL; (engine < TILE_ENGINE_LAST) && status; engine++) {
+
+            tilemap_storage_mode_set(storage_mode);
+            tilemap_dedupe_engine_set(engine);
+
+            // Packed
+            tilemap_grid_set(GRID_MARGIN_NONE, GRID_SPACING_NONE);
+
+            time_start  = get_time();
+            status      = tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+            time_packed = get_time() - time_start;
+
+            for (c = 0; status && (c < entry_count); c++)
+                p_entries_ref[c] = tilemap_map_get_entry(tilemap_get_map(), c);
+            tile_count_ref = tilemap_get_tile_set()->tile_count;
+            status         = status && tilemap_get_image_of_deduped_tile_set(&packed_set);
+
+            // Spaced, read in place
+            tilemap_grid_set(margin, spacing);
+
+            time_start  = get_time();
+            status      = status && tilemap_export_process(&spaced_img, tile_width, tile_height, check_flip);
+            time_spaced = get_time() - time_start;
+
+            if (!status) {
+                printf("Grid Benchmark: %-12s processing failed\n", tilemap_engine_get_name(engine));
+                break;
+            }
+
+            mismatches = (tile_count_ref != tilemap_get_tile_set()->tile_count) ? 1 : 0;
+            for (c = 0; c < entry_count; c++)
+                if (p_entries_ref[c] != tilemap_map_get_entry(tilemap_get_map(), c))
+                    mismatches++;
+
+            // Tile pixels must match too (reference storage reads them through the grid)
+            if (!tilemap_get_image_of_deduped_tile_set(&spaced_set)
+                || (spaced_set.size != packed_set.size)
+                || (memcmp(spaced_set.p_img_data, packed_set.p_img_data, packed_set.size) != 0))
+                mismatches++;
+
+            free(packed_set.p_img_data);
+            free(spaced_set.p_img_data);
+            packed_set.p_img_data = NULL;
+            spaced_set.p_img_data = NULL;
+
+            printf("Grid Benchmark: %-12s %-9s packed %8.3f sec, spaced %8.3f sec (%.2fx), %" PRIu32 " mismatches\n",
+                   tilemap_engine_get_name(engine), (storage_mode == TILE_STORAGE_COPY) ? "copy" : "reference",
+                   time_packed, time_spaced, (time_spaced > 0) ? time_packed / time_spaced : 0.0, mismatches);
+
+            if (mismatches)
+                status = false;
+        }
+    }
+
+    free(packed_set.p_img_data);
+    free(spaced_set.p_img_data);
+    tilemap_grid_set(GRID_MARGIN_NONE, GRID_SPACING_NONE);
+    tilemap_storage_mode_set(TILE_STORAGE_COPY);
+    tilemap_dedupe_engine_set(TILE_ENGINE_INCREMENTAL);
+    tilemap_free_resources();
+    free(spaced_img.p_img_data);
+    free(p_entries_ref);
+
+    return status;
+}
+
+
+
+// Map an image against a locked base tile set made of the first
+// half of its own tiles, for each storage mode and dedupe engine
+//
+// * The base is the (reference storage, so unflipped) tile set
+//   export cut down to its first half. Tile IDs come out in first
+//   occurrence order either way, so the map must be the same as
+//   without a base and only the second half gets appended
+// * Base tiles must keep their pixels and IDs, also when the tile
+//   set gets reduced below their count
+// * Indexing the base (first run) is timed against seeding from
+//   an index handed over from another context (later runs)
+// * Runs on the default context, leaves it on the incremental
+//   engine, copy storage, no base and without a tile set afterward
+int32_t tilemap_benchmark_base(image_data * p_img, int tile_width, int tile_height, int check_flip) {
+
+    image_data    set_ref, set_img, base_img;
+    tilemap_ctx * p_ctx_build;
+    tilemap_ctx * p_ctx_reuse;
+    const uint8_t * p_index;
+    size_t        index_size;
+    size_t        locked_bytes;
+    uint32_t      c;
+    uint32_t      entry_count;
+    uint32_t      mismatches, tile_count_ref, locked_count;
+    uint32_t    * p_entries_ref;
+    uint8_t       engine, storage_mode;
+    int32_t       status;
+    double        time_start, time_ref, time_base, time_build, time_reuse;
+
+    if ( ! tilemap_check_dimensions_valid(p_img, tile_width, tile_height) ) {
+        printf("Base Benchmark: image size must be a multiple of the tile size\n");
+        return false;
+    }
+
+    entry_count   = (p_img->width / tile_width) * (p_img->height / tile_height);
+    p_entries_ref = malloc((size_t)entry_count * sizeof(uint32_t));
+    set_ref.p_img_data  = NULL;
+    set_img.p_img_data  = NULL;
+    base_img.p_img_data = NULL;
+
+    if (!p_entries_ref) {
+        printf("Base Benchmark: Failed to allocate buffers for %" PRIu32 " entries\n", entry_count);
+        return false;
+    }
+
+    // Base tile set: first half of the tiles, as a tile strip
+    tilemap_storage_mode_set(TILE_STORAGE_REFERENCE);
+    status = tilemap_export_process(p_img, tile_width, tile_height, check_flip)
+             && tilemap_get_image_of_deduped_tile_set(&base_img);
+
+    if (!status || (tilemap_get_tile_set()->tile_count < 2)) {
+        printf("Base Benchmark: processing without a base failed\n");
+        free(base_img.p_img_data);
+        free(p_entries_ref);
+        tilemap_storage_mode_set(TILE_STORAGE_COPY);
+        tilemap_free_resources();
+        return false;
+    }
+
+    locked_count    = tilemap_get_tile_set()->tile_count / 2;
+    locked_bytes    = (size_t)locked_count * tilemap_get_tile_set()->tile_size;
+    base_img.height = locked_count * tile_height;
+    base_img.size   = locked_bytes;
+
+    printf("Base Benchmark: %" PRIu32 " x %" PRIu32 " image, %d x %d tiles (%" PRIu32 " entries), %" PRIu32 " of %" PRIu32 " tiles locked, flip %s\n",
+           p_img->width, p_img->height, tile_width, tile_height, entry_count,
+           locked_count, tilemap_get_tile_set()->tile_count, check_flip ? "on" : "off");
+
+    for (storage_mode = TILE_STORAGE_COPY; (storage_mode < TILE_STORAGE_LAST) && status; storage_mode++) {
+        for (engine = TILE_ENGINE_INCREMENTAL; (engine < TILE_ENGINE_LAST) && status; engine++) {
+
+            tilemap_storage_mode_set(storage_mode);
+            tilemap_dedupe_engine_set(engine);
+
+            // Without a base
+            tilemap_base_set(NULL);
+
+            time_start = get_time();
+            status     = tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+            time_ref   = get_time() - time_start;
+
+            for (c = 0; status && (c < entry_count); c++)
+                p_entries_ref[c] = tilemap_map_get_entry(tilemap_get_map(), c);
+            tile_count_ref = tilemap_get_tile_set()->tile_count;
+            status         = status && tilemap_get_image_of_deduped_tile_set(&set_ref);
+
+            // Against the base (the first run builds its index)
+            status = status && tilemap_base_set(&base_img);
+
+            time_start = get_time();
+            status     = status && tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+            time_base  = get_time() - time_start;
+
+            if (!status) {
+                printf("Base Benchmark: %-12s processing failed\n", tilemap_engine_get_name(engine));
+                break;
+            }
+
+            mismatches = ((tile_count_ref != tilemap_get_tile_set()->tile_count)
+                          || (locked_count != tilemap_get_tile_set()->tile_count_locked)) ? 1 : 0;
+            for (c = 0; c < entry_count; c++)
+                if (p_entries_ref[c] != tilemap_map_get_entry(tilemap_get_map(), c))
+                    mismatches++;
+
+            // Locked tiles keep the base pixels, appended ones are stored
+            // like without a base
+            if (!tilemap_get_image_of_deduped_tile_set(&set_img)
+                || (set_img.size != set_ref.size)
+                || (memcmp(set_img.p_img_data, base_img.p_img_data, locked_bytes) != 0)
+                || (memcmp(set_img.p_img_data + locked_bytes, set_ref.p_img_data + locked_bytes,
+                           set_ref.size - locked_bytes) != 0))
+                mismatches++;
+
+            free(set_ref.p_img_data);
+            free(set_img.p_img_data);
+            set_ref.p_img_data = NULL;
+            set_img.p_img_data = NULL;
+
+            printf("Base Benchmark: %-12s %-9s no base %8.3f sec, base %8.3f sec, %" PRIu32 " new tiles, %" PRIu32 " mismatches\n",
+                   tilemap_engine_get_name(engine), (storage_mode == TILE_STORAGE_COPY) ? "copy" : "reference",
+                   time_ref, time_base, tilemap_get_tile_set()->tile_count - tilemap_get_tile_set()->tile_count_locked,
+                   mismatches);
+
+            if (mismatches)
+                status = false;
+        }
+    }
+
+    // Reducing below the locked count keeps exactly the locked tiles
+    if (status) {
+        tilemap_storage_mode_set(TILE_STORAGE_COPY);
+        tilemap_dedupe_engine_set(TILE_ENGINE_INCREMENTAL);
+        tilemap_reduce_target_set((locked_count > 1) ? locked_count / 2 : 1);
+
+        status = tilemap_export_process(p_img, tile_width, tile_height, check_flip)
+                 && tilemap_get_image_of_deduped_tile_set(&set_img);
+
+        mismatches = (!status || (tilemap_get_tile_set()->tile_count != locked_count)
+                      || (memcmp(set_img.p_img_data, base_img.p_img_data, locked_bytes) != 0)) ? 1 : 0;
+        for (c = 0; status && (c < entry_count); c++)
+            if (tilemap_map_get_id(tilemap_get_map(), c) >= locked_count)
+                mismatches++;
+
+        printf("Base Benchmark: reduce to %" PRIu32 " -> %" PRIu32 " tiles, %" PRIu32 " mismatches\n",
+               (locked_count > 1) ? locked_count / 2 : 1, tilemap_get_tile_set()->tile_count, mismatches);
+
+        free(set_img.p_img_data);
+        set_img.p_img_data = NULL;
+        tilemap_reduce_target_set(REDUCE_TARGET_NONE);
+
+        if (mismatches)
+            status = false;
+    }
+
+    // Index build vs an index kept from an earlier run (another context here)
+    if (status) {
+        p_ctx_build = tilemap_ctx_create();
+        p_ctx_reuse = tilemap_ctx_create();
+        status      = (p_ctx_build && p_ctx_reuse);
+
+        status = status && tilemap_ctx_base_set(p_ctx_build, &base_img) && tilemap_ctx_base_set(p_ctx_reuse, &base_img);
+
+        time_start = get_time();
+        status     = status && tilemap_ctx_initialize(p_ctx_build, p_img, tile_width, tile_height,
+                                                      (check_flip) ? TILE_FLIP_BITS_XY : TILE_FLIP_BITS_NONE);
+        time_build = get_time() - time_start;
+
+        p_index = (status) ? tilemap_ctx_base_index_get(p_ctx_build, &index_size) : NULL;
+        status  = status && tilemap_ctx_base_index_set(p_ctx_reuse, p_index, index_size);
+
+        time_start = get_time();
+        status     = status && tilemap_ctx_initialize(p_ctx_reuse, p_img, tile_width, tile_height,
+                                                      (check_flip) ? TILE_FLIP_BITS_XY : TILE_FLIP_BITS_NONE);
+        time_reuse = get_time() - time_start;
+
+        mismatches = 0;
+        if (status) {
+            if (tilemap_ctx_get_tile_set(p_ctx_reuse)->tile_count != locked_count)
+                mismatches++;
+            for (c = 0; c < tilemap_ctx_get_tile_set(p_ctx_reuse)->tile_count; c++)
+                if (memcmp(tilemap_ctx_get_tile_set(p_ctx_build)->tiles[c].hash,
+                           tilemap_ctx_get_tile_set(p_ctx_reuse)->tiles[c].hash,
+                           sizeof(tilemap_ctx_get_tile_set(p_ctx_build)->tiles[c].hash)) != 0)
+                    mismatches++;
+
+            printf("Base Benchmark: index %zu bytes, build %8.3f sec, reuse %8.3f sec (%.2fx), %" PRIu32 " mismatches\n",
+                   index_size, time_build, time_reuse, (time_reuse > 0) ? time_build / time_reuse : 0.0, mismatches);
+        }
+        else
+            printf("Base Benchmark: index handover failed\n");
+
+        if (mismatches)
+            status = false;
+
+        tilemap_ctx_destroy(p_ctx_build);
+        tilemap_ctx_destroy(p_ctx_reuse);
+    }
+
+    free(set_ref.p_img_data);
+    free(set_img.p_img_data);
+    tilemap_base_set(NULL);
+    tilemap_storage_mode_set(TILE_STORAGE_COPY);
+    tilemap_dedupe_engine_set(TILE_ENGINE_INCREMENTAL);
+    tilemap_free_resources();
+    free(base_img.p_img_data);
+    free(p_entries_ref);
+
+    return status;
+}
+
+
+
+// Compare processing a low color indexed image with one byte
+// pixels and with bit-packed tiles, for each dedupe engine, and
+// check both give the same map
+//
+// * Packing is picked from the color count, so the unpacked run
+//   claims a full palette and the packed run the real color count
+// * Runs on the default context, leaves it on the incremental
+//   engine, without a color map and without a tile set afterward
+int32_t tilemap_benchmark_packed(image_data * p_img, int tile_width, int tile_height, int check_flip, uint16_t color_count) {
+
+    color_data colors;
+    uint32_t   c;
+    uint32_t   entry_count;
+    uint32_t   mismatches;
+    uint32_t   tile_count;
+    uint32_t * p_entries_ref;
+    uint64_t   bytes_unpacked, bytes_packed;
+    uint8_t    engine;
+    uint8_t    pack_bits;
+    int32_t    status;
+    double     time_start, time_unpacked, time_packed;
+
+    pack_bits = tile_packed_select_bits(p_img->bytes_per_pixel, color_count);
+
+    if ( ! tilemap_check_dimensions_valid(p_img, tile_width, tile_height) ) {
+        printf("Packed Benchmark: image size must be a multiple of the tile size\n");
+        return false;
+    }
+    else if (pack_bits == TILE_PACKED_BITS_NONE) {
+        printf("Packed Benchmark: needs an indexed image with %d colors or less\n", TILE_PACKED_COLORS_4BPP);
+        return false;
+    }
+
+    entry_count   = (p_img->width / tile_width) * (p_img->height / tile_height);
+    p_entries_ref = malloc((size_t)entry_count * sizeof(uint32_t));
+
+    if (!p_entries_ref) {
+        printf("Packed Benchmark: Failed to allocate buffers for %" PRIu32 " entries\n", entry_count);
+        return false;
+    }
+
+    printf("Packed Benchmark: %" PRIu32 " x %" PRIu32 " image, %d x %d tiles (%" PRIu32 " entries), %d colors -> %d bpp, flip %s\n",
+           p_img->width, p_img->height, tile_width, tile_height, entry_count, color_count, pack_bits, check_flip ? "on" : "off");
+
+    memset(&colors, 0x00, sizeof(colors));
+    colors.color_count = color_count;
+    tilemap_color_data_set(&colors);
+    status = true;
+
+    for (engine = TILE_ENGINE_INCREMENTAL; (engine < TILE_ENGINE_LAST) && status; engine++) {
+
+        tilemap_dedupe_engine_set(engine);
+
+        // One byte per pixel
+        tilemap_packing_set(TILE_PACKING_NEVER);
+
+        time_start = get_time();
+        status = tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+        time_unpacked = get_time() - time_start;
+
+        for (c = 0; status && (c < entry_count); c++)
+            p_entries_ref[c] = tilemap_map_get_entry(tilemap_get_map(), c);
+        bytes_unpacked = (uint64_t)tilemap_get_tile_set()->tile_count * tilemap_get_tile_set()->tile_size;
+
+        // Bit-packed
+        tilemap_packing_set(TILE_PACKING_ALWAYS);
+
+        time_start = get_time();
+        status = status && tilemap_export_process(p_img, tile_width, tile_height, check_flip);
+        time_packed = get_time() - time_start;
+
+        if (!status) {
+            printf("Packed Benchmark: %-12s processing failed\n", tilemap_engine_get_name(engine));
+            break;
+        }
+
+        bytes_packed = (uint64_t)tilemap_get_tile_set()->tile_count
+                       * tile_packed_get_size(tile_width, tile_height, tilemap_get_tile_set()->pack_bits);
+
+        mismatches = 0;
+        for (c = 0; c < entry_count; c++)
+            if (p_entries_ref[c] != tilemap_map_get_entry(tilemap_get_map(), c))
+                mismatches++;
+        tile_count = tilemap_get_tile_set()->tile_count;
+
+        // Which one the default setting picks for this engine and flip search
+        tilemap_packing_set(TILE_PACKING_AUTO);
+        tilemap_tile_set_initialize(p_img, tile_width, tile_height, check_flip ? TILE_FLIP_BITS_XY : TILE_FLIP_BITS_NONE);
+
+        printf("Packed Benchmark: %-12s unpacked %8.3f sec, packed %8.3f sec (%.2fx), tile pixels %" PRIu64 " -> %" PRIu64 " bytes, %" PRIu32 " unique tiles, %" PRIu32 " map mismatches, auto %s\n",
+               tilemap_engine_get_name(engine), time_unpacked, time_packed,
+               (time_packed > 0) ? time_unpacked / time_packed : 0.0,
+               bytes_unpacked, bytes_packed, tile_count, mismatches,
+               (tilemap_get_tile_set()->pack_bits) ? "packs" : "unpacked");
+    }
+
+    colors.color_count = 0;
+    tilemap_color_data_set(&colors);
+    tilemap_packing_set(TILE_PACKING_AUTO);
+    tilemap_dedupe_engine_set(TILE_ENGINE_INCREMENTAL);
+    tilemap_free_resources();
+    free(p_entries_ref);
+
+    return status;
+}
+
+
+
+// One thread's share of the index stress test
+typedef struct {
+    tile_index     * p_index;
+    const uint64_t * p_keys;     // Key per item, many duplicates
+    uint32_t       * p_slots;    // Slot each item's insert returned
+    uint32_t         item_count;
+    uint32_t         thread_num;
+    uint32_t         thread_count;
+    uint32_t         errors;     // Lookups that didn't find the slot just inserted into
+} bench_index_worker_arg;
+
+
+// Threads take interleaved items, so they keep racing on the same keys
+static void * bench_index_worker(void * p_arg) {
+
+    bench_index_worker_arg * p_w = p_arg;
+    uint32_t c;
+
+    for (c = p_w->thread_num; c < p_w->item_count; c += p_w->thread_count) {
+        p_w->p_slots[c] = tile_index_insert(p_w->p_index, p_w->p_keys[c], c);
+
+        if ((p_w->p_slots[c] == TILE_INDEX_NOT_FOUND)
+            || (tile_index_find(p_w->p_index, p_w->p_keys[c]) != p_w->p_slots[c]))
+            p_w->errors++;
+    }
+
+    return NULL;
+}
+
+
+
+// Stress test for the lock-free tile index: many threads insert a
+// duplicate heavy key stream, then the assigned IDs get checked
+// against a single threaded run (they must match on every round)
+//
+// * Key 0 is part of the stream, it uses the index's separate slot
+int32_t tilemap_benchmark_index(uint32_t thread_count, uint32_t item_count, uint32_t unique_count, uint32_t rounds) {
+
+    tile_index             index;
+    bench_index_worker_arg args[BENCHMARK_INDEX_THREADS_MAX];
+    pthread_t              threads[BENCHMARK_INDEX_THREADS_MAX];
+    uint64_t             * p_keys;
+    uint32_t             * p_slots;
+    uint32_t             * p_ids_ref;
+    uint32_t               c, round, started;
+    uint32_t               key_count, key_count_ref;
+    uint32_t               errors, mismatches;
+    uint64_t               x;
+    double                 time_start, time_insert;
+    int32_t                status;
+
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > BENCHMARK_INDEX_THREADS_MAX) thread_count = BENCHMARK_INDEX_THREADS_MAX;
+
+    p_keys    = malloc((size_t)item_count * sizeof(uint64_t));
+    p_slots   = malloc((size_t)item_count * sizeof(uint32_t));
+    p_ids_ref = malloc((size_t)item_count * sizeof(uint32_t));
+
+    if (!(p_keys && p_slots && p_ids_ref)) {
+        printf("Index Benchmark: Failed to allocate buffers for %" PRIu32 " items\n", item_count);
+        free(p_keys);
+        free(p_slots);
+        free(p_ids_ref);
+        return false;
+    }
+
+    // Pseudo-random picks out of unique_count keys (key 0 included)
+    x = 0x9E3779B97F4A7C15ULL;
+    for (c = 0; c < item_count; c++) {
+        x ^= x << 13;  x ^= x >> 7;  x ^= x << 17;
+        p_keys[c] = (x % unique_count) * 0xD6E8FEB86659FD93ULL;
+    }
+
+    printf("Index Benchmark: %" PRIu32 " items, %" PRIu32 " unique keys, %" PRIu32 " threads, %" PRIu32 " rounds\n",
+           item_count, unique_count, thread_count, rounds);
+
+    // Single threaded reference
+    status = tile_index_init(&index, item_count);
+    if (status) {
+        for (c = 0; c < item_count; c++)
+            p_slots[c] = tile_index_insert(&index, p_keys[c], c);
+
+        key_count_ref = tile_index_assign_ids(&index);
+        for (c = 0; c < item_count; c++)
+            p_ids_ref[c] = tile_index_get_id(&index, p_slots[c]);
+
+        tile_index_free(&index);
+    }
+
+    for (round = 0; status && (round < rounds); round++) {
+
+        if (!tile_index_init(&index, item_count)) {
+            status = false;
+            break;
+        }
+
+        time_start = get_time();
+
+        started = 0;
+        for (c = 0; c < thread_count; c++) {
+            args[c].p_index      = &index;
+            args[c].p_keys       = p_keys;
+            args[c].p_slots      = p_slots;
+            args[c].item_count   = item_count;
+            args[c].thread_num   = c;
+            args[c].thread_count = thread_count;
+            args[c].errors       = 0;
+
+            if (pthread_create(&threads[c], NULL, bench_index_worker, &args[c]) == 0)
+                started++;
+            else
+                break;
+        }
+
+        // Any thread that failed to start has its share done here
+        for (c = started; c < thread_count; c++)
+            bench_index_worker(&args[c]);
+
+        for (c = 0; c < started; c++)
+            pthread_join(threads[c], NULL);
+
+        time_insert = get_time() - time_start;
+
+        key_count  = tile_index_assign_ids(&index);
+        errors     = 0;
+        mismatches = 0;
+
+        for (c = 0; c < thread_count; c++)
+            errors += args[c].errors;
+
+        for (c = 0; c < item_count; c++)
+            if (tile_index_get_id(&index, p_slots[c]) != p_ids_ref[c])
+                mismatches++;
+
+        printf("Index Benchmark: Round %2" PRIu32 ": %7.1f M inserts/sec, %" PRIu32 " keys (expected %" PRIu32 "), %" PRIu32 " lookup errors, %" PRIu32 " ID mismatches\n",
+               round, (time_insert > 0) ? (item_count / 1e6) / time_insert : 0.0,
+               key_count, key_count_ref, errors, mismatches);
+
+        if ((key_count != key_count_ref) || errors || mismatches)
+            status = false;
+
+        tile_index_free(&index);
+    }
+
+    printf("Index Benchmark: %s\n", status ? "PASS" : "FAIL");
+
+    free(p_keys);
+    free(p_slots);
+    free(p_ids_ref);
+
+    return status;
+}
+
+
+
+// Build the synthetic tile with the given number and hash it
+static inline uint64_t bench_lookup_tile_key(uint8_t * p_tile, uint32_t tile_num, tile_hash_func hash_func) {
+
+    memcpy(p_tile, &tile_num, sizeof(tile_num));
+    return hash_func(p_tile, BENCHMARK_LOOKUP_TILE_BYTES);
+}
+
+
+
+// The lookups where the engine does them: the incremental engine over a
+// 2 byte per pixel image of 8 x 8 tiles with (up to) unique_count of them,
+// hashing each map row and looking it up with one tile_index_find_batch().
+// Also replays a sample of the cells through the linear tile set search
+// (tile_find_match()) the engine used before
+//
+// * The map must match the concurrent engine's, the linear search
+//   must find the same tiles
+static int32_t bench_lookup_engine(uint32_t unique_count) {
+
+    image_data     img;
+    tilemap_ctx  * p_ctx;
+    tilemap_ctx  * p_ctx_check;
+    tile_set_data * p_tile_set;
+    tile_map_data * p_map;
+    uint64_t     * p_hashes;
+    uint32_t     * p_ids;
+    tile_map_entry map_entry;
+    uint32_t       c, round, cells_linear;
+    uint32_t       mismatches;
+    double         time_start, time_engine, time_linear, t;
+    int32_t        status;
+
+    img.width           = BENCHMARK_LOOKUP_ENGINE_WIDTH;
+    img.height          = BENCHMARK_LOOKUP_ENGINE_HEIGHT;
+    img.bytes_per_pixel = 2;
+    img.size            = (uint64_t)img.width * img.height * img.bytes_per_pixel;
+    img.p_img_data      = malloc(img.size);
+
+    cells_linear = BENCHMARK_LOOKUP_LINEAR_CELLS;
+    p_hashes     = malloc((size_t)cells_linear * sizeof(uint64_t));
+    p_ids        = malloc((size_t)cells_linear * sizeof(uint32_t));
+    p_ctx        = NULL;
+    p_ctx_check  = tilemap_ctx_create();
+
+    if (!(img.p_img_data && p_hashes && p_ids && p_ctx_check)) {
+        printf("Lookup Benchmark: Failed to allocate the engine image\n");
+        status = false;
+        goto cleanup;
+    }
+
+    benchmark_fill_image(&img, 8, 8, unique_count);
+
+    time_engine = 0.0;
+    status      = true;
+
+    for (round = 0; status && (round < BENCHMARK_LOOKUP_ROUNDS); round++) {
+
+        tilemap_ctx_destroy(p_ctx);
+        p_ctx = tilemap_ctx_create();
+
+        time_start = get_time();
+        status = p_ctx && tilemap_ctx_export_process(p_ctx, &img, 8, 8, false);
+        t = get_time() - time_start;
+        if ((round == 0) || (t < time_engine))
+            time_engine = t;
+    }
+
+    tilemap_ctx_dedupe_engine_set(p_ctx_check, TILE_ENGINE_CONCURRENT);
+    if (!status || !tilemap_ctx_export_process(p_ctx_check, &img, 8, 8, false)) {
+        printf("Lookup Benchmark: Processing failed\n");
+        status = false;
+        goto cleanup;
+    }
+
+    p_map      = tilemap_ctx_get_map(p_ctx);
+    p_tile_set = tilemap_ctx_get_tile_set(p_ctx);
+
+    mismatches = 0;
+    for (c = 0; c < p_map->size; c++)
+        if (tilemap_map_get_entry(p_map, c) != tilemap_map_get_entry(tilemap_ctx_get_map(p_ctx_check), c))
+            mismatches++;
+
+    // Cell hashes are the hashes of the tiles they map to
+    if (cells_linear > p_map->size)
+        cells_linear = p_map->size;
+    for (c = 0; c < cells_linear; c++) {
+        p_ids[c]    = tilemap_map_get_id(p_map, c);
+        p_hashes[c] = p_tile_set->tiles[ p_ids[c] ].hash[0];
+    }
+
+    time_start = get_time();
+    for (c = 0; c < cells_linear; c++) {
+        map_entry = tile_find_match(p_hashes[c], p_tile_set, TILE_FLIP_BITS_NONE);
+        if (map_entry.id != p_ids[c])
+            mismatches++;
+    }
+    time_linear = get_time() - time_start;
+
+    printf("Lookup Benchmark:    engine %8" PRIu32 " tiles (%" PRIu32 " cells): incremental %6.1f M cells/sec"
+           " (hash, batched lookup, register), linear search alone %6.1f M lookups/sec, %" PRIu32 " mismatches\n",
+           p_tile_set->tile_count, p_map->size,
+           (time_engine > 0) ? (p_map->size / 1e6) / time_engine : 0.0,
+           (time_linear > 0) ? (cells_linear / 1e6) / time_linear : 0.0,
+           mismatches);
+
+    status = (mismatches == 0);
+
+cleanup:
+    tilemap_ctx_destroy(p_ctx);
+    tilemap_ctx_destroy(p_ctx_check);
+    free(img.p_img_data);
+    free(p_hashes);
+    free(p_ids);
+
+    return status;
+}
+
+
+
+// Compare the lookup stage done one cell at a time (hash, then probe
+// the tile index) against batches the size of a map row (hash the
+// whole row, then tile_index_find_batch() which prefetches slots
+// ahead), with unique_count tiles in the index. Past a few hundred
+// thousand tiles the table no longer fits in L2, so nearly every
+// probe misses the cache.
+//
+// Up to the tile set limit the incremental engine, which looks up
+// map rows that way, gets timed as well (bench_lookup_engine())
+//
+// * Both ways must return the same slots
+int32_t tilemap_benchmark_lookup(uint32_t unique_count, uint32_t lookup_count) {
+
+    tile_index     index;
+    tile_hash_func hash_func;
+    uint8_t        tile[BENCHMARK_LOOKUP_TILE_BYTES];
+    uint64_t       row_keys[BENCHMARK_LOOKUP_BATCH];
+    uint32_t     * p_picks;
+    uint32_t     * p_slots;
+    uint32_t     * p_slots_batch;
+    uint32_t       c, b, round, count;
+    uint32_t       mismatches;
+    uint64_t       x;
+    double         time_start, time_single, time_batch, t;
+    int32_t        status;
+
+    if (unique_count < 1)
+        unique_count = 1;
+
+    hash_func = tile_hash_get_func(TILE_HASH_AUTO);
+
+    p_picks       = malloc((size_t)lookup_count * sizeof(uint32_t));
+    p_slots       = malloc((size_t)lookup_count * sizeof(uint32_t));
+    p_slots_batch = malloc((size_t)lookup_count * sizeof(uint32_t));
+
+    if (!(p_picks && p_slots && p_slots_batch && tile_index_init(&index, unique_count))) {
+        printf("Lookup Benchmark: Failed to allocate buffers for %" PRIu32 " tiles\n", unique_count);
+        free(p_picks);
+        free(p_slots);
+        free(p_slots_batch);
+        return false;
+    }
+
+    for (c = 0; c < sizeof(tile); c++)
+        tile[c] = (uint8_t)(c * 37);
+
+    for (c = 0; c < unique_count; c++)
+        tile_index_insert(&index, bench_lookup_tile_key(tile, c, hash_func), c);
+
+    // Cells are pseudo-random picks out of the indexed tiles
+    x = 0x9E3779B97F4A7C15ULL;
+    for (c = 0; c < lookup_count; c++) {
+        x ^= x << 13;  x ^= x >> 7;  x ^= x << 17;
+        p_picks[c] = (uint32_t)(x % unique_count);
+    }
+
+    time_single = 0.0;
+    time_batch  = 0.0;
+
+    for (round = 0; round < BENCHMARK_LOOKUP_ROUNDS; round++) {
+
+        time_start = get_time();
+        for (c = 0; c < lookup_count; c++)
+            p_slots[c] = tile_index_find(&index, bench_lookup_tile_key(tile, p_picks[c], hash_func));
+        t = get_time() - time_start;
+        if ((round == 0) || (t < time_single))
+            time_single = t;
+
+        time_start = get_time();
+        for (c = 0; c < lookup_count; c += BENCHMARK_LOOKUP_BATCH) {
+            count = lookup_count - c;
+            if (count > BENCHMARK_LOOKUP_BATCH)
+                count = BENCHMARK_LOOKUP_BATCH;
+
+            for (b = 0; b < count; b++)
+                row_keys[b] = bench_lookup_tile_key(tile, p_picks[c + b], hash_func);
+            tile_index_find_batch(&index, row_keys, count, &p_slots_batch[c]);
+        }
+        t = get_time() - time_start;
+        if ((round == 0) || (t < time_batch))
+            time_batch = t;
+    }
+
+    mismatches = 0;
+    for (c = 0; c < lookup_count; c++)
+        if ((p_slots[c] != p_slots_batch[c]) || (p_slots[c] == TILE_INDEX_NOT_FOUND))
+            mismatches++;
+
+    printf("Lookup Benchmark: %8" PRIu32 " tiles (%6.1f MB index): single %6.1f M/sec, batched %6.1f M/sec (%.2fx), %" PRIu32 " mismatches\n",
+           unique_count,
+           ((double)index.slot_count * (sizeof(uint64_t) + sizeof(uint32_t))) / (1024.0 * 1024.0),
+           (time_single > 0) ? (lookup_count / 1e6) / time_single : 0.0,
+           (time_batch  > 0) ? (lookup_count / 1e6) / time_batch  : 0.0,
+           (time_batch  > 0) ? time_single / time_batch : 0.0,
+           mismatches);
+
+    status = (mismatches == 0);
+
+    tile_index_free(&index);
+    free(p_picks);
+    free(p_slots);
+    free(p_slots_batch);
+
+    if (unique_count <= TILES_MAX_DEFAULT)
+        status &= bench_lookup_engine(unique_count);
+
+    return status;
+}
+
+
+
+// Sub-palette solver on a synthetic tile set: tiles use random
+// subsets of count_max hidden sub-palettes of colors_max colors,
+// so a solution with count_max sub-palettes exists
+//
+// * Checks every tile got a sub-palette with all its colors and
+//   no sub-palette has more than colors_max colors
+int32_t tilemap_benchmark_subpal(uint32_t tile_count, uint16_t count_max, uint16_t colors_max) {
+
+    tile_set_data * p_tile_set;
+    color_data      colormap;
+    uint8_t         hidden[TILE_SUBPAL_SLOTS_MAX][COLOR_DATA_PAL_MAX_COUNT];
+    uint32_t        c, m, p, pick, bad;
+    uint16_t        colors;
+    uint64_t        x;
+    double          time_start, time_solve;
+    int32_t         status;
+
+    if ((count_max < 1) || (count_max > TILE_SUBPAL_SLOTS_MAX) || (colors_max < 1)
+        || (((uint32_t)count_max * colors_max) > COLOR_DATA_PAL_MAX_COUNT) || (tile_count > TILES_MAX_DEFAULT)) {
+        printf("Sub-palette Benchmark: %d x %d colors doesn't fit a %d color palette\n",
+               count_max, colors_max, COLOR_DATA_PAL_MAX_COUNT);
+        return false;
+    }
+
+    p_tile_set = calloc(1, sizeof(tile_set_data));
+    if (!p_tile_set)
+        return false;
+
+    // Distinct colors, hidden sub-palettes are disjoint runs of the colormap
+    memset(&colormap, 0x00, sizeof(colormap));
+    colormap.color_count = count_max * colors_max;
+    for (c = 0; c < colormap.color_count; c++) {
+        colormap.pal[(c * COLOR_DATA_BYTES_PER_COLOR) + 0] = (uint8_t)c;
+        colormap.pal[(c * COLOR_DATA_BYTES_PER_COLOR) + 1] = (uint8_t)(c >> 8);
+    }
+
+    for (p = 0; p < count_max; p++)
+        for (c = 0; c < colors_max; c++)
+            hidden[p][c] = (uint8_t)((p * colors_max) + c);
+
+    p_tile_set->tile_bytes_per_pixel = 1;
+    p_tile_set->tile_count           = tile_count;
+
+    x = 0x9E3779B97F4A7C15ULL;
+    for (c = 0; c < tile_count; c++) {
+        x ^= x << 13;  x ^= x >> 7;  x ^= x << 17;
+        p      = (uint32_t)(x % count_max);
+        colors = 1 + (uint16_t)((x >> 16) % colors_max);
+
+        for (m = 0; m < colors; m++) {
+            x ^= x << 13;  x ^= x >> 7;  x ^= x << 17;
+            pick = hidden[p][x % colors_max];
+            p_tile_set->tiles[c].stats.palette_used[pick >> 6] |= 1ULL << (pick & 63);
+        }
+        p_tile_set->tiles[c].stats.color_count = __builtin_popcountll(p_tile_set->tiles[c].stats.palette_used[0])
+                                                 + __builtin_popcountll(p_tile_set->tiles[c].stats.palette_used[1])
+                                                 + __builtin_popcountll(p_tile_set->tiles[c].stats.palette_used[2])
+                                                 + __builtin_popcountll(p_tile_set->tiles[c].stats.palette_used[3]);
+    }
+
+    time_start = get_time();
+    status     = tilemap_subpal_solve(p_tile_set, &colormap, count_max, colors_max);
+    time_solve = get_time() - time_start;
+
+    bad = 0;
+    for (c = 0; status && (c < tile_count); c++) {
+        p = p_tile_set->tiles[c].sub_palette;
+        if (p >= p_tile_set->subpal.count)
+            bad++;
+        else
+            for (m = 0; m < 4; m++)
+                if (p_tile_set->tiles[c].stats.palette_used[m] & ~p_tile_set->subpal.colors[p][m])
+                    bad++;
+    }
+
+    for (p = 0; status && (p < p_tile_set->subpal.count); p++)
+        if ((__builtin_popcountll(p_tile_set->subpal.colors[p][0]) + __builtin_popcountll(p_tile_set->subpal.colors[p][1])
+             + __builtin_popcountll(p_tile_set->subpal.colors[p][2]) + __builtin_popcountll(p_tile_set->subpal.colors[p][3]))
+            > colors_max)
+            bad++;
+
+    printf("Sub-palette Benchmark: %5" PRIu32 " tiles, %2d x %3d colors: %2d sub-palettes in %8.2f msec, %" PRIu32 " errors\n",
+           tile_count, count_max, colors_max, p_tile_set->subpal.count, time_solve * 1000.0, bad);
+
+    status = status && (bad == 0);
+
+    free(p_tile_set);
+
+    return status;
+}
+
+
+
+
+// Viewport residency on a synthetic map: sliding reference counts vs
+// recounting every window. Columns further right draw from more tile
+// IDs, so the peak and the heat strips aren't flat
+//
+// * Checks the peak, its location and both heat strips match the recount
+int32_t tilemap_benchmark_window(uint32_t width_in_tiles, uint32_t height_in_tiles, uint32_t unique_count,
+                                 uint16_t view_width, uint16_t view_height) {
+
+    tile_map_data map;
+    uint32_t    * p_stamp;
+    uint32_t    * p_heat_x;
+    uint32_t    * p_heat_y;
+    uint32_t      x, y, wx, wy, id, count, stamp;
+    uint32_t      peak_count, peak_x, peak_y, bad;
+    uint64_t      r;
+    double        time_start, time_slide, time_recount;
+    int32_t       status;
+
+    if ((width_in_tiles == 0) || (height_in_tiles == 0) || (unique_count == 0)
+        || (view_width == 0) || (view_width > width_in_tiles)
+        || (view_height == 0) || (view_height > height_in_tiles)) {
+        printf("Window Benchmark: %d x %d view doesn't fit a %d x %d map\n",
+               view_width, view_height, width_in_tiles, height_in_tiles);
+        return false;
+    }
+
+    memset(&map, 0x00, sizeof(map));
+    map.width_in_tiles  = width_in_tiles;
+    map.height_in_tiles = height_in_tiles;
+    map.size            = width_in_tiles * height_in_tiles;
+    map.tile_id_list    = malloc((size_t)map.size * sizeof(uint32_t));
+
+    p_stamp  = calloc(unique_count, sizeof(uint32_t));
+    p_heat_x = calloc(width_in_tiles  - view_width  + 1, sizeof(uint32_t));
+    p_heat_y = calloc(height_in_tiles - view_height + 1, sizeof(uint32_t));
+
+    if (!map.tile_id_list || !p_stamp || !p_heat_x || !p_heat_y) {
+        free(map.tile_id_list);
+        free(p_stamp);
+        free(p_heat_x);
+        free(p_heat_y);
+        return false;
+    }
+
+    r = 0x9E3779B97F4A7C15ULL;
+    for (y = 0; y < height_in_tiles; y++)
+        for (x = 0; x < width_in_tiles; x++) {
+            r ^= r << 13;  r ^= r >> 7;  r ^= r << 17;
+            map.tile_id_list[(y * width_in_tiles) + x] =
+                (uint32_t)(r % (1 + (((uint64_t)unique_count - 1) * x) / width_in_tiles));
+        }
+
+    time_start = get_time();
+    status     = tilemap_window_calc(&map, view_width, view_height);
+    time_slide = get_time() - time_start;
+
+    // Recount each window, stamps mark the IDs already counted in it
+    peak_count = 0;
+    peak_x     = 0;
+    peak_y     = 0;
+    stamp      = 0;
+
+    time_start = get_time();
+    for (wy = 0; wy + view_height <= height_in_tiles; wy++)
+        for (wx = 0; wx + view_width <= width_in_tiles; wx++) {
+
+            stamp++;
+            count = 0;
+            for (y = wy; y < wy + view_height; y++)
+                for (x = wx; x < wx + view_width; x++) {
+                    id = map.tile_id_list[(y * width_in_tiles) + x];
+                    if (p_stamp[id] != stamp) {
+                        p_stamp[id] = stamp;
+                        count++;
+                    }
+                }
+
+            if (count > p_heat_x[wx]) p_heat_x[wx] = count;
+            if (count > p_heat_y[wy]) p_heat_y[wy] = count;
+            if (count > peak_count) {
+                peak_count = count;
+                peak_x     = wx;
+                peak_y     = wy;
+            }
+        }
+    time_recount = get_time() - time_start;
+
+    bad = 0;
+    if (status) {
+        if ((map.window.peak_count != peak_count) || (map.window.peak_x != peak_x) || (map.window.peak_y != peak_y))
+            bad++;
+
+        for (x = 0; x < map.window.positions_x; x++)
+            if (map.window.p_heat_x[x] != p_heat_x[x])
+                bad++;
+
+        for (y = 0; y < map.window.positions_y; y++)
+            if (map.window.p_heat_y[y] != p_heat_y[y])
+                bad++;
+    }
+
+    printf("Window Benchmark: %5" PRIu32 " x %-5" PRIu32 " map, %3d x %-3d view: peak %4" PRIu32 " at %" PRIu32 ",%" PRIu32
+           "  sliding %8.2f msec, recount %8.2f msec (%5.1fx), %" PRIu32 " errors\n",
+           width_in_tiles, height_in_tiles, view_width, view_height, map.window.peak_count,
+           map.window.peak_x, map.window.peak_y, time_slide * 1000.0, time_recount * 1000.0,
+           (time_slide > 0) ? time_recount / time_slide : 0.0, bad);
+
+    status = status && (bad == 0);
+
+    tilemap_map_free(&map);
+    free(p_stamp);
+    free(p_heat_x);
+    free(p_heat_y);
+
+    return status;
+}
+
+
+
+// Room split on a synthetic map (same ID layout as the window
+// benchmark), the shared table and local maps get checked against
+// a per room recount
+//
+// * Every room cell's local ID must lead back to the map's global ID
+// * Each room's tile count and the shared counts must match the recount
+int32_t tilemap_benchmark_rooms(uint32_t width_in_tiles, uint32_t height_in_tiles, uint32_t unique_count,
+                                uint16_t room_width, uint16_t room_height) {
+
+    tile_map_data    map;
+    tile_rooms_data  rooms;
+    tile_room_data * p_room;
+    uint32_t       * p_stamp;
+    uint32_t       * p_refs;
+    uint32_t         x, y, r, id, count, shared, bad;
+    uint64_t         rnd;
+    double           time_start, time_rooms;
+    int32_t          status;
+
+    if ((width_in_tiles == 0) || (height_in_tiles == 0) || (unique_count == 0)
+        || (room_width == 0) || (room_width > ROOMS_SIZE_MAX) || (room_height == 0) || (room_height > ROOMS_SIZE_MAX)) {
+        printf("Rooms Benchmark: %d x %d rooms don't fit a %d x %d map\n",
+               room_width, room_height, width_in_tiles, height_in_tiles);
+        return false;
+    }
+
+    memset(&map, 0x00, sizeof(map));
+    memset(&rooms, 0x00, sizeof(rooms));
+    map.width_in_tiles  = width_in_tiles;
+    map.height_in_tiles = height_in_tiles;
+    map.size            = width_in_tiles * height_in_tiles;
+    map.tile_id_list    = malloc((size_t)map.size * sizeof(uint32_t));
+
+    p_stamp = calloc(unique_count, sizeof(uint32_t));
+    p_refs  = calloc(unique_count, sizeof(uint32_t));
+
+    if (!map.tile_id_list || !p_stamp || !p_refs) {
+        free(map.tile_id_list);
+        free(p_stamp);
+        free(p_refs);
+        return false;
+    }
+
+    rnd = 0x9E3779B97F4A7C15ULL;
+    for (y = 0; y < height_in_tiles; y++)
+        for (x = 0; x < width_in_tiles; x++) {
+            rnd ^= rnd << 13;  rnd ^= rnd >> 7;  rnd ^= rnd << 17;
+            map.tile_id_list[(y * width_in_tiles) + x] =
+                (uint32_t)(rnd % (1 + (((uint64_t)unique_count - 1) * x) / width_in_tiles));
+        }
+
+    time_start = get_time();
+    status     = tilemap_rooms_calc(&rooms, &map, unique_count, room_width, room_height);
+    time_rooms = get_time() - time_start;
+
+    bad = 0;
+
+    // Local maps lead back to the global IDs, tile counts match a recount
+    for (r = 0; status && (r < rooms.count); r++) {
+        p_room = &rooms.p_rooms[r];
+        count  = 0;
+
+        for (y = 0; y < p_room->height; y++)
+            for (x = 0; x < p_room->width; x++) {
+                id = map.tile_id_list[((p_room->y + y) * width_in_tiles) + p_room->x + x];
+
+                if (rooms.p_tile_ids[p_room->offset + rooms.p_cell_ids[p_room->offset + (y * p_room->width) + x]] != id)
+                    bad++;
+
+                if (p_stamp[id] != r + 1) {
+                    p_stamp[id] = r + 1;
+                    p_refs[id]++;
+                    count++;
+                }
+            }
+
+        if (count != p_room->tile_count)
+            bad++;
+    }
+
+    shared = 0;
+    for (id = 0; status && (id < unique_count); id++) {
+        if (p_refs[id] > 1)
+            shared++;
+        if (p_refs[id] != rooms.p_room_refs[id])
+            bad++;
+    }
+    if (shared != rooms.tiles_shared)
+        bad++;
+
+    printf("Rooms Benchmark: %5" PRIu32 " x %-5" PRIu32 " map, %3d x %-3d rooms: %6" PRIu32 " rooms, largest %4" PRIu32
+           " tiles, %4" PRIu32 " shared in %8.2f msec, %" PRIu32 " errors\n",
+           width_in_tiles, height_in_tiles, room_width, room_height, rooms.count, rooms.tile_count_max,
+           rooms.tiles_shared, time_rooms * 1000.0, bad);
+
+    status = status && (bad == 0);
+
+    tilemap_rooms_free(&rooms);
+    tilemap_map_free(&map);
+    free(p_stamp);
+    free(p_refs);
+
+    return status;
+}
+
+
+
+// Metatile table rows compared by the distinctness check below
+static const uint32_t * bench_metatile_ids;
+static const uint16_t * bench_metatile_attribs;
+static uint32_t         bench_metatile_entries;
+
+static int bench_metatile_row_compare(const void * p_a, const void * p_b) {
+
+    size_t   row_a = (size_t)*(const uint32_t *)p_a * bench_metatile_entries;
+    size_t   row_b = (size_t)*(const uint32_t *)p_b * bench_metatile_entries;
+    uint32_t n;
+
+    for (n = 0; n < bench_metatile_entries; n++) {
+        if (bench_metatile_ids[row_a + n] != bench_metatile_ids[row_b + n])
+            return (bench_metatile_ids[row_a + n] < bench_metatile_ids[row_b + n]) ? -1 : 1;
+        if (bench_metatile_attribs[row_a + n] != bench_metatile_attribs[row_b + n])
+            return (bench_metatile_attribs[row_a + n] < bench_metatile_attribs[row_b + n]) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+
+
+// Time the metatile pass against the first (tile) dedupe pass
+// on a synthetic image built from unique_count distinct blocks
+//
+// * The metatile pass runs on the packed map the first pass
+//   leaves behind, so its time includes decoding the entries
+// * Every block must equal its metatile, IDs must come in order
+//   of first use and no two metatiles may be equal
+int32_t tilemap_benchmark_metatile(uint32_t width, uint32_t height, int tile_size,
+                                   uint16_t block_width, uint16_t block_height, uint32_t unique_count) {
+
+    image_data           img;
+    tile_map_data      * p_map;
+    tile_metatile_data * p_meta;
+    tile_map_iter        iter;
+    uint32_t           * p_ids;
+    uint16_t           * p_attribs;
+    uint32_t           * p_rows;
+    uint32_t             c, n, block, id, seen, entries, bad;
+    size_t               cell;
+    double               time_start, time_process, time_meta;
+    int32_t              status;
+
+    if ((tile_size < 1) || (block_width < 1) || (block_width > METATILE_SIZE_MAX)
+        || (block_height < 1) || (block_height > METATILE_SIZE_MAX) || (unique_count < 1)
+        || (width % (tile_size * block_width)) || (height % (tile_size * block_height))) {
+        printf("Metatile Benchmark: %d x %d image must be a multiple of %d x %d blocks of %d x %d tiles\n",
+               width, height, block_width, block_height, tile_size, tile_size);
+        return false;
+    }
+
+    img.width           = width;
+    img.height          = height;
+    img.bytes_per_pixel = 4;
+    img.size            = (uint64_t)width * height * img.bytes_per_pixel;
+    img.p_img_data      = malloc(img.size);
+
+    if (!img.p_img_data) {
+        printf("Metatile Benchmark: Failed to allocate %" PRIu64 " bytes\n", img.size);
+        return false;
+    }
+
+    // One pattern per block, the tiles inside a block still differ
+    benchmark_fill_image(&img, tile_size * block_width, tile_size * block_height, unique_count);
+
+    time_start   = get_time();
+    status       = tilemap_export_process(&img, tile_size, tile_size, false);
+    time_process = get_time() - time_start;
+
+    p_map  = tilemap_get_map();
+    p_meta = &p_map->metatiles;
+
+    time_start = get_time();
+    status     = status && tilemap_metatile_calc(p_map, block_width, block_height) && p_meta->p_map;
+    time_meta  = get_time() - time_start;
+
+    entries   = (uint32_t)block_width * block_height;
+    p_ids     = malloc((size_t)p_map->size * sizeof(uint32_t));
+    p_attribs = malloc((size_t)p_map->size * sizeof(uint16_t));
+    p_rows    = malloc((size_t)((status) ? p_meta->count : 1) * sizeof(uint32_t));
+    status    = status && p_ids && p_attribs && p_rows;
+
+    bad = 0;
+
+    if (status) {
+        tilemap_map_iter_init(&iter, p_map);
+        for (c = 0; c < p_map->size; c++)
+            tilemap_map_iter_next(&iter, &p_ids[c], &p_attribs[c]);
+
+        // Blocks match their metatile, IDs in order of first use
+        seen = 0;
+        for (block = 0; block < p_meta->width_in_blocks * p_meta->height_in_blocks; block++) {
+            id = p_meta->p_map[block];
+
+            if (id == seen)
+                seen++;
+            else if (id > seen) {
+                bad++;
+                continue;
+            }
+
+            for (n = 0; n < entries; n++) {
+                cell = ((size_t)((block / p_meta->width_in_blocks) * block_height + (n / block_width)) * p_map->width_in_tiles)
+                       + ((block % p_meta->width_in_blocks) * block_width) + (n % block_width);
+
+                if ((p_ids[cell] != p_meta->p_table_ids[((size_t)id * entries) + n])
+                    || (p_attribs[cell] != p_meta->p_table_attribs[((size_t)id * entries) + n]))
+                    bad++;
+            }
+        }
+        if (seen != p_meta->count)
+            bad++;
+
+        // No two metatiles are equal
+        bench_metatile_ids     = p_meta->p_table_ids;
+        bench_metatile_attribs = p_meta->p_table_attribs;
+        bench_metatile_entries = entries;
+
+        for (c = 0; c < p_meta->count; c++)
+            p_rows[c] = c;
+        qsort(p_rows, p_meta->count, sizeof(uint32_t), bench_metatile_row_compare);
+
+        for (c = 1; c < p_meta->count; c++)
+            if (bench_metatile_row_compare(&p_rows[c - 1], &p_rows[c]) == 0)
+                bad++;
+    }
+
+    if (status)
+        printf("Metatile Benchmark: %5" PRIu32 " x %-5" PRIu32 " image, %d x %d blocks: %6" PRIu32 " tiles, %6" PRIu32
+               " metatiles (%s keys), first pass %8.2f msec, metatiles %7.2f msec (%.1f%%), %" PRIu32 " errors\n",
+               width, height, block_width, block_height, tilemap_get_tile_set()->tile_count, p_meta->count,
+               p_meta->key_bits ? "exact" : "hashed", time_process * 1000.0, time_meta * 1000.0,
+               (time_process > 0) ? (time_meta * 100.0) / time_process : 0.0, bad);
+    else
+        printf("Metatile Benchmark: Processing failed\n");
+
+    status = status && (bad == 0);
+
+    tilemap_free_resources();
+    free(img.p_img_data);
+    free(p_ids);
+    free(p_attribs);
+    free(p_rows);
+
+    return status;
+}
+
+
+
+// Pixel of synthetic sprite shape s at x,y (RGBA, alpha 0 outside
+// the ellipse), the colors make every orientation of a shape distinct
+static uint32_t bench_sprite_pixel(uint32_t s, uint32_t width, uint32_t height, uint32_t x, uint32_t y) {
+
+    int32_t dx = (int32_t)(2 * x + 1) - (int32_t)width;
+    int32_t dy = (int32_t)(2 * y + 1) - (int32_t)height;
+
+    if (((int64_t)dx * dx * height * height) + ((int64_t)dy * dy * width * width) > ((int64_t)width * width * height * height))
+        return 0;
+
+    return 0xFF000000u | ((((s + 1) * 2654435761u) ^ (x * 40503u) ^ (y * 9973u * (x + 1))) & 0x00FFFFFFu);
+}
+
+
+
+// Sprite sheet mode on a synthetic RGBA sheet: a grid of cells, each
+// with one of unique_count ellipse shaped sprites, randomly flipped
+//
+// * The sheet gets rebuilt from the placement table and unique
+//   sprites and must match the original
+// * The unique count must match the shapes used (with flip search)
+//   or the shape + flip combinations used (without)
+int32_t tilemap_benchmark_sprites(uint32_t width, uint32_t height, uint32_t unique_count, int check_flip) {
+
+    image_data               img;
+    tile_sprites_data        sprites;
+    tile_sprite_data       * p_sprite;
+    tile_sprite_placement  * p_place;
+    uint32_t               * p_sheet;
+    uint32_t               * p_rebuilt;
+    uint8_t                * p_used;
+    uint32_t                 cell_x, cell_y, x, y, sx, sy, s, w, h, flip, c, used, bad;
+    uint32_t                 pix;
+    uint64_t                 rnd;
+    double                   time_start, time_sprites;
+    int32_t                  status;
+
+    if ((width < BENCHMARK_SPRITES_CELL) || (height < BENCHMARK_SPRITES_CELL) || (unique_count == 0)) {
+        printf("Sprites Benchmark: %d x %d sheet is smaller than one %d pixel cell\n",
+               width, height, BENCHMARK_SPRITES_CELL);
+        return false;
+    }
+
+    memset(&sprites, 0x00, sizeof(sprites));
+    img.width           = width;
+    img.height          = height;
+    img.bytes_per_pixel = 4;
+    img.size            = (uint64_t)width * height * img.bytes_per_pixel;
+    img.p_img_data      = calloc(1, img.size);
+    p_rebuilt           = calloc((size_t)width * height, sizeof(uint32_t));
+    p_used              = calloc((size_t)unique_count * 4, sizeof(uint8_t));
+
+    if (!img.p_img_data || !p_rebuilt || !p_used) {
+        printf("Sprites Benchmark: Failed to allocate %" PRIu64 " bytes\n", img.size);
+        free(img.p_img_data);
+        free(p_rebuilt);
+        free(p_used);
+        return false;
+    }
+
+    p_sheet = (uint32_t *)img.p_img_data;
+
+    // One sprite per cell, 2 pixels of gap keep neighbours apart
+    rnd = 0x9E3779B97F4A7C15ULL;
+    for (cell_y = 0; cell_y + BENCHMARK_SPRITES_CELL <= height; cell_y += BENCHMARK_SPRITES_CELL)
+        for (cell_x = 0; cell_x + BENCHMARK_SPRITES_CELL <= width; cell_x += BENCHMARK_SPRITES_CELL) {
+            rnd ^= rnd << 13;  rnd ^= rnd >> 7;  rnd ^= rnd << 17;
+
+            s    = (uint32_t)(rnd % unique_count);
+            flip = (uint32_t)(rnd >> 32) & TILE_FLIP_MASK;
+            w    = 4 + ((s * 7) % (BENCHMARK_SPRITES_CELL - 6));
+            h    = 4 + ((s * 13) % (BENCHMARK_SPRITES_CELL - 6));
+            sx   = cell_x + 1 + (uint32_t)((rnd >> 40) % (BENCHMARK_SPRITES_CELL - 2 - w + 1));
+            sy   = cell_y + 1 + (uint32_t)((rnd >> 48) % (BENCHMARK_SPRITES_CELL - 2 - h + 1));
+
+            p_used[(s * 4) + ((check_flip) ? 0 : flip)] = 1;
+
+            for (y = 0; y < h; y++)
+                for (x = 0; x < w; x++)
+                    p_sheet[((size_t)(sy + y) * width) + sx + x] =
+                        bench_sprite_pixel(s, w, h, (flip & TILE_FLIP_BITS_X) ? (w - 1 - x) : x,
+                                                    (flip & TILE_FLIP_BITS_Y) ? (h - 1 - y) : y);
+        }
+
+    used = 0;
+    for (c = 0; c < unique_count * 4; c++)
+        used += p_used[c];
+
+    time_start   = get_time();
+    status       = tilemap_sprites_calc(&sprites, &img, TILE_HASH_AUTO, (check_flip) ? TILE_FLIP_BITS_XY : TILE_FLIP_BITS_NONE);
+    time_sprites = get_time() - time_start;
+
+    bad = 0;
+
+    // Rebuild the sheet: every placement draws its unique sprite with its flips
+    for (c = 0; status && (c < sprites.placement_count); c++) {
+        p_place  = &sprites.p_placements[c];
+        p_sprite = &sprites.p_sprites[p_place->sprite_id];
+
+        for (y = 0; y < p_sprite->height; y++)
+            for (x = 0; x < p_sprite->width; x++) {
+                sx = (p_place->attribs & TILE_FLIP_BITS_X) ? (p_sprite->width  - 1 - x) : x;
+                sy = (p_place->attribs & TILE_FLIP_BITS_Y) ? (p_sprite->height - 1 - y) : y;
+                memcpy(&pix, sprites.p_pixels + p_sprite->offset + ((((size_t)sy * p_sprite->width) + sx) * 4), sizeof(pix));
+
+                if (pix >> 24)
+                    p_rebuilt[((size_t)(p_place->y + y) * width) + p_place->x + x] = pix;
+            }
+    }
+
+    for (c = 0; status && (c < width * height); c++)
+        if (p_rebuilt[c] != p_sheet[c])
+            bad++;
+
+    if (status && (sprites.count != used))
+        bad++;
+
+    printf("Sprites Benchmark: %5" PRIu32 " x %-5" PRIu32 " sheet, flip %-3s: %7" PRIu32 " runs, %6" PRIu32
+           " sprites, %5" PRIu32 " unique (%" PRIu32 " expected) in %8.2f msec, %" PRIu32 " errors\n",
+           width, height, check_flip ? "on" : "off", sprites.run_count, sprites.placement_count, sprites.count, used,
+           time_sprites * 1000.0, bad);
+
+    status = status && (bad == 0);
+
+    tilemap_sprites_free(&sprites);
+    free(img.p_img_data);
+    free(p_rebuilt);
+    free(p_used);
+
+    return status;
+}
+
+
+#ifdef TILEMAP_BENCHMARK_MAIN
+
+// Fill an indexed (1 byte per pixel) image with a tiled pattern
+// like benchmark_fill_image(), using only color_count colors
+static void benchmark_fill_indexed(image_data * p_img, int tile_width, int tile_height,
+                                   uint32_t unique_count, uint32_t color_count) {
+
+    uint32_t  x, y;
+    uint32_t  tx, ty;
+    uint32_t  pattern;
+    uint8_t * p_pix;
+
+    p_pix = p_img->p_img_data;
+
+    for (y = 0; y < p_img->height; y++) {
+        for (x = 0; x < p_img->width; x++) {
+
+            pattern = (((x / tile_width) * 2654435761u) ^ ((y / tile_height) * 40503u)) % unique_count;
+            tx      = x % tile_width;
+            ty      = y % tile_height;
+
+            // Mix the pattern into every pixel so few colors still give distinct tiles
+            *p_pix++ = (uint8_t)(((pattern * 2654435761u) >> ((tx + (ty * tile_width)) % 29)) % color_count);
+        }
+    }
+}
+
+
+
+// Most positional arguments any mode takes
+#define BENCHMARK_ARGS_MAX      7
+
+// Argument slots of the modes that run on a synthetic image
+#define BENCHMARK_ARG_WIDTH     0
+#define BENCHMARK_ARG_HEIGHT    1
+#define BENCHMARK_ARG_BPP       2
+#define BENCHMARK_ARG_TILE_SIZE 3
+#define BENCHMARK_ARG_UNIQUE    4
+#define BENCHMARK_ARG_COLORS    5   // "packed" only
+#define BENCHMARK_ARG_MARGIN    5   // "grid" only
+#define BENCHMARK_ARG_SPACING   6   // "grid" only
+
+// Synthetic image main() builds for a mode before running it
+#define BENCHMARK_IMAGE_NONE    0
+#define BENCHMARK_IMAGE_TILED   1   // benchmark_fill_image()
+#define BENCHMARK_IMAGE_INDEXED 2   // benchmark_fill_indexed()
+
+typedef struct {
+    uint32_t value[BENCHMARK_ARGS_MAX];  // The mode's defaults, overridden by the ones given
+    int      count;                      // How many were given after the mode name
+    int      check_flip;                 // Mode was given with the "-flip" suffix
+} benchmark_args;
+
+typedef struct benchmark_mode benchmark_mode;
+
+struct benchmark_mode {
+    const char * name;
+    int          has_flip;               // Also runs as "<name>-flip" with flip search on
+    int          image;                  // BENCHMARK_IMAGE_* built from the image argument slots
+    int          arg_count;              // Arguments it takes after the name
+    const char * usage;
+    const char * about;
+    uint32_t     defaults[BENCHMARK_ARGS_MAX];
+    int32_t      (*parse)(benchmark_args * p_args, const benchmark_mode * p_mode, int argc, char * argv[]);
+    int32_t      (*run)(const benchmark_args * p_args, image_data * p_img);
+};
+
+
+
+// Reads a whole decimal number that fits in 32 bits
+static int32_t benchmark_parse_number(const char * p_str, uint32_t * p_value) {
+
+    char *             p_end;
+    unsigned long long value;
+
+    if ((*p_str < '0') || (*p_str > '9'))
+        return false;
+
+    errno = 0;
+    value = strtoull(p_str, &p_end, 10);
+
+    if ((errno != 0) || (*p_end != '\0') || (value > UINT32_MAX))
+        return false;
+
+    *p_value = (uint32_t)value;
+    return true;
+}
+
+
+// Fills in the mode's defaults, then the numbers given after the mode name
+// (zero allowed, the mode's parser decides which slots may be zero)
+static int32_t benchmark_read_args(benchmark_args * p_args, const benchmark_mode * p_mode, int argc, char * argv[]) {
+
+    int i;
+
+    memcpy(p_args->value, p_mode->defaults, sizeof(p_args->value));
+    p_args->count = argc;
+
+    if (argc > p_mode->arg_count) {
+        printf("Benchmark: \"%s\" takes at most %d arguments\n", p_mode->name, p_mode->arg_count);
+        return false;
+    }
+
+    for (i = 0; i < argc; i++) {
+        if (!benchmark_parse_number(argv[i], &p_args->value[i])) {
+            printf("Benchmark: \"%s\" is not a number\n", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Every argument given has to be non-zero
+static int32_t benchmark_parse_args(benchmark_args * p_args, const benchmark_mode * p_mode, int argc, char * argv[]) {
+
+    int i;
+
+    if (!benchmark_read_args(p_args, p_mode, argc, argv))
+        return false;
+
+    for (i = 0; i < p_args->count; i++)
+        if (p_args->value[i] == 0)
+            return false;
+
+    return true;
+}
+
+
+static int32_t benchmark_parse_image(benchmark_args * p_args, const benchmark_mode * p_mode, int argc, char * argv[]) {
+
+    if (!benchmark_read_args(p_args, p_mode, argc, argv))
+        return false;
+
+    return (p_args->value[BENCHMARK_ARG_WIDTH] >= 1) && (p_args->value[BENCHMARK_ARG_HEIGHT] >= 1)
+           && (p_args->value[BENCHMARK_ARG_BPP] >= 1) && (p_args->value[BENCHMARK_ARG_BPP] <= 4)
+           && (p_args->value[BENCHMARK_ARG_TILE_SIZE] >= 1) && (p_args->value[BENCHMARK_ARG_UNIQUE] >= 1);
+}
+
+
+static int32_t benchmark_parse_packed(benchmark_args * p_args, const benchmark_mode * p_mode, int argc, char * argv[]) {
+
+    if (!benchmark_parse_image(p_args, p_mode, argc, argv))
+        return false;
+
+    return (p_args->value[BENCHMARK_ARG_BPP] == 1) && (p_args->value[BENCHMARK_ARG_COLORS] >= 1)
+           && (p_args->value[BENCHMARK_ARG_COLORS] <= TILE_PACKED_COLORS_4BPP);
+}
+
+
+static int32_t benchmark_parse_grid(benchmark_args * p_args, const benchmark_mode * p_mode, int argc, char * argv[]) {
+
+    if (!benchmark_parse_image(p_args, p_mode, argc, argv))
+        return false;
+
+    return (p_args->value[BENCHMARK_ARG_MARGIN] <= GRID_SIZE_MAX) && (p_args->value[BENCHMARK_ARG_SPACING] <= GRID_SIZE_MAX);
+}
+
+
+
+static int32_t benchmark_run_large_map(const benchmark_args * p_args, image_data * p_img) {
+
+    (void)p_img;
+
+    return tilemap_benchmark_large_map(p_args->value[BENCHMARK_ARG_WIDTH], p_args->value[BENCHMARK_ARG_HEIGHT],
+                                       p_args->value[BENCHMARK_ARG_BPP], p_args->value[BENCHMARK_ARG_TILE_SIZE],
+                                       p_args->value[BENCHMARK_ARG_UNIQUE]);
+}
+
+
+static int32_t benchmark_run_hash(const benchmark_args * p_args, image_data * p_img) {
+
+    return tilemap_compare_hashes(p_img, p_args->value[BENCHMARK_ARG_TILE_SIZE], p_args->value[BENCHMARK_ARG_TILE_SIZE]);
+}
+
+
+static int32_t benchmark_run_engine(const benchmark_args * p_args, image_data * p_img) {
+
+    return tilemap_compare_engines(p_img, p_args->value[BENCHMARK_ARG_TILE_SIZE], p_args->value[BENCHMARK_ARG_TILE_SIZE],
+                                   p_args->check_flip);
+}
+
+
+static int32_t benchmark_run_layout(const benchmark_args * p_args, image_data * p_img) {
+
+    return tilemap_benchmark_layout(p_img, p_args->value[BENCHMARK_ARG_TILE_SIZE], p_args->value[BENCHMARK_ARG_TILE_SIZE],
+                                    p_args->check_flip);
+}
+
+
+static int32_t benchmark_run_grid(const benchmark_args * p_args, image_data * p_img) {
+
+    return tilemap_benchmark_grid(p_img, p_args->value[BENCHMARK_ARG_TILE_SIZE], p_args->value[BENCHMARK_ARG_TILE_SIZE],
+                                  p_args->check_flip,
+                                  p_args->value[BENCHMARK_ARG_MARGIN], p_args->value[BENCHMARK_ARG_SPACING]);
+}
+
+
+static int32_t benchmark_run_base(const benchmark_args * p_args, image_data * p_img) {
+
+    return tilemap_benchmark_base(p_img, p_args->value[BENCHMARK_ARG_TILE_SIZE], p_args->value[BENCHMARK_ARG_TILE_SIZE],
+                                  p_args->check_flip);
+}
+
+
+static int32_t benchmark_run_packed(const benchmark_args * p_args, image_data * p_img) {
+
+    return tilemap_benchmark_packed(p_img, p_args->value[BENCHMARK_ARG_TILE_SIZE], p_args->value[BENCHMARK_ARG_TILE_SIZE],
+                                    p_args->check_flip, p_args->value[BENCHMARK_ARG_COLORS]);
+}
+
+
+static int32_t benchmark_run_index(const benchmark_args * p_args, image_data * p_img) {
+
+    (void)p_img;
+
+    return tilemap_benchmark_index(p_args->value[0], p_args->value[1], p_args->value[2], p_args->value[3]);
+}
+
+
+static int32_t benchmark_run_lookup(const benchmark_args * p_args, image_data * p_img) {
+
+    uint32_t unique_count;
+    int32_t  status;
+
+    (void)p_img;
+
+    if (p_args->count > 0)
+        return tilemap_benchmark_lookup(p_args->value[0], p_args->value[1]);
+
+    status = true;
+    for (unique_count = 1024; unique_count <= (4 * 1024 * 1024); unique_count *= 4)
+        status &= tilemap_benchmark_lookup(unique_count, p_args->value[1]);
+    return status;
+}
+
+
+static int32_t benchmark_run_subpal(const benchmark_args * p_args, image_data * p_img) {
+
+    uint32_t tile_count;
+    int32_t  status;
+
+    (void)p_img;
+
+    if (p_args->count > 0)
+        return tilemap_benchmark_subpal(p_args->value[0], p_args->value[1], p_args->value[2]);
+
+    status = true;
+    for (tile_count = 256; tile_count <= TILES_MAX_DEFAULT; tile_count *= 2)
+        status &= tilemap_benchmark_subpal(tile_count, BENCHMARK_SUBPAL_COUNT, SUBPAL_COLORS_DEFAULT);
+    status &= tilemap_benchmark_subpal(TILES_MAX_DEFAULT, BENCHMARK_SUBPAL_COUNT, 16);
+    return status;
+}
+
+
+static int32_t benchmark_run_window(const benchmark_args * p_args, image_data * p_img) {
+
+    uint32_t width;
+    int32_t  status;
+
+    (void)p_img;
+
+    if (p_args->count > 1)
+        return tilemap_benchmark_window(p_args->value[0], p_args->value[1], p_args->value[4],
+                                        p_args->value[2], p_args->value[3]);
+
+    status = true;
+    for (width = 64; width <= 1024; width *= 2)
+        status &= tilemap_benchmark_window(width, width, BENCHMARK_WINDOW_UNIQUE,
+                                           WINDOW_VIEW_WIDTH_DEFAULT, WINDOW_VIEW_HEIGHT_DEFAULT);
+    status &= tilemap_benchmark_window(512, 512, BENCHMARK_WINDOW_UNIQUE, 64, 64);
+    return status;
+}
+
+
+static int32_t benchmark_run_rooms(const benchmark_args * p_args, image_data * p_img) {
+
+    uint32_t width;
+    int32_t  status;
+
+    (void)p_img;
+
+    if (p_args->count > 1)
+        return tilemap_benchmark_rooms(p_args->value[0], p_args->value[1], p_args->value[4],
+                                       p_args->value[2], p_args->value[3]);
+
+    status = true;
+    for (width = 256; width <= 4096; width *= 4)
+        status &= tilemap_benchmark_rooms(width, width, BENCHMARK_ROOMS_UNIQUE,
+                                          ROOMS_WIDTH_DEFAULT, ROOMS_HEIGHT_DEFAULT);
+    status &= tilemap_benchmark_rooms(4096, 4096, BENCHMARK_ROOMS_UNIQUE, ROOMS_SIZE_MAX, ROOMS_SIZE_MAX);
+    return status;
+}
+
+
+static int32_t benchmark_run_metatile(const benchmark_args * p_args, image_data * p_img) {
+
+    uint32_t width;
+    int32_t  status;
+
+    (void)p_img;
+
+    if (p_args->count > 1)
+        return tilemap_benchmark_metatile(p_args->value[0], p_args->value[1], p_args->value[2],
+                                          p_args->value[3], p_args->value[4], p_args->value[5]);
+
+    // Larger blocks get fewer distinct ones to stay within the tile limit
+    status = true;
+    for (width = 2; width <= METATILE_SIZE_MAX; width *= 2)
+        status &= tilemap_benchmark_metatile(BENCHMARK_METATILE_WIDTH, BENCHMARK_METATILE_HEIGHT, p_args->value[2],
+                                             width, width,
+                                             (BENCHMARK_METATILE_UNIQUE * width * width <= TILES_MAX_DEFAULT)
+                                             ? BENCHMARK_METATILE_UNIQUE : (TILES_MAX_DEFAULT / (width * width)));
+    return status;
+}
+
+
+static int32_t benchmark_run_sprites(const benchmark_args * p_args, image_data * p_img) {
+
+    uint32_t width;
+    int32_t  status;
+
+    (void)p_img;
+
+    if (p_args->count > 1)
+        return tilemap_benchmark_sprites(p_args->value[0], p_args->value[1], p_args->value[2], p_args->check_flip);
+
+    status = true;
+    for (width = 256; width <= 4096; width *= 4)
+        status &= tilemap_benchmark_sprites(width, width, BENCHMARK_SPRITES_UNIQUE, p_args->check_flip);
+    return status;
+}
+
+
+
+// One entry per mode, the first one runs when no mode is given.
+// The modes that take an image size build their synthetic image
+// from the BENCHMARK_ARG_* slots before running.
+static const benchmark_mode benchmark_modes[] = {
+    { "large", false, BENCHMARK_IMAGE_NONE, 5,
+      "[width] [height] [bytes per pixel 1-4] [tile size] [unique tiles]",
+      "dedupes one large synthetic image (the default mode)",
+      { BENCHMARK_LARGE_MAP_WIDTH, BENCHMARK_LARGE_MAP_HEIGHT, 4, 8, BENCHMARK_LARGE_MAP_UNIQUE },
+      benchmark_parse_image, benchmark_run_large_map },
+
+    { "hash", false, BENCHMARK_IMAGE_TILED, 5,
+      "[width] [height] [bytes per pixel 1-4] [tile size] [unique tiles]",
+      "compares the hash backends on the synthetic image",
+      { BENCHMARK_HASH_WIDTH, BENCHMARK_HASH_HEIGHT, 4, 8, BENCHMARK_LARGE_MAP_UNIQUE },
+      benchmark_parse_image, benchmark_run_hash },
+
+    { "engine", true, BENCHMARK_IMAGE_TILED, 5,
+      "[width] [height] [bytes per pixel 1-4] [tile size] [unique tiles]",
+      "compares the dedupe engines",
+      { BENCHMARK_ENGINE_WIDTH, BENCHMARK_ENGINE_HEIGHT, 4, 8, BENCHMARK_LARGE_MAP_UNIQUE },
+      benchmark_parse_image, benchmark_run_engine },
+
+    { "layout", true, BENCHMARK_IMAGE_TILED, 5,
+      "[width] [height] [bytes per pixel 1-4] [tile size] [unique tiles]",
+      "compares row-major and tile-major source layouts",
+      { BENCHMARK_ENGINE_WIDTH, BENCHMARK_ENGINE_HEIGHT, 4, 8, BENCHMARK_LARGE_MAP_UNIQUE },
+      benchmark_parse_image, benchmark_run_layout },
+
+    { "grid", true, BENCHMARK_IMAGE_TILED, 7,
+      "[width] [height] [bytes per pixel 1-4] [tile size] [unique tiles] [margin] [spacing]",
+      "compares a packed image with the same tiles spaced out by a margin and spacing",
+      { BENCHMARK_ENGINE_WIDTH, BENCHMARK_ENGINE_HEIGHT, 4, 8, BENCHMARK_LARGE_MAP_UNIQUE,
+        BENCHMARK_GRID_MARGIN, BENCHMARK_GRID_SPACING },
+      benchmark_parse_grid, benchmark_run_grid },
+
+    { "base", true, BENCHMARK_IMAGE_TILED, 5,
+      "[width] [height] [bytes per pixel 1-4] [tile size] [unique tiles]",
+      "maps the image against a locked base tile set of half its tiles,\n"
+      "and times building the base index vs reusing it",
+      { BENCHMARK_ENGINE_WIDTH, BENCHMARK_ENGINE_HEIGHT, 4, 8, BENCHMARK_BASE_UNIQUE },
+      benchmark_parse_image, benchmark_run_base },
+
+    { "packed", true, BENCHMARK_IMAGE_INDEXED, 6,
+      "[width] [height] [1] [tile size] [unique tiles] [colors 1-16]",
+      "compares one byte and bit-packed pixels on a low color indexed image",
+      { BENCHMARK_ENGINE_WIDTH, BENCHMARK_ENGINE_HEIGHT, 1, 8, BENCHMARK_LARGE_MAP_UNIQUE,
+        BENCHMARK_PACKED_COLORS },
+      benchmark_parse_packed, benchmark_run_packed },
+
+    { "index", false, BENCHMARK_IMAGE_NONE, 4,
+      "[threads] [items] [unique keys] [rounds]",
+      "stress tests the lock-free tile index from several threads",
+      { BENCHMARK_INDEX_THREADS, BENCHMARK_INDEX_ITEMS, BENCHMARK_INDEX_UNIQUE, BENCHMARK_INDEX_ROUNDS },
+      benchmark_parse_args, benchmark_run_index },
+
+    { "lookup", false, BENCHMARK_IMAGE_NONE, 2,
+      "[unique keys] [lookups]",
+      "compares batched and unbatched index lookups, and up to the tile\n"
+      "set limit times the incremental engine that batches them per map\n"
+      "row against the linear search it replaced, without a key count it\n"
+      "runs from cache resident up to well past L2 size",
+      { 0, BENCHMARK_LOOKUP_COUNT },
+      benchmark_parse_args, benchmark_run_lookup },
+
+    { "subpal", false, BENCHMARK_IMAGE_NONE, 3,
+      "[tiles] [sub-palettes] [colors per sub-palette]",
+      "times the sub-palette solver on synthetic tile color sets,\n"
+      "without a tile count it runs a range of tile set sizes",
+      { 0, BENCHMARK_SUBPAL_COUNT, SUBPAL_COLORS_DEFAULT },
+      benchmark_parse_args, benchmark_run_subpal },
+
+    { "window", false, BENCHMARK_IMAGE_NONE, 5,
+      "[map width] [map height] [view width] [view height] [unique tiles]",
+      "compares sliding and recounted viewport residency,\n"
+      "without a map size it runs a range of map sizes",
+      { 0, 0, WINDOW_VIEW_WIDTH_DEFAULT, WINDOW_VIEW_HEIGHT_DEFAULT, BENCHMARK_WINDOW_UNIQUE },
+      benchmark_parse_args, benchmark_run_window },
+
+    { "rooms", false, BENCHMARK_IMAGE_NONE, 5,
+      "[map width] [map height] [room width] [room height] [unique tiles]",
+      "times the room split and checks it against a recount,\n"
+      "without a map size it runs a range of map sizes",
+      { 0, 0, ROOMS_WIDTH_DEFAULT, ROOMS_HEIGHT_DEFAULT, BENCHMARK_ROOMS_UNIQUE },
+      benchmark_parse_args, benchmark_run_rooms },
+
+    { "metatile", false, BENCHMARK_IMAGE_NONE, 6,
+      "[width] [height] [tile size] [block width] [block height] [unique blocks]",
+      "compares the metatile pass with the first dedupe pass,\n"
+      "without an image size it runs a range of block sizes",
+      { 0, 0, 8, METATILE_WIDTH_DEFAULT, METATILE_HEIGHT_DEFAULT, BENCHMARK_METATILE_UNIQUE },
+      benchmark_parse_args, benchmark_run_metatile },
+
+    { "sprites", true, BENCHMARK_IMAGE_NONE, 3,
+      "[width] [height] [unique sprites]",
+      "runs sprite sheet mode and checks the sheet rebuilt from its result,\n"
+      "without a sheet size it runs a range of sheet sizes",
+      { 0, 0, BENCHMARK_SPRITES_UNIQUE },
+      benchmark_parse_args, benchmark_run_sprites },
+};
+
+#define BENCHMARK_MODE_COUNT  (sizeof(benchmark_modes) / sizeof(benchmark_modes[0]))
+
+
+
+// Finds the mode named p_name, with or without the "-flip" suffix
+static const benchmark_mode * benchmark_find_mode(const char * p_name, int * p_check_flip) {
+
+    uint32_t i;
+    size_t   len;
+
+    for (i = 0; i < BENCHMARK_MODE_COUNT; i++) {
+
+        len = strlen(benchmark_modes[i].name);
+        if (strncmp(p_name, benchmark_modes[i].name, len) != 0)
+            continue;
+
+        *p_check_flip = (strcmp(p_name + len, "-flip") == 0);
+        if ((p_name[len] == '\0') || (*p_check_flip && benchmark_modes[i].has_flip))
+            return &benchmark_modes[i];
+    }
+
+    return NULL;
+}
+
+
+static void benchmark_print_usage(const char * p_prog) {
+
+    uint32_t     i;
+    const char * p_line;
+    const char * p_end;
+
+    printf("Usage: %s [mode] [arguments]\n\n", p_prog);
+
+    for (i = 0; i < BENCHMARK_MODE_COUNT; i++) {
+        printf("  %s %s%s %s\n", p_prog, benchmark_modes[i].name,
+               benchmark_modes[i].has_flip ? "[-flip]" : "", benchmark_modes[i].usage);
+
+        // One indented line per line of the description
+        for (p_line = benchmark_modes[i].about; *p_line; p_line = *p_end ? p_end + 1 : p_end) {
+            p_end = strchr(p_line, '\n');
+            if (!p_end)
+                p_end = p_line + strlen(p_line);
+            printf("      %.*s\n", (int)(p_end - p_line), p_line);
+        }
+    }
+
+    printf("\n  \"-flip\" runs the mode with flip search on, arguments left out keep their defaults\n");
+}
+
+
+
+// Usage: tilemap-benchmark [mode] [arguments], see benchmark_modes[] above.
+//
+// Without a mode the arguments go to the first entry ("large"),
+// anything else that isn't a number is rejected with the usage.
+int main(int argc, char * argv[]) {
+
+    const char           * p_prog = argv[0];
+    const benchmark_mode * p_mode;
+    benchmark_args         args;
+    image_data             img;
+    image_data           * p_img;
+    int32_t                status;
+
+    args.check_flip = false;
+    p_mode          = (argc > 1) ? benchmark_find_mode(argv[1], &args.check_flip) : NULL;
+
+    if (p_mode) {
+        argc--;
+        argv++;
+    }
+    else if ((argc > 1) && ((strcmp(argv[1], "-h") == 0) || (strcmp(argv[1], "--help") == 0))) {
+        benchmark_print_usage(p_prog);
+        return 0;
+    }
+    else if ((argc > 1) && ((argv[1][0] < '0') || (argv[1][0] > '9'))) {
+        printf("Benchmark: Unknown mode \"%s\"\n\n", argv[1]);
+        benchmark_print_usage(p_prog);
+        return 1;
+    }
+    else {
+        p_mode          = &benchmark_modes[0];
+        args.check_flip = false;
+    }
+
+    if (!p_mode->parse(&args, p_mode, argc - 1, argv + 1)) {
+        benchmark_print_usage(p_prog);
+        return 1;
+    }
+
+    p_img = NULL;
+
+    if (p_mode->image != BENCHMARK_IMAGE_NONE) {
+
+        img.width           = args.value[BENCHMARK_ARG_WIDTH];
+        img.height          = args.value[BENCHMARK_ARG_HEIGHT];
+        img.bytes_per_pixel = args.value[BENCHMARK_ARG_BPP];
+        img.size            = (uint64_t)img.width * img.height * img.bytes_per_pixel;
+        img.p_img_data      = malloc(img.size);
+
+        if (!img.p_img_data) {
+            printf("Benchmark: Failed to allocate %" PRIu64 " bytes\n", img.size);
+            return 1;
+        }
+
+        if (p_mode->image == BENCHMARK_IMAGE_INDEXED)
+            benchmark_fill_indexed(&img, args.value[BENCHMARK_ARG_TILE_SIZE], args.value[BENCHMARK_ARG_TILE_SIZE],
+                                   args.value[BENCHMARK_ARG_UNIQUE], args.value[BENCHMARK_ARG_COLORS]);
+        else
+            benchmark_fill_image(&img, args.value[BENCHMARK_ARG_TILE_SIZE], args.value[BENCHMARK_ARG_TILE_SIZE],
+                                 args.value[BENCHMARK_ARG_UNIQUE]);
+        p_img = &img;
+    }
+
+    status = p_mode->run(&args, p_img);
+
+    if (p_img)
+        free(p_img->p_img_data);
+
+    return status ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,73 @@
+//
+// tilemap_benchmark.h
+//
+
+#ifndef __TILEMAP_BENCHMARK_H_
+#define __TILEMAP_BENCHMARK_H_
+
+    #include <stdint.h>
+
+    #include "image_info.h"
+
+    #define BENCHMARK_LARGE_MAP_WIDTH   32768
+    #define BENCHMARK_LARGE_MAP_HEIGHT  32768
+    #define BENCHMARK_LARGE_MAP_UNIQUE  64     // Unique tiles in the synthetic image
+
+    #define BENCHMARK_HASH_WIDTH        4096   // Synthetic image for the stand-alone hash comparison
+    #define BENCHMARK_HASH_HEIGHT       4096
+
+    #define BENCHMARK_ENGINE_WIDTH      8192   // Synthetic image for the stand-alone engine and layout comparisons
+    #define BENCHMARK_ENGINE_HEIGHT     8192
+
+    #define BENCHMARK_GRID_MARGIN       1      // Grid layout of the spaced copy for the grid comparison
+    #define BENCHMARK_GRID_SPACING      1
+
+    #define BENCHMARK_BASE_UNIQUE       1024   // Unique tiles in the synthetic image for the locked base comparison (half get locked)
+
+    #define BENCHMARK_PACKED_COLORS     4      // Colors in the synthetic indexed image for the packed tile comparison
+
+    #define BENCHMARK_INDEX_THREADS     16     // Lock-free index stress test defaults
+    #define BENCHMARK_INDEX_THREADS_MAX 256
+    #define BENCHMARK_INDEX_ITEMS       (4 * 1024 * 1024)
+    #define BENCHMARK_INDEX_UNIQUE      5000
+    #define BENCHMARK_INDEX_ROUNDS      10
+
+    #define BENCHMARK_LOOKUP_COUNT      (4 * 1024 * 1024)  // Batched vs unbatched index lookup defaults
+    #define BENCHMARK_LOOKUP_BATCH      1024               // Keys per batch (one map row of 8x8 tiles at 8192 pixels)
+    #define BENCHMARK_LOOKUP_ROUNDS     3                  // Best time of this many is reported
+    #define BENCHMARK_LOOKUP_TILE_BYTES 64                 // Synthetic tile hashed per lookup (8x8 indexed)
+    #define BENCHMARK_LOOKUP_ENGINE_WIDTH  8192         // Image the incremental engine looks up (one batch per map row)
+    #define BENCHMARK_LOOKUP_ENGINE_HEIGHT 4096
+    #define BENCHMARK_LOOKUP_LINEAR_CELLS  65536        // Cells replayed through the linear tile set search
+
+    #define BENCHMARK_SUBPAL_COUNT      8      // Hidden sub-palettes in the synthetic tile set for the solver benchmark
+
+    #define BENCHMARK_WINDOW_UNIQUE     4096   // Tile IDs in the synthetic map for the viewport residency benchmark
+    #define BENCHMARK_ROOMS_UNIQUE      4096   // Tile IDs in the synthetic map for the room split benchmark
+
+    #define BENCHMARK_METATILE_WIDTH    4096   // Synthetic image for the metatile vs first pass comparison
+    #define BENCHMARK_METATILE_HEIGHT   4096
+    #define BENCHMARK_METATILE_UNIQUE   256    // Distinct blocks in it
+
+    #define BENCHMARK_SPRITES_CELL      40     // Synthetic sprite sheet: one sprite per cell of this size
+    #define BENCHMARK_SPRITES_UNIQUE    200    // Distinct sprite shapes on it
+
+    int32_t tilemap_benchmark_large_map(uint32_t width, uint32_t height, uint8_t bytes_per_pixel,
+                                        int tile_size, uint32_t unique_count);
+    int32_t tilemap_benchmark_layout(image_data * p_img, int tile_width, int tile_height, int check_flip);
+    int32_t tilemap_benchmark_grid(image_data * p_img, int tile_width, int tile_height, int check_flip,
+                                   uint16_t margin, uint16_t spacing);
+    int32_t tilemap_benchmark_base(image_data * p_img, int tile_width, int tile_height, int check_flip);
+    int32_t tilemap_benchmark_packed(image_data * p_img, int tile_width, int tile_height, int check_flip, uint16_t color_count);
+    int32_t tilemap_benchmark_index(uint32_t thread_count, uint32_t item_count, uint32_t unique_count, uint32_t rounds);
+    int32_t tilemap_benchmark_lookup(uint32_t unique_count, uint32_t lookup_count);
+    int32_t tilemap_benchmark_subpal(uint32_t tile_count, uint16_t count_max, uint16_t colors_max);
+    int32_t tilemap_benchmark_window(uint32_t width_in_tiles, uint32_t height_in_tiles, uint32_t unique_count,
+                                     uint16_t view_width, uint16_t view_height);
+    int32_t tilemap_benchmark_rooms(uint32_t width_in_tiles, uint32_t height_in_tiles, uint32_t unique_count,
+                                    uint16_t room_width, uint16_t room_height);
+    int32_t tilemap_benchmark_metatile(uint32_t width, uint32_t height, int tile_size,
+                                       uint16_t block_width, uint16_t block_height, uint32_t unique_count);
+    int32_t tilemap_benchmark_sprites(uint32_t width, uint32_t height, uint32_t unique_count, int check_flip);
+
+#endif
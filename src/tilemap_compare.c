@@ -0,0 +1,299 @@
+//
+// tilemap_compare.c
+//
+
+// ========================
+//
+// Side-by-side comparisons on an image: tile hash
+// backends (throughput and collisions) and dedupe
+// engines (processing time and resulting map).
+//
+// Used by the dialog's "Bench" buttons and by the
+// stand-alone benchmark, results go to the console.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "lib_tilemap.h"
+#include "tilemap_compare.h"
+#include "tilemap_hash.h"
+#include "tilemap_batch.h"
+
+#include "benchmark.h"
+
+
+
+// Hash + source tile index, sorted to find equal hashes
+typedef struct {
+    uint64_t hash;
+    uint32_t index;
+} compare_hash_entry;
+
+
+static int compare_hash_entry_compare(const void * p_a, const void * p_b) {
+
+    const compare_hash_entry * p_ea = p_a;
+    const compare_hash_entry * p_eb = p_b;
+
+    if (p_ea->hash != p_eb->hash)
+        return (p_ea->hash < p_eb->hash) ? -1 : 1;
+    else
+        return (p_ea->index < p_eb->index) ? -1 : (p_ea->index > p_eb->index);
+}
+
+
+
+// Count hash collisions: tiles with different pixels but the same hash
+//
+// * Tiles in each run of equal hashes get compared against the
+//   distinct tiles found so far in that run (usually just one)
+// * p_unique_hashes / p_unique_tiles: distinct hash values and distinct tiles
+static uint32_t compare_hash_count_collisions(compare_hash_entry * p_entries, uint32_t count,
+                                            const uint8_t * p_tiles, uint32_t tile_size,
+                                            uint32_t * p_reps,
+                                            uint32_t * p_unique_hashes, uint32_t * p_unique_tiles) {
+    uint32_t c, r;
+    uint32_t run_start, rep_count;
+    uint32_t collisions;
+
+    qsort(p_entries, count, sizeof(compare_hash_entry), compare_hash_entry_compare);
+
+    collisions       = 0;
+    *p_unique_hashes = 0;
+    *p_unique_tiles  = 0;
+
+    for (run_start = 0; run_start < count; run_start = c) {
+
+        rep_count = 0;
+
+        for (c = run_start; (c < count) && (p_entries[c].hash == p_entries[run_start].hash); c++) {
+
+            for (r = 0; r < rep_count; r++)
+                if (memcmp(p_tiles + ((size_t)p_reps[r] * tile_size),
+                           p_tiles + ((size_t)p_entries[c].index * tile_size), tile_size) == 0)
+                    break;
+
+            if (r == rep_count)
+                p_reps[rep_count++] = p_entries[c].index;
+        }
+
+        (*p_unique_hashes)++;
+        *p_unique_tiles += rep_count;
+        collisions      += rep_count - 1;
+    }
+
+    return collisions;
+}
+
+
+
+// Compare the tile hash backends on an image: throughput
+// (hashing tiles the way processing does) and collision count
+//
+// * Tiles are copied out into a contiguous buffer first, which
+//   needs as much memory as the image itself
+// * Hashing repeats until at least COMPARE_HASH_MIN_SECONDS
+//   have passed so small images still give stable numbers
+int32_t tilemap_compare_hashes(image_data * p_img, int tile_width, int tile_height) {
+
+    uint32_t           tile_count, tile_size, row_bytes;
+    uint32_t           width_in_tiles, height_in_tiles;
+    uint32_t           tx, ty, y, c;
+    uint32_t           passes;
+    uint32_t           collisions, unique_hashes, unique_tiles;
+    uint32_t           mismatches;
+    uint8_t            backend;
+    uint8_t          * p_tiles;
+    uint8_t          * p_dst;
+    uint32_t         * p_reps;
+    compare_hash_entry * p_entries;
+    uint64_t         * p_row_hashes;
+    tile_hash_func     hash_func;
+    tile_hash_row_func row_func;
+    double             time_start, time_elapsed;
+
+    if ( ! tilemap_check_dimensions_valid(p_img, tile_width, tile_height) ) {
+        printf("Hash Benchmark: image size must be a multiple of the tile size\n");
+        return false;
+    }
+
+    width_in_tiles  = p_img->width  / tile_width;
+    height_in_tiles = p_img->height / tile_height;
+    tile_count      = width_in_tiles * height_in_tiles;
+    row_bytes       = tile_width * p_img->bytes_per_pixel;
+    tile_size       = row_bytes * tile_height;
+
+    p_tiles   = malloc((size_t)tile_count * tile_size);
+    p_entries = malloc((size_t)tile_count * sizeof(compare_hash_entry));
+    p_reps    = malloc((size_t)tile_count * sizeof(uint32_t));
+    p_row_hashes = malloc((size_t)tile_count * sizeof(uint64_t));
+
+    if (!(p_tiles && p_entries && p_reps && p_row_hashes)) {
+        printf("Hash Benchmark: Failed to allocate buffers for %" PRIu32 " tiles\n", tile_count);
+        free(p_tiles);
+        free(p_entries);
+        free(p_reps);
+        free(p_row_hashes);
+        return false;
+    }
+
+    // Gather tiles in map order
+    p_dst = p_tiles;
+    for (ty = 0; ty < height_in_tiles; ty++)
+        for (tx = 0; tx < width_in_tiles; tx++)
+            for (y = 0; y < (uint32_t)tile_height; y++) {
+                memcpy(p_dst,
+                       p_img->p_img_data + ((((size_t)ty * tile_height + y) * p_img->width) + ((size_t)tx * tile_width)) * p_img->bytes_per_pixel,
+                       row_bytes);
+                p_dst += row_bytes;
+            }
+
+    printf("Hash Benchmark: %" PRIu32 " x %" PRIu32 " image, %d x %d tiles (%" PRIu32 " tiles, %" PRIu32 " bytes each), auto = %s\n",
+           p_img->width, p_img->height, tile_width, tile_height, tile_count, tile_size,
+           tile_hash_get_name(tile_hash_resolve(TILE_HASH_AUTO)));
+
+    for (backend = TILE_HASH_AUTO + 1; backend < TILE_HASH_LAST; backend++) {
+
+        if (!tile_hash_available(backend)) {
+            printf("Hash Benchmark: %-12s not supported on this CPU\n", tile_hash_get_name(backend));
+            continue;
+        }
+
+        hash_func = tile_hash_get_func(backend);
+        passes    = 0;
+
+        time_start = get_time();
+        do {
+            for (c = 0; c < tile_count; c++) {
+                p_entries[c].hash  = hash_func(p_tiles + ((size_t)c * tile_size), tile_size);
+                p_entries[c].index = c;
+            }
+            passes++;
+            time_elapsed = get_time() - time_start;
+        } while (time_elapsed < COMPARE_HASH_MIN_SECONDS);
+
+        collisions = compare_hash_count_collisions(p_entries, tile_count, p_tiles, tile_size,
+                                                 p_reps, &unique_hashes, &unique_tiles);
+
+        printf("Hash Benchmark: %-12s %9.1f MB/sec  %7.1f M tiles/sec  %" PRIu32 " unique hashes, %" PRIu32 " unique tiles, %" PRIu32 " collisions\n",
+               tile_hash_get_name(backend),
+               (((double)tile_count * tile_size * passes) / (1024.0 * 1024.0)) / time_elapsed,
+               (((double)tile_count * passes) / 1e6) / time_elapsed,
+               unique_hashes, unique_tiles, collisions);
+    }
+
+    // Row kernels hash straight from the image, check them against
+    // hashing the copied out tiles one at a time
+    for (backend = TILE_HASH_AUTO + 1; backend < TILE_HASH_LAST; backend++) {
+
+        row_func = tile_hash_get_row_func(backend, row_bytes);
+        if (!tile_hash_available(backend) || !row_func)
+            continue;
+
+        hash_func = tile_hash_get_func(backend);
+        passes    = 0;
+
+        time_start = get_time();
+        do {
+            for (ty = 0; ty < height_in_tiles; ty++)
+                row_func(p_img->p_img_data + ((size_t)ty * tile_height * p_img->width * p_img->bytes_per_pixel),
+                         p_img->width * p_img->bytes_per_pixel, row_bytes, row_bytes, tile_height,
+                         width_in_tiles, p_row_hashes + ((size_t)ty * width_in_tiles));
+            passes++;
+            time_elapsed = get_time() - time_start;
+        } while (time_elapsed < COMPARE_HASH_MIN_SECONDS);
+
+        mismatches = 0;
+        for (c = 0; c < tile_count; c++)
+            if (p_row_hashes[c] != hash_func(p_tiles + ((size_t)c * tile_size), tile_size))
+                mismatches++;
+
+        printf("Hash Benchmark: %-12s %9.1f MB/sec  %7.1f M tiles/sec  (row kernel, in place), %" PRIu32 " mismatches\n",
+               tile_hash_get_name(backend),
+               (((double)tile_count * tile_size * passes) / (1024.0 * 1024.0)) / time_elapsed,
+               (((double)tile_count * passes) / 1e6) / time_elapsed,
+               mismatches);
+    }
+
+    free(p_tiles);
+    free(p_entries);
+    free(p_reps);
+    free(p_row_hashes);
+
+    return true;
+}
+
+
+
+// Compare the dedupe engines on an image: full processing time
+// for each, and whether they produce the same map
+//
+// * Runs on the default context, leaves it on the incremental
+//   engine and without a tile set afterward
+int32_t tilemap_compare_engines(image_data * p_img, int tile_width, int tile_height, int check_flip) {
+
+    uint32_t   c;
+    uint32_t   entry_count;
+    uint32_t   mismatches;
+    uint32_t * p_entries_ref;
+    uint8_t    engine;
+    int32_t    status;
+    double     time_start, time_process;
+
+    if ( ! tilemap_check_dimensions_valid(p_img, tile_width, tile_height) ) {
+        printf("Engine Benchmark: image size must be a multiple of the tile size\n");
+        return false;
+    }
+
+    entry_count   = (p_img->width / tile_width) * (p_img->height / tile_height);
+    p_entries_ref = malloc((size_t)entry_count * sizeof(uint32_t));
+
+    if (!p_entries_ref) {
+        printf("Engine Benchmark: Failed to allocate buffers for %" PRIu32 " entries\n", entry_count);
+        return false;
+    }
+
+    printf("Engine Benchmark: %" PRIu32 " x %" PRIu32 " image, %d x %d tiles (%" PRIu32 " entries), flip %s\n",
+           p_img->width, p_img->height, tile_width, tile_height, entry_count, check_flip ? "on" : "off");
+
+    status = true;
+
+    for (engine = TILE_ENGINE_INCREMENTAL; engine < TILE_ENGINE_LAST; engine++) {
+
+        tilemap_dedupe_engine_set(engine);
+
+        time_start = get_time();
+        if ( ! tilemap_export_process(p_img, tile_width, tile_height, check_flip) ) {
+            printf("Engine Benchmark: %-12s processing failed\n", tilemap_engine_get_name(engine));
+            status = false;
+            break;
+        }
+        time_process = get_time() - time_start;
+
+        // First engine is the reference for the map contents
+        mismatches = 0;
+        for (c = 0; c < entry_count; c++) {
+            if (engine == TILE_ENGINE_INCREMENTAL)
+                p_entries_ref[c] = tilemap_map_get_entry(tilemap_get_map(), c);
+            else if (p_entries_ref[c] != tilemap_map_get_entry(tilemap_get_map(), c))
+                mismatches++;
+        }
+
+        printf("Engine Benchmark: %-12s %8.3f sec  %7.1f MB/sec  %7.1f M tiles/sec  %" PRIu32 " unique tiles, %" PRIu32 " map mismatches\n",
+               tilemap_engine_get_name(engine), time_process,
+               (time_process > 0) ? (p_img->size / (1024.0 * 1024.0)) / time_process : 0.0,
+               (time_process > 0) ? (entry_count / 1e6) / time_process : 0.0,
+               tilemap_get_tile_set()->tile_count, mismatches);
+    }
+
+    tilemap_dedupe_engine_set(TILE_ENGINE_INCREMENTAL);
+    tilemap_free_resources();
+    free(p_entries_ref);
+
+    return status;
+}
@@ -0,0 +1,17 @@
+//
+// tilemap_compare.h
+//
+
+#ifndef __TILEMAP_COMPARE_H_
+#define __TILEMAP_COMPARE_H_
+
+    #include <stdint.h>
+
+    #include "image_info.h"
+
+    #define COMPARE_HASH_MIN_SECONDS    0.25   // Hash each backend for at least this long
+
+    int32_t tilemap_compare_hashes(image_data * p_img, int tile_width, int tile_height);
+    int32_t tilemap_compare_engines(image_data * p_img, int tile_width, int tile_height, int check_flip);
+
+#endif
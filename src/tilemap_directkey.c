@@ -0,0 +1,360 @@
+//
+// tilemap_directkey.c
+//
+
+// ========================
+//
+// Direct-key tile dedupe for small tiles.
+//
+// When a tile is small enough, its pixels are used as the
+// lookup key instead of a hash: an 8x8 indexed tile with
+// up to 4 colors packs into 128 bits (2 bits per pixel),
+// and any tile of 64 bytes or less fits a zero padded
+// 512 bit key. Keys live in an open addressing table and
+// are compared in full, so there are no hash collisions
+// to worry about and tiles that match never get hashed.
+// Tile sets that keep their tiles bit-packed (see
+// tilemap_packed.c) use the packed tile as the key, up
+// to 64 bytes of it.
+//
+// Flipped variants of each tile (when flip search is on)
+// are inserted as extra keys pointing at the same tile ID
+// with the flip bits set. The first tile to claim a key
+// keeps it, which gives the same result as the linear
+// hash search (lowest tile ID, then lowest flip).
+//
+// The table only tracks tiles registered through
+// processing, tile_dkey_begin() refuses to use it once it
+// is out of step with the tile set (e.g. after reduction).
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "win_aligned_alloc.h"
+
+#include "lib_tilemap.h"
+#include "tilemap_directkey.h"
+
+
+#define DKEY_ALIGN        16
+#define DKEY_FOLD_MULT    0x9E3779B97F4A7C15ULL
+
+
+static const uint16_t dkey_flip_bits[] = {
+    TILE_FLIP_BITS_NONE,
+    TILE_FLIP_BITS_X,
+    TILE_FLIP_BITS_Y,
+    TILE_FLIP_BITS_XY };
+
+
+static int32_t dkey_table_alloc(tile_dkey_data * p_dkey, uint32_t slot_count);
+static int32_t dkey_grow(tile_dkey_data * p_dkey);
+static int32_t dkey_insert(tile_dkey_data * p_dkey, const uint8_t * p_key, uint32_t tile_id, uint16_t attribs);
+
+
+
+// Fold key words down to a starting slot (keys are exact-matched,
+// this only has to spread them out)
+static inline uint32_t dkey_slot_start(tile_dkey_data * p_dkey, const uint8_t * p_key) {
+
+    uint32_t o;
+    uint64_t word;
+    uint64_t acc = 0;
+
+    for (o = 0; o < p_dkey->key_bytes; o += sizeof(uint64_t)) {
+        memcpy(&word, p_key + o, sizeof(uint64_t));
+        acc = (acc ^ word) * DKEY_FOLD_MULT;
+    }
+
+    return (uint32_t)(acc >> 32) & (p_dkey->slot_count - 1);
+}
+
+
+
+// Full key compare, p_table_key must be 16 byte aligned
+static inline int dkey_equal(const uint8_t * p_table_key, const uint8_t * p_key, uint32_t key_bytes) {
+
+#ifdef __SSE2__
+    uint32_t o;
+    __m128i  diff = _mm_setzero_si128();
+
+    for (o = 0; o < key_bytes; o += 16)
+        diff = _mm_or_si128(diff, _mm_xor_si128(_mm_load_si128((const __m128i *)(p_table_key + o)),
+                                                _mm_loadu_si128((const __m128i *)(p_key + o))));
+
+    return (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) == 0xFFFF);
+#else
+    return (memcmp(p_table_key, p_key, key_bytes) == 0);
+#endif
+}
+
+
+
+// Pick the key mode for a tile set and clear the table
+//
+// * color_count is only used for indexed images (1 byte per pixel)
+// * packed_size_bytes: size of the tile set's bit-packed tiles, 0 if
+//   it doesn't pack them (see tilemap_packed.c). Packed tiles are
+//   their own key, callers pass the packed pixels to tile_dkey_pack()
+void tile_dkey_configure(tile_dkey_data * p_dkey, uint8_t bytes_per_pixel, uint32_t tile_size_bytes, uint16_t color_count,
+                         uint32_t packed_size_bytes) {
+
+    tile_dkey_disable(p_dkey);
+
+    if (packed_size_bytes) {
+        if (packed_size_bytes <= TILE_DKEY_BYTES_MAX) {
+            p_dkey->mode      = TILE_DKEY_MODE_PACKED;
+            p_dkey->key_bytes = (packed_size_bytes + (DKEY_ALIGN - 1)) & ~(DKEY_ALIGN - 1);
+        }
+        else
+            p_dkey->mode = TILE_DKEY_MODE_OFF;
+    }
+    else if ((bytes_per_pixel == 1) && (color_count > 0) && (color_count <= TILE_DKEY_PACKED_COLORS)
+        && (tile_size_bytes <= (16 * 4))) { // 4 pixels per key byte
+        p_dkey->mode      = TILE_DKEY_MODE_2BPP;
+        p_dkey->key_bytes = 16;
+    }
+    else if (tile_size_bytes <= TILE_DKEY_BYTES_MAX) {
+        p_dkey->mode      = TILE_DKEY_MODE_RAW;
+        p_dkey->key_bytes = TILE_DKEY_BYTES_MAX;
+    }
+    else
+        p_dkey->mode = TILE_DKEY_MODE_OFF;
+}
+
+
+
+// Free the table, the key mode stays as configured
+// (a new table gets started by tile_dkey_begin())
+void tile_dkey_release(tile_dkey_data * p_dkey) {
+
+    if (p_dkey->p_keys)
+        free(p_dkey->p_keys);
+    if (p_dkey->p_ids)
+        free(p_dkey->p_ids);
+    if (p_dkey->p_attribs)
+        free(p_dkey->p_attribs);
+
+    p_dkey->p_keys      = NULL;
+    p_dkey->p_ids       = NULL;
+    p_dkey->p_attribs   = NULL;
+    p_dkey->slot_count  = 0;
+    p_dkey->used_count  = 0;
+    p_dkey->tile_count  = 0;
+    p_dkey->search_mask = 0;
+}
+
+
+
+// Free the table and turn direct keys off until the next tile_dkey_configure()
+void tile_dkey_disable(tile_dkey_data * p_dkey) {
+
+    tile_dkey_release(p_dkey);
+    p_dkey->mode      = TILE_DKEY_MODE_OFF;
+    p_dkey->key_bytes = 0;
+}
+
+
+
+// Check whether the table can be used for a processing pass
+//
+// * A tile set with no tiles yet starts a fresh table
+// * Returns false if direct keys are off or the table no longer
+//   matches the tile set, the hash search works in either case
+int32_t tile_dkey_begin(tile_dkey_data * p_dkey, uint32_t tile_count, uint16_t search_mask) {
+
+    if (p_dkey->mode == TILE_DKEY_MODE_OFF)
+        return false;
+
+    if (tile_count == 0) {
+        if (!p_dkey->p_keys) {
+            if (!dkey_table_alloc(p_dkey, TILE_DKEY_SLOTS_MIN))
+                return false;
+        } else {
+            memset(p_dkey->p_ids, 0xFF, (size_t)p_dkey->slot_count * sizeof(uint32_t));
+            p_dkey->used_count = 0;
+        }
+        p_dkey->tile_count  = 0;
+        p_dkey->search_mask = search_mask;
+        return true;
+    }
+
+    return (p_dkey->p_keys && (p_dkey->tile_count == tile_count) && (p_dkey->search_mask == search_mask));
+}
+
+
+
+// Pack tile pixels into a key (p_key must hold TILE_DKEY_BYTES_MAX bytes)
+//
+// * TILE_DKEY_MODE_PACKED: p_pixels are the bit-packed tile
+// * Returns false if a pixel doesn't fit the packed format
+int32_t tile_dkey_pack(tile_dkey_data * p_dkey, const uint8_t * p_pixels, uint32_t size_bytes, uint8_t * p_key) {
+
+    uint32_t c;
+
+    if (p_dkey->mode == TILE_DKEY_MODE_2BPP) {
+
+        memset(p_key, 0x00, p_dkey->key_bytes);
+
+        for (c = 0; c < size_bytes; c++) {
+            if (p_pixels[c] >= TILE_DKEY_PACKED_COLORS)
+                return false;
+            p_key[c >> 2] |= p_pixels[c] << ((c & 0x03) * 2);
+        }
+    }
+    else {
+        memcpy(p_key, p_pixels, size_bytes);
+        memset(p_key + size_bytes, 0x00, p_dkey->key_bytes - size_bytes);
+    }
+
+    return true;
+}
+
+
+
+// Look up a key, returns true and sets tile ID and flip bits if found
+int32_t tile_dkey_find(tile_dkey_data * p_dkey, const uint8_t * p_key, uint32_t * p_id, uint16_t * p_attribs) {
+
+    uint32_t slot;
+    uint32_t slot_mask = p_dkey->slot_count - 1;
+
+    slot = dkey_slot_start(p_dkey, p_key);
+
+    while (p_dkey->p_ids[slot] != TILE_DKEY_SLOT_EMPTY) {
+
+        if (dkey_equal(p_dkey->p_keys + ((size_t)slot * p_dkey->key_bytes), p_key, p_dkey->key_bytes)) {
+            *p_id      = p_dkey->p_ids[slot];
+            *p_attribs = p_dkey->p_attribs[slot];
+            return true;
+        }
+        slot = (slot + 1) & slot_mask;
+    }
+
+    return false;
+}
+
+
+
+// Index a newly registered tile: keys[0] is the tile itself,
+// keys[1..3] the flip x / y / xy variants (only used if the
+// table was started with a flip search mask)
+//
+// * Returns false on allocation failure, direct keys are off then
+int32_t tile_dkey_add_tile(tile_dkey_data * p_dkey, uint8_t keys[][TILE_DKEY_BYTES_MAX], uint32_t tile_id) {
+
+    int h, h_range;
+
+    h_range = (p_dkey->search_mask) ? TILE_FLIP_MAX : TILE_FLIP_MIN;
+
+    for (h = TILE_FLIP_MIN; h <= h_range; h++)
+        if (!dkey_insert(p_dkey, keys[h], tile_id, dkey_flip_bits[h])) {
+            tile_dkey_disable(p_dkey);
+            return false;
+        }
+
+    p_dkey->tile_count++;
+    return true;
+}
+
+
+
+const char * tile_dkey_get_name(tile_dkey_data * p_dkey) {
+
+    switch (p_dkey->mode) {
+        case TILE_DKEY_MODE_2BPP: return "128 bit (2bpp packed)";
+        case TILE_DKEY_MODE_RAW:  return "512 bit (raw)";
+        case TILE_DKEY_MODE_PACKED: return "packed tile pixels";
+        default:                  return "off";
+    }
+}
+
+
+
+static int32_t dkey_table_alloc(tile_dkey_data * p_dkey, uint32_t slot_count) {
+
+    p_dkey->p_keys    = aligned_alloc(DKEY_ALIGN, (size_t)slot_count * p_dkey->key_bytes);
+    p_dkey->p_ids     = malloc((size_t)slot_count * sizeof(uint32_t));
+    p_dkey->p_attribs = malloc((size_t)slot_count * sizeof(uint16_t));
+
+    if (!(p_dkey->p_keys && p_dkey->p_ids && p_dkey->p_attribs)) {
+        free(p_dkey->p_keys);
+        free(p_dkey->p_ids);
+        free(p_dkey->p_attribs);
+        p_dkey->p_keys    = NULL;
+        p_dkey->p_ids     = NULL;
+        p_dkey->p_attribs = NULL;
+        return false;
+    }
+
+    memset(p_dkey->p_ids, 0xFF, (size_t)slot_count * sizeof(uint32_t));
+    p_dkey->slot_count = slot_count;
+    p_dkey->used_count = 0;
+
+    return true;
+}
+
+
+
+// Double the table size and re-insert all keys
+static int32_t dkey_grow(tile_dkey_data * p_dkey) {
+
+    uint32_t   c;
+    uint32_t   old_slot_count = p_dkey->slot_count;
+    uint8_t  * p_old_keys     = p_dkey->p_keys;
+    uint32_t * p_old_ids      = p_dkey->p_ids;
+    uint16_t * p_old_attribs  = p_dkey->p_attribs;
+
+    if (!dkey_table_alloc(p_dkey, old_slot_count * 2)) {
+        // Keep the old table so the caller can release it
+        p_dkey->p_keys    = p_old_keys;
+        p_dkey->p_ids     = p_old_ids;
+        p_dkey->p_attribs = p_old_attribs;
+        return false;
+    }
+
+    for (c = 0; c < old_slot_count; c++)
+        if (p_old_ids[c] != TILE_DKEY_SLOT_EMPTY)
+            dkey_insert(p_dkey, p_old_keys + ((size_t)c * p_dkey->key_bytes), p_old_ids[c], p_old_attribs[c]);
+
+    free(p_old_keys);
+    free(p_old_ids);
+    free(p_old_attribs);
+
+    return true;
+}
+
+
+
+// Insert a key unless it's already present (first claim wins)
+static int32_t dkey_insert(tile_dkey_data * p_dkey, const uint8_t * p_key, uint32_t tile_id, uint16_t attribs) {
+
+    uint32_t slot;
+
+    // Keep the load at or below 1/2 so probe runs stay short
+    if (((p_dkey->used_count + 1) * 2) > p_dkey->slot_count)
+        if (!dkey_grow(p_dkey))
+            return false;
+
+    slot = dkey_slot_start(p_dkey, p_key);
+
+    while (p_dkey->p_ids[slot] != TILE_DKEY_SLOT_EMPTY) {
+        if (dkey_equal(p_dkey->p_keys + ((size_t)slot * p_dkey->key_bytes), p_key, p_dkey->key_bytes))
+            return true;
+        slot = (slot + 1) & (p_dkey->slot_count - 1);
+    }
+
+    memcpy(p_dkey->p_keys + ((size_t)slot * p_dkey->key_bytes), p_key, p_dkey->key_bytes);
+    p_dkey->p_ids[slot]     = tile_id;
+    p_dkey->p_attribs[slot] = attribs;
+    p_dkey->used_count++;
+
+    return true;
+}
@@ -0,0 +1,49 @@
+//
+// tilemap_directkey.h
+//
+
+#ifndef __TILEMAP_DIRECTKEY_H_
+#define __TILEMAP_DIRECTKEY_H_
+
+    #include <stdint.h>
+
+    #define TILE_DKEY_BYTES_MAX      64          // 512 bit key
+    #define TILE_DKEY_SLOTS_MIN      256         // Table starts at this size, power of two
+    #define TILE_DKEY_SLOT_EMPTY     0xFFFFFFFF
+    #define TILE_DKEY_PACKED_COLORS  4           // Indexed images with this many colors pack at 2 bits per pixel
+
+    // Direct key modes (picked from tile size and color count)
+    enum tile_dkey_modes {
+        TILE_DKEY_MODE_OFF    = 0, // Tiles too large, hash lookup only
+        TILE_DKEY_MODE_2BPP   = 1, // Indexed pixels packed 2 bits each, 128 bit key
+        TILE_DKEY_MODE_RAW    = 2, // Raw pixel bytes zero padded, 512 bit key
+        TILE_DKEY_MODE_PACKED = 3, // Bit-packed tile (tilemap_packed.c) zero padded to 16 bytes, up to 512 bit key
+        TILE_DKEY_MODE_LAST
+    };
+
+    // Exact-match table of packed tile keys, one per tile set (zeroed = off)
+    typedef struct {
+        uint8_t    mode;          // enum tile_dkey_modes
+        uint8_t    key_bytes;     // 16 to 64, multiple of 16
+        uint16_t   search_mask;   // Flip keys are present for these bits
+        uint32_t   tile_count;    // Tiles indexed so far, must match the tile set
+        uint32_t   slot_count;
+        uint32_t   used_count;
+        uint8_t  * p_keys;        // slot_count * key_bytes, 16 byte aligned
+        uint32_t * p_ids;         // Tile ID per slot, TILE_DKEY_SLOT_EMPTY if unused
+        uint16_t * p_attribs;     // Flip bits per slot
+    } tile_dkey_data;
+
+    void    tile_dkey_configure(tile_dkey_data * p_dkey, uint8_t bytes_per_pixel, uint32_t tile_size_bytes, uint16_t color_count,
+                                    uint32_t packed_size_bytes);
+    void    tile_dkey_release(tile_dkey_data * p_dkey);
+    void    tile_dkey_disable(tile_dkey_data * p_dkey);
+    int32_t tile_dkey_begin(tile_dkey_data * p_dkey, uint32_t tile_count, uint16_t search_mask);
+
+    int32_t tile_dkey_pack(tile_dkey_data * p_dkey, const uint8_t * p_pixels, uint32_t size_bytes, uint8_t * p_key);
+    int32_t tile_dkey_find(tile_dkey_data * p_dkey, const uint8_t * p_key, uint32_t * p_id, uint16_t * p_attribs);
+    int32_t tile_dkey_add_tile(tile_dkey_data * p_dkey, uint8_t keys[][TILE_DKEY_BYTES_MAX], uint32_t tile_id);
+
+    const char * tile_dkey_get_name(tile_dkey_data * p_dkey);
+
+#endif
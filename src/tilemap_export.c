@@ -10,6 +10,254 @@
 
  #define CALC_REM_LEN() if (len <= max_len) len_rem = max_len - len; else len_rem = 0;
 
+
+static uint32_t tilemap_export_c_metatiles_to_string(char * p_dest_str, uint32_t max_len,
+                                                     char * p_prefix_str,
+                                                     tile_map_data * p_map, tile_set_data * p_tile_set);
+static uint32_t tilemap_export_asm_rgbds_metatiles_to_string(char * p_dest_str, uint32_t max_len,
+                                                             char * p_prefix_str,
+                                                             tile_map_data * p_map, tile_set_data * p_tile_set);
+
+
+
+// Metatile table and metatile map, when the metatile pass built them
+static uint32_t tilemap_export_c_metatiles_to_string(char * p_dest_str, uint32_t max_len,
+                                                     char * p_prefix_str,
+                                                     tile_map_data * p_map, tile_set_data * p_tile_set) {
+
+    tile_metatile_data * p_meta = &p_map->metatiles;
+    uint32_t   len, len_rem;
+    uint32_t   idx, entry, entries;
+    uint32_t   block_count;
+
+    len = 0;
+
+    if (!p_meta->p_map)
+        return (0);
+
+    entries     = p_meta->block_width * p_meta->block_height;
+    block_count = p_meta->width_in_blocks * p_meta->height_in_blocks;
+
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n\n\n// Metatiles: unique blocks of map entries, tile IDs in row-major order\n"
+            "#define %s_METATILE_WIDTH  %8d\n"
+            "#define %s_METATILE_HEIGHT %8d\n"
+            "#define %s_METATILE_COUNT  %8d\n"
+            "#define %s_METAMAP_WIDTH   %8d\n"
+            "#define %s_METAMAP_HEIGHT  %8d\n"
+            "\n"
+            "const %s %s_metatiles[%d][%d] = \n"
+            "{\n",
+            p_prefix_str, p_meta->block_width,
+            p_prefix_str, p_meta->block_height,
+            p_prefix_str, p_meta->count,
+            p_prefix_str, p_meta->width_in_blocks,
+            p_prefix_str, p_meta->height_in_blocks,
+            (p_tile_set->tile_count <= 255) ? "unsigned char" : "unsigned int", p_prefix_str,
+            p_meta->count, entries
+            );
+
+    for (idx = 0; idx < p_meta->count; idx++) {
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "    {");
+
+        for (entry = 0; entry < entries; entry++) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "%3d,", p_meta->p_table_ids[(idx * entries) + entry]);
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "},\n");
+    }
+
+    CALC_REM_LEN();
+    len += snprintf((p_dest_str + len), len_rem, "};\n");
+
+
+    // Flip attribs of each metatile entry, same layout
+    if (p_map->search_mask) {
+
+        CALC_REM_LEN();
+        len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+                "\n\n\nconst unsigned int %s_metatile_attribs[%d][%d] = \n"
+                "{\n",
+                p_prefix_str, p_meta->count, entries
+                );
+
+        for (idx = 0; idx < p_meta->count; idx++) {
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "    {");
+
+            for (entry = 0; entry < entries; entry++) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "%4x,", p_meta->p_table_attribs[(idx * entries) + entry]);
+            }
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "},\n");
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "};\n");
+    }
+
+
+    // Metatile ID of each block
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n\n\nconst %s %s_metamap[] = \n"
+            "{\n",
+            (p_meta->count <= 255) ? "unsigned char" : "unsigned int", p_prefix_str
+            );
+
+    for (idx = 0; idx < block_count; idx++) {
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "%3d,", p_meta->p_map[idx]);
+
+        if (idx && (((idx+1) % 16) == 0)) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\n"); // Line break every 16 blocks
+        }
+
+        if (idx && (((idx+1) % 64) == 0)) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\n"); // An extra line break every 64 blocks
+        }
+    }
+
+    CALC_REM_LEN();
+    len += snprintf((p_dest_str + len), len_rem, "};\n");
+
+    return (len);
+}
+
+
+
+// Metatile table and metatile map, when the metatile pass built them
+static uint32_t tilemap_export_asm_rgbds_metatiles_to_string(char * p_dest_str, uint32_t max_len,
+                                                             char * p_prefix_str,
+                                                             tile_map_data * p_map, tile_set_data * p_tile_set) {
+
+    tile_metatile_data * p_meta = &p_map->metatiles;
+    uint32_t   len, len_rem;
+    uint32_t   idx, entry, entries;
+    uint32_t   block_count, per_line;
+
+    len = 0;
+
+    if (!p_meta->p_map)
+        return (0);
+
+    entries     = p_meta->block_width * p_meta->block_height;
+    block_count = p_meta->width_in_blocks * p_meta->height_in_blocks;
+
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n\n\n; Metatiles: unique blocks of map entries, tile IDs in row-major order\n"
+            "%sMetatileWidth  EQU %8d\n"
+            "%sMetatileHeight EQU %8d\n"
+            "%sMetatileCount  EQU %8d\n"
+            "%sMetamapWidth   EQU %8d\n"
+            "%sMetamapHeight  EQU %8d\n\n"
+            "%sMetatiles::",
+            p_prefix_str, p_meta->block_width,
+            p_prefix_str, p_meta->block_height,
+            p_prefix_str, p_meta->count,
+            p_prefix_str, p_meta->width_in_blocks,
+            p_prefix_str, p_meta->height_in_blocks,
+            p_prefix_str
+            );
+
+    // One line per metatile, 8 or 16 bit IDs to match the map
+    for (idx = 0; idx < p_meta->count; idx++) {
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, (p_tile_set->tile_count <= 255) ? "\nDB " : "\nDW ");
+
+        for (entry = 0; entry < entries; entry++) {
+            CALC_REM_LEN();
+            if (p_tile_set->tile_count <= 255)
+                len += snprintf((p_dest_str + len), len_rem, (entry) ? ",$%02x" : "$%02x",
+                                p_meta->p_table_ids[(idx * entries) + entry]);
+            else
+                len += snprintf((p_dest_str + len), len_rem, (entry) ? ",$%04x" : "$%04x",
+                                p_meta->p_table_ids[(idx * entries) + entry]);
+        }
+    }
+
+    CALC_REM_LEN();
+    len += snprintf((p_dest_str + len), len_rem, "\n");
+
+
+    // Flip attribs of each metatile entry, same layout
+    if (p_map->search_mask) {
+
+        CALC_REM_LEN();
+        len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+                "\n\n\n%sMetatileAttribs::",
+                p_prefix_str);
+
+        for (idx = 0; idx < p_meta->count; idx++) {
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\nDW ");
+
+            for (entry = 0; entry < entries; entry++) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, (entry) ? ",$%04x" : "$%04x",
+                                p_meta->p_table_attribs[(idx * entries) + entry]);
+            }
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "\n");
+    }
+
+
+    // Metatile ID of each block
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n\n\n%sMetamap::",
+            p_prefix_str);
+
+    per_line = (p_meta->count <= 255) ? 16 : 8;
+
+    for (idx = 0; idx < block_count; idx++) {
+
+        // Line break every 16 (bytes) or 8 (words) entries
+        if ((idx % per_line) == 0) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, (p_meta->count <= 255) ? "\nDB " : "\nDW ");
+        }
+
+        // Only trailing commas when it's not the last entry of the line
+        CALC_REM_LEN();
+        if (p_meta->count <= 255)
+            len += snprintf((p_dest_str + len), len_rem, (((idx+1) % per_line) != 0) ? "$%02x," : "$%02x",
+                            p_meta->p_map[idx]);
+        else
+            len += snprintf((p_dest_str + len), len_rem, (((idx+1) % per_line) != 0) ? "$%04x," : "$%04x",
+                            p_meta->p_map[idx]);
+
+        // An extra line break every 64 blocks
+        if (idx && (((idx+1) % 64) == 0)) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\n");
+        }
+    }
+
+    CALC_REM_LEN();
+    len += snprintf((p_dest_str + len), len_rem, "\n");
+
+    return (len);
+}
+
+
+
 // Returns string length
 // If the string to write exceeds max_len then it will get cropped and return an error
 uint32_t tilemap_export_c_source_to_string(char * p_dest_str, uint32_t max_len,
@@ -18,6 +266,10 @@ uint32_t tilemap_export_c_source_to_string(char * p_dest_str, uint32_t max_len,
 
     uint32_t   len, len_rem;
     uint32_t   idx;
+    uint32_t   tile_id;
+    uint16_t   tile_attribs;
+    uint32_t   pal, color;
+    tile_map_iter iter;
 
     len = 0;
 
@@ -51,10 +303,12 @@ uint32_t tilemap_export_c_source_to_string(char * p_dest_str, uint32_t max_len,
             );
 
     // Write all the Tile Map data to a file
+    tilemap_map_iter_init(&iter, p_map);
     for (idx = 0; idx < p_map->size; idx++) {
+        tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
 
             CALC_REM_LEN();
-            len += snprintf((p_dest_str + len), len_rem, "%3d,", p_map->tile_id_list[idx]);
+            len += snprintf((p_dest_str + len), len_rem, "%3d,", tile_id);
 
         if (idx && (((idx+1) % 16) == 0)) {
             CALC_REM_LEN();
@@ -84,10 +338,12 @@ uint32_t tilemap_export_c_source_to_string(char * p_dest_str, uint32_t max_len,
                 );
 
         // Write all the Tile Map Attrib data to a file
+        tilemap_map_iter_init(&iter, p_map);
         for (idx = 0; idx < p_map->size; idx++) {
+            tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
 
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "%4x,", p_map->tile_attribs_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "%4x,", tile_attribs);
 
             if (idx && (((idx+1) % 16) == 0)) {
                 CALC_REM_LEN();
@@ -106,6 +362,79 @@ uint32_t tilemap_export_c_source_to_string(char * p_dest_str, uint32_t max_len,
 
     }
 
+
+    // If sub-palettes were assigned, write out the per-map-entry
+    // sub-palette and the colormap indices of each sub-palette
+    if (p_tile_set->subpal.count_max) {
+
+        CALC_REM_LEN();
+        len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+                "\n\n\n// Sub-palette of each map entry (%d = tile has too many colors)\n"
+                "const unsigned char %s_palettes[] = \n"
+                "{\n",
+                TILE_SUBPAL_UNFIT, p_prefix_str
+                );
+
+        tilemap_map_iter_init(&iter, p_map);
+        for (idx = 0; idx < p_map->size; idx++) {
+            tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
+
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "%3d,", p_tile_set->tiles[tile_id].sub_palette);
+
+            if (idx && (((idx+1) % 16) == 0)) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "\n"); // Line break every 8 tiles
+            }
+
+            if (idx && (((idx+1) % 64) == 0)) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "\n"); // An extra line break every 64 tiles
+            }
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "};\n");
+
+
+        CALC_REM_LEN();
+        len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+                "\n\n\nconst unsigned char %s_subpal_colors[%d][%d] = \n"
+                "{\n",
+                p_prefix_str, p_tile_set->subpal.count, p_tile_set->subpal.colors_max
+                );
+
+        for (pal = 0; pal < p_tile_set->subpal.count; pal++) {
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "    {");
+
+            // Colormap indices in order, unused slots are zero
+            color = 0;
+            for (idx = 0; idx < 256; idx++) {
+                if ((p_tile_set->subpal.colors[pal][idx >> 6] >> (idx & 63)) & 1) {
+                    CALC_REM_LEN();
+                    len += snprintf((p_dest_str + len), len_rem, "%3d,", idx);
+                    color++;
+                }
+            }
+            for (; color < p_tile_set->subpal.colors_max; color++) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "%3d,", 0);
+            }
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "},\n");
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "};\n");
+    }
+
+    // Second level: metatile table + metatile map
+    CALC_REM_LEN();
+    len += tilemap_export_c_metatiles_to_string((p_dest_str + len), len_rem, p_prefix_str, p_map, p_tile_set);
+
     return (len);
 }
 
@@ -120,6 +449,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
 
     uint32_t   len, len_rem;
     uint32_t   idx;
+    uint32_t   tile_id;
+    uint16_t   tile_attribs;
+    uint32_t   pal, color;
+    tile_map_iter iter;
 
     len = 0;
 
@@ -157,7 +490,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
     // Different text rendering for 8 bits versus 16 bits
     if (p_tile_set->tile_count <= 255) {
 
+        tilemap_map_iter_init(&iter, p_map);
         for (idx = 0; idx < p_map->size; idx++) {
+            tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
+
             // Line break every 8 tiles, select var type based on size
             if ((idx % 16) == 0) {
                 CALC_REM_LEN();
@@ -167,10 +503,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
             // Print the entry (BYTE), only trailing commas when it's not the last byte of the line
             if (((idx+1) % 16) != 0) {
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "$%02x,", p_map->tile_id_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "$%02x,", tile_id);
             } else {
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "$%02x", p_map->tile_id_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "$%02x", tile_id);
             }
 
             // An extra line break every 64 tiles
@@ -181,7 +517,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
         }
     } else {
         // Write all the Tile Map data to a file
+        tilemap_map_iter_init(&iter, p_map);
         for (idx = 0; idx < p_map->size; idx++) {
+            tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
+
             // Line break every 8 tiles, select var type based on size
             if ((idx % 8) == 0) {
                 CALC_REM_LEN();
@@ -191,10 +530,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
             // Print the entry (WORD), only trailing commas when it's not the last byte of the line
             if (((idx+1) % 8) != 0) {
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "$%04x,", p_map->tile_id_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "$%04x,", tile_id);
             } else {
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "$%04x", p_map->tile_id_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "$%04x", tile_id);
             }
 
             // An extra line break every 64 tiles
@@ -220,7 +559,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
                 p_prefix_str);
 
         // Write all the Tile Map data to a file
+        tilemap_map_iter_init(&iter, p_map);
         for (idx = 0; idx < p_map->size; idx++) {
+            tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
+
             // Line break every 8 tiles, select var type based on size
             if ((idx % 8) == 0) {
                 CALC_REM_LEN();
@@ -230,10 +572,10 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
             // Print the entry (WORD), only trailing commas when it's not the last byte of the line
             if (((idx+1) % 8) != 0) {
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "$%04x,", p_map->tile_attribs_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "$%04x,", tile_attribs);
             } else {
                 CALC_REM_LEN();
-                len += snprintf((p_dest_str + len), len_rem, "$%04x", p_map->tile_attribs_list[idx]);
+                len += snprintf((p_dest_str + len), len_rem, "$%04x", tile_attribs);
             }
 
             // An extra line break every 64 tiles
@@ -251,5 +593,247 @@ uint32_t tilemap_export_asm_rgbds_source_to_string(char * p_dest_str, uint32_t m
 
     }
 
+
+    // If sub-palettes were assigned, write out the per-map-entry
+    // sub-palette and the colormap indices of each sub-palette
+    if (p_tile_set->subpal.count_max) {
+
+        CALC_REM_LEN();
+        len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+                "\n\n\n; Sub-palette of each map entry ($%02x = tile has too many colors)\n"
+                "%sPalettes::",
+                TILE_SUBPAL_UNFIT, p_prefix_str);
+
+        tilemap_map_iter_init(&iter, p_map);
+        for (idx = 0; idx < p_map->size; idx++) {
+            tilemap_map_iter_next(&iter, &tile_id, &tile_attribs);
+
+            // Line break every 16 entries
+            if ((idx % 16) == 0) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "\nDB ");
+            }
+
+            // Print the entry (BYTE), only trailing commas when it's not the last byte of the line
+            if (((idx+1) % 16) != 0) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "$%02x,", p_tile_set->tiles[tile_id].sub_palette);
+            } else {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "$%02x", p_tile_set->tiles[tile_id].sub_palette);
+            }
+
+            // An extra line break every 64 tiles
+            if (idx && (((idx+1) % 64) == 0)) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, "\n");
+            }
+        }
+
+        CALC_REM_LEN();
+        len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+                "\n\n\n%sSubPalColors::",
+                p_prefix_str);
+
+        // One line per sub-palette: colormap indices in order, unused slots are zero
+        for (pal = 0; pal < p_tile_set->subpal.count; pal++) {
+
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\nDB ");
+
+            color = 0;
+            for (idx = 0; idx < 256; idx++) {
+                if ((p_tile_set->subpal.colors[pal][idx >> 6] >> (idx & 63)) & 1) {
+                    CALC_REM_LEN();
+                    len += snprintf((p_dest_str + len), len_rem, (color) ? ",$%02x" : "$%02x", idx);
+                    color++;
+                }
+            }
+            for (; color < p_tile_set->subpal.colors_max; color++) {
+                CALC_REM_LEN();
+                len += snprintf((p_dest_str + len), len_rem, (color) ? ",$%02x" : "$%02x", 0);
+            }
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "\n");
+    }
+
+    // Second level: metatile table + metatile map
+    CALC_REM_LEN();
+    len += tilemap_export_asm_rgbds_metatiles_to_string((p_dest_str + len), len_rem, p_prefix_str, p_map, p_tile_set);
+
+    return (len);
+}
+
+
+
+// Sprite sheet mode: unique sprites (size + offset into the pixel
+// data), their pixels in source image format and the placement table
+uint32_t tilemap_export_c_sprites_to_string(char * p_dest_str, uint32_t max_len,
+                                            char * p_prefix_str,
+                                            tile_sprites_data * p_sprites) {
+
+    uint32_t   len, len_rem;
+    uint32_t   idx;
+    size_t     byte;
+    tile_sprite_placement * p_place;
+
+    len = 0;
+
+    if(p_dest_str == NULL)
+        return (0); // return zero length for string
+
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n"
+            "// Sprite Sheet Source File \n"
+            "// This file generated by: Gimp Tilemap Helper Plugin\n"
+            "\n"
+            "#define %s_SPRITE_COUNT    %8d\n"
+            "#define %s_PLACEMENT_COUNT %8d\n"
+            "#define %s_BYTES_PER_PIXEL %8d\n"
+            "\n"
+            "// Unique sprites: width, height, byte offset into %s_sprite_pixels\n"
+            "const unsigned int %s_sprites[%d][3] = \n"
+            "{\n",
+            p_prefix_str, p_sprites->count,
+            p_prefix_str, p_sprites->placement_count,
+            p_prefix_str, p_sprites->bytes_per_pixel,
+            p_prefix_str,
+            p_prefix_str, p_sprites->count
+            );
+
+    for (idx = 0; idx < p_sprites->count; idx++) {
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "    {%4d,%4d,%8zu},\n",
+                        p_sprites->p_sprites[idx].width, p_sprites->p_sprites[idx].height,
+                        p_sprites->p_sprites[idx].offset);
+    }
+
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "};\n"
+            "\n\n\n"
+            "const unsigned char %s_sprite_pixels[%zu] = \n"
+            "{",
+            p_prefix_str, p_sprites->pixels_size
+            );
+
+    for (byte = 0; byte < p_sprites->pixels_size; byte++) {
+
+        // Line break every 16 bytes
+        if ((byte % 16) == 0) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\n    ");
+        }
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "0x%02x,", p_sprites->p_pixels[byte]);
+    }
+
+    // Placements in sheet scan order: x, y, sprite ID, flip attribs
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n};\n"
+            "\n\n\n"
+            "const unsigned int %s_placements[%d][4] = \n"
+            "{\n",
+            p_prefix_str, p_sprites->placement_count
+            );
+
+    for (idx = 0; idx < p_sprites->placement_count; idx++) {
+        p_place = &p_sprites->p_placements[idx];
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "    {%5d,%5d,%5d,%4x},\n",
+                        p_place->x, p_place->y, p_place->sprite_id, p_place->attribs);
+    }
+
+    CALC_REM_LEN();
+    len += snprintf((p_dest_str + len), len_rem, "};\n");
+
+    return (len);
+}
+
+
+
+uint32_t tilemap_export_asm_rgbds_sprites_to_string(char * p_dest_str, uint32_t max_len,
+                                                    char * p_prefix_str,
+                                                    tile_sprites_data * p_sprites) {
+
+    uint32_t   len, len_rem;
+    uint32_t   idx;
+    size_t     byte;
+    tile_sprite_placement * p_place;
+
+    len = 0;
+
+    if(p_dest_str == NULL)
+        return (0); // return zero length for string
+
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n"
+            "; Sprite Sheet Source File \n"
+            "; This file generated by: Gimp Tilemap Helper Plugin\n"
+            "\n"
+            "%sSpriteCount    EQU %8d\n"
+            "%sPlacementCount EQU %8d\n"
+            "%sBytesPerPixel  EQU %8d\n"
+            "\n"
+            "; Unique sprites: width, height, byte offset into %sSpritePixels\n"
+            "%sSprites::",
+            p_prefix_str, p_sprites->count,
+            p_prefix_str, p_sprites->placement_count,
+            p_prefix_str, p_sprites->bytes_per_pixel,
+            p_prefix_str,
+            p_prefix_str
+            );
+
+    for (idx = 0; idx < p_sprites->count; idx++) {
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "\nDW $%04x,$%04x\nDL $%08zx",
+                        p_sprites->p_sprites[idx].width, p_sprites->p_sprites[idx].height,
+                        p_sprites->p_sprites[idx].offset);
+    }
+
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n\n\n\n%sSpritePixels::",
+            p_prefix_str);
+
+    for (byte = 0; byte < p_sprites->pixels_size; byte++) {
+
+        // Line break every 16 bytes
+        if ((byte % 16) == 0) {
+            CALC_REM_LEN();
+            len += snprintf((p_dest_str + len), len_rem, "\nDB ");
+        }
+
+        // Only trailing commas when it's not the last byte of the line
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem,
+                        ((((byte+1) % 16) != 0) && ((byte+1) < p_sprites->pixels_size)) ? "$%02x," : "$%02x",
+                        p_sprites->p_pixels[byte]);
+    }
+
+    // Placements in sheet scan order: x, y, sprite ID, flip attribs
+    CALC_REM_LEN();
+    len += (uint32_t)snprintf((p_dest_str + len), len_rem,
+            "\n\n\n\n%sPlacements::",
+            p_prefix_str);
+
+    for (idx = 0; idx < p_sprites->placement_count; idx++) {
+        p_place = &p_sprites->p_placements[idx];
+
+        CALC_REM_LEN();
+        len += snprintf((p_dest_str + len), len_rem, "\nDW $%04x,$%04x,$%04x,$%04x",
+                        p_place->x, p_place->y, p_place->sprite_id, p_place->attribs);
+    }
+
+    CALC_REM_LEN();
+    len += snprintf((p_dest_str + len), len_rem, "\n");
+
     return (len);
 }
@@ -18,4 +18,12 @@
                                                        char * p_prefix_str,
                                                        tile_map_data * p_map, tile_set_data * p_tile_set);
 
+    uint32_t tilemap_export_c_sprites_to_string(char * p_dest_str, uint32_t max_len,
+                                                char * p_prefix_str,
+                                                tile_sprites_data * p_sprites);
+
+    uint32_t tilemap_export_asm_rgbds_sprites_to_string(char * p_dest_str, uint32_t max_len,
+                                                        char * p_prefix_str,
+                                                        tile_sprites_data * p_sprites);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+//
+// tilemap_grid.c
+//
+
+// ========================
+//
+// Tile sheet layout: margin and spacing between tiles.
+//
+// Tile sheets exported by other tools often have a border
+// around the tiles and a gap between them. Rather than
+// repacking the image, tiles are read where they sit:
+// every tile copy, hash and reference view takes its
+// offset from here and keeps using the image row stride.
+//
+// Tile n along an axis starts at margin + n x (tile size
+// + spacing). Pixels right of or below the last whole tile
+// (a trailing margin, or a partial tile) are ignored.
+//
+// With no margin and no spacing this reduces to the packed
+// layout, so those images must still be an exact multiple
+// of the tile size (see tilemap_check_grid_dimensions_valid()).
+//
+// ========================
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "tilemap_grid.h"
+
+
+
+// True if the tiles are not packed edge to edge from the upper left
+int32_t tile_grid_is_set(tile_grid_data * p_grid) {
+
+    return (p_grid->margin != GRID_MARGIN_NONE) || (p_grid->spacing != GRID_SPACING_NONE);
+}
+
+
+
+// Whole tiles along one axis of the image (width or height)
+uint32_t tile_grid_get_count(uint32_t image_size, uint16_t tile_size, tile_grid_data * p_grid) {
+
+    if ((tile_size == 0) || (image_size < (uint32_t)p_grid->margin + tile_size))
+        return 0;
+
+    return ((image_size - p_grid->margin - tile_size) / ((uint32_t)tile_size + p_grid->spacing)) + 1;
+}
+
+
+
+// Byte offset of the upper left pixel of map cell map_x, map_y in the image
+// (64 bit math, large images exceed 4GB)
+size_t tile_grid_get_offset(image_data * p_src_img, tile_grid_data * p_grid,
+                            uint16_t tile_width, uint16_t tile_height, uint32_t map_x, uint32_t map_y) {
+
+    size_t x, y;
+
+    x = p_grid->margin + ((size_t)map_x * ((size_t)tile_width  + p_grid->spacing));
+    y = p_grid->margin + ((size_t)map_y * ((size_t)tile_height + p_grid->spacing));
+
+    return ((y * p_src_img->width) + x) * p_src_img->bytes_per_pixel;
+}
+
+
+
+// Map cell under image pixel img_x, img_y
+//
+// * Returns false over the margin, the spacing between
+//   tiles or the unused pixels right of / below the map
+int32_t tile_grid_find_cell(tile_map_data * p_map, uint32_t img_x, uint32_t img_y,
+                            uint32_t * p_map_x, uint32_t * p_map_y) {
+
+    uint32_t step_x, step_y;
+
+    if ((img_x < p_map->grid.margin) || (img_y < p_map->grid.margin)
+        || (p_map->tile_width == 0) || (p_map->tile_height == 0))
+        return false;
+
+    img_x -= p_map->grid.margin;
+    img_y -= p_map->grid.margin;
+
+    step_x = (uint32_t)p_map->tile_width  + p_map->grid.spacing;
+    step_y = (uint32_t)p_map->tile_height + p_map->grid.spacing;
+
+    if (((img_x % step_x) >= p_map->tile_width) || ((img_y % step_y) >= p_map->tile_height))
+        return false;
+
+    *p_map_x = img_x / step_x;
+    *p_map_y = img_y / step_y;
+
+    return (*p_map_x < p_map->width_in_tiles) && (*p_map_y < p_map->height_in_tiles);
+}
@@ -0,0 +1,24 @@
+//
+// tilemap_grid.h
+//
+
+#ifndef __TILEMAP_GRID_H_
+#define __TILEMAP_GRID_H_
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    #include "lib_tilemap.h"
+
+    #define GRID_MARGIN_NONE            0     // Tiles start at the upper left pixel
+    #define GRID_SPACING_NONE           0     // Tiles are packed edge to edge
+    #define GRID_SIZE_MAX               64    // Largest margin or spacing in pixels
+
+    int32_t  tile_grid_is_set(tile_grid_data * p_grid);
+    uint32_t tile_grid_get_count(uint32_t image_size, uint16_t tile_size, tile_grid_data * p_grid);
+    size_t   tile_grid_get_offset(image_data * p_src_img, tile_grid_data * p_grid,
+                                  uint16_t tile_width, uint16_t tile_height, uint32_t map_x, uint32_t map_y);
+    int32_t  tile_grid_find_cell(tile_map_data * p_map, uint32_t img_x, uint32_t img_y,
+                                 uint32_t * p_map_x, uint32_t * p_map_y);
+
+#endif
@@ -0,0 +1,200 @@
+//
+// tilemap_hash.c
+//
+
+// ========================
+//
+// Tile hash backends.
+//
+// Every tile in a tile set must be hashed with the same
+// function, so the backend gets resolved once when the
+// tile set is initialized (tile_set_data.hash_backend)
+// and processing calls it through a function pointer.
+//
+// TILE_HASH_AUTO picks hardware CRC32C when the CPU has
+// SSE4.2, and the multiply-mix hash otherwise.
+//
+// Backends can also have a row kernel that hashes a whole
+// row of map cells in place in the image, several tiles at
+// once. MurmurHash2 has one for AVX2 CPUs (its 32 bit
+// multiplies map directly onto vector lanes). CRC32C, the
+// auto choice, interleaves a few tiles so their crc32
+// chains overlap, for tile rows of whole 8 byte words.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "tilemap_hash.h"
+#include "hash.h"
+
+
+static uint64_t tile_hash_murmur2(const uint8_t * p_data, uint32_t size_bytes);
+static uint64_t tile_hash_crc32c(const uint8_t * p_data, uint32_t size_bytes);
+static uint64_t tile_hash_mulmix64(const uint8_t * p_data, uint32_t size_bytes);
+
+static void     tile_hash_row_murmur2_lanes(const uint8_t * p_src, uint32_t src_stride,
+                                            uint32_t tile_step_bytes,
+                                            uint32_t tile_width_bytes, uint32_t tile_height,
+                                            uint32_t tile_count, uint64_t * p_hashes);
+static void     tile_hash_row_crc32c(const uint8_t * p_src, uint32_t src_stride,
+                                     uint32_t tile_step_bytes,
+                                     uint32_t tile_width_bytes, uint32_t tile_height,
+                                     uint32_t tile_count, uint64_t * p_hashes);
+
+
+static const char * tile_hash_names[TILE_HASH_LAST] = {
+    "Auto",
+    "MurmurHash2",
+    "CRC32C",
+    "MulMix64"
+};
+
+static const tile_hash_func tile_hash_funcs[TILE_HASH_LAST] = {
+    NULL,
+    tile_hash_murmur2,
+    tile_hash_crc32c,
+    tile_hash_mulmix64
+};
+
+
+
+static uint64_t tile_hash_murmur2(const uint8_t * p_data, uint32_t size_bytes) {
+    return MurmurHash2(p_data, size_bytes, TILE_HASH_SEED);
+}
+
+static uint64_t tile_hash_crc32c(const uint8_t * p_data, uint32_t size_bytes) {
+    return crc32c_hash(p_data, size_bytes, TILE_HASH_SEED);
+}
+
+static uint64_t tile_hash_mulmix64(const uint8_t * p_data, uint32_t size_bytes) {
+    return mulmix64_hash(p_data, size_bytes, TILE_HASH_SEED);
+}
+
+
+
+// Hash a row of tiles MURMUR2_LANES_MAX at a time, one per lane
+static void tile_hash_row_murmur2_lanes(const uint8_t * p_src, uint32_t src_stride,
+                                        uint32_t tile_step_bytes,
+                                        uint32_t tile_width_bytes, uint32_t tile_height,
+                                        uint32_t tile_count, uint64_t * p_hashes) {
+
+    uint32_t lane_hashes[MURMUR2_LANES_MAX];
+    uint32_t t, c, count;
+
+    for (t = 0; t < tile_count; t += MURMUR2_LANES_MAX) {
+
+        count = tile_count - t;
+        if (count > MURMUR2_LANES_MAX)
+            count = MURMUR2_LANES_MAX;
+
+        MurmurHash2_lanes_strided(p_src + ((size_t)t * tile_step_bytes), src_stride,
+                                  tile_step_bytes, count,
+                                  tile_width_bytes, tile_height,
+                                  TILE_HASH_SEED, lane_hashes);
+
+        for (c = 0; c < count; c++)
+            p_hashes[t + c] = lane_hashes[c];
+    }
+}
+
+
+
+// Hash a row of tiles CRC32C_LANES at a time
+static void tile_hash_row_crc32c(const uint8_t * p_src, uint32_t src_stride,
+                                 uint32_t tile_step_bytes,
+                                 uint32_t tile_width_bytes, uint32_t tile_height,
+                                 uint32_t tile_count, uint64_t * p_hashes) {
+
+    crc32c_hash_strided(p_src, src_stride, tile_step_bytes, tile_count,
+                        tile_width_bytes, tile_height, TILE_HASH_SEED, p_hashes);
+}
+
+
+
+// Returns true if a backend can run on this CPU
+int32_t tile_hash_available(uint8_t backend) {
+
+    static int crc32c_supported = -1; // Checked on first use
+
+    switch (backend) {
+        case TILE_HASH_MURMUR2:
+        case TILE_HASH_MULMIX64:
+            return true;
+
+        case TILE_HASH_CRC32C:
+            if (crc32c_supported < 0)
+                crc32c_supported = hash_cpu_has_crc32c();
+            return crc32c_supported;
+
+        default:
+            return false;
+    }
+}
+
+
+
+// Turn a settings value into a concrete backend that can run here
+//
+// * TILE_HASH_AUTO and unavailable backends fall back
+//   to the fastest one the CPU supports
+uint8_t tile_hash_resolve(uint8_t backend) {
+
+    if ((backend != TILE_HASH_AUTO) && tile_hash_available(backend))
+        return backend;
+
+    if ((backend != TILE_HASH_AUTO) && (backend < TILE_HASH_LAST))
+        printf("Tile Hash: %s not supported on this CPU, using auto\n", tile_hash_names[backend]);
+
+    if (tile_hash_available(TILE_HASH_CRC32C))
+        return TILE_HASH_CRC32C;
+    else
+        return TILE_HASH_MULMIX64;
+}
+
+
+
+// Hash function for a backend (resolves TILE_HASH_AUTO)
+tile_hash_func tile_hash_get_func(uint8_t backend) {
+    return tile_hash_funcs[ tile_hash_resolve(backend) ];
+}
+
+
+
+// Row kernel for a backend (resolves TILE_HASH_AUTO)
+//
+// * Returns NULL if the backend has none, the CPU can't run it
+//   or it can't handle the tile width, hash per tile instead
+tile_hash_row_func tile_hash_get_row_func(uint8_t backend, uint32_t tile_width_bytes) {
+
+    static int avx2_supported = -1; // Checked on first use
+
+    uint8_t resolved;
+
+    if (avx2_supported < 0)
+        avx2_supported = hash_cpu_has_avx2();
+
+    resolved = tile_hash_resolve(backend);
+
+    // Lane kernel reads whole 32 bit words, lane offsets are 32 bit
+    if ((resolved == TILE_HASH_MURMUR2) && avx2_supported
+        && ((tile_width_bytes % 4) == 0) && (tile_width_bytes < (0x7FFFFFFF / MURMUR2_LANES_MAX)))
+        return tile_hash_row_murmur2_lanes;
+
+    // Reads whole 64 bit words (resolving only picks CRC32C if the CPU has it)
+    if ((resolved == TILE_HASH_CRC32C) && ((tile_width_bytes % 8) == 0))
+        return tile_hash_row_crc32c;
+
+    return NULL;
+}
+
+
+
+const char * tile_hash_get_name(uint8_t backend) {
+
+    if (backend < TILE_HASH_LAST)
+        return tile_hash_names[backend];
+    else
+        return "Unknown";
+}
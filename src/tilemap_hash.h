@@ -0,0 +1,38 @@
+//
+// tilemap_hash.h
+//
+
+#ifndef __TILEMAP_HASH_H_
+#define __TILEMAP_HASH_H_
+
+    #include <stdint.h>
+
+    #define TILE_HASH_SEED  0xF0A5
+
+    // Tile hash backends (settings value)
+    enum tile_hash_backends {
+        TILE_HASH_AUTO     = 0, // Fastest backend the CPU supports
+        TILE_HASH_MURMUR2  = 1, // MurmurHash2, 32 bit result
+        TILE_HASH_CRC32C   = 2, // Hardware CRC32C (SSE4.2), two 32 bit lanes
+        TILE_HASH_MULMIX64 = 3, // Wide multiply-mix, 64 bit
+        TILE_HASH_LAST
+    };
+
+    typedef uint64_t (* tile_hash_func)(const uint8_t * p_data, uint32_t size_bytes);
+
+    // Hashes tile_count tiles along a row straight from an image
+    // (tile n starts at p_src + n * tile_step_bytes, which is more
+    // than tile_width_bytes when there is spacing between tiles),
+    // same results as the backend's tile_hash_func on each copied out tile
+    typedef void (* tile_hash_row_func)(const uint8_t * p_src, uint32_t src_stride,
+                                        uint32_t tile_step_bytes,
+                                        uint32_t tile_width_bytes, uint32_t tile_height,
+                                        uint32_t tile_count, uint64_t * p_hashes);
+
+    uint8_t        tile_hash_resolve(uint8_t backend);
+    int32_t        tile_hash_available(uint8_t backend);
+    tile_hash_func tile_hash_get_func(uint8_t backend);
+    tile_hash_row_func tile_hash_get_row_func(uint8_t backend, uint32_t tile_width_bytes);
+    const char *   tile_hash_get_name(uint8_t backend);
+
+#endif
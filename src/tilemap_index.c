@@ -0,0 +1,337 @@
+//
+// tilemap_index.c
+//
+
+// ========================
+//
+// Lock-free concurrent tile index.
+//
+// An open addressing (linear probing) table of 64 bit
+// tile hashes that any number of threads can insert into
+// and look up in at the same time, without locks:
+//
+// * A slot is claimed by compare-and-swap of its key from
+//   empty to the new key. A thread that loses the race
+//   re-checks the winner's key and keeps probing if it
+//   differs.
+// * Each slot records the lowest item index (map cell)
+//   that inserted its key, via an atomic minimum. That
+//   value doesn't depend on which thread got there first.
+// * Which slot a key lands in can depend on thread timing,
+//   so slots aren't used as IDs directly. Once inserting
+//   is done, tile_index_assign_ids() numbers the keys in
+//   order of their lowest item, which is deterministic.
+//
+// The table doesn't grow, it's sized for the largest
+// possible key count up front (at most half full).
+//
+// Once the table is larger than the cache nearly every probe
+// is a cache miss. The batched calls take a whole run of keys
+// (e.g. one row of map cells) and prefetch the start slot of
+// keys further ahead while resolving the current one, so the
+// misses overlap instead of being paid one at a time.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_index.h"
+
+
+// Lowest item + slot, sorted to number the keys
+typedef struct {
+    uint32_t first;
+    uint32_t slot;
+} index_order_entry;
+
+
+
+static inline uint32_t index_slot_start(tile_index * p_index, uint64_t key) {
+
+    // Hashes can be 32 bit (MurmurHash2), so fold the upper half in
+    return (uint32_t)(key ^ (key >> 32)) & (p_index->slot_count - 1);
+}
+
+
+
+// Start fetching a key's first probe slot into the cache
+static inline void index_prefetch(tile_index * p_index, uint64_t key, int32_t for_insert) {
+
+    uint32_t slot;
+
+    if (key == TILE_INDEX_KEY_EMPTY)
+        return;
+
+    slot = index_slot_start(p_index, key);
+
+    if (for_insert) {
+        __builtin_prefetch(&p_index->p_keys[slot], 1);
+        __builtin_prefetch(&p_index->p_first[slot], 1);
+    } else
+        __builtin_prefetch(&p_index->p_keys[slot], 0);
+}
+
+
+
+// Lower a slot's first item to "item" if that's smaller
+static inline void index_first_min(uint32_t * p_first, uint32_t item) {
+
+    uint32_t cur = __atomic_load_n(p_first, __ATOMIC_RELAXED);
+
+    while ((item < cur) &&
+           !__atomic_compare_exchange_n(p_first, &cur, item, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ; // cur was reloaded by the failed exchange
+}
+
+
+
+// Allocate an empty index with room for key_capacity distinct keys
+int32_t tile_index_init(tile_index * p_index, uint32_t key_capacity) {
+
+    uint32_t slot_count;
+
+    memset(p_index, 0x00, sizeof(tile_index));
+
+    // Keep the load at or below 1/2 so probe runs stay short
+    slot_count = 16;
+    while ((slot_count / 2) < key_capacity) {
+        if (slot_count >= 0x80000000u)
+            return false;
+        slot_count *= 2;
+    }
+
+    // One extra slot at the end for key 0
+    p_index->p_keys  = malloc(((size_t)slot_count + 1) * sizeof(uint64_t));
+    p_index->p_first = malloc(((size_t)slot_count + 1) * sizeof(uint32_t));
+
+    if (!(p_index->p_keys && p_index->p_first)) {
+        tile_index_free(p_index);
+        return false;
+    }
+
+    memset(p_index->p_keys,  0x00, ((size_t)slot_count + 1) * sizeof(uint64_t));
+    memset(p_index->p_first, 0xFF, ((size_t)slot_count + 1) * sizeof(uint32_t));
+    p_index->slot_count = slot_count;
+
+    return true;
+}
+
+
+
+void tile_index_free(tile_index * p_index) {
+
+    if (p_index->p_keys)
+        free(p_index->p_keys);
+    if (p_index->p_first)
+        free(p_index->p_first);
+    if (p_index->p_ids)
+        free(p_index->p_ids);
+
+    memset(p_index, 0x00, sizeof(tile_index));
+}
+
+
+
+// Insert a key on behalf of an item (safe to call from many threads)
+//
+// * Item indexes must be unique per insert (e.g. one insert per map cell)
+// * Returns the key's slot, TILE_INDEX_NOT_FOUND if the table is full
+// * Inserting a key that's present only lowers its first item
+uint32_t tile_index_insert(tile_index * p_index, uint64_t key, uint32_t item) {
+
+    uint32_t slot, probes;
+    uint64_t cur;
+
+    if (key == TILE_INDEX_KEY_EMPTY) {
+        __atomic_store_n(&p_index->zero_used, true, __ATOMIC_RELAXED);
+        index_first_min(&p_index->p_first[p_index->slot_count], item);
+        return p_index->slot_count;
+    }
+
+    slot = index_slot_start(p_index, key);
+
+    for (probes = 0; probes < p_index->slot_count; probes++) {
+
+        cur = __atomic_load_n(&p_index->p_keys[slot], __ATOMIC_ACQUIRE);
+
+        if (cur == TILE_INDEX_KEY_EMPTY) {
+            // Claim the slot. If another thread beat us to it,
+            // cur now holds its key and gets checked below
+            if (__atomic_compare_exchange_n(&p_index->p_keys[slot], &cur, key, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_fetch_add(&p_index->used_count, 1, __ATOMIC_RELAXED);
+                cur = key;
+            }
+        }
+
+        if (cur == key) {
+            index_first_min(&p_index->p_first[slot], item);
+            return slot;
+        }
+
+        slot = (slot + 1) & (p_index->slot_count - 1);
+    }
+
+    return TILE_INDEX_NOT_FOUND;
+}
+
+
+
+// Look up a key's slot (safe to call while other threads insert)
+//
+// * Returns TILE_INDEX_NOT_FOUND if the key isn't present
+uint32_t tile_index_find(tile_index * p_index, uint64_t key) {
+
+    uint32_t slot, probes;
+    uint64_t cur;
+
+    if (key == TILE_INDEX_KEY_EMPTY)
+        return __atomic_load_n(&p_index->zero_used, __ATOMIC_RELAXED) ? p_index->slot_count : TILE_INDEX_NOT_FOUND;
+
+    slot = index_slot_start(p_index, key);
+
+    for (probes = 0; probes < p_index->slot_count; probes++) {
+
+        cur = __atomic_load_n(&p_index->p_keys[slot], __ATOMIC_ACQUIRE);
+
+        if (cur == key)
+            return slot;
+        else if (cur == TILE_INDEX_KEY_EMPTY)
+            break;
+
+        slot = (slot + 1) & (p_index->slot_count - 1);
+    }
+
+    return TILE_INDEX_NOT_FOUND;
+}
+
+
+
+// Insert a run of keys, key c on behalf of item first_item + c,
+// writing each key's slot to p_slots[c]
+//
+// * Same result as calling tile_index_insert() for each key in order
+// * Returns false if the table filled up (those slots are TILE_INDEX_NOT_FOUND)
+int32_t tile_index_insert_batch(tile_index * p_index, const uint64_t * p_keys, uint32_t count,
+                                uint32_t first_item, uint32_t * p_slots) {
+
+    uint32_t c;
+    int32_t  status;
+
+    status = true;
+
+    for (c = 0; (c < count) && (c < TILE_INDEX_PREFETCH_AHEAD); c++)
+        index_prefetch(p_index, p_keys[c], true);
+
+    for (c = 0; c < count; c++) {
+
+        if ((c + TILE_INDEX_PREFETCH_AHEAD) < count)
+            index_prefetch(p_index, p_keys[c + TILE_INDEX_PREFETCH_AHEAD], true);
+
+        p_slots[c] = tile_index_insert(p_index, p_keys[c], first_item + c);
+        if (p_slots[c] == TILE_INDEX_NOT_FOUND)
+            status = false;
+    }
+
+    return status;
+}
+
+
+
+// Look up a run of keys, writing each key's slot
+// (or TILE_INDEX_NOT_FOUND) to p_slots[c]
+void tile_index_find_batch(tile_index * p_index, const uint64_t * p_keys, uint32_t count, uint32_t * p_slots) {
+
+    uint32_t c;
+
+    for (c = 0; (c < count) && (c < TILE_INDEX_PREFETCH_AHEAD); c++)
+        index_prefetch(p_index, p_keys[c], false);
+
+    for (c = 0; c < count; c++) {
+
+        if ((c + TILE_INDEX_PREFETCH_AHEAD) < count)
+            index_prefetch(p_index, p_keys[c + TILE_INDEX_PREFETCH_AHEAD], false);
+
+        p_slots[c] = tile_index_find(p_index, p_keys[c]);
+    }
+}
+
+
+
+// Lowest item that inserted the key in a slot
+// (final once all inserting threads are done)
+uint32_t tile_index_get_first(tile_index * p_index, uint32_t slot) {
+
+    return __atomic_load_n(&p_index->p_first[slot], __ATOMIC_RELAXED);
+}
+
+
+
+static int index_order_compare(const void * p_a, const void * p_b) {
+
+    const index_order_entry * p_ea = p_a;
+    const index_order_entry * p_eb = p_b;
+
+    return (p_ea->first > p_eb->first) - (p_ea->first < p_eb->first);
+}
+
+
+
+// Number the keys 0..n-1 in order of their lowest item
+//
+// * Call once all inserting threads are done
+// * Returns the key count, or TILE_INDEX_NOT_FOUND on allocation failure
+uint32_t tile_index_assign_ids(tile_index * p_index) {
+
+    uint32_t            slot, count, c;
+    index_order_entry * p_order;
+
+    p_order = malloc(((size_t)p_index->used_count + 1) * sizeof(index_order_entry));
+    if (!p_index->p_ids)
+        p_index->p_ids = malloc(((size_t)p_index->slot_count + 1) * sizeof(uint32_t));
+
+    if (!(p_order && p_index->p_ids)) {
+        free(p_order);
+        return TILE_INDEX_NOT_FOUND;
+    }
+
+    memset(p_index->p_ids, 0xFF, ((size_t)p_index->slot_count + 1) * sizeof(uint32_t));
+
+    count = 0;
+    for (slot = 0; slot < p_index->slot_count; slot++)
+        if (p_index->p_keys[slot] != TILE_INDEX_KEY_EMPTY) {
+            p_order[count].first = p_index->p_first[slot];
+            p_order[count].slot  = slot;
+            count++;
+        }
+
+    if (p_index->zero_used) {
+        p_order[count].first = p_index->p_first[p_index->slot_count];
+        p_order[count].slot  = p_index->slot_count;
+        count++;
+    }
+
+    // Lowest items are distinct per key, so the order is unique
+    qsort(p_order, count, sizeof(index_order_entry), index_order_compare);
+
+    for (c = 0; c < count; c++)
+        p_index->p_ids[p_order[c].slot] = c;
+
+    free(p_order);
+
+    return count;
+}
+
+
+
+// ID of the key in a slot (after tile_index_assign_ids())
+uint32_t tile_index_get_id(tile_index * p_index, uint32_t slot) {
+
+    if (!p_index->p_ids || (slot > p_index->slot_count))
+        return TILE_INDEX_NOT_FOUND;
+
+    return p_index->p_ids[slot];
+}
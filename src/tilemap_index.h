@@ -0,0 +1,43 @@
+//
+// tilemap_index.h
+//
+
+#ifndef __TILEMAP_INDEX_H_
+#define __TILEMAP_INDEX_H_
+
+    #include <stdint.h>
+
+    #define TILE_INDEX_KEY_EMPTY    0           // Unused slot (key 0 lives in its own slot)
+    #define TILE_INDEX_FIRST_NONE   0xFFFFFFFF
+    #define TILE_INDEX_NOT_FOUND    0xFFFFFFFF
+    #define TILE_INDEX_PREFETCH_AHEAD  16       // Batched calls prefetch this many keys ahead of the one they resolve
+
+    // Lock-free open addressing table of 64 bit tile hashes
+    //
+    // Slots [0 .. slot_count - 1] are probed, slot_count is
+    // reserved for key 0. Each slot keeps the lowest item
+    // index (e.g. map cell) that inserted its key.
+    typedef struct {
+        uint64_t * p_keys;
+        uint32_t * p_first;      // Lowest inserting item per slot
+        uint32_t * p_ids;        // Per slot IDs from tile_index_assign_ids() (NULL before)
+        uint32_t   slot_count;   // Power of two
+        uint32_t   used_count;   // Keys present (updated atomically)
+        uint32_t   zero_used;    // Key 0 present
+    } tile_index;
+
+    int32_t  tile_index_init(tile_index * p_index, uint32_t key_capacity);
+    void     tile_index_free(tile_index * p_index);
+
+    uint32_t tile_index_insert(tile_index * p_index, uint64_t key, uint32_t item);
+    uint32_t tile_index_find(tile_index * p_index, uint64_t key);
+
+    int32_t  tile_index_insert_batch(tile_index * p_index, const uint64_t * p_keys, uint32_t count,
+                                     uint32_t first_item, uint32_t * p_slots);
+    void     tile_index_find_batch(tile_index * p_index, const uint64_t * p_keys, uint32_t count, uint32_t * p_slots);
+    uint32_t tile_index_get_first(tile_index * p_index, uint32_t slot);
+
+    uint32_t tile_index_assign_ids(tile_index * p_index);
+    uint32_t tile_index_get_id(tile_index * p_index, uint32_t slot);
+
+#endif
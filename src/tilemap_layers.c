@@ -0,0 +1,397 @@
+//
+// tilemap_layers.c
+//
+
+// ========================
+//
+// All-layers mode: builds one tile map per layer,
+// every layer deduplicated against a single shared
+// tile set.
+//
+// Layers are handed over one at a time by the caller
+// (which fetches them from GIMP on the main thread)
+// while a worker thread hashes and registers the tiles
+// of the layers already submitted, so fetching and
+// processing overlap. Layers are processed strictly in
+// submission order, which keeps tile IDs deterministic.
+//
+// The run's state lives in the context (tilemap_ctx.layers),
+// so separate contexts can run all-layers mode at the same
+// time. The tilemap_layers_*() calls use the default context.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "tilemap_layers.h"
+#include "tilemap_reduce.h"
+#include "tilemap_subpal.h"
+#include "tilemap_window.h"
+#include "tilemap_rooms.h"
+#include "tilemap_metatile.h"
+
+#include "benchmark.h"
+
+
+static void   layer_process(tilemap_ctx * p_ctx, layer_map_data * p_layer);
+static void   layer_count_used(layer_map_data * p_layer, uint32_t tile_count);
+static void * layers_worker_run(void * p_arg);
+
+
+
+// Count unique tiles referenced by a layer's (unpacked) map
+static void layer_count_used(layer_map_data * p_layer, uint32_t tile_count) {
+
+    uint32_t   c;
+    uint8_t  * p_used;
+
+    p_layer->tiles_used = 0;
+    p_used = calloc(tile_count, sizeof(uint8_t));
+
+    if (p_used) {
+        for (c = 0; c < p_layer->map.size; c++) {
+            if (!p_used[ p_layer->map.tile_id_list[c] ]) {
+                p_used[ p_layer->map.tile_id_list[c] ] = true;
+                p_layer->tiles_used++;
+            }
+        }
+        free(p_used);
+    }
+}
+
+
+
+// Build the tile map for one layer against the shared tile set
+static void layer_process(tilemap_ctx * p_ctx, layer_map_data * p_layer) {
+
+    tile_layers_data * p_layers;
+    tile_set_data    * p_tile_set;
+    uint32_t           tile_count_before;
+
+    p_layers   = &p_ctx->layers;
+    p_tile_set = tilemap_ctx_get_tile_set(p_ctx);
+    tile_count_before = p_tile_set->tile_count;
+
+    printf("Layers: Processing layer %d \"%s\"\n", p_layer->layer_id, p_layer->name);
+
+    if (p_layers->failed)
+        p_layer->status = false;
+    else
+        p_layer->status = tilemap_map_initialize(&p_layer->map, &p_layer->img,
+                                                 p_layers->tile_width, p_layers->tile_height,
+                                                 &p_tile_set->grid, p_layers->search_mask)
+                          && tilemap_ctx_process_tiles_to_map(p_ctx, &p_layer->img, &p_layer->map);
+
+    if (p_layer->status) {
+
+        p_layer->tiles_new = p_tile_set->tile_count - tile_count_before;
+        layer_count_used(p_layer, p_tile_set->tile_count);
+    }
+    else {
+        // A failed layer leaves the shared tile set incomplete, so later
+        // layers are skipped. It gets released once the worker is done.
+        p_layers->failed = true;
+        tilemap_map_free(&p_layer->map);
+    }
+
+    // Tiles are copied into the tile set, layer pixels are no longer needed
+    if (p_layer->img.p_img_data)
+        free(p_layer->img.p_img_data);
+    p_layer->img.p_img_data = NULL;
+}
+
+
+
+static void * layers_worker_run(void * p_arg) {
+
+    tilemap_ctx      * p_ctx = p_arg;
+    tile_layers_data * p_layers = &p_ctx->layers;
+    uint32_t           index;
+
+    while (true) {
+
+        pthread_mutex_lock(&p_layers->lock);
+
+        while ((p_layers->done == p_layers->count) && !p_layers->closed)
+            pthread_cond_wait(&p_layers->cond, &p_layers->lock);
+
+        if (p_layers->done == p_layers->count) {
+            // Closed and nothing left to do
+            pthread_mutex_unlock(&p_layers->lock);
+            break;
+        }
+
+        index = p_layers->done;
+        pthread_mutex_unlock(&p_layers->lock);
+
+        layer_process(p_ctx, &p_layers->layers[index]);
+
+        pthread_mutex_lock(&p_layers->lock);
+        p_layers->done++;
+        pthread_mutex_unlock(&p_layers->lock);
+    }
+
+    return NULL;
+}
+
+
+
+// Start an all-layers run: resets the shared tile set and starts the worker
+//
+// * p_format_img: image with the size and bit depth all layers must share
+// * Tiles always keep private pixel copies in this mode (TILE_STORAGE_COPY),
+//   since there is no single source image for them to reference
+int32_t tilemap_ctx_layers_begin(tilemap_ctx * p_ctx, image_data * p_format_img,
+                                 int tile_width, int tile_height, int check_flip) {
+
+    tile_layers_data * p_layers = &p_ctx->layers;
+
+    tilemap_ctx_layers_free(p_ctx);
+
+    if ( ! tilemap_check_grid_dimensions_valid(p_format_img, tile_width, tile_height, &p_ctx->grid) ) {
+        printf("Layers: Begin: tilemap_check_grid_dimensions_valid: failed\n" );
+        return false;
+    }
+
+    memcpy(&p_layers->format, p_format_img, sizeof(image_data));
+    p_layers->format.p_img_data = NULL;
+
+    p_layers->tile_width  = tile_width;
+    p_layers->tile_height = tile_height;
+    p_layers->search_mask = (check_flip) ? TILE_FLIP_BITS_XY : TILE_FLIP_BITS_NONE;
+
+    tilemap_ctx_tile_set_initialize(p_ctx, &p_layers->format, tile_width, tile_height, p_layers->search_mask);
+    tilemap_ctx_get_tile_set(p_ctx)->storage_mode = TILE_STORAGE_COPY;
+
+    // Every layer maps against the locked base tiles (if any)
+    if ( ! tilemap_ctx_base_apply(p_ctx, p_layers->search_mask) ) {
+        printf("Layers: Begin: tilemap_ctx_base_apply: failed\n" );
+        return false;
+    }
+
+    p_layers->count  = 0;
+    p_layers->done   = 0;
+    p_layers->closed = false;
+    p_layers->failed = false;
+
+printf("Layers: Start -> Process..  ");
+benchmark_start();
+
+    // If the worker can't be started, layers get processed as they are submitted
+    pthread_mutex_init(&p_layers->lock, NULL);
+    pthread_cond_init(&p_layers->cond, NULL);
+    p_layers->worker_running = (pthread_create(&p_layers->worker, NULL, layers_worker_run, p_ctx) == 0);
+
+    if (!p_layers->worker_running) {
+        pthread_cond_destroy(&p_layers->cond);
+        pthread_mutex_destroy(&p_layers->lock);
+    }
+
+    return true;
+}
+
+
+
+// Queue a layer for processing, takes ownership of p_layer_img->p_img_data
+//
+// Returns false (and releases the pixels) if the layer doesn't
+// match the size and bit depth of the run, or there are too many layers
+int32_t tilemap_ctx_layers_submit(tilemap_ctx * p_ctx, image_data * p_layer_img, int32_t layer_id, const char * p_name) {
+
+    tile_layers_data * p_layers = &p_ctx->layers;
+    layer_map_data   * p_layer;
+
+    if ((p_layers->count >= LAYERS_MAX) ||
+        (p_layer_img->width           != p_layers->format.width) ||
+        (p_layer_img->height          != p_layers->format.height) ||
+        (p_layer_img->bytes_per_pixel != p_layers->format.bytes_per_pixel)) {
+
+        printf("Layers: Skipping layer %d (size, bit depth or count mismatch)\n", layer_id);
+        if (p_layer_img->p_img_data)
+            free(p_layer_img->p_img_data);
+        p_layer_img->p_img_data = NULL;
+        return false;
+    }
+
+    p_layer = &p_layers->layers[p_layers->count];
+
+    memset(p_layer, 0x00, sizeof(layer_map_data));
+    memcpy(&p_layer->img, p_layer_img, sizeof(image_data));
+    p_layer->layer_id = layer_id;
+    strncpy(p_layer->name, (p_name) ? p_name : "", LAYER_NAME_MAX_LEN);
+    p_layer->name[LAYER_NAME_MAX_LEN] = '\0';
+
+    p_layer_img->p_img_data = NULL; // Ownership moved to the layer
+
+    if (p_layers->worker_running) {
+        pthread_mutex_lock(&p_layers->lock);
+        p_layers->count++;
+        pthread_cond_signal(&p_layers->cond);
+        pthread_mutex_unlock(&p_layers->lock);
+    }
+    else {
+        p_layers->count++;
+        layer_process(p_ctx, p_layer);
+        p_layers->done++;
+    }
+
+    return true;
+}
+
+
+
+// Wait for all submitted layers, then publish the map of the
+// active layer (or the first one) as the main tile map for
+// preview, overlay and export
+int32_t tilemap_ctx_layers_finish(tilemap_ctx * p_ctx, int32_t active_layer_id) {
+
+    tile_layers_data * p_layers = &p_ctx->layers;
+    tile_set_data    * p_tile_set;
+    uint32_t           c;
+    layer_map_data   * p_active;
+    tile_map_data    * p_map;
+    tile_map_data    * p_layer_maps[LAYERS_MAX];
+
+    if (p_layers->worker_running) {
+        pthread_mutex_lock(&p_layers->lock);
+        p_layers->closed = true;
+        pthread_cond_signal(&p_layers->cond);
+        pthread_mutex_unlock(&p_layers->lock);
+
+        pthread_join(p_layers->worker, NULL);
+        p_layers->worker_running = false;
+
+        pthread_cond_destroy(&p_layers->cond);
+        pthread_mutex_destroy(&p_layers->lock);
+    }
+
+benchmark_elapsed();
+benchmark_slot_printall();
+
+    if (p_layers->failed || (p_layers->count == 0)) {
+        tilemap_ctx_free_resources(p_ctx);
+        return false;
+    }
+
+    p_tile_set = tilemap_ctx_get_tile_set(p_ctx);
+
+    // Optionally merge similar tiles of the shared set, every layer's map follows
+    for (c = 0; c < p_layers->count; c++)
+        p_layer_maps[c] = &p_layers->layers[c].map;
+
+    if (!tilemap_reduce_tile_set_maps(p_layer_maps, p_layers->count, p_tile_set,
+                                      tilemap_ctx_color_data_get(p_ctx), p_ctx->reduce_target_count))
+        return false;
+
+    // Reduction may have merged tiles within a layer
+    if (p_tile_set->tile_count_unreduced)
+        for (c = 0; c < p_layers->count; c++)
+            layer_count_used(&p_layers->layers[c], p_tile_set->tile_count);
+
+    // Shared tile set is final now, fit it into the target's sub-palettes
+    if (!tilemap_subpal_solve(p_tile_set, tilemap_ctx_color_data_get(p_ctx),
+                              p_ctx->subpal_count, p_ctx->subpal_colors))
+        return false;
+
+    // Viewport residency of each layer's map
+    for (c = 0; c < p_layers->count; c++)
+        if (!tilemap_window_calc(&p_layers->layers[c].map, p_ctx->window_width, p_ctx->window_height))
+            return false;
+
+    // Metatiles of each layer's map (per layer, blocks don't mix layers)
+    for (c = 0; c < p_layers->count; c++)
+        if (!tilemap_metatile_calc(&p_layers->layers[c].map, p_ctx->metatile_width, p_ctx->metatile_height))
+            return false;
+
+    // Shared tile count is final now, pack every layer's map
+    for (c = 0; c < p_layers->count; c++)
+        if (!tilemap_map_pack(&p_layers->layers[c].map, p_tile_set->tile_count, p_ctx->map_rle_enabled))
+            return false;
+
+    p_active = &p_layers->layers[0];
+    for (c = 0; c < p_layers->count; c++)
+        if (p_layers->layers[c].layer_id == active_layer_id)
+            p_active = &p_layers->layers[c];
+
+    // Main map gets its own copy so it can be released independently
+    p_map = tilemap_ctx_get_map(p_ctx);
+    tilemap_map_free(p_map);
+
+    if (!tilemap_map_copy(p_map, &p_active->map)) {
+        tilemap_map_free(p_map);
+        return false;
+    }
+
+    // Rooms follow the published map
+    if (!tilemap_rooms_calc(tilemap_ctx_get_rooms(p_ctx), p_map, p_tile_set->tile_count,
+                            p_ctx->room_width, p_ctx->room_height))
+        return false;
+
+    printf("Layers: %d layers, %d shared tiles\n", p_layers->count, p_tile_set->tile_count);
+
+    tilemap_ctx_recalc_clear_flag(p_ctx);
+    return true;
+}
+
+
+
+uint32_t tilemap_ctx_layers_get_count(tilemap_ctx * p_ctx) {
+    return p_ctx->layers.count;
+}
+
+
+
+layer_map_data * tilemap_ctx_layers_get(tilemap_ctx * p_ctx, uint32_t index) {
+
+    if (index < p_ctx->layers.count)
+        return &p_ctx->layers.layers[index];
+    else
+        return NULL;
+}
+
+
+
+void tilemap_ctx_layers_free(tilemap_ctx * p_ctx) {
+
+    tile_layers_data * p_layers = &p_ctx->layers;
+    uint32_t           c;
+
+    for (c = 0; c < p_layers->count; c++) {
+        tilemap_map_free(&p_layers->layers[c].map);
+
+        if (p_layers->layers[c].img.p_img_data)
+            free(p_layers->layers[c].img.p_img_data);
+        p_layers->layers[c].img.p_img_data = NULL;
+    }
+
+    p_layers->count = 0;
+    p_layers->done  = 0;
+}
+
+
+
+// ========================
+//
+// Default context wrappers
+//
+// ========================
+
+int32_t tilemap_layers_begin(image_data * p_format_img, int tile_width, int tile_height, int check_flip) {
+    return tilemap_ctx_layers_begin(tilemap_ctx_get_default(), p_format_img, tile_width, tile_height, check_flip);
+}
+
+int32_t tilemap_layers_submit(image_data * p_layer_img, int32_t layer_id, const char * p_name) {
+    return tilemap_ctx_layers_submit(tilemap_ctx_get_default(), p_layer_img, layer_id, p_name);
+}
+
+int32_t tilemap_layers_finish(int32_t active_layer_id) {
+    return tilemap_ctx_layers_finish(tilemap_ctx_get_default(), active_layer_id);
+}
+
+uint32_t         tilemap_layers_get_count(void)     { return tilemap_ctx_layers_get_count(tilemap_ctx_get_default()); }
+layer_map_data * tilemap_layers_get(uint32_t index) { return tilemap_ctx_layers_get(tilemap_ctx_get_default(), index); }
+
+void tilemap_layers_free(void) { tilemap_ctx_layers_free(tilemap_ctx_get_default()); }
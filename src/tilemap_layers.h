@@ -0,0 +1,34 @@
+//
+// tilemap_layers.h
+//
+
+#ifndef __TILEMAP_LAYERS_H_
+#define __TILEMAP_LAYERS_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    int32_t          tilemap_ctx_layers_begin(tilemap_ctx * p_ctx, image_data * p_format_img,
+                                              int tile_width, int tile_height, int check_flip);
+    int32_t          tilemap_ctx_layers_submit(tilemap_ctx * p_ctx, image_data * p_layer_img,
+                                               int32_t layer_id, const char * p_name);
+    int32_t          tilemap_ctx_layers_finish(tilemap_ctx * p_ctx, int32_t active_layer_id);
+
+    uint32_t         tilemap_ctx_layers_get_count(tilemap_ctx * p_ctx);
+    layer_map_data * tilemap_ctx_layers_get(tilemap_ctx * p_ctx, uint32_t index);
+
+    void             tilemap_ctx_layers_free(tilemap_ctx * p_ctx);
+
+
+    // Default context
+    int32_t          tilemap_layers_begin(image_data * p_format_img, int tile_width, int tile_height, int check_flip);
+    int32_t          tilemap_layers_submit(image_data * p_layer_img, int32_t layer_id, const char * p_name);
+    int32_t          tilemap_layers_finish(int32_t active_layer_id);
+
+    uint32_t         tilemap_layers_get_count(void);
+    layer_map_data * tilemap_layers_get(uint32_t index);
+
+    void             tilemap_layers_free(void);
+
+#endif
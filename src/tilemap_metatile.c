@@ -0,0 +1,384 @@
+//
+// tilemap_metatile.c
+//
+
+// ========================
+//
+// Metatile (block) dedupe, a second pass over a processed map.
+//
+// Many engines store maps as 2x2 or 4x4 blocks of tiles
+// ("metatiles") and the level data as a map of those. The
+// map gets cut into block_width x block_height blocks of
+// entries (tile ID + attribs), equal blocks share one
+// metatile, giving a metatile table (the entries of each
+// unique block) and a metatile map (one ID per block).
+//
+// Blocks are only a few small integers, so they don't need
+// the pixel hashing of the first pass:
+//
+// * When an entry fits in few enough bits that a whole
+//   block fits in 64, the block key is just its entries
+//   packed together. Keys are exact, so equal keys are
+//   equal blocks.
+// * Larger blocks get hashed (MULMIX64). Every block is
+//   then checked against the first block with its key, a
+//   collision drops the result instead of merging blocks
+//   that differ.
+//
+// Keys go into the same lock-free index as the concurrent
+// tile engine, one row of blocks per pool task. Metatile
+// IDs come out in order of first use, scanning the blocks
+// row-major.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_metatile.h"
+#include "tilemap_hash.h"
+#include "tilemap_index.h"
+#include "tilemap_pool.h"
+
+#include "benchmark.h"
+
+
+typedef struct {
+    tile_metatile_data * p_meta;
+    const uint32_t     * p_ids;        // Map tile IDs, row-major
+    const uint16_t     * p_attribs;    // Map attribs, row-major
+    uint32_t             stride;       // Map width in tiles
+    uint32_t             id_bits;      // Exact keys: entry = id | attribs << id_bits
+    tile_hash_func       hash_func;    // NULL for exact keys
+    tile_index         * p_index;
+    uint64_t           * p_keys;       // Per block
+    uint32_t           * p_slots;      // Per block: index slot of its key
+    uint32_t             failed;       // Index filled up, updated atomically
+    uint32_t             mismatches;   // Hashed blocks unequal to the first with their key, updated atomically
+} metatile_job;
+
+
+static uint64_t metatile_block_key(metatile_job * p_job, uint32_t block);
+static int32_t  metatile_block_equal(metatile_job * p_job, uint32_t block_a, uint32_t block_b);
+static void     metatile_key_task(void * p_arg, uint32_t row, uint32_t worker);
+static void     metatile_map_task(void * p_arg, uint32_t row, uint32_t worker);
+
+
+
+// Map cell of entry n of a block
+static inline size_t metatile_block_cell(metatile_job * p_job, uint32_t block, uint32_t n) {
+
+    tile_metatile_data * p_meta = p_job->p_meta;
+
+    return ((size_t)((block / p_meta->width_in_blocks) * p_meta->block_height + (n / p_meta->block_width))
+            * p_job->stride)
+           + ((block % p_meta->width_in_blocks) * p_meta->block_width) + (n % p_meta->block_width);
+}
+
+
+
+static uint64_t metatile_block_key(metatile_job * p_job, uint32_t block) {
+
+    uint32_t words[METATILE_ENTRIES_MAX * 2];
+    uint32_t n, entries;
+    uint64_t key;
+    size_t   cell;
+
+    entries = p_job->p_meta->block_width * p_job->p_meta->block_height;
+
+    if (!p_job->hash_func) {
+        key = 0;
+        for (n = 0; n < entries; n++) {
+            cell = metatile_block_cell(p_job, block, n);
+            key  = (key << p_job->p_meta->key_bits)
+                   | p_job->p_ids[cell] | ((uint64_t)p_job->p_attribs[cell] << p_job->id_bits);
+        }
+        return key;
+    }
+
+    for (n = 0; n < entries; n++) {
+        cell             = metatile_block_cell(p_job, block, n);
+        words[n * 2]     = p_job->p_ids[cell];
+        words[n * 2 + 1] = p_job->p_attribs[cell];
+    }
+
+    return p_job->hash_func((const uint8_t *)words, entries * 2 * sizeof(uint32_t));
+}
+
+
+
+static int32_t metatile_block_equal(metatile_job * p_job, uint32_t block_a, uint32_t block_b) {
+
+    uint32_t n, entries;
+    size_t   cell_a, cell_b;
+
+    entries = p_job->p_meta->block_width * p_job->p_meta->block_height;
+
+    for (n = 0; n < entries; n++) {
+        cell_a = metatile_block_cell(p_job, block_a, n);
+        cell_b = metatile_block_cell(p_job, block_b, n);
+
+        if ((p_job->p_ids[cell_a] != p_job->p_ids[cell_b])
+            || (p_job->p_attribs[cell_a] != p_job->p_attribs[cell_b]))
+            return false;
+    }
+
+    return true;
+}
+
+
+
+// Pool task: keys of one row of blocks, inserted into the index as a batch
+static void metatile_key_task(void * p_arg, uint32_t row, uint32_t worker) {
+
+    metatile_job * p_job = (metatile_job *)p_arg;
+    uint32_t       block, bx;
+
+    (void)worker;
+
+    block = row * p_job->p_meta->width_in_blocks;
+    for (bx = 0; bx < p_job->p_meta->width_in_blocks; bx++)
+        p_job->p_keys[block + bx] = metatile_block_key(p_job, block + bx);
+
+    if (!tile_index_insert_batch(p_job->p_index, &p_job->p_keys[block], p_job->p_meta->width_in_blocks,
+                                 block, &p_job->p_slots[block]))
+        __atomic_store_n(&p_job->failed, true, __ATOMIC_RELAXED);
+}
+
+
+
+// Pool task: metatile IDs of one row of blocks, first blocks fill the table
+static void metatile_map_task(void * p_arg, uint32_t row, uint32_t worker) {
+
+    metatile_job       * p_job  = (metatile_job *)p_arg;
+    tile_metatile_data * p_meta = p_job->p_meta;
+    uint32_t             block, bx, id, first, n, entries;
+    size_t               cell;
+
+    (void)worker;
+
+    entries = p_meta->block_width * p_meta->block_height;
+
+    for (bx = 0; bx < p_meta->width_in_blocks; bx++) {
+        block = (row * p_meta->width_in_blocks) + bx;
+        id    = tile_index_get_id(p_job->p_index, p_job->p_slots[block]);
+        first = tile_index_get_first(p_job->p_index, p_job->p_slots[block]);
+
+        p_meta->p_map[block] = id;
+
+        if (first == block) {
+            // Only one block per ID gets here, so table rows have a single writer
+            for (n = 0; n < entries; n++) {
+                cell = metatile_block_cell(p_job, block, n);
+                p_meta->p_table_ids[(size_t)id * entries + n]     = p_job->p_ids[cell];
+                p_meta->p_table_attribs[(size_t)id * entries + n] = p_job->p_attribs[cell];
+            }
+        }
+        else if (p_job->hash_func && !metatile_block_equal(p_job, block, first))
+            __atomic_fetch_add(&p_job->mismatches, 1, __ATOMIC_RELAXED);
+    }
+}
+
+
+
+// Find the unique block_width x block_height blocks of a processed map,
+// building a metatile table and a metatile map
+//
+// * Reads tile_id_list / tile_attribs_list when present (before packing),
+//   otherwise decodes the packed or RLE entries first
+// * The map size has to be a multiple of the block size, otherwise
+//   nothing gets built (count stays 0)
+// * block_width or block_height METATILE_SIZE_NONE: clears any previous result
+int32_t tilemap_metatile_calc(tile_map_data * p_map, uint16_t block_width, uint16_t block_height) {
+
+    tile_metatile_data * p_meta;
+    metatile_job         job;
+    tile_index           index;
+    tile_map_iter        iter;
+    uint32_t           * p_ids_decoded;
+    uint16_t           * p_attribs_decoded;
+    uint32_t             c, id_max, attribs_max, attrib_bits, entries, block_count;
+    int32_t              status;
+
+    p_meta = &p_map->metatiles;
+    tilemap_metatile_free(p_meta);
+
+    if ((block_width == METATILE_SIZE_NONE) || (block_height == METATILE_SIZE_NONE)
+        || (p_map->width_in_tiles == 0) || (p_map->height_in_tiles == 0))
+        return true;
+
+    if (block_width  > METATILE_SIZE_MAX) block_width  = METATILE_SIZE_MAX;
+    if (block_height > METATILE_SIZE_MAX) block_height = METATILE_SIZE_MAX;
+
+    p_meta->block_width  = block_width;
+    p_meta->block_height = block_height;
+
+    if ((p_map->width_in_tiles % block_width) || (p_map->height_in_tiles % block_height)) {
+        printf("Metatiles: %d x %d map is not a multiple of %d x %d blocks, skipped\n",
+               p_map->width_in_tiles, p_map->height_in_tiles, block_width, block_height);
+        return true;
+    }
+
+    printf("Metatiles: Start -> %d x %d blocks over %d x %d map  ", block_width, block_height,
+           p_map->width_in_tiles, p_map->height_in_tiles);
+    benchmark_start();
+
+    p_ids_decoded     = NULL;
+    p_attribs_decoded = NULL;
+
+    if (p_map->tile_id_list && p_map->tile_attribs_list) {
+        job.p_ids     = p_map->tile_id_list;
+        job.p_attribs = p_map->tile_attribs_list;
+    }
+    else {
+        p_ids_decoded     = malloc((size_t)p_map->size * sizeof(uint32_t));
+        p_attribs_decoded = malloc((size_t)p_map->size * sizeof(uint16_t));
+
+        if (!p_ids_decoded || !p_attribs_decoded) {
+            free(p_ids_decoded);
+            free(p_attribs_decoded);
+            tilemap_metatile_free(p_meta);
+            return false;
+        }
+
+        tilemap_map_iter_init(&iter, p_map);
+        for (c = 0; c < p_map->size; c++)
+            tilemap_map_iter_next(&iter, &p_ids_decoded[c], &p_attribs_decoded[c]);
+
+        job.p_ids     = p_ids_decoded;
+        job.p_attribs = p_attribs_decoded;
+    }
+
+    p_meta->width_in_blocks  = p_map->width_in_tiles  / block_width;
+    p_meta->height_in_blocks = p_map->height_in_tiles / block_height;
+    block_count = p_meta->width_in_blocks * p_meta->height_in_blocks;
+    entries     = (uint32_t)block_width * block_height;
+
+    // Exact keys when a whole block of entries fits in 64 bits
+    id_max      = 0;
+    attribs_max = 0;
+    for (c = 0; c < p_map->size; c++) {
+        if (job.p_ids[c] > id_max)          id_max      = job.p_ids[c];
+        if (job.p_attribs[c] > attribs_max) attribs_max = job.p_attribs[c];
+    }
+
+    for (job.id_bits = 1; (job.id_bits < 32) && (id_max >> job.id_bits); job.id_bits++);
+    for (attrib_bits = 0; (attrib_bits < 16) && (attribs_max >> attrib_bits); attrib_bits++);
+
+    if ((job.id_bits + attrib_bits) * entries <= 64) {
+        p_meta->key_bits = (uint8_t)(job.id_bits + attrib_bits);
+        job.hash_func    = NULL;
+    }
+    else {
+        p_meta->key_bits = 0;
+        job.hash_func    = tile_hash_get_func(TILE_HASH_MULMIX64);
+    }
+
+    job.p_meta     = p_meta;
+    job.stride     = p_map->width_in_tiles;
+    job.failed     = false;
+    job.mismatches = 0;
+    job.p_index    = NULL;
+    job.p_keys     = malloc((size_t)block_count * sizeof(uint64_t));
+    job.p_slots    = malloc((size_t)block_count * sizeof(uint32_t));
+
+    p_meta->p_map = malloc((size_t)block_count * sizeof(uint32_t));
+
+    status = (job.p_keys && job.p_slots && p_meta->p_map && tile_index_init(&index, block_count));
+
+    if (status) {
+        job.p_index = &index;
+
+        tilemap_pool_run(p_meta->height_in_blocks, metatile_key_task, &job);
+        status = !job.failed;
+    }
+
+    if (status) {
+        p_meta->count = tile_index_assign_ids(&index);
+
+        p_meta->p_table_ids     = malloc((size_t)p_meta->count * entries * sizeof(uint32_t));
+        p_meta->p_table_attribs = malloc((size_t)p_meta->count * entries * sizeof(uint16_t));
+        status = (p_meta->p_table_ids && p_meta->p_table_attribs);
+    }
+
+    if (status) {
+        tilemap_pool_run(p_meta->height_in_blocks, metatile_map_task, &job);
+
+    }
+
+    if (job.p_index)
+        tile_index_free(job.p_index);
+    free(job.p_keys);
+    free(job.p_slots);
+    free(p_ids_decoded);
+    free(p_attribs_decoded);
+
+    if (!status) {
+        tilemap_metatile_free(p_meta);
+        return false;
+    }
+
+    // Not an error for the map itself, it just can't be split reliably
+    if (job.mismatches) {
+        printf("\nMetatiles: %d blocks collided with a different block's hash, dropped\n", job.mismatches);
+        tilemap_metatile_free(p_meta);
+        return true;
+    }
+
+    benchmark_elapsed();
+    printf("Metatiles: %d unique of %d blocks (%d x %d), %s keys\n", p_meta->count, block_count,
+           p_meta->width_in_blocks, p_meta->height_in_blocks, p_meta->key_bits ? "exact" : "hashed");
+
+    return true;
+}
+
+
+
+// Duplicate a metatile result, p_dst gets its own table and map
+int32_t tilemap_metatile_copy(tile_metatile_data * p_dst, tile_metatile_data * p_src) {
+
+    size_t table_size;
+    size_t map_size;
+
+    memcpy(p_dst, p_src, sizeof(tile_metatile_data));
+    p_dst->p_table_ids     = NULL;
+    p_dst->p_table_attribs = NULL;
+    p_dst->p_map           = NULL;
+
+    if (!p_src->p_map)
+        return true;
+
+    table_size = (size_t)p_src->count * p_src->block_width * p_src->block_height;
+    map_size   = (size_t)p_src->width_in_blocks * p_src->height_in_blocks;
+
+    p_dst->p_table_ids     = malloc(table_size * sizeof(uint32_t));
+    p_dst->p_table_attribs = malloc(table_size * sizeof(uint16_t));
+    p_dst->p_map           = malloc(map_size * sizeof(uint32_t));
+
+    if (!p_dst->p_table_ids || !p_dst->p_table_attribs || !p_dst->p_map) {
+        tilemap_metatile_free(p_dst);
+        return false;
+    }
+
+    memcpy(p_dst->p_table_ids,     p_src->p_table_ids,     table_size * sizeof(uint32_t));
+    memcpy(p_dst->p_table_attribs, p_src->p_table_attribs, table_size * sizeof(uint16_t));
+    memcpy(p_dst->p_map,           p_src->p_map,           map_size * sizeof(uint32_t));
+    return true;
+}
+
+
+
+void tilemap_metatile_free(tile_metatile_data * p_meta) {
+
+    if (p_meta->p_table_ids)
+        free(p_meta->p_table_ids);
+
+    if (p_meta->p_table_attribs)
+        free(p_meta->p_table_attribs);
+
+    if (p_meta->p_map)
+        free(p_meta->p_map);
+
+    memset(p_meta, 0x00, sizeof(tile_metatile_data));
+}
@@ -0,0 +1,23 @@
+//
+// tilemap_metatile.h
+//
+
+#ifndef __TILEMAP_METATILE_H_
+#define __TILEMAP_METATILE_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define METATILE_SIZE_NONE          0     // Metatile pass disabled
+    #define METATILE_WIDTH_DEFAULT      2     // Metatile size in tiles
+    #define METATILE_HEIGHT_DEFAULT     2
+    #define METATILE_SIZE_MAX           8     // Blocks up to 8 x 8 entries
+
+    #define METATILE_ENTRIES_MAX        (METATILE_SIZE_MAX * METATILE_SIZE_MAX)
+
+    int32_t tilemap_metatile_calc(tile_map_data * p_map, uint16_t block_width, uint16_t block_height);
+    int32_t tilemap_metatile_copy(tile_metatile_data * p_dst, tile_metatile_data * p_src);
+    void    tilemap_metatile_free(tile_metatile_data * p_meta);
+
+#endif
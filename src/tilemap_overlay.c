@@ -10,6 +10,7 @@
 
 
 #include "tilemap_overlay.h"
+#include "tilemap_pool.h"
 
 #include "benchmark.h"
 
@@ -31,34 +32,47 @@
     };
 
 
-static uint8_t * p_overlaybuf; // TODO: fixme - probs better to always pass this in than static global
-static int bpp;
-static int width;
-static int height;
-static int tile_width;
-static int tile_height;
+// Renders the part of a layer that falls in one row of tiles
+// (rows don't overlap, so they can be drawn in parallel)
+typedef void (* overlay_row_func)(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty);
 
-static int grid_enabled;
-static int tilenums_enabled;
+typedef struct {
+    tilemap_overlay_ctx * p_ctx;
+    uint8_t             * p_buf;
+    overlay_row_func      row_func;
+} overlay_rows_job;
 
-#define TILE_HIGHLIGHT_NONE -1
-static int tile_to_hightlight = TILE_HIGHLIGHT_NONE;
 
-static int redraw_required = true;
+// Default overlay, used by the calls that don't take a context
+static tilemap_overlay_ctx overlay_default = {
+    .p_overlaybuf       = NULL,
+    .p_error_list       = NULL,
+    .p_window           = NULL,
+    .tile_to_hightlight = TILE_HIGHLIGHT_NONE,
+    .redraw_required    = true
+};
 
 
-static void font_render_number(int x, int y, uint16_t num, uint8_t * p_buf );
-static void font_render_digit(int x, int y, uint8_t digit, uint8_t * p_buf );
-static void pixel_draw_contrast(int x, int y, uint8_t * p_buf);
-// static void pixel_draw_color(int x, int y, uint8_t * p_buf, uint8_t r, uint8_t g, uint8_t b);
+static void font_render_number(tilemap_overlay_ctx * p_ctx, int x, int y, uint16_t num, uint8_t * p_buf );
+static void font_render_digit(tilemap_overlay_ctx * p_ctx, int x, int y, uint8_t digit, uint8_t * p_buf );
+static void pixel_draw_contrast(tilemap_overlay_ctx * p_ctx, int x, int y, uint8_t * p_buf);
+static void pixel_draw_color(tilemap_overlay_ctx * p_ctx, int x, int y, uint8_t * p_buf, uint8_t r, uint8_t g, uint8_t b);
 
-static void render_grid_rgb(uint8_t * p_buf);
-static void render_grid_rgba(uint32_t * p_buf);
+static void overlay_rows_task(void * p_arg, uint32_t tile_row, uint32_t worker);
+static void overlay_render_rows(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, overlay_row_func row_func);
 
+static void render_grid_row_rgb(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty);
+static void render_grid_row_rgba(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty);
 
-static void highlight_tile_rgb(uint8_t * p_buf, int tx, int ty);
-static void highlight_tile_rgba(uint32_t * p_buf, int tx, int ty);
-static void render_highlight_tilenum (uint8_t * p_buf, uint32_t map_size, uint32_t * map_tilelist);
+
+static void highlight_tile_rgb(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int tx, int ty);
+static void highlight_tile_rgba(tilemap_overlay_ctx * p_ctx, uint32_t * p_buf, int tx, int ty);
+static void render_highlight_tilenum (tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, tile_map_data * p_map);
+static void render_error_tint(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, uint32_t map_size);
+static void render_error_tint_row(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty);
+static void render_window_heat(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, tile_window_data * p_window);
+static void render_window_heat_cell(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int x, int y, int width, int height,
+                                    uint32_t count, uint32_t peak);
 
 
 
@@ -66,65 +80,77 @@ static void render_highlight_tilenum (uint8_t * p_buf, uint32_t map_size, uint32
 
 
 
-void overlay_redraw_invalidate(void) {
+void tilemap_overlay_ctx_redraw_invalidate(tilemap_overlay_ctx * p_ctx) {
     printf("Overlay: invalidated\n");
-    redraw_required = true;
+    p_ctx->redraw_required = true;
 }
 
 
-void overlay_redraw_clear_flag(void) {
+void tilemap_overlay_ctx_redraw_clear_flag(tilemap_overlay_ctx * p_ctx) {
     printf("Overlay: redraw flag cleared\n");
-    redraw_required = false;
+    p_ctx->redraw_required = false;
 }
 
 
-int overlay_redraw_needed(void) {
-    return redraw_required;
+int tilemap_overlay_ctx_redraw_needed(tilemap_overlay_ctx * p_ctx) {
+    return p_ctx->redraw_required;
 }
 
 
-void tilemap_overlay_set_highlight_tile(int tile_id) {
+void tilemap_overlay_ctx_set_highlight_tile(tilemap_overlay_ctx * p_ctx, int tile_id) {
 
     // Set tile number if it's different
-    if (tile_to_hightlight != tile_id) {
-        tile_to_hightlight = tile_id;
-        printf("Overlay: Highlight: Set to %d\n", tile_to_hightlight);
+    if (p_ctx->tile_to_hightlight != tile_id) {
+        p_ctx->tile_to_hightlight = tile_id;
+        printf("Overlay: Highlight: Set to %d\n", p_ctx->tile_to_hightlight);
     }
     else {
         // If it's the same tile as already set then de-select it
-        tilemap_overlay_clear_highlight_tile();
+        tilemap_overlay_ctx_clear_highlight_tile(p_ctx);
     }
 }
 
-void tilemap_overlay_clear_highlight_tile(void) {
-    tile_to_hightlight = TILE_HIGHLIGHT_NONE;
-    printf("Overlay: Highlight: Set to %d\n", tile_to_hightlight);
+void tilemap_overlay_ctx_clear_highlight_tile(tilemap_overlay_ctx * p_ctx) {
+    p_ctx->tile_to_hightlight = TILE_HIGHLIGHT_NONE;
+    printf("Overlay: Highlight: Set to %d\n", p_ctx->tile_to_hightlight);
 }
 
 // Called from main dialog to toggle individual overlays on and off
-void tilemap_overlay_set_enables(int grid_enabled_new, int tilenums_enabled_new) {
-    grid_enabled = grid_enabled_new;
-    tilenums_enabled = tilenums_enabled_new;
+void tilemap_overlay_ctx_set_enables(tilemap_overlay_ctx * p_ctx, int grid_enabled_new, int tilenums_enabled_new) {
+    p_ctx->grid_enabled = grid_enabled_new;
+    p_ctx->tilenums_enabled = tilenums_enabled_new;
 }
 
-// NOTE: expects scale_factor to be pre-multipled against width, height, tile_width, tile_height before being fed in
-void tilemap_overlay_setparams(uint8_t * p_overlaybuf_new,
-                               int bpp_new,
-                               int width_new, int height_new,
-                               int tile_width_new, int tile_height_new) {
+// Called from main dialog to show per-tile reduction error (NULL to disable)
+void tilemap_overlay_ctx_set_error_list(tilemap_overlay_ctx * p_ctx, uint32_t * p_error_list_new, uint32_t error_max_new) {
+    p_ctx->p_error_list = p_error_list_new;
+    p_ctx->error_max    = error_max_new;
+}
 
-    p_overlaybuf = p_overlaybuf_new;
-    bpp = bpp_new;
-    width = width_new;
-    height = height_new;
-    tile_width = tile_width_new;
-    tile_height = tile_height_new;
+// Called from main dialog to show viewport residency (NULL to disable)
+void tilemap_overlay_ctx_set_window(tilemap_overlay_ctx * p_ctx, tile_window_data * p_window_new) {
+    p_ctx->p_window = p_window_new;
+}
+
+// NOTE: expects scale_factor to be pre-multipled against width, height, tile_width, tile_height before being fed in
+void tilemap_overlay_ctx_setparams(tilemap_overlay_ctx * p_ctx,
+                                   uint8_t * p_overlaybuf_new,
+                                   int bpp_new,
+                                   int width_new, int height_new,
+                                   int tile_width_new, int tile_height_new) {
+
+    p_ctx->p_overlaybuf = p_overlaybuf_new;
+    p_ctx->bpp = bpp_new;
+    p_ctx->width = width_new;
+    p_ctx->height = height_new;
+    p_ctx->tile_width = tile_width_new;
+    p_ctx->tile_height = tile_height_new;
 }
 
 
 
 // Render a font digit
-static void font_render_number(int x, int y, uint16_t num, uint8_t * p_buf ) {
+static void font_render_number(tilemap_overlay_ctx * p_ctx, int x, int y, uint16_t num, uint8_t * p_buf ) {
     int digits[5];       // Store At most 5 digits
     int digit_count = 0; // Initialize digit count
 
@@ -138,14 +164,14 @@ static void font_render_number(int x, int y, uint16_t num, uint8_t * p_buf ) {
 
     // Print digits
     while (digit_count--) {
-        font_render_digit(x, y, digits[digit_count], p_buf);
+        font_render_digit(p_ctx, x, y, digits[digit_count], p_buf);
         x += 4; // TODO: #define FONT_WIDTH
     }
 }
 
 
 // Render a font digit
-static void font_render_digit(int x, int y, uint8_t digit, uint8_t * p_buf ) {
+static void font_render_digit(tilemap_overlay_ctx * p_ctx, int x, int y, uint8_t digit, uint8_t * p_buf ) {
     int pix;
 
     if (digit <= 9) {
@@ -154,11 +180,11 @@ static void font_render_digit(int x, int y, uint8_t digit, uint8_t * p_buf ) {
 
         // Draw each pixel pair until none are left (array starts at 1, not zero)
         while (pix) {
-            pixel_draw_contrast(x + font[digit][(pix*2) - 1],  // x location + x font pixel offset
+            pixel_draw_contrast(p_ctx, x + font[digit][(pix*2) - 1],  // x location + x font pixel offset
                                 y + font[digit][(pix*2)    ],  // y location + y font pixel offset
                                 p_buf);
 /*
-            pixel_draw_color(x + font[digit][(pix*2) - 1],  // x location + x font pixel offset
+            pixel_draw_color(p_ctx, x + font[digit][(pix*2) - 1],  // x location + x font pixel offset
                              y + font[digit][(pix*2)    ],  // y location + y font pixel offset
                              p_buf,
                              0,0,0);  // Black
@@ -172,16 +198,16 @@ static void font_render_digit(int x, int y, uint8_t digit, uint8_t * p_buf ) {
 
 // Draw a pixel by semi-inverting the current pixel value (roll it 128 bytes upward + wraparound)
 // Expects BPP to only = 3 or 4
-static void pixel_draw_contrast(int x, int y, uint8_t * p_buf) {
+static void pixel_draw_contrast(tilemap_overlay_ctx * p_ctx, int x, int y, uint8_t * p_buf) {
 
     // Don't draw outside the image buffer
-    if ((x < width) && (y < height)) {
+    if ((x < p_ctx->width) && (y < p_ctx->height)) {
 
         // Move to pixel location
-        p_buf += (x + (y * width)) * bpp;
+        p_buf += ((size_t)x + ((size_t)y * p_ctx->width)) * p_ctx->bpp;
 
         // Handle mostly alpha transparent pixels differently (fixed color)
-        if ((bpp == 4) && (*(p_buf + 3) < 192)) {
+        if ((p_ctx->bpp == 4) && (*(p_buf + 3) < 192)) {
             // Set pixel to fixed color value
             *p_buf++ = 255; // Red
             *p_buf++ = 255; // Green
@@ -196,7 +222,7 @@ static void pixel_draw_contrast(int x, int y, uint8_t * p_buf) {
         }
 
         // handle opacity if needed
-        if (bpp == 4)
+        if (p_ctx->bpp == 4)
             *p_buf++ = 255; //*p_buf + 128; // Blue
     }
 }
@@ -204,14 +230,13 @@ static void pixel_draw_contrast(int x, int y, uint8_t * p_buf) {
 
 // Draw a pixel with a given color
 // Expects BPP to only = 3 or 4
-/*
-static void pixel_draw_color(int x, int y, uint8_t * p_buf, uint8_t r, uint8_t g, uint8_t b) {
+static void pixel_draw_color(tilemap_overlay_ctx * p_ctx, int x, int y, uint8_t * p_buf, uint8_t r, uint8_t g, uint8_t b) {
 
     // Don't draw outside the image buffer
-    if ((x < width) && (y < height)) {
+    if ((x < p_ctx->width) && (y < p_ctx->height)) {
 
         // Move to pixel location
-        p_buf += (x + (y * width)) * bpp;
+        p_buf += ((size_t)x + ((size_t)y * p_ctx->width)) * p_ctx->bpp;
 
         // Set pixel to new contrasted value
         *p_buf++ = r; // Red
@@ -219,27 +244,26 @@ static void pixel_draw_color(int x, int y, uint8_t * p_buf, uint8_t r, uint8_t g
         *p_buf++ = b; // Blue
 
         // handle opacity if needed
-        if (bpp == 4)
+        if (p_ctx->bpp == 4)
             *p_buf++ = 255;
     }
 }
-*/
 
 // Render a solid tile inverted at x,y
-static void highlight_tile_rgb(uint8_t * p_buf, int tx, int ty) {
+static void highlight_tile_rgb(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int tx, int ty) {
 
     int       x,y;
     uint32_t  row_gap_u8;
 
     // Pre-calculate the buffer distance from the
     // end of one row to the start of the next
-    row_gap_u8       = (width - tile_width) * bpp;
+    row_gap_u8       = (p_ctx->width - p_ctx->tile_width) * p_ctx->bpp;
 
     // Move down to first pixel of first row of tile
-    p_buf += ((width * ty) + tx) * bpp;
+    p_buf += (((size_t)p_ctx->width * ty) + tx) * p_ctx->bpp;
 
-    for (y=0; y < tile_height; y++) {
-        for (x=0; x < tile_width; x++) {
+    for (y=0; y < p_ctx->tile_height; y++) {
+        for (x=0; x < p_ctx->tile_width; x++) {
 
             // Semi-invert the pixel
             *p_buf++ ^= 0x80; // R
@@ -253,20 +277,20 @@ static void highlight_tile_rgb(uint8_t * p_buf, int tx, int ty) {
 
 
 // Render a solid tile inverted at x,y
-static void highlight_tile_rgba(uint32_t * p_buf, int tx, int ty) {
+static void highlight_tile_rgba(tilemap_overlay_ctx * p_ctx, uint32_t * p_buf, int tx, int ty) {
 
     int        x,y;
     uint32_t   row_gap_u32;
 
     // Pre-calculate the buffer distance from the
     // end of one grid-line to the start of the next
-    row_gap_u32       = (width  - tile_width);
+    row_gap_u32       = (p_ctx->width  - p_ctx->tile_width);
 
     // Move down to first pixel of first row of tile
-    p_buf += ((width * ty) + tx);
+    p_buf += (((size_t)p_ctx->width * ty) + tx);
 
-    for (y=0; y < tile_height; y++) {
-        for (x=0; x < tile_width; x++) {
+    for (y=0; y < p_ctx->tile_height; y++) {
+        for (x=0; x < p_ctx->tile_width; x++) {
 
             // If the pixel is mostly visible, semi-invert it
             // If it's mostly transparent then set it to red + fully visible
@@ -284,33 +308,32 @@ static void highlight_tile_rgba(uint32_t * p_buf, int tx, int ty) {
 }
 
 
-static void render_highlight_tilenum (uint8_t * p_buf,
-                                      uint32_t map_size,
-                                      uint32_t * map_tilelist) {
+static void render_highlight_tilenum (tilemap_overlay_ctx * p_ctx, uint8_t * p_buf,
+                                      tile_map_data * p_map) {
     int x,y;
     int tile_index;
 
     tile_index = 0;
 
     // Overlay doesn't have access to tile_count right now
-    // if (tile_to_hightlight >= tile_count) {
+    // if (p_ctx->tile_to_hightlight >= tile_count) {
     //     printf("Overlay: Render Highlight Tilenum -> invalid tile number!\n");
     //     return;
     // }
 
-    if (map_size != ((width / tile_width) * (height / tile_height))) {
+    if (p_map->size != ((p_ctx->width / p_ctx->tile_width) * (p_ctx->height / p_ctx->tile_height))) {
         printf("Overlay: Render Highlight Tilenum -> WRONG MAP SIZE!\n");
         return;
     }
 
-    for (y=0; y < height; y+= tile_height) {
-        for (x=0; x < width; x+= tile_width) {
+    for (y=0; y < p_ctx->height; y+= p_ctx->tile_height) {
+        for (x=0; x < p_ctx->width; x+= p_ctx->tile_width) {
 
-            if (map_tilelist[ tile_index++ ] == tile_to_hightlight ) {
-                if (bpp == 3)
-                    highlight_tile_rgb(p_buf, x, y);
-                else if (bpp == 4)
-                    highlight_tile_rgba((uint32_t * )p_buf, x, y);
+            if (tilemap_map_get_id(p_map, tile_index++) == p_ctx->tile_to_hightlight ) {
+                if (p_ctx->bpp == 3)
+                    highlight_tile_rgb(p_ctx, p_buf, x, y);
+                else if (p_ctx->bpp == 4)
+                    highlight_tile_rgba(p_ctx, (uint32_t * )p_buf, x, y);
             }
         }
     }
@@ -318,43 +341,175 @@ static void render_highlight_tilenum (uint8_t * p_buf,
 }
 
 
-// Render a tile spaced grid of semi-inverted pixels in the image buffer
-static void render_grid_rgb(uint8_t * p_buf) {
+// Pool task: one row of tiles
+static void overlay_rows_task(void * p_arg, uint32_t tile_row, uint32_t worker) {
+
+    overlay_rows_job * p_job = (overlay_rows_job *)p_arg;
+
+    p_job->row_func(p_job->p_ctx, p_job->p_buf, (int)tile_row * p_job->p_ctx->tile_height);
+}
+
+
+
+// Render every row of tiles with row_func across the thread pool
+static void overlay_render_rows(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, overlay_row_func row_func) {
+
+    overlay_rows_job job;
+
+    job.p_ctx    = p_ctx;
+    job.p_buf    = p_buf;
+    job.row_func = row_func;
+
+    tilemap_pool_run((p_ctx->height + (p_ctx->tile_height - 1)) / p_ctx->tile_height,
+                     overlay_rows_task, &job);
+}
+
+
+
+// Tint every tile red in proportion to how far it is from
+// the representative tile it got merged into (zero error = untouched)
+static void render_error_tint(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, uint32_t map_size) {
+
+    if (map_size != ((p_ctx->width / p_ctx->tile_width) * (p_ctx->height / p_ctx->tile_height))) {
+        printf("Overlay: Render Error Tint -> WRONG MAP SIZE!\n");
+        return;
+    }
+
+    if (p_ctx->error_max == 0)
+        return;
+
+    overlay_render_rows(p_ctx, p_buf, render_error_tint_row);
+}
 
+
+
+// Error tint for the row of tiles starting at pixel row ty
+static void render_error_tint_row(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty) {
+
+    int       x, y, tx;
+    int       tile_index;
+    uint32_t  strength;
     uint8_t * p_pix;
-    int       x,y;
-    uint32_t  row_gap_u8, col_increment_u8;
 
-    // Pre-calculate the buffer distance from the
-    // end of one grid-line to the start of the next
-    row_gap_u8       = (width * (tile_height - 1)) * bpp;
-    col_increment_u8 = (width * bpp) - bpp;
+    tile_index = (ty / p_ctx->tile_height) * ((p_ctx->width + (p_ctx->tile_width - 1)) / p_ctx->tile_width);
 
-    // Draw horizontal grid lines using the tile size
-    p_pix = p_buf;
+    for (tx = 0; tx < p_ctx->width; tx += p_ctx->tile_width) {
 
-    for (y=0; y < height; y += tile_height) {
-        for (x=0; x < width; x++) {
+        if (p_ctx->p_error_list[tile_index]) {
 
-// TODO: renger grid rgb: handle transparency better here (see RGBA)
-            // Semi-invert the pixel
-            *p_pix++ ^= 0x20; // R
-            *p_pix++ ^= 0x20; // G
-            *p_pix++ ^= 0x20; // B
+            // Scale to 64..255 so even small errors remain visible
+            strength = 64 + (uint32_t)(((uint64_t)p_ctx->p_error_list[tile_index] * 191) / p_ctx->error_max);
+
+            for (y = ty; y < ty + p_ctx->tile_height; y++) {
+
+                p_pix = p_buf + (((size_t)tx + ((size_t)y * p_ctx->width)) * p_ctx->bpp);
+
+                for (x = 0; x < p_ctx->tile_width; x++) {
+                    *(p_pix    ) += ((255 - *(p_pix    )) * strength) >> 8; // R toward full
+                    *(p_pix + 1) -= (       *(p_pix + 1)  * strength) >> 9; // G, B toward half
+                    *(p_pix + 2) -= (       *(p_pix + 2)  * strength) >> 9;
+                    p_pix += p_ctx->bpp;
+                }
+            }
         }
-        // Advance image buffer to next horizontal grid line
-        p_pix += row_gap_u8;
+
+        tile_index++;
+    }
+}
+
+
+// Fill a heat strip cell, green (few tiles) through red (the peak)
+static void render_window_heat_cell(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int x, int y, int width, int height,
+                                    uint32_t count, uint32_t peak) {
+
+    int     px, py;
+    uint8_t heat;
+
+    heat = (uint8_t)(((uint64_t)count * 255) / peak);
+
+    for (py = y; py < y + height; py++)
+        for (px = x; px < x + width; px++)
+            pixel_draw_color(p_ctx, px, py, p_buf, heat, 255 - heat, 0);
+}
+
+
+
+// Viewport residency: heat strips along the top edge (windows
+// starting in each tile column) and left edge (windows starting in
+// each tile row), plus an outline around the peak window
+static void render_window_heat(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, tile_window_data * p_window) {
+
+    int      strip_width, strip_height;
+    int      x, y, x_end, y_end, i;
+    uint32_t c;
+
+    if ((p_window->peak_count == 0) || !p_window->p_heat_x || !p_window->p_heat_y)
+        return;
+
+    // A quarter tile thick, but at least 2 pixels
+    strip_height = (p_ctx->tile_height / 4 > 2) ? (p_ctx->tile_height / 4) : 2;
+    strip_width  = (p_ctx->tile_width  / 4 > 2) ? (p_ctx->tile_width  / 4) : 2;
+
+    for (c = 0; c < p_window->positions_x; c++)
+        render_window_heat_cell(p_ctx, p_buf, c * p_ctx->tile_width, 0, p_ctx->tile_width, strip_height,
+                                p_window->p_heat_x[c], p_window->peak_count);
+
+    for (c = 0; c < p_window->positions_y; c++)
+        render_window_heat_cell(p_ctx, p_buf, 0, c * p_ctx->tile_height, strip_width, p_ctx->tile_height,
+                                p_window->p_heat_y[c], p_window->peak_count);
+
+    // Outline the peak window
+    x     = p_window->peak_x * p_ctx->tile_width;
+    y     = p_window->peak_y * p_ctx->tile_height;
+    x_end = x + (p_window->view_width  * p_ctx->tile_width)  - 1;
+    y_end = y + (p_window->view_height * p_ctx->tile_height) - 1;
+
+    for (i = x; i <= x_end; i++) {
+        pixel_draw_contrast(p_ctx, i, y,     p_buf);
+        pixel_draw_contrast(p_ctx, i, y_end, p_buf);
+    }
+
+    for (i = y + 1; i < y_end; i++) {
+        pixel_draw_contrast(p_ctx, x,     i, p_buf);
+        pixel_draw_contrast(p_ctx, x_end, i, p_buf);
+    }
+}
+
+
+// Render the tile spaced grid of semi-inverted pixels for the
+// row of tiles starting at pixel row ty (top edge + vertical lines)
+static void render_grid_row_rgb(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty) {
+
+    uint8_t * p_pix;
+    int       x,y, y_end;
+    uint32_t  col_increment_u8;
+
+    // Buffer distance from one pixel to the one below it
+    col_increment_u8 = (p_ctx->width * p_ctx->bpp) - p_ctx->bpp;
+
+    // Draw the horizontal grid line along the top of the row
+    p_pix = p_buf + ((size_t)ty * p_ctx->width * p_ctx->bpp);
+
+    for (x=0; x < p_ctx->width; x++) {
+
+// TODO: renger grid rgb: handle transparency better here (see RGBA)
+        // Semi-invert the pixel
+        *p_pix++ ^= 0x20; // R
+        *p_pix++ ^= 0x20; // G
+        *p_pix++ ^= 0x20; // B
     }
 
 
     // Draw veritcal grid lines using the tile size
-    p_pix = p_buf;
+    y_end = ty + p_ctx->tile_height;
+    if (y_end > p_ctx->height)
+        y_end = p_ctx->height;
 
-    for (x=0; x < width; x += tile_width) {
+    for (x=0; x < p_ctx->width; x += p_ctx->tile_width) {
 
-        p_pix = p_buf + (x * bpp);
+        p_pix = p_buf + (((size_t)ty * p_ctx->width) + x) * p_ctx->bpp;
 
-        for (y=0; y < height; y++) {
+        for (y=ty; y < y_end; y++) {
 
             // Semi-invert the pixel
             *p_pix++ ^= 0x20; // R
@@ -368,47 +523,44 @@ static void render_grid_rgb(uint8_t * p_buf) {
 }
 
 
-// Render a tile spaced grid of semi-inverted pixels in the image buffer
-static void render_grid_rgba(uint32_t * p_buf) {
+// Render the tile spaced grid of semi-inverted pixels for the
+// row of tiles starting at pixel row ty (top edge + vertical lines)
+static void render_grid_row_rgba(tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, int ty) {
 
     uint32_t * p_pix;
-    int        x,y;
-    uint32_t   row_gap_u32, col_increment_u32;
+    int        x,y, y_end;
+    uint32_t   col_increment_u32;
 
-    // Pre-calculate the buffer distance from the
-    // end of one grid-line to the start of the next
-    row_gap_u32       = width * (tile_height - 1);
-    col_increment_u32 = width;
+    // Buffer distance from one pixel to the one below it
+    col_increment_u32 = p_ctx->width;
 
-    // Draw horizontal grid lines using the tile size
-    p_pix = p_buf;
+    // Draw the horizontal grid line along the top of the row
+    p_pix = (uint32_t *)p_buf + ((size_t)ty * p_ctx->width);
 
-    for (y=0; y < height; y += tile_height) {
-        for (x=0; x < width; x++) {
+    for (x=0; x < p_ctx->width; x++) {
 
-            // If the pixel is mostly visible, semi-invert it
-            // If it's mostly transparent then set it to red + fully visible
-            if (*p_pix & 0xC0000000)
-                *p_pix ^= 0x00202020;
-            else
-                *p_pix = 0xFF0000FF;
+        // If the pixel is mostly visible, semi-invert it
+        // If it's mostly transparent then set it to red + fully visible
+        if (*p_pix & 0xC0000000)
+            *p_pix ^= 0x00202020;
+        else
+            *p_pix = 0xFF0000FF;
 
-            // Move right by one pixel (col)
-            p_pix++;
-        }
-        // Advance image buffer to next horizontal grid line
-        p_pix += row_gap_u32;
+        // Move right by one pixel (col)
+        p_pix++;
     }
 
 
     // Draw veritcal grid lines using the tile size
-    p_pix = p_buf;
+    y_end = ty + p_ctx->tile_height;
+    if (y_end > p_ctx->height)
+        y_end = p_ctx->height;
 
-    for (x=0; x < width; x += tile_width) {
+    for (x=0; x < p_ctx->width; x += p_ctx->tile_width) {
 
-        p_pix = p_buf + x;
+        p_pix = (uint32_t *)p_buf + ((size_t)ty * p_ctx->width) + x;
 
-        for (y=0; y < height; y++) {
+        for (y=ty; y < y_end; y++) {
 
             // If the pixel is mostly visible, semi-invert it
             // If it's mostly transparent then set it to red + fully visible
@@ -424,22 +576,22 @@ static void render_grid_rgba(uint32_t * p_buf) {
 }
 
 
-static void render_tilenums (uint8_t * p_buf, uint32_t map_size, uint32_t * map_tilelist) {
+static void render_tilenums (tilemap_overlay_ctx * p_ctx, uint8_t * p_buf, tile_map_data * p_map) {
 
     int x,y;
     int tile_index;
 
     tile_index = 0;
 
-    if (map_size != ((width / tile_width) * (height / tile_height)))
+    if (p_map->size != ((p_ctx->width / p_ctx->tile_width) * (p_ctx->height / p_ctx->tile_height)))
         printf("Overlay: Render tilenums -> WRONG MAP SIZE!\n");
     else {
-        for (y=0; y < height; y+= tile_height) {
-            for (x=0; x < width; x+= tile_width) {
+        for (y=0; y < p_ctx->height; y+= p_ctx->tile_height) {
+            for (x=0; x < p_ctx->width; x+= p_ctx->tile_width) {
 
-                font_render_number(x + 2,
+                font_render_number(p_ctx, x + 2,
                                    y + 2,
-                                   map_tilelist[ tile_index++ ],
+                                   tilemap_map_get_id(p_map, tile_index++),
                                    p_buf);
             }
         }
@@ -447,40 +599,104 @@ static void render_tilenums (uint8_t * p_buf, uint32_t map_size, uint32_t * map_
 }
 
 
-void tilemap_overlay_apply(uint32_t map_size, uint32_t * map_tilelist) {
+void tilemap_overlay_ctx_apply(tilemap_overlay_ctx * p_ctx, tile_map_data * p_map) {
 
 //    printf("Overlay: Drawing now...\n");
 
-    if (p_overlaybuf == NULL)
+    if (p_ctx->p_overlaybuf == NULL)
         return;
 
-    printf("Overlay: Start -> Grid  ");
+    printf("Overlay: Start -> Error Tint  ");
     benchmark_start();
 
+    // Shade tiles which got merged by tile set reduction
+    if (p_ctx->p_error_list)
+        render_error_tint(p_ctx, p_ctx->p_overlaybuf, p_map->size);
+
+    benchmark_elapsed();
+    printf("Overlay: Start -> Grid  ");
+
     // Draw the tile grid
-    if (grid_enabled) {
-        if (bpp == 3)
-            render_grid_rgb (p_overlaybuf);
-        else if (bpp == 4)
-            render_grid_rgba ((uint32_t * )p_overlaybuf);
+    if (p_ctx->grid_enabled) {
+        if (p_ctx->bpp == 3)
+            overlay_render_rows(p_ctx, p_ctx->p_overlaybuf, render_grid_row_rgb);
+        else if (p_ctx->bpp == 4)
+            overlay_render_rows(p_ctx, p_ctx->p_overlaybuf, render_grid_row_rgba);
     }
 
+    benchmark_elapsed();
+    printf("Overlay: Start -> Window Heat  ");
+
+    // Show where a scrolling viewport needs the most tiles
+    if (p_ctx->p_window)
+        render_window_heat(p_ctx, p_ctx->p_overlaybuf, p_ctx->p_window);
+
     benchmark_elapsed();
     printf("Overlay: Start -> Tilenums  ");
 
     // Draw the tile numbers
-    if (tilenums_enabled)
-        render_tilenums ( p_overlaybuf, map_size, map_tilelist);
+    if (p_ctx->tilenums_enabled)
+        render_tilenums (p_ctx, p_ctx->p_overlaybuf, p_map);
 
     benchmark_elapsed();
-    printf("Overlay: Start -> Highlight (%d) ", tile_to_hightlight);
+    printf("Overlay: Start -> Highlight (%d) ", p_ctx->tile_to_hightlight);
 
-    if (tile_to_hightlight != TILE_HIGHLIGHT_NONE)
-        render_highlight_tilenum(p_overlaybuf, map_size, map_tilelist);
+    if (p_ctx->tile_to_hightlight != TILE_HIGHLIGHT_NONE)
+        render_highlight_tilenum(p_ctx, p_ctx->p_overlaybuf, p_map);
 
     benchmark_elapsed();
 
-    overlay_redraw_clear_flag();
+    tilemap_overlay_ctx_redraw_clear_flag(p_ctx);
+}
+
+
+
+// Reset an overlay context to defaults (nothing to draw into yet)
+void tilemap_overlay_ctx_init(tilemap_overlay_ctx * p_ctx) {
+
+    memset(p_ctx, 0, sizeof(tilemap_overlay_ctx));
+    p_ctx->p_overlaybuf       = NULL;
+    p_ctx->p_error_list       = NULL;
+    p_ctx->p_window           = NULL;
+    p_ctx->tile_to_hightlight = TILE_HIGHLIGHT_NONE;
+    p_ctx->redraw_required    = true;
+}
+
+
+
+// ========================
+//
+// Default overlay wrappers
+//
+// ========================
+
+void overlay_redraw_invalidate(void) { tilemap_overlay_ctx_redraw_invalidate(&overlay_default); }
+void overlay_redraw_clear_flag(void) { tilemap_overlay_ctx_redraw_clear_flag(&overlay_default); }
+int  overlay_redraw_needed(void)     { return tilemap_overlay_ctx_redraw_needed(&overlay_default); }
+
+void tilemap_overlay_set_highlight_tile(int tile_id) { tilemap_overlay_ctx_set_highlight_tile(&overlay_default, tile_id); }
+void tilemap_overlay_clear_highlight_tile(void)      { tilemap_overlay_ctx_clear_highlight_tile(&overlay_default); }
+
+void tilemap_overlay_set_enables(int grid_enabled_new, int tilenums_enabled_new) {
+    tilemap_overlay_ctx_set_enables(&overlay_default, grid_enabled_new, tilenums_enabled_new);
+}
+
+void tilemap_overlay_set_error_list(uint32_t * p_error_list_new, uint32_t error_max_new) {
+    tilemap_overlay_ctx_set_error_list(&overlay_default, p_error_list_new, error_max_new);
 }
 
+void tilemap_overlay_set_window(tile_window_data * p_window_new) {
+    tilemap_overlay_ctx_set_window(&overlay_default, p_window_new);
+}
+
+void tilemap_overlay_setparams(uint8_t * p_overlaybuf_new,
+                               int bpp_new,
+                               int width_new, int height_new,
+                               int tile_width_new, int tile_height_new) {
+    tilemap_overlay_ctx_setparams(&overlay_default, p_overlaybuf_new, bpp_new,
+                                  width_new, height_new, tile_width_new, tile_height_new);
+}
 
+void tilemap_overlay_apply(tile_map_data * p_map) {
+    tilemap_overlay_ctx_apply(&overlay_default, p_map);
+}
@@ -5,9 +5,57 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include "lib_tilemap.h"
+
 #ifndef TILEMAP_OVERLAY_H
 #define TILEMAP_OVERLAY_H
 
+#define TILE_HIGHLIGHT_NONE -1
+
+// Overlay state for one preview buffer
+// (the calls without a context use a built-in default one)
+typedef struct {
+    uint8_t  * p_overlaybuf;
+    int        bpp;
+    int        width;
+    int        height;
+    int        tile_width;
+    int        tile_height;
+
+    int        grid_enabled;
+    int        tilenums_enabled;
+
+    uint32_t * p_error_list; // Per map entry error from tile set reduction (optional)
+    uint32_t   error_max;
+
+    tile_window_data * p_window; // Viewport residency heat strips + peak window (optional)
+
+    int        tile_to_hightlight;
+    int        redraw_required;
+} tilemap_overlay_ctx;
+
+
+void tilemap_overlay_ctx_init(tilemap_overlay_ctx * p_ctx);
+
+void tilemap_overlay_ctx_setparams(tilemap_overlay_ctx * p_ctx,
+                                   uint8_t * p_overlaybuf_new,
+                                   int bpp_new,
+                                   int width_new, int height_new,
+                                   int tile_width_new, int tile_height_new);
+
+void tilemap_overlay_ctx_set_enables(tilemap_overlay_ctx * p_ctx, int grid_enabled, int tilenums_enabled);
+void tilemap_overlay_ctx_set_error_list(tilemap_overlay_ctx * p_ctx, uint32_t * p_error_list_new, uint32_t error_max_new);
+void tilemap_overlay_ctx_set_window(tilemap_overlay_ctx * p_ctx, tile_window_data * p_window_new);
+void tilemap_overlay_ctx_apply(tilemap_overlay_ctx * p_ctx, tile_map_data * p_map);
+
+void tilemap_overlay_ctx_set_highlight_tile(tilemap_overlay_ctx * p_ctx, int tile_id);
+void tilemap_overlay_ctx_clear_highlight_tile(tilemap_overlay_ctx * p_ctx);
+
+void tilemap_overlay_ctx_redraw_invalidate(tilemap_overlay_ctx * p_ctx);
+void tilemap_overlay_ctx_redraw_clear_flag(tilemap_overlay_ctx * p_ctx);
+int  tilemap_overlay_ctx_redraw_needed(tilemap_overlay_ctx * p_ctx);
+
+
 void tilemap_overlay_setparams(uint8_t * p_overlaybuf_new,
                                int bpp_new,
                                int width_new, int height_new,
@@ -15,7 +63,11 @@ void tilemap_overlay_setparams(uint8_t * p_overlaybuf_new,
 
 void tilemap_overlay_set_enables(int grid_enabled, int tilenums_enabled);
 
-void tilemap_overlay_apply(uint32_t map_size, uint32_t * map_tilelist);
+void tilemap_overlay_set_error_list(uint32_t * p_error_list_new, uint32_t error_max_new);
+
+void tilemap_overlay_set_window(tile_window_data * p_window_new);
+
+void tilemap_overlay_apply(tile_map_data * p_map);
 
 void tilemap_overlay_set_highlight_tile(int tile_id);
 void tilemap_overlay_clear_highlight_tile(void);
@@ -0,0 +1,268 @@
+//
+// tilemap_packed.c
+//
+
+// ========================
+//
+// Bit-packed tile pixels for low color indexed images.
+//
+// Indexed images with few colors only use the low bits of
+// each pixel byte. With up to 4 colors a pixel fits in 2
+// bits, with up to 16 in 4 bits, so an 8x8 tile shrinks
+// from 64 bytes to 16 or 32.
+//
+// Tile sets of such images can keep their working tiles
+// and stored tiles packed: hashing, flips and the tile store
+// all run on the packed bytes, which is 2-4x less data to
+// move per tile. Pixels only get unpacked on the way out
+// (tile views, export, reduction).
+//
+// Packing every cell of the image isn't free though, and
+// mostly costs more than it saves. By default tile sets
+// only pack where flips dominate (bulk engines with flip
+// search) or where the direct keys would pack every cell
+// to 2 bits anyway (see enum tile_packing_modes).
+//
+// Layout: each tile row starts on a byte boundary, pixels
+// are stored first pixel in the highest bits of a byte.
+// Unused low bits at the end of a row are zero, so equal
+// tiles always have equal packed bytes.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_packed.h"
+
+
+static inline uint8_t packed_reverse_byte(uint8_t b, uint8_t bits);
+static inline uint8_t packed_get_pixel(const uint8_t * p_row, uint16_t x, uint8_t bits);
+static inline void    packed_set_pixel(uint8_t * p_row, uint16_t x, uint8_t bits, uint8_t value);
+
+
+
+// Packed pixel size for a tile set, TILE_PACKED_BITS_NONE if the
+// tiles should stay one byte per pixel
+//
+// * Only plain indexed images (no alpha) with a known color count
+uint8_t tile_packed_select_bits(uint8_t bytes_per_pixel, uint16_t color_count) {
+
+    if ((bytes_per_pixel != 1) || (color_count == 0))
+        return TILE_PACKED_BITS_NONE;
+    else if (color_count <= TILE_PACKED_COLORS_2BPP)
+        return 2;
+    else if (color_count <= TILE_PACKED_COLORS_4BPP)
+        return 4;
+    else
+        return TILE_PACKED_BITS_NONE;
+}
+
+
+
+uint32_t tile_packed_get_row_bytes(uint16_t width, uint8_t bits) {
+
+    return (((uint32_t)width * bits) + 7) / 8;
+}
+
+
+
+uint32_t tile_packed_get_size(uint16_t width, uint16_t height, uint8_t bits) {
+
+    return tile_packed_get_row_bytes(width, bits) * height;
+}
+
+
+
+// True if every pixel of an image fits in the given bit count
+//
+// * The limit is a power of two, so OR-ing all pixels
+//   together and checking the high bits is enough
+int32_t tile_packed_image_fits(image_data * p_img, uint8_t bits) {
+
+    const uint8_t * p_data;
+    uint64_t        word, acc;
+    uint64_t        c, words;
+    uint8_t         tail;
+
+    p_data = p_img->p_img_data;
+    words  = p_img->size / sizeof(uint64_t);
+    acc    = 0;
+
+    for (c = 0; c < words; c++) {
+        memcpy(&word, p_data + (c * sizeof(uint64_t)), sizeof(uint64_t));
+        acc |= word;
+    }
+
+    tail = 0;
+    for (c = words * sizeof(uint64_t); c < p_img->size; c++)
+        tail |= p_data[c];
+
+    // Fold the word down to one byte (OR of all lanes)
+    acc |= acc >> 32;
+    acc |= acc >> 16;
+    acc |= acc >> 8;
+    tail |= (uint8_t)acc;
+
+    return ((tail >> bits) == 0);
+}
+
+
+
+// Pack a tile of one byte pixels (src_stride bytes per source row)
+//
+// * Pixel values must fit in "bits" (see tile_packed_image_fits()),
+//   higher bits are dropped
+void tile_packed_pack(const uint8_t * p_src, size_t src_stride, uint16_t width, uint16_t height,
+                      uint8_t bits, uint8_t * p_dst) {
+
+    uint16_t x, y;
+    uint8_t  b;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    uint64_t v;
+#endif
+
+    for (y = 0; y < height; y++, p_src += src_stride) {
+
+        x = 0;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        // 8 pixels at a time in a 64 bit word (first pixel in the
+        // low byte): merge neighbouring pixels into each 16 bit lane,
+        // then (2bpp) neighbouring lanes into each 32 bit lane, and
+        // gather the low bytes of the lanes
+        if (bits == 4) {
+            for (; (x + 8) <= width; x += 8, p_dst += 4) {
+                memcpy(&v, p_src + x, sizeof(v));
+                v &= 0x0F0F0F0F0F0F0F0Full;
+                v  = ((v & 0x00FF00FF00FF00FFull) << 4) | ((v >> 8) & 0x00FF00FF00FF00FFull);
+                v  = (v | (v >> 8))  & 0x0000FFFF0000FFFFull;
+                v  = (v | (v >> 16)) & 0x00000000FFFFFFFFull;
+                p_dst[0] = (uint8_t)v;
+                p_dst[1] = (uint8_t)(v >> 8);
+                p_dst[2] = (uint8_t)(v >> 16);
+                p_dst[3] = (uint8_t)(v >> 24);
+            }
+        }
+        else if (bits == 2) {
+            for (; (x + 8) <= width; x += 8, p_dst += 2) {
+                memcpy(&v, p_src + x, sizeof(v));
+                v &= 0x0303030303030303ull;
+                v  = ((v & 0x00FF00FF00FF00FFull) << 2) | ((v >> 8)  & 0x00FF00FF00FF00FFull);
+                v  = ((v & 0x0000FFFF0000FFFFull) << 4) | ((v >> 16) & 0x0000FFFF0000FFFFull);
+                p_dst[0] = (uint8_t)v;
+                p_dst[1] = (uint8_t)(v >> 32);
+            }
+        }
+#endif
+
+        if (bits == 4) {
+            for (; (x + 2) <= width; x += 2)
+                *p_dst++ = (uint8_t)(((p_src[x] & 0x0F) << 4) | (p_src[x + 1] & 0x0F));
+        }
+        else if (bits == 2) {
+            for (; (x + 4) <= width; x += 4)
+                *p_dst++ = (uint8_t)(((p_src[x]     & 0x03) << 6) | ((p_src[x + 1] & 0x03) << 4) |
+                                     ((p_src[x + 2] & 0x03) << 2) |  (p_src[x + 3] & 0x03));
+        }
+
+        // Partial last byte of the row, unused bits stay zero
+        if (x < width) {
+            b = 0;
+            for (; x < width; x++)
+                packed_set_pixel(&b, x % (8 / bits), bits, p_src[x]);
+            *p_dst++ = b;
+        }
+    }
+}
+
+
+
+// Unpack a packed tile to one byte pixels (dst_stride bytes per destination row)
+void tile_packed_unpack(const uint8_t * p_src, uint16_t width, uint16_t height, uint8_t bits,
+                        uint8_t * p_dst, size_t dst_stride) {
+
+    uint16_t x, y;
+    uint32_t row_bytes;
+
+    row_bytes = tile_packed_get_row_bytes(width, bits);
+
+    for (y = 0; y < height; y++, p_src += row_bytes, p_dst += dst_stride)
+        for (x = 0; x < width; x++)
+            p_dst[x] = packed_get_pixel(p_src, x, bits);
+}
+
+
+
+// Mirror a packed tile horizontally
+//
+// * When rows fill whole bytes this is a byte order reversal
+//   plus reversing the pixels inside each byte, otherwise
+//   pixels get moved one at a time
+void tile_packed_flip_x(const uint8_t * p_src, uint8_t * p_dst, uint16_t width, uint16_t height, uint8_t bits) {
+
+    uint16_t x, y;
+    uint32_t c, row_bytes;
+
+    row_bytes = tile_packed_get_row_bytes(width, bits);
+
+    if ((((uint32_t)width * bits) % 8) == 0) {
+        for (y = 0; y < height; y++, p_src += row_bytes, p_dst += row_bytes)
+            for (c = 0; c < row_bytes; c++)
+                p_dst[row_bytes - 1 - c] = packed_reverse_byte(p_src[c], bits);
+    }
+    else {
+        for (y = 0; y < height; y++, p_src += row_bytes, p_dst += row_bytes) {
+            memset(p_dst, 0x00, row_bytes);
+            for (x = 0; x < width; x++)
+                packed_set_pixel(p_dst, width - 1 - x, bits, packed_get_pixel(p_src, x, bits));
+        }
+    }
+}
+
+
+
+// Mirror a packed tile vertically (whole rows, they're byte aligned)
+void tile_packed_flip_y(const uint8_t * p_src, uint8_t * p_dst, uint16_t width, uint16_t height, uint8_t bits) {
+
+    uint16_t y;
+    uint32_t row_bytes;
+
+    row_bytes = tile_packed_get_row_bytes(width, bits);
+    p_dst    += (size_t)(height - 1) * row_bytes;
+
+    for (y = 0; y < height; y++, p_src += row_bytes, p_dst -= row_bytes)
+        memcpy(p_dst, p_src, row_bytes);
+}
+
+
+
+// Reverse the order of the pixels inside one packed byte
+static inline uint8_t packed_reverse_byte(uint8_t b, uint8_t bits) {
+
+    // 2bpp: swap neighbouring pixels first, then the nibbles
+    if (bits == 2)
+        b = (uint8_t)(((b & 0x33) << 2) | ((b >> 2) & 0x33));
+
+    return (uint8_t)((b << 4) | (b >> 4));
+}
+
+
+
+static inline uint8_t packed_get_pixel(const uint8_t * p_row, uint16_t x, uint8_t bits) {
+
+    uint32_t bit = (uint32_t)x * bits;
+
+    return (p_row[bit / 8] >> (8 - bits - (bit % 8))) & ((1 << bits) - 1);
+}
+
+
+
+// ORs the value in, the pixel's bits must be zero beforehand
+static inline void packed_set_pixel(uint8_t * p_row, uint16_t x, uint8_t bits, uint8_t value) {
+
+    uint32_t bit = (uint32_t)x * bits;
+
+    p_row[bit / 8] |= (uint8_t)((value & ((1 << bits) - 1)) << (8 - bits - (bit % 8)));
+}
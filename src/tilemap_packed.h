@@ -0,0 +1,36 @@
+//
+// tilemap_packed.h
+//
+
+#ifndef __TILEMAP_PACKED_H_
+#define __TILEMAP_PACKED_H_
+
+    #include <stdint.h>
+    #include <stddef.h>
+
+    #include "image_info.h"
+
+    #define TILE_PACKED_BITS_NONE    0  // Tiles are kept as one byte per pixel
+    #define TILE_PACKED_COLORS_2BPP  4  // Indexed images with up to this many colors pack at 2 bits per pixel
+    #define TILE_PACKED_COLORS_4BPP  16 // ... and up to this many at 4 bits per pixel
+
+    enum tile_packing_modes {
+        TILE_PACKING_AUTO   = 0, // Pack where it measures faster (see tilemap_ctx_tile_set_initialize())
+        TILE_PACKING_ALWAYS = 1, // Pack whenever the colors allow it (smallest tile pixels)
+        TILE_PACKING_NEVER  = 2, // Keep one byte per pixel
+        TILE_PACKING_LAST
+    };
+
+    uint8_t  tile_packed_select_bits(uint8_t bytes_per_pixel, uint16_t color_count);
+    uint32_t tile_packed_get_row_bytes(uint16_t width, uint8_t bits);
+    uint32_t tile_packed_get_size(uint16_t width, uint16_t height, uint8_t bits);
+    int32_t  tile_packed_image_fits(image_data * p_img, uint8_t bits);
+
+    void     tile_packed_pack(const uint8_t * p_src, size_t src_stride, uint16_t width, uint16_t height,
+                              uint8_t bits, uint8_t * p_dst);
+    void     tile_packed_unpack(const uint8_t * p_src, uint16_t width, uint16_t height, uint8_t bits,
+                                uint8_t * p_dst, size_t dst_stride);
+    void     tile_packed_flip_x(const uint8_t * p_src, uint8_t * p_dst, uint16_t width, uint16_t height, uint8_t bits);
+    void     tile_packed_flip_y(const uint8_t * p_src, uint8_t * p_dst, uint16_t width, uint16_t height, uint8_t bits);
+
+#endif
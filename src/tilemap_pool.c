@@ -0,0 +1,367 @@
+//
+// tilemap_pool.c
+//
+
+// ========================
+//
+// Shared work-stealing thread pool.
+//
+// One set of worker threads is started per plug-in session
+// (sized to the machine) and reused by every stage that
+// can split its work into independent tasks, usually bands
+// of rows: the bulk dedupe engines, tile set reduction,
+// preview scaling and the overlay.
+//
+// * A run hands each worker a contiguous share of the task
+//   numbers. Workers take tasks from the front of their own
+//   share, and once it's empty steal the back half of
+//   another worker's share. Idle or early workers pick up
+//   whatever is left over from slow ones.
+// * Shares are a packed (next, end) pair updated with
+//   compare-and-swap, so taking and stealing need no locks.
+// * The calling thread works as worker 0 and the call
+//   blocks until every task is done.
+// * Runs started from inside a task, or while another run is
+//   in progress, just execute their tasks inline.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "tilemap_pool.h"
+
+
+// Task share of one worker, kept on its own cache line
+typedef struct {
+    uint64_t range;     // (next << 32) | end, tasks [next .. end) not taken yet
+    uint8_t  pad[56];
+} pool_queue;
+
+
+static pthread_mutex_t pool_lock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  pool_wake     = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  pool_done     = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t pool_run_lock = PTHREAD_MUTEX_INITIALIZER; // One run at a time
+
+static pthread_t       pool_threads[TILEMAP_POOL_THREADS_MAX];
+static uint32_t        pool_thread_count = 0;  // Started helper threads
+static int32_t         pool_started      = false;
+static int32_t         pool_stopping     = false;
+
+// Current run (guarded by pool_lock)
+static uint32_t               pool_generation = 0;
+static uint32_t               pool_active     = 0; // Helpers working on the current run
+static uint32_t               pool_joined     = 0; // Helpers that took part in the current run
+static tilemap_pool_task_func pool_task_func  = NULL; // NULL when no run is open
+static void *                 pool_p_arg      = NULL;
+
+static pool_queue      pool_queues[TILEMAP_POOL_THREADS_MAX];
+
+static __thread int32_t pool_in_worker = false;
+
+
+static uint32_t pool_machine_thread_count(void);
+static void *   pool_thread(void * p_arg);
+static void     pool_work(uint32_t worker, uint32_t worker_count, tilemap_pool_task_func task_func, void * p_arg);
+
+
+
+static inline uint64_t pool_range_pack(uint32_t next, uint32_t end) {
+    return ((uint64_t)next << 32) | end;
+}
+
+static inline uint32_t pool_range_next(uint64_t range) { return (uint32_t)(range >> 32); }
+static inline uint32_t pool_range_end(uint64_t range)  { return (uint32_t)range; }
+
+
+
+static uint32_t pool_machine_thread_count(void) {
+
+    long count;
+
+#ifdef _WIN32
+    SYSTEM_INFO sys_info;
+    GetSystemInfo(&sys_info);
+    count = sys_info.dwNumberOfProcessors;
+#else
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    if (count < 1)
+        count = 1;
+    else if (count > TILEMAP_POOL_THREADS_MAX)
+        count = TILEMAP_POOL_THREADS_MAX;
+
+    return (uint32_t)count;
+}
+
+
+
+// Take the next task from the front of a worker's own share
+static int32_t pool_take(uint32_t worker, uint32_t * p_task) {
+
+    uint64_t cur;
+
+    cur = __atomic_load_n(&pool_queues[worker].range, __ATOMIC_ACQUIRE);
+
+    while (pool_range_next(cur) < pool_range_end(cur)) {
+        if (__atomic_compare_exchange_n(&pool_queues[worker].range, &cur,
+                                        pool_range_pack(pool_range_next(cur) + 1, pool_range_end(cur)),
+                                        true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *p_task = pool_range_next(cur);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+// Steal the back half of another worker's share, run the first
+// stolen task now and keep the rest as this worker's own share
+//
+// * Only called once the worker's own share is empty, nobody
+//   else writes to an empty share
+static int32_t pool_steal(uint32_t worker, uint32_t worker_count, uint32_t * p_task) {
+
+    uint32_t c, victim, split;
+    uint64_t cur;
+
+    for (c = 1; c < worker_count; c++) {
+
+        victim = (worker + c) % worker_count;
+        cur    = __atomic_load_n(&pool_queues[victim].range, __ATOMIC_ACQUIRE);
+
+        while (pool_range_next(cur) < pool_range_end(cur)) {
+
+            split = pool_range_end(cur) - ((pool_range_end(cur) - pool_range_next(cur) + 1) / 2);
+
+            if (__atomic_compare_exchange_n(&pool_queues[victim].range, &cur,
+                                            pool_range_pack(pool_range_next(cur), split),
+                                            true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_store_n(&pool_queues[worker].range,
+                                 pool_range_pack(split + 1, pool_range_end(cur)), __ATOMIC_RELEASE);
+                *p_task = split;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+
+// Run tasks until there are none left to take or steal
+static void pool_work(uint32_t worker, uint32_t worker_count, tilemap_pool_task_func task_func, void * p_arg) {
+
+    uint32_t task;
+
+    while (pool_take(worker, &task) || pool_steal(worker, worker_count, &task))
+        task_func(p_arg, task, worker);
+}
+
+
+
+// Helper thread: wait for runs and work on them until shutdown
+static void * pool_thread(void * p_arg) {
+
+    uint32_t               worker, seen;
+    tilemap_pool_task_func task_func;
+    void                 * p_task_arg;
+
+    worker         = (uint32_t)(uintptr_t)p_arg;
+    seen           = 0;
+    pool_in_worker = true;
+
+    pthread_mutex_lock(&pool_lock);
+
+    while (true) {
+
+        // Runs that closed before this thread woke up are skipped
+        while (!pool_stopping && ((pool_generation == seen) || (pool_task_func == NULL))) {
+            seen = pool_generation;
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+
+        if (pool_stopping)
+            break;
+
+        seen       = pool_generation;
+        task_func  = pool_task_func;
+        p_task_arg = pool_p_arg;
+        pool_active++;
+        pool_joined++;
+
+        pthread_mutex_unlock(&pool_lock);
+        pool_work(worker, pool_thread_count + 1, task_func, p_task_arg);
+        pthread_mutex_lock(&pool_lock);
+
+        if (--pool_active == 0)
+            pthread_cond_broadcast(&pool_done);
+    }
+
+    pthread_mutex_unlock(&pool_lock);
+
+    return NULL;
+}
+
+
+
+// Start the pool's helper threads (once per session)
+//
+// * thread_count includes the calling thread,
+//   TILEMAP_POOL_THREADS_AUTO sizes the pool to the machine
+// * Does nothing if the pool is already running
+// * With one thread (or if no helpers start) runs are serial
+int32_t tilemap_pool_init(uint32_t thread_count) {
+
+    uint32_t c;
+
+    pthread_mutex_lock(&pool_lock);
+
+    if (pool_started) {
+        pthread_mutex_unlock(&pool_lock);
+        return true;
+    }
+
+    if (thread_count == TILEMAP_POOL_THREADS_AUTO)
+        thread_count = pool_machine_thread_count();
+    if (thread_count > TILEMAP_POOL_THREADS_MAX)
+        thread_count = TILEMAP_POOL_THREADS_MAX;
+
+    pool_stopping     = false;
+    pool_task_func    = NULL;
+    pool_thread_count = 0;
+
+    // Helper numbers are fixed per thread, so stop at the first failure
+    for (c = 1; c < thread_count; c++) {
+        if (pthread_create(&pool_threads[pool_thread_count], NULL, pool_thread, (void *)(uintptr_t)c) != 0)
+            break;
+        pool_thread_count++;
+    }
+
+    pool_started = true;
+
+    pthread_mutex_unlock(&pool_lock);
+
+    printf("Pool: Started with %d threads\n", pool_thread_count + 1);
+
+    return true;
+}
+
+
+
+// Stop and join the helper threads (end of session)
+void tilemap_pool_shutdown(void) {
+
+    uint32_t c;
+
+    pthread_mutex_lock(&pool_lock);
+
+    if (!pool_started) {
+        pthread_mutex_unlock(&pool_lock);
+        return;
+    }
+
+    pool_stopping = true;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    for (c = 0; c < pool_thread_count; c++)
+        pthread_join(pool_threads[c], NULL);
+
+    pthread_mutex_lock(&pool_lock);
+    pool_thread_count = 0;
+    pool_started      = false;
+    pool_stopping     = false;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+
+
+// Number of distinct worker numbers a task can be passed
+// (size of per-worker scratch arrays)
+uint32_t tilemap_pool_get_worker_count(void) {
+
+    if (!pool_started)
+        tilemap_pool_init(TILEMAP_POOL_THREADS_AUTO);
+
+    return pool_thread_count + 1;
+}
+
+
+
+// Run task_func for tasks 0 .. task_count - 1 across the pool and
+// wait for all of them to finish
+//
+// * Tasks may run in any order and on any worker
+// * Starts the pool if it isn't running yet
+// * Returns the number of threads that took part
+uint32_t tilemap_pool_run(uint32_t task_count, tilemap_pool_task_func task_func, void * p_arg) {
+
+    uint32_t worker_count, c;
+    uint32_t task, share, extra;
+    uint32_t joined;
+
+    if (task_count == 0)
+        return 0;
+
+    worker_count = tilemap_pool_get_worker_count();
+
+    // Nested, concurrent or single task runs go inline
+    if (pool_in_worker || (worker_count == 1) || (task_count == 1)
+        || (pthread_mutex_trylock(&pool_run_lock) != 0)) {
+
+        for (task = 0; task < task_count; task++)
+            task_func(p_arg, task, 0);
+        return 1;
+    }
+
+    // Contiguous shares, the first "extra" workers get one more task
+    share = task_count / worker_count;
+    extra = task_count % worker_count;
+    task  = 0;
+
+    for (c = 0; c < worker_count; c++) {
+        __atomic_store_n(&pool_queues[c].range,
+                         pool_range_pack(task, task + share + ((c < extra) ? 1 : 0)), __ATOMIC_RELAXED);
+        task += share + ((c < extra) ? 1 : 0);
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    pool_task_func = task_func;
+    pool_p_arg     = p_arg;
+    pool_joined    = 0;
+    pool_generation++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    pool_in_worker = true;
+    pool_work(0, worker_count, task_func, p_arg);
+    pool_in_worker = false;
+
+    // Nothing is left to take, close the run to latecomers and
+    // wait for helpers still finishing (or holding stolen) tasks
+    pthread_mutex_lock(&pool_lock);
+    pool_task_func = NULL;
+    while (pool_active > 0)
+        pthread_cond_wait(&pool_done, &pool_lock);
+    joined = pool_joined;
+    pthread_mutex_unlock(&pool_lock);
+
+    pthread_mutex_unlock(&pool_run_lock);
+
+    return joined + 1;
+}
@@ -0,0 +1,23 @@
+//
+// tilemap_pool.h
+//
+
+#ifndef __TILEMAP_POOL_H_
+#define __TILEMAP_POOL_H_
+
+    #include <stdint.h>
+
+    #define TILEMAP_POOL_THREADS_MAX   64
+    #define TILEMAP_POOL_THREADS_AUTO  0     // Size the pool to the machine
+
+    // Runs one task, "worker" is 0 .. tilemap_pool_get_worker_count() - 1
+    // and is only used by one task at a time (for per-worker scratch buffers)
+    typedef void (* tilemap_pool_task_func)(void * p_arg, uint32_t task, uint32_t worker);
+
+    int32_t  tilemap_pool_init(uint32_t thread_count);
+    void     tilemap_pool_shutdown(void);
+    uint32_t tilemap_pool_get_worker_count(void);
+
+    uint32_t tilemap_pool_run(uint32_t task_count, tilemap_pool_task_func task_func, void * p_arg);
+
+#endif
@@ -0,0 +1,626 @@
+//
+// tilemap_reduce.c
+//
+
+// ========================
+//
+// Reduce a deduplicated tile set down to a target
+// tile count by clustering visually similar tiles
+// (weighted k-medoids), then remap the tile map(s)
+// onto the cluster representatives
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#include "win_aligned_alloc.h"
+
+#include "tilemap_reduce.h"
+#include "tilemap_tiles.h"
+#include "tilemap_store.h"
+#include "tilemap_pool.h"
+
+#include "benchmark.h"
+
+
+#define REDUCE_ALIGN 16 // SIMD distance kernel works on 16 byte chunks
+
+
+// Upper triangle distance matrix between all tiles in a set,
+// calculated in square blocks of tiles spread across the thread pool
+typedef struct {
+    uint8_t  * p_pixels;      // All tiles expanded to RGB/A, one per tile_stride
+    uint32_t   tile_stride;   // Bytes per expanded tile (padded to REDUCE_ALIGN)
+    uint32_t   tile_count;
+    uint32_t * p_dist;        // tile_count * (tile_count - 1) / 2 entries
+
+    uint16_t * p_jobs;        // Block pairs (row, col), row <= col
+    uint32_t   job_count;
+} reduce_matrix;
+
+
+static int32_t  reduce_tiles_expand(reduce_matrix * p_mx, tile_set_data * p_tile_set, color_data * p_colormap);
+static int32_t  reduce_matrix_calc(reduce_matrix * p_mx);
+static void     reduce_matrix_task(void * p_arg, uint32_t job, uint32_t worker);
+static uint32_t reduce_tile_distance(const uint8_t * p_a, const uint8_t * p_b, uint32_t size_bytes);
+static void     reduce_kmedoids(reduce_matrix * p_mx, tile_set_data * p_tile_set,
+                                uint32_t * p_medoids, uint32_t target_count, uint32_t locked_count,
+                                uint32_t * p_assign);
+
+
+
+// Look up the distance between two tiles in the triangle matrix
+static inline uint32_t reduce_dist(reduce_matrix * p_mx, uint32_t a, uint32_t b) {
+
+    uint32_t t;
+
+    if (a == b)
+        return 0;
+
+    if (a > b) {
+        t = a; a = b; b = t;
+    }
+
+    return p_mx->p_dist[ ((size_t)a * p_mx->tile_count) - (((size_t)a * (a + 1)) / 2) + (b - a - 1) ];
+}
+
+
+
+// Sum of absolute differences between two expanded tiles
+//
+// * Buffers must be REDUCE_ALIGN aligned and padded with zeros
+static uint32_t reduce_tile_distance(const uint8_t * p_a, const uint8_t * p_b, uint32_t size_bytes) {
+
+    uint32_t c;
+
+#ifdef __SSE2__
+    __m128i  sum;
+
+    sum = _mm_setzero_si128();
+
+    for (c = 0; c < size_bytes; c += REDUCE_ALIGN)
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_load_si128((const __m128i *)(p_a + c)),
+                                              _mm_load_si128((const __m128i *)(p_b + c))));
+
+    // Fold the two 64 bit partial sums together
+    return (uint32_t)(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#else
+    uint32_t sum;
+
+    sum = 0;
+
+    for (c = 0; c < size_bytes; c++)
+        sum += (p_a[c] > p_b[c]) ? (p_a[c] - p_b[c]) : (p_b[c] - p_a[c]);
+
+    return sum;
+#endif
+}
+
+
+
+// Copy every tile into one packed buffer for the distance kernel
+//
+// Indexed tiles get expanded through the color map so that distances
+// are measured between actual colors rather than palette indexes
+static int32_t reduce_tiles_expand(reduce_matrix * p_mx, tile_set_data * p_tile_set, color_data * p_colormap) {
+
+    uint32_t   c, x, y;
+    uint32_t   expanded_bpp;
+    uint8_t  * p_dest;
+    uint8_t  * p_src;
+    uint8_t    index;
+    uint8_t  * p_unpacked;
+    tile_view  view;
+
+    // INDEXED -> RGB, INDEXED_ALPHA -> RGBA, RGB/A unchanged
+    if (p_tile_set->tile_bytes_per_pixel <= IMG_BITDEPTH_INDEXED_ALPHA)
+        expanded_bpp = COLOR_DATA_BYTES_PER_COLOR + (p_tile_set->tile_bytes_per_pixel - 1);
+    else
+        expanded_bpp = p_tile_set->tile_bytes_per_pixel;
+
+    p_mx->tile_stride = p_tile_set->tile_width * p_tile_set->tile_height * expanded_bpp;
+    p_mx->tile_stride = (p_mx->tile_stride + (REDUCE_ALIGN - 1)) & ~(REDUCE_ALIGN - 1);
+
+    p_mx->p_pixels = (uint8_t *)aligned_alloc(REDUCE_ALIGN, (size_t)p_mx->tile_stride * p_mx->tile_count);
+    if (!p_mx->p_pixels)
+        return false;
+
+    // Zero the padding so it doesn't contribute to distances
+    memset(p_mx->p_pixels, 0x00, (size_t)p_mx->tile_stride * p_mx->tile_count);
+
+    // Bit-packed tiles are unpacked here before expanding them
+    p_unpacked = NULL;
+    if (p_tile_set->pack_bits) {
+        p_unpacked = malloc(p_tile_set->tile_size);
+        if (!p_unpacked)
+            return false;
+    }
+
+    for (c = 0; c < p_mx->tile_count; c++) {
+
+        tile_get_view(p_tile_set, c, &view);
+        if (!view.p_data) {
+            free(p_unpacked);
+            return false;
+        }
+
+        if (view.packed_bits) {
+            tile_view_copy_to_buffer(&view, p_unpacked);
+            view.p_data      = p_unpacked;
+            view.row_stride  = view.width * view.bytes_per_pixel;
+            view.packed_bits = 0;
+        }
+
+        p_dest = p_mx->p_pixels + ((size_t)c * p_mx->tile_stride);
+
+        if (expanded_bpp == view.bytes_per_pixel)
+            tile_view_copy_to_buffer(&view, p_dest);
+        else {
+            for (y = 0; y < view.height; y++) {
+
+                p_src = view.p_data + (y * view.row_stride);
+
+                for (x = 0; x < view.width; x++) {
+
+                    index = *p_src;
+
+                    if (index < p_colormap->color_count)
+                        memcpy(p_dest, &p_colormap->pal[index * COLOR_DATA_BYTES_PER_COLOR], COLOR_DATA_BYTES_PER_COLOR);
+                    else
+                        memset(p_dest, 0x00, COLOR_DATA_BYTES_PER_COLOR);
+                    p_dest += COLOR_DATA_BYTES_PER_COLOR;
+
+                    // Carry alpha through for indexed-alpha
+                    if (view.bytes_per_pixel == IMG_BITDEPTH_INDEXED_ALPHA)
+                        *p_dest++ = *(p_src + 1);
+
+                    p_src += view.bytes_per_pixel;
+                }
+            }
+        }
+    }
+
+    free(p_unpacked);
+
+    return true;
+}
+
+
+
+// Pool task: distances for one block pair
+static void reduce_matrix_task(void * p_arg, uint32_t job, uint32_t worker) {
+
+    reduce_matrix * p_mx;
+    uint32_t        a, b;
+    uint32_t        a_start, a_end, b_start, b_end;
+    uint32_t      * p_row;
+    uint8_t       * p_tile_a;
+
+    (void)worker;
+
+    p_mx = (reduce_matrix *)p_arg;
+
+    a_start = p_mx->p_jobs[(job * 2)    ] * REDUCE_BLOCK_TILES;
+    b_start = p_mx->p_jobs[(job * 2) + 1] * REDUCE_BLOCK_TILES;
+
+    a_end = a_start + REDUCE_BLOCK_TILES;
+    b_end = b_start + REDUCE_BLOCK_TILES;
+    if (a_end > p_mx->tile_count) a_end = p_mx->tile_count;
+    if (b_end > p_mx->tile_count) b_end = p_mx->tile_count;
+
+    // Both blocks of tiles stay cache resident while they get compared
+    for (a = a_start; a < a_end; a++) {
+
+        p_tile_a = p_mx->p_pixels + ((size_t)a * p_mx->tile_stride);
+
+        // Start of row "a" in the triangle matrix (entry for b = a + 1)
+        p_row = p_mx->p_dist + ((size_t)a * p_mx->tile_count) - (((size_t)a * (a + 1)) / 2);
+
+        for (b = (b_start > a) ? b_start : (a + 1); b < b_end; b++)
+            p_row[b - a - 1] = reduce_tile_distance(p_tile_a,
+                                            p_mx->p_pixels + ((size_t)b * p_mx->tile_stride),
+                                            p_mx->tile_stride);
+    }
+}
+
+
+
+static int32_t reduce_matrix_calc(reduce_matrix * p_mx) {
+
+    uint32_t   block_count;
+    uint32_t   row, col;
+    uint32_t   threads;
+
+    p_mx->p_dist = malloc( (((size_t)p_mx->tile_count * (p_mx->tile_count - 1)) / 2) * sizeof(uint32_t) );
+    if (!p_mx->p_dist)
+        return false;
+
+    // Build list of block pairs on or above the diagonal
+    block_count = (p_mx->tile_count + (REDUCE_BLOCK_TILES - 1)) / REDUCE_BLOCK_TILES;
+
+    p_mx->p_jobs = malloc( ((block_count * (block_count + 1)) / 2) * 2 * sizeof(uint16_t) );
+    if (!p_mx->p_jobs)
+        return false;
+
+    p_mx->job_count = 0;
+
+    for (row = 0; row < block_count; row++)
+        for (col = row; col < block_count; col++) {
+            p_mx->p_jobs[(p_mx->job_count * 2)    ] = row;
+            p_mx->p_jobs[(p_mx->job_count * 2) + 1] = col;
+            p_mx->job_count++;
+        }
+
+    threads = tilemap_pool_run(p_mx->job_count, reduce_matrix_task, p_mx);
+
+    printf("Reduce: Distance matrix: %d tiles, %d blocks, %d threads\n",
+           p_mx->tile_count, p_mx->job_count, threads);
+
+    return true;
+}
+
+
+
+// Weighted k-medoids (alternating assignment / medoid update)
+//
+// * Tiles are weighted by their number of uses in the map, so
+//   frequently used tiles are less likely to get merged away
+// * Seeded with weighted farthest-point selection, starting
+//   from the most used tile. Deterministic for a given input.
+// * Locked tiles (IDs below locked_count) are fixed medoids
+//   0 .. locked_count - 1 and stay in their own clusters,
+//   seeding starts from them instead
+// * Every medoid stays in its own cluster, so identical tiles
+//   (e.g. duplicate palette entries) never end up sharing one
+static void reduce_kmedoids(reduce_matrix * p_mx, tile_set_data * p_tile_set,
+                            uint32_t * p_medoids, uint32_t target_count, uint32_t locked_count,
+                            uint32_t * p_assign) {
+
+    uint32_t   c, m, i, iter, m_first;
+    uint32_t   n;
+    uint32_t   best_idx, best_dist, dist;
+    uint64_t   best_score, score;
+    uint32_t * p_nearest;
+    uint32_t * p_offsets;
+    uint32_t * p_members;
+    uint32_t * p_fill;
+    uint32_t * p_slot;
+    uint8_t  * p_is_medoid;
+    int        changed;
+
+    n = p_mx->tile_count;
+
+    p_nearest   = malloc(n * sizeof(uint32_t));
+    p_members   = malloc(n * sizeof(uint32_t));
+    p_offsets   = malloc((target_count + 1) * sizeof(uint32_t));
+    p_fill      = malloc(target_count * sizeof(uint32_t));
+    p_slot      = malloc(n * sizeof(uint32_t));
+    p_is_medoid = calloc(n, sizeof(uint8_t));
+
+    if (!(p_nearest && p_members && p_offsets && p_fill && p_slot && p_is_medoid)) {
+        // Fall back to keeping the first N tiles as-is
+        for (m = 0; m < target_count; m++)
+            p_medoids[m] = m;
+        for (i = 0; i < n; i++)
+            p_assign[i] = (i < target_count) ? i : 0;
+        goto cleanup;
+    }
+
+    // == Seed ==
+    if (locked_count) {
+        for (i = 0; i < n; i++)
+            p_nearest[i] = UINT32_MAX;
+
+        for (m = 0; m < locked_count; m++) {
+            p_medoids[m] = m;
+            p_is_medoid[m] = true;
+
+            for (i = 0; i < n; i++) {
+                dist = reduce_dist(p_mx, i, m);
+                if (dist < p_nearest[i])
+                    p_nearest[i] = dist;
+            }
+        }
+        m_first = locked_count;
+    }
+    else {
+        best_idx = 0;
+        for (i = 1; i < n; i++)
+            if (p_tile_set->tiles[i].map_entry_count > p_tile_set->tiles[best_idx].map_entry_count)
+                best_idx = i;
+
+        p_medoids[0] = best_idx;
+        p_is_medoid[best_idx] = true;
+
+        for (i = 0; i < n; i++)
+            p_nearest[i] = reduce_dist(p_mx, i, best_idx);
+
+        m_first = 1;
+    }
+
+    for (m = m_first; m < target_count; m++) {
+
+        best_score = 0;
+        best_idx   = n;
+
+        for (i = 0; i < n; i++) {
+            if (p_is_medoid[i])
+                continue;
+
+            score = (uint64_t)p_nearest[i] * p_tile_set->tiles[i].map_entry_count;
+            if ((best_idx == n) || (score > best_score)) {
+                best_score = score;
+                best_idx   = i;
+            }
+        }
+
+        p_medoids[m] = best_idx;
+        p_is_medoid[best_idx] = true;
+
+        for (i = 0; i < n; i++) {
+            dist = reduce_dist(p_mx, i, best_idx);
+            if (dist < p_nearest[i])
+                p_nearest[i] = dist;
+        }
+    }
+
+
+    // == Refine ==
+    for (iter = 0; iter < REDUCE_ITERATIONS_MAX; iter++) {
+
+        // Cluster of each medoid tile
+        for (i = 0; i < n; i++)
+            p_slot[i] = UINT32_MAX;
+        for (m = 0; m < target_count; m++)
+            p_slot[ p_medoids[m] ] = m;
+
+        // Assign each tile to its closest medoid
+        // (medoids and locked tiles to themselves, even if another medoid is identical)
+        for (i = 0; i < n; i++) {
+
+            if (p_slot[i] != UINT32_MAX) {
+                p_assign[i] = p_slot[i];
+                continue;
+            }
+
+            best_dist = UINT32_MAX;
+            best_idx  = 0;
+
+            for (m = 0; m < target_count; m++) {
+                dist = reduce_dist(p_mx, i, p_medoids[m]);
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best_idx  = m;
+                }
+            }
+            p_assign[i] = best_idx;
+        }
+
+        // Group tiles by cluster (counting sort)
+        memset(p_offsets, 0x00, (target_count + 1) * sizeof(uint32_t));
+        for (i = 0; i < n; i++)
+            p_offsets[p_assign[i] + 1]++;
+        for (m = 0; m < target_count; m++)
+            p_offsets[m + 1] += p_offsets[m];
+
+        memcpy(p_fill, p_offsets, target_count * sizeof(uint32_t));
+        for (i = 0; i < n; i++)
+            p_members[ p_fill[p_assign[i]]++ ] = i;
+
+        // Move each medoid to the member with the lowest weighted distance to the rest
+        changed = false;
+
+        for (m = locked_count; m < target_count; m++) {
+
+            best_score = UINT64_MAX;
+            best_idx   = p_medoids[m];
+
+            for (c = p_offsets[m]; c < p_offsets[m + 1]; c++) {
+
+                // Tiles that already represent another cluster can't move here
+                if (p_is_medoid[ p_members[c] ] && (p_members[c] != p_medoids[m]))
+                    continue;
+
+                score = 0;
+                for (i = p_offsets[m]; i < p_offsets[m + 1]; i++)
+                    score += (uint64_t)reduce_dist(p_mx, p_members[c], p_members[i])
+                             * p_tile_set->tiles[ p_members[i] ].map_entry_count;
+
+                // Prefer the lowest tile ID on ties to keep results stable
+                if ((score < best_score) ||
+                    ((score == best_score) && (p_members[c] < best_idx))) {
+                    best_score = score;
+                    best_idx   = p_members[c];
+                }
+            }
+
+            if (best_idx != p_medoids[m]) {
+                p_is_medoid[ p_medoids[m] ] = false;
+                p_is_medoid[best_idx]       = true;
+                p_medoids[m] = best_idx;
+                changed = true;
+            }
+        }
+
+        if (!changed)
+            break;
+    }
+
+    printf("Reduce: k-medoids: %d -> %d tiles, %d iterations\n", n, target_count, iter + 1);
+
+cleanup:
+    free(p_nearest);
+    free(p_members);
+    free(p_offsets);
+    free(p_fill);
+    free(p_slot);
+    free(p_is_medoid);
+}
+
+
+
+// Reduce the tile set of a single map, see tilemap_reduce_tile_set_maps()
+int32_t tilemap_reduce_tile_set(tile_map_data * p_map, tile_set_data * p_tile_set,
+                                color_data * p_colormap, uint32_t target_count) {
+
+    return tilemap_reduce_tile_set_maps(&p_map, 1, p_tile_set, p_colormap, target_count);
+}
+
+
+
+// Reduce the tile set to (at most) target_count tiles
+//
+// * Each entry of every map sharing the tile set gets remapped to
+//   its cluster representative, flip attributes are kept as-is
+// * Representatives keep their relative (first-occurrence) order
+// * Per map entry error (sum of absolute color differences against
+//   the representative) is stored in each map's tile_error_list
+// * Locked base tiles always survive with their IDs, so the target
+//   can't go below their count (see tilemap_base.c)
+//
+// Returns false on failure, tile set and maps are left unchanged
+int32_t tilemap_reduce_tile_set_maps(tile_map_data ** pp_maps, uint32_t map_count, tile_set_data * p_tile_set,
+                                     color_data * p_colormap, uint32_t target_count) {
+
+    reduce_matrix   mx;
+    tile_map_data * p_map;
+    uint32_t        c, m, n, i;
+    uint32_t        new_id;
+    int32_t         status;
+    uint32_t      * p_medoids;
+    uint32_t      * p_assign;
+    uint32_t      * p_remap;
+    uint32_t      * p_error;
+    uint32_t      * p_cluster_id;
+    uint32_t      * p_cluster_err;
+    uint8_t       * p_is_medoid;
+
+    n = p_tile_set->tile_count;
+
+    if ((target_count != REDUCE_TARGET_NONE) && (target_count < p_tile_set->tile_count_locked)) {
+        printf("Reduce: target %d is below the %d locked tiles, using %d\n", target_count,
+               p_tile_set->tile_count_locked, p_tile_set->tile_count_locked);
+        target_count = p_tile_set->tile_count_locked;
+    }
+
+    if ((target_count == REDUCE_TARGET_NONE) || (n <= target_count))
+        return true; // Nothing to do
+
+printf("Reduce: Start -> %d tiles to %d  .. ", n, target_count);
+benchmark_start();
+
+    memset(&mx, 0x00, sizeof(mx));
+    mx.tile_count = n;
+
+    p_medoids     = malloc(target_count * sizeof(uint32_t));
+    p_cluster_id  = malloc(target_count * sizeof(uint32_t));
+    p_cluster_err = calloc(target_count, sizeof(uint32_t));
+    p_assign      = malloc(n * sizeof(uint32_t));
+    p_remap       = malloc(n * sizeof(uint32_t));
+    p_error       = malloc(n * sizeof(uint32_t));
+    p_is_medoid   = calloc(n, sizeof(uint8_t));
+
+    status = (p_medoids && p_cluster_id && p_cluster_err && p_assign && p_remap && p_error && p_is_medoid);
+
+    if (status)
+        status = reduce_tiles_expand(&mx, p_tile_set, p_colormap);
+
+    if (status)
+        status = reduce_matrix_calc(&mx);
+
+    for (i = 0; status && (i < map_count); i++) {
+        pp_maps[i]->tile_error_list = malloc(pp_maps[i]->size * sizeof(uint32_t));
+        status = (pp_maps[i]->tile_error_list != NULL);
+    }
+
+    if (status) {
+
+        reduce_kmedoids(&mx, p_tile_set, p_medoids, target_count, p_tile_set->tile_count_locked, p_assign);
+
+        // Number the surviving tiles in their original order
+        for (m = 0; m < target_count; m++)
+            p_is_medoid[ p_medoids[m] ] = true;
+
+        new_id = 0;
+        for (c = 0; c < n; c++)
+            if (p_is_medoid[c])
+                p_remap[c] = new_id++;
+
+        for (m = 0; m < target_count; m++)
+            p_cluster_id[m] = p_remap[ p_medoids[m] ];
+
+        // Resolve every tile to its representative's new ID
+        for (c = 0; c < n; c++) {
+            m = p_assign[c];
+            p_error[c] = reduce_dist(&mx, c, p_medoids[m]);
+            p_remap[c] = p_cluster_id[m];
+
+            if (p_error[c] > p_cluster_err[m])
+                p_cluster_err[m] = p_error[c];
+        }
+
+        // Remap the tile maps
+        for (i = 0; i < map_count; i++) {
+
+            p_map = pp_maps[i];
+            p_map->tile_error_max = 0;
+
+            for (c = 0; c < p_map->size; c++) {
+                p_map->tile_error_list[c] = p_error[ p_map->tile_id_list[c] ];
+                p_map->tile_id_list[c]    = p_remap[ p_map->tile_id_list[c] ];
+
+                if (p_map->tile_error_list[c] > p_map->tile_error_max)
+                    p_map->tile_error_max = p_map->tile_error_list[c];
+            }
+        }
+
+        // Merge usage counts into the representatives, release the others
+        for (c = 0; c < n; c++) {
+            if (!p_is_medoid[c]) {
+                p_tile_set->tiles[ p_medoids[p_assign[c]] ].map_entry_count += p_tile_set->tiles[c].map_entry_count;
+
+                tile_release_pixels(p_tile_set, &p_tile_set->tiles[c]);
+            }
+        }
+
+        for (m = 0; m < target_count; m++)
+            p_tile_set->tiles[ p_medoids[m] ].reduce_error = p_cluster_err[m];
+
+        // Compact the tile set (new IDs are never higher than old ones)
+        for (c = 0; c < n; c++)
+            if (p_is_medoid[c] && (p_remap[c] != c))
+                memcpy(&p_tile_set->tiles[ p_remap[c] ], &p_tile_set->tiles[c], sizeof(tile_data));
+
+        p_tile_set->tile_count_unreduced = n;
+        p_tile_set->tile_count           = new_id;
+    }
+    else {
+        for (i = 0; i < map_count; i++) {
+            if (pp_maps[i]->tile_error_list)
+                free(pp_maps[i]->tile_error_list);
+            pp_maps[i]->tile_error_list = NULL;
+        }
+        printf("Reduce: FAIL -> could not allocate working buffers\n");
+    }
+
+    free(mx.p_pixels);
+    free(mx.p_dist);
+    free(mx.p_jobs);
+    free(p_medoids);
+    free(p_cluster_id);
+    free(p_cluster_err);
+    free(p_assign);
+    free(p_remap);
+    free(p_error);
+    free(p_is_medoid);
+
+benchmark_elapsed();
+
+    return (status);
+}
@@ -0,0 +1,21 @@
+//
+// tilemap_reduce.h
+//
+
+#ifndef __TILEMAP_REDUCE_H_
+#define __TILEMAP_REDUCE_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define REDUCE_TARGET_NONE       0     // Tile set reduction disabled
+    #define REDUCE_BLOCK_TILES       64    // Tiles per side of a distance matrix block
+    #define REDUCE_ITERATIONS_MAX    20    // k-medoids refinement passes
+
+    int32_t tilemap_reduce_tile_set(tile_map_data * p_map, tile_set_data * p_tile_set,
+                                    color_data * p_colormap, uint32_t target_count);
+    int32_t tilemap_reduce_tile_set_maps(tile_map_data ** pp_maps, uint32_t map_count, tile_set_data * p_tile_set,
+                                         color_data * p_colormap, uint32_t target_count);
+
+#endif
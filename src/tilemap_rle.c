@@ -0,0 +1,216 @@
+//
+// tilemap_rle.c
+//
+
+// ========================
+//
+// Run-length encoded map rows.
+//
+// Each map row is stored as a list of runs (starting
+// column + packed entry word), with a per-row index
+// pointing at the first run of every row. Random access
+// is a binary search over the runs of one row, exports
+// walk the runs in order with a tile_map_iter.
+//
+// Built from the packed map (tilemap_map_pack()) and only
+// kept when it is smaller than the packed entries.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#include "tilemap_rle.h"
+
+
+
+// Size in bytes of an RLE map with a given run count
+static uint64_t rle_calc_size_bytes(tile_map_data * p_map, uint32_t run_count) {
+
+    return ((uint64_t)(p_map->height_in_tiles + 1) * sizeof(uint32_t))  // Row index
+           + ((uint64_t)run_count * (sizeof(uint32_t) * 2));             // Run column + entry
+}
+
+
+
+// Count the runs of a packed map and set the RLE size it would have
+// (cheap enough to always run, so the size can be reported)
+void tilemap_rle_measure(tile_map_data * p_map) {
+
+    uint32_t x, y;
+    uint32_t index;
+    uint32_t entry, entry_last;
+
+    if (!p_map->p_packed)
+        return;
+
+    p_map->rle_run_count = 0;
+    index = 0;
+
+    for (y = 0; y < p_map->height_in_tiles; y++) {
+        entry_last = 0;
+        for (x = 0; x < p_map->width_in_tiles; x++, index++) {
+            entry = tilemap_map_get_entry(p_map, index);
+            if ((x == 0) || (entry != entry_last))
+                p_map->rle_run_count++;
+            entry_last = entry;
+        }
+    }
+
+    p_map->rle_size_bytes = rle_calc_size_bytes(p_map, p_map->rle_run_count);
+}
+
+
+
+// Convert a packed map to RLE rows and release the packed entries
+//
+// * Keeps the packed entries if RLE wouldn't be smaller,
+//   p_map->rle_size_bytes reports the RLE size either way
+// * Returns false only on allocation failure
+int32_t tilemap_rle_encode(tile_map_data * p_map) {
+
+    uint32_t   x, y;
+    uint32_t   index;
+    uint32_t   run;
+    uint32_t   entry, entry_last;
+    uint32_t * p_row_index;
+    uint32_t * p_run_x;
+    uint32_t * p_run_entry;
+
+    if (!p_map->p_packed)
+        return (p_map->p_rle_run_x != NULL); // Must be packed first (or already RLE)
+
+    // First pass: count the runs
+    tilemap_rle_measure(p_map);
+
+    printf("Tilemap: RLE map %" PRIu32 " runs, %" PRIu64 " bytes (flat %" PRIu64 " bytes)%s\n",
+           p_map->rle_run_count, p_map->rle_size_bytes,
+           (uint64_t)p_map->size * p_map->packed_entry_bytes,
+           (p_map->rle_size_bytes < (uint64_t)p_map->size * p_map->packed_entry_bytes) ? "" : " -> keeping flat");
+
+    if (p_map->rle_size_bytes >= (uint64_t)p_map->size * p_map->packed_entry_bytes)
+        return true;
+
+    // Built in locals, the map reads as RLE as soon as p_rle_run_x is set
+    p_row_index = malloc((size_t)(p_map->height_in_tiles + 1) * sizeof(uint32_t));
+    p_run_x     = malloc((size_t)p_map->rle_run_count * sizeof(uint32_t));
+    p_run_entry = malloc((size_t)p_map->rle_run_count * sizeof(uint32_t));
+
+    if (!(p_row_index && p_run_x && p_run_entry)) {
+        free(p_row_index);
+        free(p_run_x);
+        free(p_run_entry);
+        return false;
+    }
+
+    // Second pass: store the runs
+    run   = 0;
+    index = 0;
+
+    for (y = 0; y < p_map->height_in_tiles; y++) {
+
+        p_row_index[y] = run;
+        entry_last = 0;
+
+        for (x = 0; x < p_map->width_in_tiles; x++, index++) {
+            entry = tilemap_map_get_entry(p_map, index);
+
+            if ((x == 0) || (entry != entry_last)) {
+                p_run_x[run]     = x;
+                p_run_entry[run] = entry;
+                run++;
+            }
+            entry_last = entry;
+        }
+    }
+    p_row_index[p_map->height_in_tiles] = run;
+
+    // Runs replace the packed entries
+    free(p_map->p_packed);
+    p_map->p_packed = NULL;
+
+    p_map->p_rle_row_index = p_row_index;
+    p_map->p_rle_run_x     = p_run_x;
+    p_map->p_rle_run_entry = p_run_entry;
+
+    return true;
+}
+
+
+
+// Packed entry word at a map index, O(log runs in row)
+uint32_t tilemap_rle_get_entry(tile_map_data * p_map, uint32_t index) {
+
+    uint32_t x, y;
+    uint32_t lo, hi, mid;
+
+    y = index / p_map->width_in_tiles;
+    x = index % p_map->width_in_tiles;
+
+    // Find the last run in the row starting at or before x
+    // (the first run of a row always starts at column 0)
+    lo = p_map->p_rle_row_index[y];
+    hi = p_map->p_rle_row_index[y + 1] - 1;
+
+    while (lo < hi) {
+        mid = lo + ((hi - lo + 1) / 2);
+
+        if (p_map->p_rle_run_x[mid] <= x)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return p_map->p_rle_run_entry[lo];
+}
+
+
+
+uint64_t tilemap_rle_get_size_bytes(tile_map_data * p_map) {
+    return rle_calc_size_bytes(p_map, p_map->rle_run_count);
+}
+
+
+
+// Duplicate the RLE rows of p_src_map into p_dst_map (other fields untouched)
+int32_t tilemap_rle_copy(tile_map_data * p_dst_map, tile_map_data * p_src_map) {
+
+    size_t index_bytes, run_bytes;
+
+    index_bytes = (size_t)(p_src_map->height_in_tiles + 1) * sizeof(uint32_t);
+    run_bytes   = (size_t)p_src_map->rle_run_count * sizeof(uint32_t);
+
+    p_dst_map->p_rle_row_index = malloc(index_bytes);
+    p_dst_map->p_rle_run_x     = malloc(run_bytes);
+    p_dst_map->p_rle_run_entry = malloc(run_bytes);
+
+    if (!(p_dst_map->p_rle_row_index && p_dst_map->p_rle_run_x && p_dst_map->p_rle_run_entry)) {
+        tilemap_rle_free(p_dst_map);
+        return false;
+    }
+
+    memcpy(p_dst_map->p_rle_row_index, p_src_map->p_rle_row_index, index_bytes);
+    memcpy(p_dst_map->p_rle_run_x,     p_src_map->p_rle_run_x,     run_bytes);
+    memcpy(p_dst_map->p_rle_run_entry, p_src_map->p_rle_run_entry, run_bytes);
+
+    return true;
+}
+
+
+
+void tilemap_rle_free(tile_map_data * p_map) {
+
+    if (p_map->p_rle_row_index)
+        free(p_map->p_rle_row_index);
+    p_map->p_rle_row_index = NULL;
+
+    if (p_map->p_rle_run_x)
+        free(p_map->p_rle_run_x);
+    p_map->p_rle_run_x = NULL;
+
+    if (p_map->p_rle_run_entry)
+        free(p_map->p_rle_run_entry);
+    p_map->p_rle_run_entry = NULL;
+}
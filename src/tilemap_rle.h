@@ -0,0 +1,19 @@
+//
+// tilemap_rle.h
+//
+
+#ifndef __TILEMAP_RLE_H_
+#define __TILEMAP_RLE_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    void     tilemap_rle_measure(tile_map_data * p_map);
+    int32_t  tilemap_rle_encode(tile_map_data * p_map);
+    uint32_t tilemap_rle_get_entry(tile_map_data * p_map, uint32_t index);
+    uint64_t tilemap_rle_get_size_bytes(tile_map_data * p_map);
+    int32_t  tilemap_rle_copy(tile_map_data * p_dst_map, tile_map_data * p_src_map);
+    void     tilemap_rle_free(tile_map_data * p_map);
+
+#endif
@@ -0,0 +1,232 @@
+//
+// tilemap_rooms.c
+//
+
+// ========================
+//
+// Room (chunk) split of a processed map.
+//
+// Games that load a tile set per room (or screen) need to
+// know the tile count of every room, not of the whole map.
+// The map gets split into fixed size rooms, each room gets
+// a local tile set (the global tiles it uses, in order of
+// first use) and a local map indexing into it. A global
+// table counts the rooms using each tile, so tiles shared
+// between rooms stand out.
+//
+// Rooms are built from the global map instead of running
+// the dedupe again per room: the global pass already
+// matched every cell (including flips) to a unique tile,
+// so a room's unique tiles are the distinct global IDs in
+// it. That keeps the result consistent with the global
+// tile set and costs one pass over the map IDs.
+//
+// Rooms don't depend on each other, so they get built in
+// parallel on the shared thread pool. Each worker marks the
+// IDs it has seen with the room number, which avoids
+// clearing its lookup table between rooms.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_rooms.h"
+#include "tilemap_pool.h"
+
+#include "benchmark.h"
+
+
+typedef struct {
+    tile_rooms_data * p_rooms;
+    const uint32_t  * p_ids;       // Map tile IDs, row-major
+    uint32_t          stride;      // Map width in tiles
+    uint32_t        * p_stamps;    // Per worker: room number + 1 that last used each global ID
+    uint16_t        * p_local;     // Per worker: local ID of each global ID in that room
+} rooms_job;
+
+
+static void rooms_build_task(void * p_arg, uint32_t room, uint32_t worker);
+
+
+
+// Pool task: local tile set and map of one room
+static void rooms_build_task(void * p_arg, uint32_t room, uint32_t worker) {
+
+    rooms_job      * p_job   = (rooms_job *)p_arg;
+    tile_room_data * p_room  = &p_job->p_rooms->p_rooms[room];
+    uint32_t       * p_stamp = p_job->p_stamps + ((size_t)worker * p_job->p_rooms->tile_count);
+    uint16_t       * p_local = p_job->p_local  + ((size_t)worker * p_job->p_rooms->tile_count);
+    uint32_t       * p_tile_ids;
+    uint16_t       * p_cell_ids;
+    const uint32_t * p_row;
+    uint32_t         x, y, id;
+    uint32_t         stamp, count;
+
+    p_tile_ids = p_job->p_rooms->p_tile_ids + p_room->offset;
+    p_cell_ids = p_job->p_rooms->p_cell_ids + p_room->offset;
+    stamp      = room + 1;
+    count      = 0;
+
+    for (y = 0; y < p_room->height; y++) {
+
+        p_row = p_job->p_ids + ((size_t)(p_room->y + y) * p_job->stride) + p_room->x;
+
+        for (x = 0; x < p_room->width; x++) {
+            id = p_row[x];
+
+            if (p_stamp[id] != stamp) {
+                p_stamp[id]       = stamp;
+                p_local[id]       = (uint16_t)count;
+                p_tile_ids[count] = id;
+                count++;
+            }
+
+            *p_cell_ids++ = p_local[id];
+        }
+    }
+
+    p_room->tile_count = count;
+}
+
+
+
+// Split a processed map into room_width x room_height rooms,
+// each with its own local tile set and map
+//
+// * Reads tile_id_list when present (before packing),
+//   otherwise decodes the packed or RLE entries first
+// * tile_count: global tile count (size of the shared tile table)
+// * room_width or room_height ROOMS_SIZE_NONE: clears any previous result
+int32_t tilemap_rooms_calc(tile_rooms_data * p_rooms, tile_map_data * p_map, uint32_t tile_count,
+                           uint16_t room_width, uint16_t room_height) {
+
+    rooms_job        job;
+    tile_room_data * p_room;
+    uint32_t       * p_ids_decoded;
+    uint32_t         c, r, rx, ry, offset, worker_count;
+
+    tilemap_rooms_free(p_rooms);
+
+    if ((room_width == ROOMS_SIZE_NONE) || (room_height == ROOMS_SIZE_NONE)
+        || (p_map->width_in_tiles == 0) || (p_map->height_in_tiles == 0))
+        return true;
+
+    if (room_width  > ROOMS_SIZE_MAX) room_width  = ROOMS_SIZE_MAX;
+    if (room_height > ROOMS_SIZE_MAX) room_height = ROOMS_SIZE_MAX;
+
+    printf("Rooms: Start -> %d x %d rooms over %d x %d map  ", room_width, room_height,
+           p_map->width_in_tiles, p_map->height_in_tiles);
+    benchmark_start();
+
+    p_ids_decoded = NULL;
+    if (p_map->tile_id_list)
+        job.p_ids = p_map->tile_id_list;
+    else {
+        p_ids_decoded = tilemap_map_decode_ids(p_map);
+        if (!p_ids_decoded)
+            return false;
+        job.p_ids = p_ids_decoded;
+    }
+
+    // Reduction can leave gaps, so make sure every ID in use fits the table
+    for (c = 0; c < p_map->size; c++)
+        if (job.p_ids[c] >= tile_count)
+            tile_count = job.p_ids[c] + 1;
+
+    p_rooms->room_width  = room_width;
+    p_rooms->room_height = room_height;
+    p_rooms->rooms_x     = (p_map->width_in_tiles  + (room_width  - 1)) / room_width;
+    p_rooms->rooms_y     = (p_map->height_in_tiles + (room_height - 1)) / room_height;
+    p_rooms->count       = p_rooms->rooms_x * p_rooms->rooms_y;
+    p_rooms->tile_count  = tile_count;
+
+    worker_count = tilemap_pool_get_worker_count();
+
+    job.p_rooms  = p_rooms;
+    job.stride   = p_map->width_in_tiles;
+    job.p_stamps = calloc((size_t)worker_count * tile_count, sizeof(uint32_t));
+    job.p_local  = malloc((size_t)worker_count * tile_count * sizeof(uint16_t));
+
+    p_rooms->p_rooms     = calloc(p_rooms->count, sizeof(tile_room_data));
+    p_rooms->p_tile_ids  = malloc((size_t)p_map->size * sizeof(uint32_t));
+    p_rooms->p_cell_ids  = malloc((size_t)p_map->size * sizeof(uint16_t));
+    p_rooms->p_room_refs = calloc(tile_count, sizeof(uint32_t));
+
+    if (!job.p_stamps || !job.p_local || !p_rooms->p_rooms || !p_rooms->p_tile_ids
+        || !p_rooms->p_cell_ids || !p_rooms->p_room_refs) {
+        free(job.p_stamps);
+        free(job.p_local);
+        free(p_ids_decoded);
+        tilemap_rooms_free(p_rooms);
+        return false;
+    }
+
+    // Room layout, a room's local tiles and cells start at its first cell
+    offset = 0;
+    for (ry = 0; ry < p_rooms->rooms_y; ry++)
+        for (rx = 0; rx < p_rooms->rooms_x; rx++) {
+            p_room         = &p_rooms->p_rooms[(ry * p_rooms->rooms_x) + rx];
+            p_room->x      = rx * room_width;
+            p_room->y      = ry * room_height;
+            p_room->width  = ((p_room->x + room_width)  <= p_map->width_in_tiles)
+                             ? room_width  : (p_map->width_in_tiles  - p_room->x);
+            p_room->height = ((p_room->y + room_height) <= p_map->height_in_tiles)
+                             ? room_height : (p_map->height_in_tiles - p_room->y);
+            p_room->offset = offset;
+            offset += (uint32_t)p_room->width * p_room->height;
+        }
+
+    tilemap_pool_run(p_rooms->count, rooms_build_task, &job);
+
+    // Shared table: rooms using each global tile
+    for (r = 0; r < p_rooms->count; r++) {
+        p_room = &p_rooms->p_rooms[r];
+        for (c = 0; c < p_room->tile_count; c++)
+            p_rooms->p_room_refs[p_rooms->p_tile_ids[p_room->offset + c]]++;
+    }
+
+    for (c = 0; c < tile_count; c++)
+        if (p_rooms->p_room_refs[c] > 1)
+            p_rooms->tiles_shared++;
+
+    for (r = 0; r < p_rooms->count; r++) {
+        p_room = &p_rooms->p_rooms[r];
+        for (c = 0; c < p_room->tile_count; c++)
+            if (p_rooms->p_room_refs[p_rooms->p_tile_ids[p_room->offset + c]] > 1)
+                p_room->tiles_shared++;
+
+        if (p_room->tile_count > p_rooms->tile_count_max)
+            p_rooms->tile_count_max = p_room->tile_count;
+    }
+
+    free(job.p_stamps);
+    free(job.p_local);
+    free(p_ids_decoded);
+
+    benchmark_elapsed();
+    printf("Rooms: %d rooms (%d x %d), largest %d tiles, %d tiles shared between rooms\n",
+           p_rooms->count, p_rooms->rooms_x, p_rooms->rooms_y, p_rooms->tile_count_max, p_rooms->tiles_shared);
+
+    return true;
+}
+
+
+
+void tilemap_rooms_free(tile_rooms_data * p_rooms) {
+
+    if (p_rooms->p_rooms)
+        free(p_rooms->p_rooms);
+
+    if (p_rooms->p_tile_ids)
+        free(p_rooms->p_tile_ids);
+
+    if (p_rooms->p_cell_ids)
+        free(p_rooms->p_cell_ids);
+
+    if (p_rooms->p_room_refs)
+        free(p_rooms->p_room_refs);
+
+    memset(p_rooms, 0x00, sizeof(tile_rooms_data));
+}
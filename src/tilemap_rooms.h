@@ -0,0 +1,21 @@
+//
+// tilemap_rooms.h
+//
+
+#ifndef __TILEMAP_ROOMS_H_
+#define __TILEMAP_ROOMS_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define ROOMS_SIZE_NONE            0     // Room split disabled
+    #define ROOMS_WIDTH_DEFAULT        20    // Room size in tiles (one screen)
+    #define ROOMS_HEIGHT_DEFAULT       18
+    #define ROOMS_SIZE_MAX             255   // Keeps local tile IDs within 16 bits
+
+    int32_t tilemap_rooms_calc(tile_rooms_data * p_rooms, tile_map_data * p_map, uint32_t tile_count,
+                               uint16_t room_width, uint16_t room_height);
+    void    tilemap_rooms_free(tile_rooms_data * p_rooms);
+
+#endif
@@ -0,0 +1,615 @@
+//
+// tilemap_sprites.c
+//
+
+// ========================
+//
+// Sprite sheet mode: sprites found by connected component
+// labelling instead of a fixed tile grid.
+//
+// Sprite sheets have irregular sprites on a transparent
+// background, so the grid based passes don't fit them.
+// Here every 8-connected group of opaque pixels becomes
+// one sprite:
+//
+// * Scan: each row gets split into runs of opaque pixels.
+//   Transparent stretches are skipped 8 bytes at a time
+//   (2 RGBA, 4 gray + alpha or 8 indexed pixels per load).
+//   Rows don't depend on each other, so they get scanned
+//   on the shared thread pool: once to count the runs,
+//   once to store them.
+// * Label: runs touching a run in the row above (including
+//   diagonally) get joined with union-find. The root of a
+//   group is its earliest run, so sprites come out in scan
+//   order of their top row.
+// * Crop: each sprite is copied out at its bounding box,
+//   pixels of other sprites inside the box are left
+//   transparent.
+// * Dedupe: cropped sprites are hashed with the tile hash
+//   backend, with flip search on the key is the smallest of
+//   the four orientation hashes (like the batch engines).
+//   Every match is checked pixel for pixel.
+//
+// Transparent means alpha 0 for images with alpha. Images
+// without alpha use the color of the upper left pixel as
+// the background.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_sprites.h"
+#include "tilemap_tiles.h"
+#include "tilemap_hash.h"
+#include "tilemap_index.h"
+#include "tilemap_pool.h"
+
+#include "benchmark.h"
+
+
+// Opaque pixels [x_start .. x_end - 1] of row y
+typedef struct {
+    uint32_t x_start;
+    uint32_t x_end;
+    uint32_t y;
+} sprite_run;
+
+
+typedef struct {
+    image_data     * p_img;
+    uint8_t          bpp;
+    uint8_t          has_alpha;
+    uint8_t          background[4];    // Background color of images without alpha
+
+    // Transparency of 8 bytes at once: (word & swar_mask) == swar_value,
+    // swar_pixels 0 when the pixel size doesn't divide 8 bytes
+    uint64_t         swar_mask;
+    uint64_t         swar_value;
+    uint32_t         swar_pixels;
+
+    uint32_t       * p_row_first;      // First run of each row, height + 1 entries
+    sprite_run     * p_runs;
+
+    // Per sprite instance (component)
+    uint32_t       * p_comp_first;     // First entry of each component in p_comp_runs, count + 1 entries
+    uint32_t       * p_comp_runs;      // Run indices grouped by component
+    tile_sprite_placement * p_placements;
+    uint32_t       * p_widths;
+    uint32_t       * p_heights;
+    size_t         * p_crop_offsets;
+    uint8_t        * p_crops;
+    uint64_t       * p_hashes;         // 4 per instance: normal, flip-x, flip-y, flip-xy
+    uint8_t        * p_scratch;        // Per worker flip buffer
+    size_t           scratch_size;
+    tile_hash_func   hash_func;
+    uint16_t         search_mask;
+} sprites_job;
+
+
+static inline int32_t sprites_pixel_opaque(sprites_job * p_job, const uint8_t * p_pix);
+static uint32_t sprites_row_runs(sprites_job * p_job, uint32_t y, sprite_run * p_runs);
+static void     sprites_count_task(void * p_arg, uint32_t row, uint32_t worker);
+static void     sprites_fill_task(void * p_arg, uint32_t row, uint32_t worker);
+static uint32_t sprites_find(uint32_t * p_parent, uint32_t run);
+static void     sprites_union(uint32_t * p_parent, uint32_t run_a, uint32_t run_b);
+static void     sprites_crop_flip(const uint8_t * p_src, uint8_t * p_dst, uint32_t width, uint32_t height,
+                                  uint8_t bpp, uint16_t flip_bits);
+static void     sprites_crop_task(void * p_arg, uint32_t inst, uint32_t worker);
+
+
+
+static inline int32_t sprites_pixel_opaque(sprites_job * p_job, const uint8_t * p_pix) {
+
+    if (p_job->has_alpha)
+        return (p_pix[p_job->bpp - 1] != 0);
+    else
+        return (memcmp(p_pix, p_job->background, p_job->bpp) != 0);
+}
+
+
+
+// Runs of opaque pixels in row y, stored to p_runs if it's not NULL
+static uint32_t sprites_row_runs(sprites_job * p_job, uint32_t y, sprite_run * p_runs) {
+
+    const uint8_t * p_row;
+    uint64_t        word;
+    uint32_t        x, x_start, width, count;
+    uint8_t         bpp;
+
+    bpp   = p_job->bpp;
+    width = p_job->p_img->width;
+    p_row = p_job->p_img->p_img_data + ((size_t)y * width * bpp);
+    count = 0;
+    x     = 0;
+
+    while (x < width) {
+
+        // Skip transparent stretches a word at a time, then finish per pixel
+        if (p_job->swar_pixels) {
+            while (x + p_job->swar_pixels <= width) {
+                memcpy(&word, p_row + ((size_t)x * bpp), sizeof(word));
+                if ((word & p_job->swar_mask) != p_job->swar_value)
+                    break;
+                x += p_job->swar_pixels;
+            }
+        }
+
+        while ((x < width) && !sprites_pixel_opaque(p_job, p_row + ((size_t)x * bpp)))
+            x++;
+
+        if (x >= width)
+            break;
+
+        x_start = x;
+        while ((x < width) && sprites_pixel_opaque(p_job, p_row + ((size_t)x * bpp)))
+            x++;
+
+        if (p_runs) {
+            p_runs[count].x_start = x_start;
+            p_runs[count].x_end   = x;
+            p_runs[count].y       = y;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+
+
+// Pool task: run count of one row (stored after the row's
+// entry, so a prefix sum turns it into first run indices)
+static void sprites_count_task(void * p_arg, uint32_t row, uint32_t worker) {
+
+    sprites_job * p_job = (sprites_job *)p_arg;
+
+    (void)worker;
+    p_job->p_row_first[row + 1] = sprites_row_runs(p_job, row, NULL);
+}
+
+
+
+// Pool task: runs of one row
+static void sprites_fill_task(void * p_arg, uint32_t row, uint32_t worker) {
+
+    sprites_job * p_job = (sprites_job *)p_arg;
+
+    (void)worker;
+    sprites_row_runs(p_job, row, &p_job->p_runs[p_job->p_row_first[row]]);
+}
+
+
+
+// Root of a run's group (path halving)
+static uint32_t sprites_find(uint32_t * p_parent, uint32_t run) {
+
+    while (p_parent[run] != run) {
+        p_parent[run] = p_parent[p_parent[run]];
+        run = p_parent[run];
+    }
+
+    return run;
+}
+
+
+
+// Join two groups, the earlier root stays the root
+static void sprites_union(uint32_t * p_parent, uint32_t run_a, uint32_t run_b) {
+
+    run_a = sprites_find(p_parent, run_a);
+    run_b = sprites_find(p_parent, run_b);
+
+    if (run_a < run_b)
+        p_parent[run_b] = run_a;
+    else if (run_b < run_a)
+        p_parent[run_a] = run_b;
+}
+
+
+
+// Copy a cropped sprite with flip_bits (TILE_FLIP_BITS_*) applied
+static void sprites_crop_flip(const uint8_t * p_src, uint8_t * p_dst, uint32_t width, uint32_t height,
+                              uint8_t bpp, uint16_t flip_bits) {
+
+    uint32_t        x, y;
+    size_t          row_size;
+    const uint8_t * p_src_row;
+
+    row_size = (size_t)width * bpp;
+
+    for (y = 0; y < height; y++) {
+
+        p_src_row = p_src + (((flip_bits & TILE_FLIP_BITS_Y) ? (height - 1 - y) : y) * row_size);
+
+        if (flip_bits & TILE_FLIP_BITS_X) {
+            for (x = 0; x < width; x++)
+                memcpy(p_dst + ((size_t)x * bpp), p_src_row + ((size_t)(width - 1 - x) * bpp), bpp);
+        }
+        else
+            memcpy(p_dst, p_src_row, row_size);
+
+        p_dst += row_size;
+    }
+}
+
+
+
+// Pool task: crop one sprite instance out of the sheet and hash it
+static void sprites_crop_task(void * p_arg, uint32_t inst, uint32_t worker) {
+
+    sprites_job           * p_job = (sprites_job *)p_arg;
+    tile_sprite_placement * p_place = &p_job->p_placements[inst];
+    const sprite_run      * p_run;
+    uint8_t               * p_crop;
+    uint8_t               * p_flipped;
+    uint64_t              * p_hash;
+    uint32_t                c, x, width, height;
+    size_t                  size, row_size;
+    uint8_t                 bpp;
+
+    bpp      = p_job->bpp;
+    width    = p_job->p_widths[inst];
+    height   = p_job->p_heights[inst];
+    row_size = (size_t)width * bpp;
+    size     = row_size * height;
+    p_crop   = p_job->p_crops + p_job->p_crop_offsets[inst];
+    p_hash   = &p_job->p_hashes[inst * 4];
+
+    // Start out transparent, then copy this sprite's runs in
+    if (p_job->has_alpha)
+        memset(p_crop, 0x00, size);
+    else
+        for (x = 0; x < (uint32_t)(width * height); x++)
+            memcpy(p_crop + ((size_t)x * bpp), p_job->background, bpp);
+
+    for (c = p_job->p_comp_first[inst]; c < p_job->p_comp_first[inst + 1]; c++) {
+        p_run = &p_job->p_runs[ p_job->p_comp_runs[c] ];
+        memcpy(p_crop + ((size_t)(p_run->y - p_place->y) * row_size) + ((size_t)(p_run->x_start - p_place->x) * bpp),
+               p_job->p_img->p_img_data + (((size_t)p_run->y * p_job->p_img->width) + p_run->x_start) * bpp,
+               (size_t)(p_run->x_end - p_run->x_start) * bpp);
+    }
+
+    p_hash[0] = p_job->hash_func(p_crop, (uint32_t)size);
+    p_hash[1] = p_hash[2] = p_hash[3] = p_hash[0];
+
+    if (p_job->search_mask) {
+        p_flipped = p_job->p_scratch + ((size_t)worker * p_job->scratch_size);
+
+        for (c = 1; c < 4; c++) {
+            if ((tile_flip_bits[c] & ~p_job->search_mask) == 0) {
+                sprites_crop_flip(p_crop, p_flipped, width, height, bpp, tile_flip_bits[c]);
+                p_hash[c] = p_job->hash_func(p_flipped, (uint32_t)size);
+            }
+        }
+    }
+}
+
+
+
+// Find the sprites of a sprite sheet, crop them to their
+// bounding boxes and dedupe them (with flips when search_mask
+// has flip bits), giving a unique sprite list and a placement
+// table of every sprite on the sheet
+int32_t tilemap_sprites_calc(tile_sprites_data * p_sprites, image_data * p_src_img,
+                             uint8_t hash_backend, uint16_t search_mask) {
+
+    sprites_job   job;
+    tile_index    index;
+    sprite_run  * p_prev;
+    sprite_run  * p_cur;
+    uint32_t    * p_parent;
+    uint32_t    * p_label;
+    uint32_t    * p_inst_ids;
+    uint8_t     * p_flipped;
+    uint32_t      c, r, y, i, j, run_count, inst_count, inst, first, slot, flip, worker_count;
+    uint32_t      x_max, y_max;
+    uint64_t      key;
+    size_t        crops_size, size, offset;
+    uint8_t       swar_bytes[8];
+    int32_t       status, index_ready;
+
+    tilemap_sprites_free(p_sprites);
+
+    if ((p_src_img->width == 0) || (p_src_img->height == 0) || (p_src_img->p_img_data == NULL)
+        || (p_src_img->bytes_per_pixel < 1) || (p_src_img->bytes_per_pixel > 4))
+        return false;
+
+    printf("Sprites: Start -> %d x %d sheet  ", p_src_img->width, p_src_img->height);
+    benchmark_start();
+
+    memset(&job, 0x00, sizeof(job));
+    job.p_img       = p_src_img;
+    job.bpp         = p_src_img->bytes_per_pixel;
+    job.has_alpha   = (job.bpp == 2) || (job.bpp == 4);
+    job.search_mask = search_mask;
+    job.hash_func   = tile_hash_get_func(hash_backend);
+    memcpy(job.background, p_src_img->p_img_data, job.bpp);
+
+    // Word test for the transparent skip
+    if (job.bpp != 3) {
+        job.swar_pixels = 8 / job.bpp;
+        for (c = 0; c < 8; c++)
+            swar_bytes[c] = (job.has_alpha) ? (((c % job.bpp) == (uint32_t)(job.bpp - 1)) ? 0xFF : 0x00) : 0xFF;
+        memcpy(&job.swar_mask, swar_bytes, sizeof(uint64_t));
+
+        for (c = 0; c < 8; c++)
+            swar_bytes[c] = (job.has_alpha) ? 0x00 : job.background[0];
+        memcpy(&job.swar_value, swar_bytes, sizeof(uint64_t));
+    }
+
+    p_sprites->bytes_per_pixel = job.bpp;
+    p_sprites->search_mask     = search_mask;
+
+    worker_count = tilemap_pool_get_worker_count();
+    p_parent     = NULL;
+    p_label      = NULL;
+    p_inst_ids   = NULL;
+    p_flipped    = NULL;
+    inst_count   = 0;
+    status       = true;
+
+    // Scan: count runs per row, then store them
+    job.p_row_first = calloc((size_t)p_src_img->height + 1, sizeof(uint32_t));
+    if (!job.p_row_first)
+        return false;
+
+    tilemap_pool_run(p_src_img->height, sprites_count_task, &job);
+
+    for (y = 0; y < p_src_img->height; y++)
+        job.p_row_first[y + 1] += job.p_row_first[y];
+    run_count = job.p_row_first[p_src_img->height];
+
+    job.p_runs = malloc(((size_t)run_count + 1) * sizeof(sprite_run));
+    p_parent   = malloc(((size_t)run_count + 1) * sizeof(uint32_t));
+    p_label    = malloc(((size_t)run_count + 1) * sizeof(uint32_t));
+    status     = (job.p_runs && p_parent && p_label);
+
+    if (status) {
+        tilemap_pool_run(p_src_img->height, sprites_fill_task, &job);
+
+        // Label: join runs that touch a run in the row above
+        for (r = 0; r < run_count; r++)
+            p_parent[r] = r;
+
+        for (y = 1; y < p_src_img->height; y++) {
+            i = job.p_row_first[y - 1];
+            j = job.p_row_first[y];
+
+            while ((i < job.p_row_first[y]) && (j < job.p_row_first[y + 1])) {
+                p_prev = &job.p_runs[i];
+                p_cur  = &job.p_runs[j];
+
+                // 8-connected: diagonal neighbours count too
+                if ((p_prev->x_start <= p_cur->x_end) && (p_prev->x_end >= p_cur->x_start))
+                    sprites_union(p_parent, i, j);
+
+                if (p_prev->x_end <= p_cur->x_end)
+                    i++;
+                else
+                    j++;
+            }
+        }
+
+        // Roots always come before their runs, so one pass numbers the sprites in scan order
+        inst_count = 0;
+        for (r = 0; r < run_count; r++) {
+            first = sprites_find(p_parent, r);
+            p_label[r] = (first == r) ? inst_count++ : p_label[first];
+        }
+
+        p_sprites->run_count       = run_count;
+        p_sprites->placement_count = inst_count;
+
+        job.p_comp_first   = calloc((size_t)inst_count + 1, sizeof(uint32_t));
+        job.p_comp_runs    = malloc(((size_t)run_count + 1) * sizeof(uint32_t));
+        job.p_widths       = malloc(((size_t)inst_count + 1) * sizeof(uint32_t));
+        job.p_heights      = malloc(((size_t)inst_count + 1) * sizeof(uint32_t));
+        job.p_crop_offsets = malloc(((size_t)inst_count + 1) * sizeof(size_t));
+        job.p_hashes       = malloc(((size_t)inst_count + 1) * 4 * sizeof(uint64_t));
+        p_inst_ids         = malloc(((size_t)inst_count + 1) * sizeof(uint32_t));
+        p_sprites->p_placements = calloc((size_t)inst_count + 1, sizeof(tile_sprite_placement));
+        job.p_placements   = p_sprites->p_placements;
+
+        status = (job.p_comp_first && job.p_comp_runs && job.p_widths && job.p_heights && job.p_crop_offsets
+                  && job.p_hashes && p_inst_ids && p_sprites->p_placements);
+    }
+
+    if (status && inst_count) {
+
+        // Bounding boxes (x_max / y_max kept in width / height until the end)
+        for (inst = 0; inst < inst_count; inst++) {
+            job.p_placements[inst].x = p_src_img->width;
+            job.p_placements[inst].y = p_src_img->height;
+            job.p_widths[inst]       = 0;
+            job.p_heights[inst]      = 0;
+        }
+
+        for (r = 0; r < run_count; r++) {
+            inst = p_label[r];
+            if (job.p_runs[r].x_start < job.p_placements[inst].x) job.p_placements[inst].x = job.p_runs[r].x_start;
+            if (job.p_runs[r].y       < job.p_placements[inst].y) job.p_placements[inst].y = job.p_runs[r].y;
+            if (job.p_runs[r].x_end   > job.p_widths[inst])       job.p_widths[inst]       = job.p_runs[r].x_end;
+            if (job.p_runs[r].y + 1   > job.p_heights[inst])      job.p_heights[inst]      = job.p_runs[r].y + 1;
+            job.p_comp_first[inst + 1]++;
+        }
+
+        // Group the runs by sprite (counting sort, keeps scan order inside a sprite)
+        for (inst = 0; inst < inst_count; inst++)
+            job.p_comp_first[inst + 1] += job.p_comp_first[inst];
+
+        memcpy(p_parent, job.p_comp_first, (size_t)inst_count * sizeof(uint32_t));
+        for (r = 0; r < run_count; r++)
+            job.p_comp_runs[ p_parent[ p_label[r] ]++ ] = r;
+
+        crops_size       = 0;
+        job.scratch_size = 0;
+        for (inst = 0; inst < inst_count; inst++) {
+            x_max = job.p_widths[inst];
+            y_max = job.p_heights[inst];
+            job.p_widths[inst]  = x_max - job.p_placements[inst].x;
+            job.p_heights[inst] = y_max - job.p_placements[inst].y;
+
+            size = (size_t)job.p_widths[inst] * job.p_heights[inst] * job.bpp;
+            job.p_crop_offsets[inst] = crops_size;
+            crops_size += size;
+            if (size > job.scratch_size)
+                job.scratch_size = size;
+        }
+
+        // Crop + hash (parallel)
+        job.p_crops   = malloc(crops_size);
+        job.p_scratch = malloc(job.scratch_size * worker_count);
+        p_flipped     = malloc(job.scratch_size);
+        status = (job.p_crops && job.p_scratch && p_flipped);
+
+        if (status)
+            tilemap_pool_run(inst_count, sprites_crop_task, &job);
+    }
+
+    // Dedupe in placement order, so unique sprites are numbered by first use
+    if (status && inst_count) {
+
+        index_ready = tile_index_init(&index, inst_count);
+        p_sprites->p_sprites = malloc((size_t)inst_count * sizeof(tile_sprite_data));
+        status = (index_ready && p_sprites->p_sprites);
+
+        for (inst = 0; status && (inst < inst_count); inst++) {
+
+            key = job.p_hashes[inst * 4];
+            if (search_mask)
+                for (c = 1; c < 4; c++)
+                    if (job.p_hashes[(inst * 4) + c] < key)
+                        key = job.p_hashes[(inst * 4) + c];
+
+            // Sprites of different sizes never match
+            key ^= (((uint64_t)job.p_widths[inst] << 32) | job.p_heights[inst]) * 0x9E3779B97F4A7C15ULL;
+
+            slot  = tile_index_insert(&index, key, inst);
+            first = tile_index_get_first(&index, slot);
+            flip  = 4;
+
+            if (first != inst) {
+                // Orientation of this instance that gives the unique sprite, checked pixel for pixel
+                size = (size_t)job.p_widths[inst] * job.p_heights[inst] * job.bpp;
+
+                for (c = 0; c < 4; c++) {
+                    if ((c > 0) && (tile_flip_bits[c] & ~search_mask))
+                        continue;
+
+                    if ((job.p_widths[inst] != job.p_widths[first]) || (job.p_heights[inst] != job.p_heights[first])
+                        || (job.p_hashes[(inst * 4) + c] != job.p_hashes[first * 4]))
+                        continue;
+
+                    sprites_crop_flip(job.p_crops + job.p_crop_offsets[inst], p_flipped,
+                                      job.p_widths[inst], job.p_heights[inst], job.bpp, tile_flip_bits[c]);
+                    if (memcmp(p_flipped, job.p_crops + job.p_crop_offsets[first], size) == 0) {
+                        flip = c;
+                        break;
+                    }
+                }
+
+                // Hash collision: keep it as its own sprite (later copies of it won't merge either)
+                if (flip == 4)
+                    printf("\nSprites: sprite at %d,%d collided with a different sprite's hash\n",
+                           job.p_placements[inst].x, job.p_placements[inst].y);
+            }
+
+            if (flip == 4) {
+                p_inst_ids[inst] = p_sprites->count;
+
+                p_sprites->p_sprites[p_sprites->count].width           = job.p_widths[inst];
+                p_sprites->p_sprites[p_sprites->count].height          = job.p_heights[inst];
+                p_sprites->p_sprites[p_sprites->count].pixel_count     = 0;
+                p_sprites->p_sprites[p_sprites->count].use_count       = 0;
+                p_sprites->p_sprites[p_sprites->count].first_placement = inst;
+                p_sprites->count++;
+
+                job.p_placements[inst].attribs = TILE_FLIP_BITS_NONE;
+            }
+            else {
+                p_inst_ids[inst] = p_inst_ids[first];
+                job.p_placements[inst].attribs = tile_flip_bits[flip];
+            }
+
+            job.p_placements[inst].sprite_id = p_inst_ids[inst];
+            p_sprites->p_sprites[ p_inst_ids[inst] ].use_count++;
+        }
+
+        if (index_ready)
+            tile_index_free(&index);
+
+        // Opaque pixel counts of the unique sprites
+        for (r = 0; status && (r < run_count); r++) {
+            inst = p_label[r];
+            if (p_sprites->p_sprites[ p_inst_ids[inst] ].first_placement == inst)
+                p_sprites->p_sprites[ p_inst_ids[inst] ].pixel_count += job.p_runs[r].x_end - job.p_runs[r].x_start;
+        }
+
+        // Keep only the pixels of the unique sprites
+        if (status) {
+            offset = 0;
+            for (c = 0; c < p_sprites->count; c++)
+                offset += (size_t)p_sprites->p_sprites[c].width * p_sprites->p_sprites[c].height * job.bpp;
+
+            p_sprites->pixels_size = offset;
+            p_sprites->p_pixels    = malloc(offset + 1);
+            status = (p_sprites->p_pixels != NULL);
+        }
+
+        if (status) {
+            offset = 0;
+            for (c = 0; c < p_sprites->count; c++) {
+                inst = p_sprites->p_sprites[c].first_placement;
+                size = (size_t)p_sprites->p_sprites[c].width * p_sprites->p_sprites[c].height * job.bpp;
+
+                p_sprites->p_sprites[c].offset = offset;
+                memcpy(p_sprites->p_pixels + offset, job.p_crops + job.p_crop_offsets[inst], size);
+                offset += size;
+            }
+        }
+    }
+
+    free(job.p_row_first);
+    free(job.p_runs);
+    free(job.p_comp_first);
+    free(job.p_comp_runs);
+    free(job.p_widths);
+    free(job.p_heights);
+    free(job.p_crop_offsets);
+    free(job.p_crops);
+    free(job.p_hashes);
+    free(job.p_scratch);
+    free(p_parent);
+    free(p_label);
+    free(p_inst_ids);
+    free(p_flipped);
+
+    if (!status) {
+        tilemap_sprites_free(p_sprites);
+        return false;
+    }
+
+    benchmark_elapsed();
+    printf("Sprites: %d runs, %d sprites placed, %d unique\n",
+           p_sprites->run_count, p_sprites->placement_count, p_sprites->count);
+
+    return true;
+}
+
+
+
+void tilemap_sprites_free(tile_sprites_data * p_sprites) {
+
+    if (p_sprites->p_sprites)
+        free(p_sprites->p_sprites);
+
+    if (p_sprites->p_placements)
+        free(p_sprites->p_placements);
+
+    if (p_sprites->p_pixels)
+        free(p_sprites->p_pixels);
+
+    memset(p_sprites, 0x00, sizeof(tile_sprites_data));
+}
@@ -0,0 +1,18 @@
+//
+// tilemap_sprites.h
+//
+
+#ifndef __TILEMAP_SPRITES_H_
+#define __TILEMAP_SPRITES_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define SPRITES_NONE               0      // Sprite sheet mode disabled
+
+    int32_t tilemap_sprites_calc(tile_sprites_data * p_sprites, image_data * p_src_img,
+                                 uint8_t hash_backend, uint16_t search_mask);
+    void    tilemap_sprites_free(tile_sprites_data * p_sprites);
+
+#endif
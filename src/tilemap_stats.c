@@ -0,0 +1,219 @@
+//
+// tilemap_stats.c
+//
+
+// ========================
+//
+// Per tile pixel statistics.
+//
+// Sub-palette planning and the info panel need to know
+// which colors each unique tile uses: the color count,
+// the set of palette indices (indexed images), whether
+// any pixel is transparent and whether the whole tile is
+// one color.
+//
+// All of them come out of a single pass over the tile's
+// pixels, run by tile_register_new() right after the new
+// tile got hashed and while its pixels are still in cache.
+// Only unique tiles get registered, so this costs nothing
+// for the (much more frequent) cells that match a tile.
+//
+// None of the values change when a tile is flipped, so
+// they hold for every map entry using the tile.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_stats.h"
+#include "tilemap_packed.h"
+
+
+#define STATS_COLOR_SLOTS_MAX  (TILE_STATS_COLORS_MAX * 2) // Open addressing table, at most half full
+#define STATS_COLOR_USED       0x100000000ULL              // Marks a used slot (colors are 32 bit)
+#define STATS_HASH_MULT        0x9E3779B1U
+
+
+// Distinct color counter for RGB / RGBA tiles
+typedef struct {
+    uint64_t slots[STATS_COLOR_SLOTS_MAX];
+    uint32_t slot_mask;
+    uint16_t count;
+} stats_color_set;
+
+
+static void stats_color_set_init(stats_color_set * p_set, uint32_t pixel_count);
+static void stats_color_set_add(stats_color_set * p_set, uint32_t color);
+static void stats_calc_packed(tile_stats * p_stats, const uint8_t * p_data, uint16_t width, uint16_t height,
+                              uint8_t packed_bits);
+
+
+
+// Calculate the statistics of a tile's pixels (stored contiguously)
+//
+// * packed_bits != 0: p_data is bit-packed (see tilemap_packed.c)
+// * bytes_per_pixel 1, 2: indexed (+ alpha), 3, 4: RGB (+ alpha)
+// * Transparent (alpha 0) pixels only set TILE_STATS_TRANSPARENT,
+//   they don't count as a color
+void tile_stats_calc(tile_stats * p_stats, const uint8_t * p_data, uint16_t width, uint16_t height,
+                     uint8_t bytes_per_pixel, uint8_t packed_bits) {
+
+    stats_color_set color_set;
+    uint32_t        c, pixel_count;
+    uint32_t        color, first, diff;
+    uint8_t         index;
+
+    memset(p_stats, 0x00, sizeof(tile_stats));
+
+    pixel_count = (uint32_t)width * height;
+    if (pixel_count == 0)
+        return;
+
+    if (packed_bits) {
+        stats_calc_packed(p_stats, p_data, width, height, packed_bits);
+        return;
+    }
+
+    diff = 0;
+
+    switch (bytes_per_pixel) {
+
+        case 1:
+            first = p_data[0];
+            for (c = 0; c < pixel_count; c++) {
+                index = p_data[c];
+                diff |= index ^ first;
+                p_stats->palette_used[index >> 6] |= 1ULL << (index & 63);
+            }
+            break;
+
+        case 2:
+            first = p_data[0] | (p_data[1] << 8);
+            for (c = 0; c < pixel_count; c++, p_data += 2) {
+                diff |= (p_data[0] | (p_data[1] << 8)) ^ first;
+
+                if (p_data[1] == 0)
+                    p_stats->flags |= TILE_STATS_TRANSPARENT;
+                else
+                    p_stats->palette_used[p_data[0] >> 6] |= 1ULL << (p_data[0] & 63);
+            }
+            break;
+
+        case 3:
+        case 4:
+            stats_color_set_init(&color_set, pixel_count);
+
+            first = p_data[0] | (p_data[1] << 8) | (p_data[2] << 16)
+                    | ((bytes_per_pixel == 4) ? ((uint32_t)p_data[3] << 24) : 0);
+
+            for (c = 0; c < pixel_count; c++, p_data += bytes_per_pixel) {
+                color = p_data[0] | (p_data[1] << 8) | (p_data[2] << 16)
+                        | ((bytes_per_pixel == 4) ? ((uint32_t)p_data[3] << 24) : 0);
+                diff |= color ^ first;
+
+                if ((bytes_per_pixel == 4) && (p_data[3] == 0))
+                    p_stats->flags |= TILE_STATS_TRANSPARENT;
+                else
+                    stats_color_set_add(&color_set, color);
+            }
+
+            p_stats->color_count = color_set.count;
+            break;
+
+        default:
+            return;
+    }
+
+    if (bytes_per_pixel <= 2)
+        p_stats->color_count = __builtin_popcountll(p_stats->palette_used[0])
+                               + __builtin_popcountll(p_stats->palette_used[1])
+                               + __builtin_popcountll(p_stats->palette_used[2])
+                               + __builtin_popcountll(p_stats->palette_used[3]);
+
+    if (diff == 0)
+        p_stats->flags |= TILE_STATS_UNIFORM;
+}
+
+
+
+int32_t tile_stats_palette_index_used(tile_stats * p_stats, uint8_t index) {
+
+    return (p_stats->palette_used[index >> 6] >> (index & 63)) & 1;
+}
+
+
+
+// Packed tiles are indexed with at most 16 colors,
+// each row starts on a byte boundary
+static void stats_calc_packed(tile_stats * p_stats, const uint8_t * p_data, uint16_t width, uint16_t height,
+                              uint8_t packed_bits) {
+
+    uint16_t x, y;
+    uint32_t row_bytes, bit;
+    uint8_t  index, first, diff;
+    uint8_t  mask;
+
+    row_bytes = tile_packed_get_row_bytes(width, packed_bits);
+    mask      = (1 << packed_bits) - 1;
+    first     = (p_data[0] >> (8 - packed_bits)) & mask;
+    diff      = 0;
+
+    for (y = 0; y < height; y++, p_data += row_bytes) {
+        for (x = 0, bit = 0; x < width; x++, bit += packed_bits) {
+            index = (p_data[bit / 8] >> (8 - packed_bits - (bit % 8))) & mask;
+            diff |= index ^ first;
+            p_stats->palette_used[0] |= 1ULL << index;
+        }
+    }
+
+    p_stats->color_count = __builtin_popcountll(p_stats->palette_used[0]);
+
+    if (diff == 0)
+        p_stats->flags |= TILE_STATS_UNIFORM;
+}
+
+
+
+// Table size follows the pixel count, so small tiles
+// don't clear the whole table
+static void stats_color_set_init(stats_color_set * p_set, uint32_t pixel_count) {
+
+    uint32_t slot_count;
+
+    if (pixel_count > TILE_STATS_COLORS_MAX)
+        pixel_count = TILE_STATS_COLORS_MAX;
+
+    slot_count = 16;
+    while (slot_count < (pixel_count * 2))
+        slot_count *= 2;
+
+    memset(p_set->slots, 0x00, slot_count * sizeof(p_set->slots[0]));
+    p_set->slot_mask = slot_count - 1;
+    p_set->count     = 0;
+}
+
+
+
+// Stops counting at TILE_STATS_COLORS_MAX
+static void stats_color_set_add(stats_color_set * p_set, uint32_t color) {
+
+    uint32_t slot;
+    uint64_t key;
+
+    if (p_set->count >= TILE_STATS_COLORS_MAX)
+        return;
+
+    key  = color | STATS_COLOR_USED;
+    slot = ((color * STATS_HASH_MULT) >> 16) & p_set->slot_mask;
+
+    while (p_set->slots[slot]) {
+        if (p_set->slots[slot] == key)
+            return;
+        slot = (slot + 1) & p_set->slot_mask;
+    }
+
+    p_set->slots[slot] = key;
+    p_set->count++;
+}
@@ -0,0 +1,27 @@
+//
+// tilemap_stats.h
+//
+
+#ifndef __TILEMAP_STATS_H_
+#define __TILEMAP_STATS_H_
+
+    #include <stdint.h>
+
+    #define TILE_STATS_COLORS_MAX    256  // color_count saturates here (RGB tiles can have more)
+
+    #define TILE_STATS_TRANSPARENT   0x01 // At least one pixel is fully transparent
+    #define TILE_STATS_UNIFORM       0x02 // Every pixel is the same
+
+    // Per tile pixel statistics, computed once when a tile gets registered
+    typedef struct {
+        uint16_t color_count;      // Distinct colors of the non-transparent pixels
+        uint8_t  flags;            // TILE_STATS_*
+        uint64_t palette_used[4];  // Indexed images: bit n is set if palette index n is used
+                                   // by a non-transparent pixel (color_count bits are set)
+    } tile_stats;
+
+    void    tile_stats_calc(tile_stats * p_stats, const uint8_t * p_data, uint16_t width, uint16_t height,
+                            uint8_t bytes_per_pixel, uint8_t packed_bits);
+    int32_t tile_stats_palette_index_used(tile_stats * p_stats, uint8_t index);
+
+#endif
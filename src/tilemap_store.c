@@ -0,0 +1,211 @@
+//
+// tilemap_store.c
+//
+
+// ========================
+//
+// Pixel storage for tile set tiles, with an optional
+// memory budget.
+//
+// While under budget tile pixels live on the heap. Once
+// the budget is exceeded, further tiles are carved out of
+// a temporary file mapped into memory (MAP_SHARED), so the
+// OS can write those pages back to disk instead of keeping
+// them resident. Hashes and the rest of the tile set stay
+// in RAM, only the pixel buffers move.
+//
+// Spilled buffers aren't freed individually, the whole
+// spill file goes away in tile_store_release().
+//
+// Each tile set owns its own store (tile_store_data),
+// a single store is not thread safe: tiles are registered
+// from a single thread at a time.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "tilemap_store.h"
+
+
+static uint8_t * spill_alloc(tile_store_data * p_store, size_t size_bytes);
+static int       spill_chunk_add(tile_store_data * p_store);
+static int       spill_contains(tile_store_data * p_store, uint8_t * p_data);
+
+
+
+// Set the budget for resident (heap) tile pixel bytes,
+// TILE_STORE_BUDGET_NONE disables spilling
+void tile_store_budget_set(tile_store_data * p_store, uint64_t budget_bytes) {
+    p_store->budget = budget_bytes;
+}
+
+
+
+// Allocate a tile pixel buffer (at least 32 bit aligned)
+//
+// Spills to the mapped file once the budget is used up,
+// falls back to the heap if spilling isn't possible
+uint8_t * tile_store_alloc(tile_store_data * p_store, size_t size_bytes) {
+
+    uint8_t * p_data;
+
+    // Pad size to a multiple of the alignment so spilled tiles stay aligned
+    size_bytes = (size_bytes + (TILE_STORE_ALIGN - 1)) & ~(TILE_STORE_ALIGN - 1);
+
+    if ((p_store->budget != TILE_STORE_BUDGET_NONE) &&
+        ((p_store->resident_bytes + size_bytes) > p_store->budget)) {
+
+        p_data = spill_alloc(p_store, size_bytes);
+        if (p_data) {
+            p_store->spilled_bytes += size_bytes;
+            return p_data;
+        }
+    }
+
+    p_data = malloc(size_bytes);
+    if (p_data)
+        p_store->resident_bytes += size_bytes;
+
+    return p_data;
+}
+
+
+
+// Release a tile pixel buffer (spilled buffers are released with the file)
+//
+// * size_bytes must match the size used for tile_store_alloc()
+void tile_store_free(tile_store_data * p_store, uint8_t * p_data, size_t size_bytes) {
+
+    if (!p_data)
+        return;
+
+    if (!spill_contains(p_store, p_data)) {
+        free(p_data);
+        p_store->resident_bytes -= (size_bytes + (TILE_STORE_ALIGN - 1)) & ~(TILE_STORE_ALIGN - 1);
+    }
+}
+
+
+
+// Unmap and delete the spill file, resets usage counters
+//
+// * All heap buffers must have been released with tile_store_free() first
+void tile_store_release(tile_store_data * p_store) {
+
+#ifndef _WIN32
+    uint32_t c;
+
+    for (c = 0; c < p_store->spill_chunk_count; c++)
+        munmap(p_store->spill_chunks[c], TILE_STORE_SPILL_CHUNK_SIZE);
+#endif
+
+    if (p_store->p_spill_file) {
+        printf("Tile Store: Released spill file (%" PRIu64 " bytes spilled)\n", p_store->spilled_bytes);
+        fclose(p_store->p_spill_file); // tmpfile() deletes it on close
+    }
+
+    p_store->p_spill_file      = NULL;
+    p_store->spill_chunk_count = 0;
+    p_store->spill_chunk_used  = 0;
+    p_store->resident_bytes    = 0;
+    p_store->spilled_bytes     = 0;
+}
+
+
+
+uint64_t tile_store_get_resident_bytes(tile_store_data * p_store) {
+    return p_store->resident_bytes;
+}
+
+
+uint64_t tile_store_get_spilled_bytes(tile_store_data * p_store) {
+    return p_store->spilled_bytes;
+}
+
+
+
+// Bump allocate from the newest chunk of the spill file
+static uint8_t * spill_alloc(tile_store_data * p_store, size_t size_bytes) {
+
+    uint8_t * p_data;
+
+    if (size_bytes > TILE_STORE_SPILL_CHUNK_SIZE)
+        return NULL;
+
+    if ((p_store->spill_chunk_count == 0) ||
+        ((p_store->spill_chunk_used + size_bytes) > TILE_STORE_SPILL_CHUNK_SIZE)) {
+
+        if (!spill_chunk_add(p_store))
+            return NULL;
+    }
+
+    p_data = p_store->spill_chunks[p_store->spill_chunk_count - 1] + p_store->spill_chunk_used;
+    p_store->spill_chunk_used += size_bytes;
+
+    return p_data;
+}
+
+
+
+// Grow the spill file by one chunk and map it
+static int spill_chunk_add(tile_store_data * p_store) {
+
+#ifndef _WIN32
+    uint8_t * p_chunk;
+    off_t     file_size;
+
+    if (p_store->spill_chunk_count >= TILE_STORE_SPILL_CHUNKS_MAX)
+        return false;
+
+    if (!p_store->p_spill_file) {
+        p_store->p_spill_file = tmpfile();
+        if (!p_store->p_spill_file) {
+            printf("Tile Store: Unable to create spill file, using heap\n");
+            return false;
+        }
+        printf("Tile Store: Budget of %" PRIu64 " bytes exceeded, spilling tile pixels to disk\n", p_store->budget);
+    }
+
+    file_size = (off_t)(p_store->spill_chunk_count + 1) * TILE_STORE_SPILL_CHUNK_SIZE;
+
+    if (ftruncate(fileno(p_store->p_spill_file), file_size) != 0)
+        return false;
+
+    p_chunk = mmap(NULL, TILE_STORE_SPILL_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fileno(p_store->p_spill_file), file_size - TILE_STORE_SPILL_CHUNK_SIZE);
+
+    if (p_chunk == MAP_FAILED)
+        return false;
+
+    p_store->spill_chunks[p_store->spill_chunk_count++] = p_chunk;
+    p_store->spill_chunk_used = 0;
+
+    return true;
+#else
+    // No spill support on Windows yet, tiles stay on the heap
+    return false;
+#endif
+}
+
+
+
+static int spill_contains(tile_store_data * p_store, uint8_t * p_data) {
+
+    uint32_t c;
+
+    for (c = 0; c < p_store->spill_chunk_count; c++)
+        if ((p_data >= p_store->spill_chunks[c]) && (p_data < p_store->spill_chunks[c] + TILE_STORE_SPILL_CHUNK_SIZE))
+            return true;
+
+    return false;
+}
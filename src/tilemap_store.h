@@ -0,0 +1,38 @@
+//
+// tilemap_store.h
+//
+
+#ifndef __TILEMAP_STORE_H_
+#define __TILEMAP_STORE_H_
+
+    #include <stdio.h>
+    #include <stdint.h>
+    #include <stddef.h>
+
+    #define TILE_STORE_BUDGET_NONE       0                   // No limit, tile pixels always on the heap
+    #define TILE_STORE_SPILL_CHUNK_SIZE  (16 * 1024 * 1024)  // Spill file grows (and is mapped) in chunks of this size
+    #define TILE_STORE_SPILL_CHUNKS_MAX  1024
+    #define TILE_STORE_ALIGN             sizeof(uint32_t)
+
+    // Pixel storage state, one per tile set (zeroed = empty, no budget)
+    typedef struct {
+        uint64_t  budget;
+        uint64_t  resident_bytes;    // Heap bytes currently allocated
+        uint64_t  spilled_bytes;     // Bytes handed out from the spill file
+
+        FILE    * p_spill_file;
+        uint8_t * spill_chunks[TILE_STORE_SPILL_CHUNKS_MAX];
+        uint32_t  spill_chunk_count;
+        size_t    spill_chunk_used;  // Bytes used in the newest chunk
+    } tile_store_data;
+
+    void      tile_store_budget_set(tile_store_data * p_store, uint64_t budget_bytes);
+
+    uint8_t * tile_store_alloc(tile_store_data * p_store, size_t size_bytes);
+    void      tile_store_free(tile_store_data * p_store, uint8_t * p_data, size_t size_bytes);
+    void      tile_store_release(tile_store_data * p_store);
+
+    uint64_t  tile_store_get_resident_bytes(tile_store_data * p_store);
+    uint64_t  tile_store_get_spilled_bytes(tile_store_data * p_store);
+
+#endif
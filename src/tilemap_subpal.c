@@ -0,0 +1,484 @@
+//
+// tilemap_subpal.c
+//
+
+// ========================
+//
+// Sub-palette assignment for tile attribute hardware.
+//
+// Consoles like the GBC and SNES give every tile one of N
+// sub-palettes of K colors, so each tile's colors have to
+// be a subset of one sub-palette. This packs the color sets
+// of the unique tiles (see tilemap_stats.c) into as few
+// sub-palettes as possible:
+//
+// * Colormap entries with the same RGB value count as one
+//   color, and color sets that are a subset of another set
+//   are dropped (they fit wherever the larger set goes)
+// * Greedy bin packing, largest sets first, each set goes
+//   where it adds the fewest new colors
+// * Local search: try to empty each sub-palette (fewest
+//   sets first) by moving its sets into the others, until
+//   no more can be removed
+//
+// Several attempts with shuffled set orders run across the
+// thread pool, the one with the fewest sub-palettes (then
+// fewest colors, then lowest attempt) wins, so the result
+// doesn't depend on thread timing.
+//
+// Transparent pixels don't count as a color. Tiles with more
+// than K colors can't fit any sub-palette, they're marked
+// with TILE_SUBPAL_UNFIT and left out.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_subpal.h"
+#include "tilemap_pool.h"
+
+#include "benchmark.h"
+
+
+#define SUBPAL_ATTEMPT_FAILED  0xFFFF
+
+
+// A tile color set (bit n = palette index n)
+typedef struct {
+    uint64_t bits[4];
+    uint16_t size;
+} subpal_set;
+
+
+// Shared by all attempts, each attempt writes only its own results
+typedef struct {
+    subpal_set * p_sets;        // Maximal color sets, largest first
+    uint32_t     set_count;
+    uint16_t     colors_max;
+
+    uint8_t    * p_assign;      // SUBPAL_ATTEMPTS * set_count: sub-palette of each set
+    uint16_t     pal_count[SUBPAL_ATTEMPTS];
+    uint32_t     color_total[SUBPAL_ATTEMPTS];
+} subpal_job;
+
+
+static void subpal_attempt_task(void * p_arg, uint32_t attempt, uint32_t worker);
+static int  subpal_set_compare(const void * p_a, const void * p_b);
+static int  subpal_order_compare(const void * p_a, const void * p_b);
+
+
+
+static inline uint16_t subpal_popcount(const uint64_t * p_bits) {
+
+    return __builtin_popcountll(p_bits[0]) + __builtin_popcountll(p_bits[1])
+           + __builtin_popcountll(p_bits[2]) + __builtin_popcountll(p_bits[3]);
+}
+
+
+static inline int32_t subpal_is_subset(const uint64_t * p_a, const uint64_t * p_b) {
+
+    return ((p_a[0] & ~p_b[0]) | (p_a[1] & ~p_b[1]) | (p_a[2] & ~p_b[2]) | (p_a[3] & ~p_b[3])) == 0;
+}
+
+
+static inline void subpal_merge(uint64_t * p_dst, const uint64_t * p_src) {
+
+    p_dst[0] |= p_src[0];
+    p_dst[1] |= p_src[1];
+    p_dst[2] |= p_src[2];
+    p_dst[3] |= p_src[3];
+}
+
+
+
+// Sub-palette a set adds the fewest new colors to without going
+// over colors_max (lowest index on ties), -1 if none fits
+static int32_t subpal_best_fit(uint64_t pals[][4], uint32_t pal_count, uint32_t skip,
+                               const subpal_set * p_set, uint16_t colors_max) {
+
+    uint32_t p;
+    uint16_t size, added, best_added;
+    int32_t  best;
+    uint64_t merged[4];
+
+    best       = -1;
+    best_added = 0xFFFF;
+
+    for (p = 0; p < pal_count; p++) {
+
+        if (p == skip)
+            continue;
+
+        memcpy(merged, pals[p], sizeof(merged));
+        subpal_merge(merged, p_set->bits);
+
+        size = subpal_popcount(merged);
+        if (size > colors_max)
+            continue;
+
+        added = size - subpal_popcount(pals[p]);
+        if (added < best_added) {
+            best       = p;
+            best_added = added;
+            if (added == 0)
+                break;
+        }
+    }
+
+    return best;
+}
+
+
+
+// Rebuild each sub-palette from the sets assigned to it
+static void subpal_rebuild(subpal_job * p_job, uint8_t * p_assign, uint64_t pals[][4], uint32_t pal_sets[],
+                           uint32_t pal_count) {
+
+    uint32_t c;
+
+    memset(pals, 0x00, pal_count * sizeof(pals[0]));
+    memset(pal_sets, 0x00, pal_count * sizeof(pal_sets[0]));
+
+    for (c = 0; c < p_job->set_count; c++) {
+        subpal_merge(pals[ p_assign[c] ], p_job->p_sets[c].bits);
+        pal_sets[ p_assign[c] ]++;
+    }
+}
+
+
+
+// Pool task: one greedy packing plus local search
+//
+// * Attempt 0 places sets in size order, later attempts
+//   shuffle equal sizes, the second half also lets
+//   sets of nearly equal size trade places
+static void subpal_attempt_task(void * p_arg, uint32_t attempt, uint32_t worker) {
+
+    subpal_job * p_job = p_arg;
+    uint64_t     pals[TILE_SUBPAL_SLOTS_MAX][4];
+    uint64_t     trial[TILE_SUBPAL_SLOTS_MAX][4];
+    uint32_t     pal_sets[TILE_SUBPAL_SLOTS_MAX];
+    uint32_t     victims[TILE_SUBPAL_SLOTS_MAX];
+    uint32_t     pal_count;
+    uint8_t    * p_assign;
+    uint64_t   * p_order;
+    uint32_t     c, v, p, t, key, seed;
+    int32_t      best;
+    int32_t      improved, fits;
+
+    (void)worker;
+
+    p_job->pal_count[attempt] = SUBPAL_ATTEMPT_FAILED;
+    p_assign = p_job->p_assign + ((size_t)attempt * p_job->set_count);
+
+    p_order = malloc(p_job->set_count * sizeof(uint64_t));
+    if (!p_order)
+        return;
+
+    // Sort key in the upper half, lowest set index first on ties
+    seed = (attempt * 0x9E3779B9U) | 1;
+    for (c = 0; c < p_job->set_count; c++) {
+
+        key = (uint32_t)p_job->p_sets[c].size << 16;
+
+        if (attempt) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+
+            key |= seed & 0xFFFF;
+            if (attempt >= (SUBPAL_ATTEMPTS / 2))
+                key += ((seed >> 16) % 3) << 16;
+        }
+
+        p_order[c] = ((uint64_t)key << 32) | (0xFFFFFFFFU - c);
+    }
+    qsort(p_order, p_job->set_count, sizeof(uint64_t), subpal_order_compare);
+
+
+    // Greedy packing
+    pal_count = 0;
+    for (c = 0; c < p_job->set_count; c++) {
+
+        t    = 0xFFFFFFFFU - (uint32_t)p_order[c];
+        best = subpal_best_fit(pals, pal_count, TILE_SUBPAL_SLOTS_MAX, &p_job->p_sets[t], p_job->colors_max);
+
+        if (best < 0) {
+            if (pal_count == TILE_SUBPAL_SLOTS_MAX) {
+                free(p_order);
+                return; // Out of sub-palettes, attempt failed
+            }
+            best = pal_count++;
+            memset(pals[best], 0x00, sizeof(pals[best]));
+        }
+
+        subpal_merge(pals[best], p_job->p_sets[t].bits);
+        p_assign[t] = best;
+    }
+    free(p_order);
+
+    subpal_rebuild(p_job, p_assign, pals, pal_sets, pal_count);
+
+
+    // Local search: empty out sub-palettes until none can be removed
+    do {
+        improved = false;
+
+        // Fewest sets first (insertion sort, stable)
+        for (p = 0; p < pal_count; p++) {
+            for (v = p; (v > 0) && (pal_sets[ victims[v - 1] ] > pal_sets[p]); v--)
+                victims[v] = victims[v - 1];
+            victims[v] = p;
+        }
+
+        for (p = 0; (p < pal_count) && !improved; p++) {
+
+            v = victims[p];
+
+            // Trial run on a copy, then the same moves for real
+            memcpy(trial, pals, pal_count * sizeof(pals[0]));
+            fits = true;
+            for (c = 0; (c < p_job->set_count) && fits; c++) {
+                if (p_assign[c] == v) {
+                    best = subpal_best_fit(trial, pal_count, v, &p_job->p_sets[c], p_job->colors_max);
+                    if (best < 0)
+                        fits = false;
+                    else
+                        subpal_merge(trial[best], p_job->p_sets[c].bits);
+                }
+            }
+
+            if (!fits)
+                continue;
+
+            for (c = 0; c < p_job->set_count; c++) {
+                if (p_assign[c] == v) {
+                    best = subpal_best_fit(pals, pal_count, v, &p_job->p_sets[c], p_job->colors_max);
+                    subpal_merge(pals[best], p_job->p_sets[c].bits);
+                    p_assign[c] = best;
+                }
+            }
+
+            // Last sub-palette takes over the emptied slot
+            pal_count--;
+            for (c = 0; c < p_job->set_count; c++)
+                if (p_assign[c] == pal_count)
+                    p_assign[c] = v;
+
+            subpal_rebuild(p_job, p_assign, pals, pal_sets, pal_count);
+            improved = true;
+        }
+    } while (improved);
+
+
+    p_job->pal_count[attempt]   = pal_count;
+    p_job->color_total[attempt] = 0;
+    for (p = 0; p < pal_count; p++)
+        p_job->color_total[attempt] += subpal_popcount(pals[p]);
+}
+
+
+
+// Largest sets first, equal sets next to each other
+static int subpal_set_compare(const void * p_a, const void * p_b) {
+
+    const subpal_set * p_set_a = p_a;
+    const subpal_set * p_set_b = p_b;
+
+    if (p_set_a->size != p_set_b->size)
+        return (p_set_a->size > p_set_b->size) ? -1 : 1;
+
+    return memcmp(p_set_a->bits, p_set_b->bits, sizeof(p_set_a->bits));
+}
+
+
+
+// Descending
+static int subpal_order_compare(const void * p_a, const void * p_b) {
+
+    uint64_t a = *(const uint64_t *)p_a;
+    uint64_t b = *(const uint64_t *)p_b;
+
+    return (a < b) ? 1 : ((a > b) ? -1 : 0);
+}
+
+
+
+// Assign every tile of a tile set to one of count_max sub-palettes
+// of colors_max colors each (SUBPAL_COUNT_NONE to skip)
+//
+// * Results go to p_tile_set->subpal and tiles[].sub_palette,
+//   subpal.count can be more than count_max if the tiles don't fit
+// * Indexed images only, sub-palettes hold colormap indices
+// * Returns false on allocation failure
+int32_t tilemap_subpal_solve(tile_set_data * p_tile_set, color_data * p_colormap,
+                             uint16_t count_max, uint16_t colors_max) {
+
+    subpal_job   job;
+    subpal_set * p_tile_sets;
+    subpal_set * p_cands;
+    uint8_t      canonical[256];
+    uint8_t      remap[TILE_SUBPAL_SLOTS_MAX];
+    uint64_t     pals[TILE_SUBPAL_SLOTS_MAX][4];
+    uint32_t     pal_sets[TILE_SUBPAL_SLOTS_MAX];
+    uint32_t     c, m, p, n, cand_count, best;
+    int32_t      has_duplicates;
+    uint8_t      index;
+
+    memset(&p_tile_set->subpal, 0x00, sizeof(p_tile_set->subpal));
+    for (c = 0; c < p_tile_set->tile_count; c++)
+        p_tile_set->tiles[c].sub_palette = 0;
+
+    if ((count_max == SUBPAL_COUNT_NONE) || (colors_max == 0) || (p_tile_set->tile_count == 0))
+        return true; // Nothing to do
+
+    if (p_tile_set->tile_bytes_per_pixel > 2) {
+        printf("Sub-palettes: skipped, image is not indexed\n");
+        return true;
+    }
+
+printf("Sub-palettes: Start -> %d tiles into %d x %d colors  .. ", p_tile_set->tile_count, count_max, colors_max);
+benchmark_start();
+
+    n = p_tile_set->tile_count;
+
+    // Colormap entries with the same color are interchangeable,
+    // count them as the first one
+    has_duplicates = false;
+    for (c = 0; c < 256; c++)
+        canonical[c] = c;
+    for (c = 1; c < p_colormap->color_count; c++)
+        for (m = 0; m < c; m++)
+            if ((canonical[m] == m)
+                && !memcmp(&p_colormap->pal[c * COLOR_DATA_BYTES_PER_COLOR],
+                           &p_colormap->pal[m * COLOR_DATA_BYTES_PER_COLOR], COLOR_DATA_BYTES_PER_COLOR)) {
+                canonical[c]   = m;
+                has_duplicates = true;
+                break;
+            }
+
+    memset(&job, 0x00, sizeof(job));
+    job.colors_max = colors_max;
+
+    p_tile_sets = malloc(n * sizeof(subpal_set));
+    p_cands     = malloc(n * sizeof(subpal_set));
+
+    if (!p_tile_sets || !p_cands) {
+        free(p_tile_sets);
+        free(p_cands);
+        printf("FAILED (out of memory)\n");
+        return false;
+    }
+
+    // Tile color sets, the ones that fit a sub-palette are candidates
+    cand_count = 0;
+    for (c = 0; c < n; c++) {
+
+        memcpy(p_tile_sets[c].bits, p_tile_set->tiles[c].stats.palette_used, sizeof(p_tile_sets[c].bits));
+
+        if (has_duplicates) {
+            memset(p_tile_sets[c].bits, 0x00, sizeof(p_tile_sets[c].bits));
+            for (m = 0; m < 256; m++)
+                if (tile_stats_palette_index_used(&p_tile_set->tiles[c].stats, m)) {
+                    index = canonical[m];
+                    p_tile_sets[c].bits[index >> 6] |= 1ULL << (index & 63);
+                }
+        }
+
+        p_tile_sets[c].size = subpal_popcount(p_tile_sets[c].bits);
+
+        if (p_tile_sets[c].size <= colors_max)
+            p_cands[cand_count++] = p_tile_sets[c];
+    }
+
+    // Keep only sets that aren't a subset of another one
+    // (sorted largest first, so any superset comes earlier)
+    qsort(p_cands, cand_count, sizeof(subpal_set), subpal_set_compare);
+
+    job.set_count = 0;
+    for (c = 0; c < cand_count; c++) {
+        for (m = 0; m < job.set_count; m++)
+            if (subpal_is_subset(p_cands[c].bits, p_cands[m].bits))
+                break;
+
+        if ((m == job.set_count) && (p_cands[c].size > 0))
+            p_cands[job.set_count++] = p_cands[c];
+    }
+    job.p_sets = p_cands;
+
+    job.p_assign = malloc(((size_t)SUBPAL_ATTEMPTS * job.set_count) + 1);
+    if (!job.p_assign) {
+        free(p_tile_sets);
+        free(p_cands);
+        printf("FAILED (out of memory)\n");
+        return false;
+    }
+
+    tilemap_pool_run(SUBPAL_ATTEMPTS, subpal_attempt_task, &job);
+
+    // Fewest sub-palettes, then fewest colors, then lowest attempt
+    best = SUBPAL_ATTEMPTS;
+    for (c = 0; c < SUBPAL_ATTEMPTS; c++)
+        if ((job.pal_count[c] != SUBPAL_ATTEMPT_FAILED)
+            && ((best == SUBPAL_ATTEMPTS)
+                || (job.pal_count[c] < job.pal_count[best])
+                || ((job.pal_count[c] == job.pal_count[best]) && (job.color_total[c] < job.color_total[best]))))
+            best = c;
+
+    p_tile_set->subpal.count_max  = count_max;
+    p_tile_set->subpal.colors_max = colors_max;
+
+    if (best == SUBPAL_ATTEMPTS) {
+        // Only when more than TILE_SUBPAL_SLOTS_MAX are needed
+        p = 0;
+        memset(pals, 0x00, sizeof(pals));
+    }
+    else {
+        p = job.pal_count[best];
+        subpal_rebuild(&job, job.p_assign + ((size_t)best * job.set_count), pals, pal_sets, p);
+    }
+
+    // Each tile takes the first sub-palette that has all its colors,
+    // sub-palettes get numbered in order of first use and only keep
+    // the colors their tiles use
+    memset(remap, 0xFF, sizeof(remap));
+
+    for (c = 0; c < n; c++) {
+
+        for (m = 0; m < p; m++)
+            if (subpal_is_subset(p_tile_sets[c].bits, pals[m]))
+                break;
+
+        // No sub-palettes at all (only transparent tiles) still gives an empty one
+        if ((p == 0) && (p_tile_sets[c].size == 0))
+            m = 0;
+        else if (m == p) {
+            p_tile_set->tiles[c].sub_palette = TILE_SUBPAL_UNFIT;
+            p_tile_set->subpal.tiles_unfit++;
+            continue;
+        }
+
+        if (remap[m] == 0xFF)
+            remap[m] = p_tile_set->subpal.count++;
+
+        p_tile_set->tiles[c].sub_palette = remap[m];
+        subpal_merge(p_tile_set->subpal.colors[ remap[m] ], p_tile_sets[c].bits);
+    }
+
+benchmark_elapsed();
+
+    if ((best == SUBPAL_ATTEMPTS) && job.set_count)
+        printf("Sub-palettes: more than %d sub-palettes needed\n", TILE_SUBPAL_SLOTS_MAX);
+
+    printf("Sub-palettes: %d color sets -> %d sub-palettes (%d available), %d tiles with too many colors\n",
+           job.set_count, p_tile_set->subpal.count, count_max, p_tile_set->subpal.tiles_unfit);
+
+    free(job.p_assign);
+    free(p_tile_sets);
+    free(p_cands);
+
+    return true;
+}
@@ -0,0 +1,20 @@
+//
+// tilemap_subpal.h
+//
+
+#ifndef __TILEMAP_SUBPAL_H_
+#define __TILEMAP_SUBPAL_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define SUBPAL_COUNT_NONE      0     // Sub-palette solving disabled
+    #define SUBPAL_COUNT_MAX       16    // Sub-palettes selectable in the dialog
+    #define SUBPAL_COLORS_DEFAULT  4     // Colors per sub-palette (Game Boy Color)
+    #define SUBPAL_ATTEMPTS        16    // Greedy + local search runs, spread across the thread pool
+
+    int32_t tilemap_subpal_solve(tile_set_data * p_tile_set, color_data * p_colormap,
+                                 uint16_t count_max, uint16_t colors_max);
+
+#endif
@@ -0,0 +1,194 @@
+//
+// tilemap_tilemajor.c
+//
+
+// ========================
+//
+// Tile-major image layout.
+//
+// Source images are row-major, so the rows of one tile are
+// a whole image row apart and each tile touches tile_height
+// distant cache lines every time it is read. Processing
+// reads every cell at least once (hashing, direct keys) and
+// new tiles again (copy, flips).
+//
+// A tile-major copy is transposed once per source image and
+// tile size, with each tile's pixels stored contiguously, so
+// the per-cell passes read one short linear run instead.
+// Hashing runs on the tile in place, and a row of cells is
+// one contiguous block for the lane hash kernels.
+//
+// That only pays off where processing reads tiles one at a time
+// (direct keys), rows of larger tiles get hashed in place in
+// the image by the row kernels just as fast. Callers check
+// tilemap_ctx_tile_major_wanted() before building one.
+//
+// The row-major image stays the source of truth (preview,
+// reference storage, export). The copy is only a faster way
+// to read the same pixels, and processing falls back to the
+// row-major image whenever the copy doesn't match it.
+//
+// ========================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "win_aligned_alloc.h"
+
+#include "lib_tilemap.h"
+#include "tilemap_tilemajor.h"
+#include "tilemap_pool.h"
+
+
+#define TILE_MAJOR_ALIGN  64 // Cache line
+
+
+typedef struct {
+    tile_major_image * p_tm;
+    image_data       * p_src_img;
+} tile_major_job;
+
+
+static void tile_major_row_task(void * p_arg, uint32_t map_y, uint32_t worker);
+
+
+
+// Copy one pixel row into each tile of a map row. Common row
+// sizes get a fixed size copy the compiler can inline
+static inline void tile_major_copy_rows(uint8_t * p_dst, const uint8_t * p_src, uint32_t row_bytes,
+                                        uint32_t dst_step, uint32_t count) {
+
+    #define TILE_MAJOR_COPY_ROWS(size) \
+        for (; count > 0; count--, p_src += (size), p_dst += dst_step) \
+            memcpy(p_dst, p_src, (size));
+
+    switch (row_bytes) {
+        case 8:  TILE_MAJOR_COPY_ROWS(8);  break;
+        case 16: TILE_MAJOR_COPY_ROWS(16); break;
+        case 24: TILE_MAJOR_COPY_ROWS(24); break;
+        case 32: TILE_MAJOR_COPY_ROWS(32); break;
+        case 48: TILE_MAJOR_COPY_ROWS(48); break;
+        case 64: TILE_MAJOR_COPY_ROWS(64); break;
+        default: TILE_MAJOR_COPY_ROWS(row_bytes); break;
+    }
+
+    #undef TILE_MAJOR_COPY_ROWS
+}
+
+
+
+// Pool task: transpose one row of tiles
+//
+// * Reads the source rows in order, each pixel row lands in
+//   width_in_tiles places inside one contiguous block of the copy
+static void tile_major_row_task(void * p_arg, uint32_t map_y, uint32_t worker) {
+
+    tile_major_job * p_job = p_arg;
+    const uint8_t  * p_src;
+    uint8_t        * p_dst;
+    uint32_t         y;
+    size_t           src_stride;
+    uint32_t         tile_width_bytes;
+
+    (void)worker;
+
+    src_stride       = (size_t)p_job->p_src_img->width * p_job->p_src_img->bytes_per_pixel;
+    tile_width_bytes = p_job->p_tm->tile_width * p_job->p_src_img->bytes_per_pixel;
+
+    for (y = 0; y < p_job->p_tm->tile_height; y++) {
+
+        p_src = p_job->p_src_img->p_img_data + (((size_t)map_y * p_job->p_tm->tile_height) + y) * src_stride;
+        p_dst = p_job->p_tm->img.p_img_data
+                + ((size_t)map_y * p_job->p_tm->width_in_tiles * p_job->p_tm->tile_size)
+                + ((size_t)y * tile_width_bytes);
+
+        tile_major_copy_rows(p_dst, p_src, tile_width_bytes, p_job->p_tm->tile_size, p_job->p_tm->width_in_tiles);
+    }
+}
+
+
+
+// Build (or rebuild) a tile-major copy of a source image
+//
+// * Reuses the buffer when the image size is unchanged
+// * Returns false if the tile size doesn't divide the image
+//   or allocation fails, p_tm is left empty then
+int32_t tile_major_build(tile_major_image * p_tm, image_data * p_src_img, int tile_width, int tile_height) {
+
+    tile_major_job job;
+    size_t         alloc_size;
+
+    if ( !p_src_img->p_img_data || !tilemap_check_dimensions_valid(p_src_img, tile_width, tile_height) ) {
+        tile_major_free(p_tm);
+        return false;
+    }
+
+    if (p_tm->img.p_img_data && (p_tm->img.size != p_src_img->size))
+        tile_major_free(p_tm);
+
+    if (!p_tm->img.p_img_data) {
+        // aligned_alloc expects SIZE to be a multiple of ALIGNMENT
+        alloc_size = (size_t)p_src_img->size;
+        alloc_size += (TILE_MAJOR_ALIGN - (alloc_size % TILE_MAJOR_ALIGN)) % TILE_MAJOR_ALIGN;
+
+        p_tm->img.p_img_data = aligned_alloc(TILE_MAJOR_ALIGN, alloc_size);
+        if (!p_tm->img.p_img_data) {
+            printf("Tilemap: Tile-major: failed to allocate %zu bytes\n", alloc_size);
+            tile_major_free(p_tm);
+            return false;
+        }
+    }
+
+    p_tm->p_src_data          = NULL; // Not a valid copy until done
+    p_tm->img.width           = p_src_img->width;
+    p_tm->img.height          = p_src_img->height;
+    p_tm->img.bytes_per_pixel = p_src_img->bytes_per_pixel;
+    p_tm->img.size            = p_src_img->size;
+    p_tm->tile_width          = tile_width;
+    p_tm->tile_height         = tile_height;
+    p_tm->width_in_tiles      = p_src_img->width  / tile_width;
+    p_tm->height_in_tiles     = p_src_img->height / tile_height;
+    p_tm->tile_size           = tile_width * tile_height * p_src_img->bytes_per_pixel;
+
+    job.p_tm      = p_tm;
+    job.p_src_img = p_src_img;
+    tilemap_pool_run(p_tm->height_in_tiles, tile_major_row_task, &job);
+
+    p_tm->p_src_data = p_src_img->p_img_data;
+
+    return true;
+}
+
+
+
+void tile_major_free(tile_major_image * p_tm) {
+
+    if (p_tm->img.p_img_data)
+        free(p_tm->img.p_img_data);
+
+    memset(p_tm, 0x00, sizeof(tile_major_image));
+}
+
+
+
+// True if p_tm is a copy of this source image at this tile size
+int32_t tile_major_matches(tile_major_image * p_tm, image_data * p_src_img, int tile_width, int tile_height) {
+
+    return (p_tm->img.p_img_data
+            && (p_tm->p_src_data          == p_src_img->p_img_data)
+            && (p_tm->img.width           == p_src_img->width)
+            && (p_tm->img.height          == p_src_img->height)
+            && (p_tm->img.bytes_per_pixel == p_src_img->bytes_per_pixel)
+            && (p_tm->tile_width          == tile_width)
+            && (p_tm->tile_height         == tile_height));
+}
+
+
+
+// Pixels of the tile for a map cell (cell = map_y * width_in_tiles + map_x)
+const uint8_t * tile_major_get_tile(tile_major_image * p_tm, uint32_t cell) {
+
+    return p_tm->img.p_img_data + ((size_t)cell * p_tm->tile_size);
+}
@@ -0,0 +1,33 @@
+//
+// tilemap_tilemajor.h
+//
+
+#ifndef __TILEMAP_TILEMAJOR_H_
+#define __TILEMAP_TILEMAJOR_H_
+
+    #include <stdint.h>
+
+    #include "image_info.h"
+
+    // Tile-major copy of a row-major image: the pixels of each tile
+    // back to back (tile_size bytes), tiles in map order (zeroed = none)
+    //
+    // * Only valid while the source image it was built from is unchanged,
+    //   free or rebuild it whenever the source gets freed or reloaded
+    typedef struct {
+        image_data      img;            // Same size and bpp as the source
+        const uint8_t * p_src_data;     // Pixels of the source image it was built from
+        uint16_t        tile_width;
+        uint16_t        tile_height;
+        uint32_t        width_in_tiles;
+        uint32_t        height_in_tiles;
+        uint32_t        tile_size;      // Bytes per tile
+    } tile_major_image;
+
+    int32_t tile_major_build(tile_major_image * p_tm, image_data * p_src_img, int tile_width, int tile_height);
+    void    tile_major_free(tile_major_image * p_tm);
+    int32_t tile_major_matches(tile_major_image * p_tm, image_data * p_src_img, int tile_width, int tile_height);
+
+    const uint8_t * tile_major_get_tile(tile_major_image * p_tm, uint32_t cell);
+
+#endif
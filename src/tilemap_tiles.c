@@ -10,6 +10,9 @@
 
 #include "lib_tilemap.h"
 #include "tilemap_tiles.h"
+#include "tilemap_store.h"
+#include "tilemap_packed.h"
+#include "tilemap_grid.h"
 
 const uint16_t tile_flip_bits[] = {
     TILE_FLIP_BITS_NONE,
@@ -22,8 +25,11 @@ void tile_free(tile_data * p_tile) {
 
     if (p_tile->p_img_raw)
         free(p_tile->p_img_raw);
+    if (p_tile->p_img_encoded)
+        free(p_tile->p_img_encoded);
 
-    p_tile->p_img_raw = NULL;
+    p_tile->p_img_raw     = NULL;
+    p_tile->p_img_encoded = NULL;
 }
 
 
@@ -42,13 +48,33 @@ void tile_initialize(tile_data * p_tile, tile_map_data * p_tile_map, tile_set_da
     tile_size_bytes = p_tile->raw_size_bytes;
 
     // Make sure buffer is an even multiple of 32 bits (for hash function)
-    tile_size_bytes_hash_padding = tile_size_bytes % sizeof(uint32_t);
+    tile_size_bytes_hash_padding = (sizeof(uint32_t) - (tile_size_bytes % sizeof(uint32_t))) % sizeof(uint32_t);
 
     // Allocate buffer for temporary working tile raw image, 32 bit aligned
     p_tile->p_img_raw = (uint8_t *)aligned_alloc(sizeof(uint32_t), (tile_size_bytes + tile_size_bytes_hash_padding));
 
     // Make sure padding bytes are zeroed
-    memset(p_tile->p_img_raw, 0x00, tile_size_bytes + tile_size_bytes_hash_padding);
+    if (p_tile->p_img_raw)
+        memset(p_tile->p_img_raw, 0x00, tile_size_bytes + tile_size_bytes_hash_padding);
+
+    // Packed tile sets also get a packed working buffer, hashes and flips use that one
+    p_tile->packed_bits        = p_tile_set->pack_bits;
+    p_tile->encoded_size_bytes = 0;
+    p_tile->p_img_encoded      = NULL;
+
+    if (p_tile->packed_bits) {
+        p_tile->encoded_size_bytes = tile_packed_get_size(p_tile->raw_width, p_tile->raw_height, p_tile->packed_bits);
+        tile_size_bytes = (p_tile->encoded_size_bytes + (sizeof(uint32_t) - 1)) & ~(sizeof(uint32_t) - 1);
+
+        p_tile->p_img_encoded = (uint8_t *)aligned_alloc(sizeof(uint32_t), tile_size_bytes);
+        if (p_tile->p_img_encoded)
+            memset(p_tile->p_img_encoded, 0x00, tile_size_bytes);
+        else {
+            // Callers only check p_img_raw for allocation failure
+            free(p_tile->p_img_raw);
+            p_tile->p_img_raw = NULL;
+        }
+    }
 }
 
 
@@ -76,28 +102,68 @@ tile_map_entry tile_register_new(tile_data * p_src_tile, tile_set_data * tile_se
             new_tile->hash[h] = p_src_tile->hash[h];
 
 
-        new_tile->encoded_size_bytes = 0;
+        new_tile->encoded_size_bytes = p_src_tile->encoded_size_bytes;
+        new_tile->packed_bits         = p_src_tile->packed_bits;
         new_tile->raw_bytes_per_pixel = p_src_tile->raw_bytes_per_pixel;
         new_tile->raw_width           = p_src_tile->raw_width;
         new_tile->raw_height          = p_src_tile->raw_height;
         new_tile->map_entry_count     = 1; // Tile got created since it was needed, so will be used at least once
+        new_tile->reduce_error        = 0;
+        new_tile->src_tile_x          = p_src_tile->src_tile_x;
+        new_tile->src_tile_y          = p_src_tile->src_tile_y;
+        new_tile->sub_palette         = 0;
 
-        // Copy raw tile data into tile image buffer
         new_tile->raw_size_bytes = p_src_tile->raw_size_bytes;
-        new_tile->p_img_raw      = malloc(p_src_tile->raw_size_bytes);
+        new_tile->p_img_encoded  = NULL;
+
+        // Pixels were just hashed, so they're still in cache
+        // (flipped pixels give the same stats)
+        if (p_src_tile->packed_bits)
+            tile_stats_calc(&new_tile->stats, p_src_tile->p_img_encoded, p_src_tile->raw_width, p_src_tile->raw_height,
+                            p_src_tile->raw_bytes_per_pixel, p_src_tile->packed_bits);
+        else
+            tile_stats_calc(&new_tile->stats, p_src_tile->p_img_raw, p_src_tile->raw_width, p_src_tile->raw_height,
+                            p_src_tile->raw_bytes_per_pixel, TILE_PACKED_BITS_NONE);
+
+        if (tile_set->storage_mode == TILE_STORAGE_REFERENCE) {
+
+            // No private copy, pixels get read from the
+            // source image via tile_get_view() when needed
+            new_tile->p_img_raw = NULL;
+            tile_set->tile_count++;
+        }
+        else if (p_src_tile->packed_bits) {
+            // Packed tile sets only store the packed pixels
+            new_tile->p_img_raw     = NULL;
+            new_tile->p_img_encoded = tile_store_alloc(&tile_set->store, p_src_tile->encoded_size_bytes);
 
-        new_tile->p_img_encoded  = NULL; // Unused in this project
+            if (new_tile->p_img_encoded) {
 
-        if (new_tile->p_img_raw) {
+                memcpy(new_tile->p_img_encoded,
+                       p_src_tile->p_img_encoded,
+                       p_src_tile->encoded_size_bytes);
 
-            memcpy(new_tile->p_img_raw,
-                   p_src_tile->p_img_raw,
-                   p_src_tile->raw_size_bytes);
+                tile_set->tile_count++;
 
-            tile_set->tile_count++;
+            } else // malloc failed
+                new_map_entry.id = TILE_ID_OUT_OF_SPACE;
+        }
+        else {
+            // Copy raw tile data into tile image buffer
+            // (may be backed by the spill file when over the memory budget)
+            new_tile->p_img_raw = tile_store_alloc(&tile_set->store, p_src_tile->raw_size_bytes);
 
-        } else // malloc failed
-            new_map_entry.id = TILE_ID_OUT_OF_SPACE;
+            if (new_tile->p_img_raw) {
+
+                memcpy(new_tile->p_img_raw,
+                       p_src_tile->p_img_raw,
+                       p_src_tile->raw_size_bytes);
+
+                tile_set->tile_count++;
+
+            } else // malloc failed
+                new_map_entry.id = TILE_ID_OUT_OF_SPACE;
+        }
     }
     else
         new_map_entry.id = TILE_ID_OUT_OF_SPACE;
@@ -143,15 +209,15 @@ tile_map_entry tile_find_match(uint64_t hash_sig, tile_set_data * tile_set, uint
 
 void tile_copy_tile_from_image(image_data * p_src_img,
                               tile_data * p_tile,
-                            uint32_t img_buf_offset) {
+                            size_t img_buf_offset) {
 
     int32_t tile_y;
     int32_t tile_img_offset;
-    int32_t image_width_bytes;
+    size_t  image_width_bytes;
     int32_t tile_width_bytes;
 
     tile_img_offset   = 0;
-    image_width_bytes = p_src_img->width  * p_src_img->bytes_per_pixel;
+    image_width_bytes = (size_t)p_src_img->width * p_src_img->bytes_per_pixel;
     tile_width_bytes  = p_tile->raw_width * p_tile->raw_bytes_per_pixel;
 
     if (!p_tile->p_img_raw)
@@ -175,6 +241,130 @@ void tile_copy_tile_from_image(image_data * p_src_img,
 
 
 
+// Bit-pack the tile of one map cell into p_dst (cell = map_y * width_in_tiles + map_x)
+//
+// * Reads the tile-major copy if there is one (p_tm), otherwise the image
+void tile_pack_cell(image_data * p_src_img, tile_major_image * p_tm, tile_map_data * p_map,
+                    uint8_t bits, uint32_t cell, uint8_t * p_dst) {
+
+    size_t img_buf_offset;
+
+    if (p_tm) {
+        tile_packed_pack(tile_major_get_tile(p_tm, cell), p_map->tile_width * p_src_img->bytes_per_pixel,
+                         p_map->tile_width, p_map->tile_height, bits, p_dst);
+        return;
+    }
+
+    img_buf_offset = tile_grid_get_offset(p_src_img, &p_map->grid, p_map->tile_width, p_map->tile_height,
+                                          cell % p_map->width_in_tiles, cell / p_map->width_in_tiles);
+
+    tile_packed_pack(p_src_img->p_img_data + img_buf_offset, (size_t)p_src_img->width * p_src_img->bytes_per_pixel,
+                     p_map->tile_width, p_map->tile_height, bits, p_dst);
+}
+
+
+
+// Bit-pack a whole row of map cells, back to back, into p_dst
+// (a packed tile apart, the same layout as a tile-major row)
+void tile_pack_map_row(image_data * p_src_img, tile_major_image * p_tm, tile_map_data * p_map,
+                       uint8_t bits, uint32_t map_y, uint8_t * p_dst) {
+
+    uint32_t map_x;
+    uint32_t packed_size;
+
+    packed_size = tile_packed_get_size(p_map->tile_width, p_map->tile_height, bits);
+
+    for (map_x = 0; map_x < p_map->width_in_tiles; map_x++, p_dst += packed_size)
+        tile_pack_cell(p_src_img, p_tm, p_map, bits, (map_y * p_map->width_in_tiles) + map_x, p_dst);
+}
+
+
+
+// Set up a view of a registered tile's pixels
+//
+// * TILE_STORAGE_COPY: view covers the tile's private buffer
+// * TILE_STORAGE_REFERENCE: view points into the source image
+//   at the tile's first occurrence, using the image row stride
+//   (locked base tiles aren't in it, they keep a private buffer)
+void tile_get_view(tile_set_data * tile_set, uint32_t tile_id, tile_view * p_view) {
+
+    tile_data * p_tile;
+
+    p_tile = &tile_set->tiles[tile_id];
+
+    p_view->width           = p_tile->raw_width;
+    p_view->height          = p_tile->raw_height;
+    p_view->bytes_per_pixel = p_tile->raw_bytes_per_pixel;
+    p_view->packed_bits     = TILE_PACKED_BITS_NONE;
+
+    if (p_tile->p_img_encoded) {
+        p_view->row_stride  = tile_packed_get_row_bytes(p_tile->raw_width, p_tile->packed_bits);
+        p_view->p_data      = p_tile->p_img_encoded;
+        p_view->packed_bits = p_tile->packed_bits;
+    }
+    else if (p_tile->p_img_raw || (tile_set->storage_mode != TILE_STORAGE_REFERENCE)) {
+        p_view->row_stride = p_tile->raw_width * p_tile->raw_bytes_per_pixel;
+        p_view->p_data     = p_tile->p_img_raw;
+    }
+    else {
+        p_view->row_stride = (size_t)tile_set->src_img.width * tile_set->src_img.bytes_per_pixel;
+
+        if (tile_set->src_img.p_img_data)
+            p_view->p_data = tile_set->src_img.p_img_data
+                             + tile_grid_get_offset(&tile_set->src_img, &tile_set->grid,
+                                                    p_tile->raw_width, p_tile->raw_height,
+                                                    p_tile->src_tile_x, p_tile->src_tile_y);
+        else
+            p_view->p_data = NULL;
+    }
+}
+
+
+// Materialize the pixels of a tile view into a packed (tile width stride) buffer
+//
+// * Bit-packed views get unpacked to one byte per pixel
+void tile_view_copy_to_buffer(tile_view * p_view, uint8_t * p_dest) {
+
+    uint16_t  y;
+    uint8_t * p_src;
+    uint32_t  tile_width_bytes;
+
+    if (!p_view->p_data)
+        return;
+
+    if (p_view->packed_bits) {
+        tile_packed_unpack(p_view->p_data, p_view->width, p_view->height, p_view->packed_bits,
+                           p_dest, p_view->width * p_view->bytes_per_pixel);
+        return;
+    }
+
+    p_src            = p_view->p_data;
+    tile_width_bytes = p_view->width * p_view->bytes_per_pixel;
+
+    for (y = 0; y < p_view->height; y++) {
+        memcpy(p_dest, p_src, tile_width_bytes);
+
+        p_src  += p_view->row_stride;
+        p_dest += tile_width_bytes;
+    }
+}
+
+
+
+// Release the pixel buffers of a registered tile back to the tile store
+void tile_release_pixels(tile_set_data * tile_set, tile_data * p_tile) {
+
+    if (p_tile->p_img_raw)
+        tile_store_free(&tile_set->store, p_tile->p_img_raw, p_tile->raw_size_bytes);
+    p_tile->p_img_raw = NULL;
+
+    if (p_tile->p_img_encoded)
+        tile_store_free(&tile_set->store, p_tile->p_img_encoded, p_tile->encoded_size_bytes);
+    p_tile->p_img_encoded = NULL;
+}
+
+
+
 // TODO: DEBUG: REMOVE ME
 void tile_print_buffer_raw(tile_data tile) {
 
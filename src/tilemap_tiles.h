@@ -2,12 +2,30 @@
 // tilemap_tiles.h
 //
 
+#include "tilemap_hash.h"
+
+extern const uint16_t tile_flip_bits[];
+
 void           tile_free(tile_data * p_tile);
-void           tile_copy_tile_from_image(image_data * p_src_img, tile_data * tile, uint32_t img_buf_offset);
+void           tile_copy_tile_from_image(image_data * p_src_img, tile_data * tile, size_t img_buf_offset);
+void           tile_pack_cell(image_data * p_src_img, tile_major_image * p_tm, tile_map_data * p_map,
+                              uint8_t bits, uint32_t cell, uint8_t * p_dst);
+void           tile_pack_map_row(image_data * p_src_img, tile_major_image * p_tm, tile_map_data * p_map,
+                                 uint8_t bits, uint32_t map_y, uint8_t * p_dst);
 tile_map_entry tile_find_match(uint64_t hash_sig, tile_set_data * tile_set, uint16_t search_mask);
 tile_map_entry tile_register_new(tile_data * src_tile, tile_set_data * tile_set, uint16_t search_mask);
 void           tile_initialize(tile_data * p_tile, tile_map_data * p_tile_map, tile_set_data * p_tile_set);
 
+void           tile_flip_x(tile_data * p_src_tile, tile_data * p_dst_tile);
+void           tile_flip_y(tile_data * p_src_tile, tile_data * p_dst_tile);
+void           tile_calc_alternate_hashes(tile_data * p_tile, tile_data flip_tiles[], tile_hash_func hash_func);
+void           tile_dkey_pack_flips(tile_dkey_data * p_dkey, tile_data * p_tile, tile_data flip_tiles[],
+                                    uint8_t keys[][TILE_DKEY_BYTES_MAX]);
+
+void           tile_get_view(tile_set_data * tile_set, uint32_t tile_id, tile_view * p_view);
+void           tile_view_copy_to_buffer(tile_view * p_view, uint8_t * p_dest);
+void           tile_release_pixels(tile_set_data * tile_set, tile_data * p_tile);
+
 // TODO: delete me
 void tile_print_buffer_raw(tile_data tile);
 void tile_print_buffer_encoded(tile_data tile);
@@ -0,0 +1,270 @@
+//
+// tilemap_window.c
+//
+
+// ========================
+//
+// Viewport residency analysis for scrolling maps.
+//
+// A scrolling game only needs the tiles visible on screen
+// to be loaded at once, so the number that matters for
+// VRAM is the most unique tiles in any screen sized window
+// of the map, not the tile set total.
+//
+// The window walks every position of the map in a snake
+// order: right along one row of positions, down one, left
+// along the next. Each step only moves one column (or row)
+// of map cells out of and into the window. A reference
+// count per tile ID tracks how many cells of the window
+// use it, so the unique count changes whenever a count
+// goes from or to zero, without recounting the window.
+//
+// Cost is about 2 x view height updates per step across
+// and 2 x view width per step down, vs view width x view
+// height to recount each position.
+//
+// Flipped entries use the same tile (one copy in VRAM),
+// so only tile IDs are counted.
+//
+// ========================
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "tilemap_window.h"
+
+#include "benchmark.h"
+
+
+// Sliding state: window position and the tile use counts inside it
+typedef struct {
+    const uint32_t * p_ids;     // Map tile IDs, row-major
+    uint32_t         stride;    // Map width in tiles
+    uint32_t       * p_refs;    // Map cells in the window using each tile ID
+    uint32_t         unique;    // Tile IDs with a non-zero count
+} window_state;
+
+
+static inline void window_ref_add(window_state * p_state, uint32_t id);
+static inline void window_ref_remove(window_state * p_state, uint32_t id);
+static void window_column_update(window_state * p_state, uint32_t x, uint32_t y, uint32_t count, int32_t add);
+static void window_row_update(window_state * p_state, uint32_t x, uint32_t y, uint32_t count, int32_t add);
+static void window_position_record(tile_window_data * p_window, uint32_t unique, uint32_t x, uint32_t y);
+
+
+
+static inline void window_ref_add(window_state * p_state, uint32_t id) {
+
+    if (p_state->p_refs[id]++ == 0)
+        p_state->unique++;
+}
+
+
+static inline void window_ref_remove(window_state * p_state, uint32_t id) {
+
+    if (--p_state->p_refs[id] == 0)
+        p_state->unique--;
+}
+
+
+
+// Add or remove the count cells of map column x starting at row y
+static void window_column_update(window_state * p_state, uint32_t x, uint32_t y, uint32_t count, int32_t add) {
+
+    const uint32_t * p_id;
+
+    p_id = p_state->p_ids + ((size_t)y * p_state->stride) + x;
+
+    if (add)
+        for (; count; count--, p_id += p_state->stride)
+            window_ref_add(p_state, *p_id);
+    else
+        for (; count; count--, p_id += p_state->stride)
+            window_ref_remove(p_state, *p_id);
+}
+
+
+
+// Add or remove the count cells of map row y starting at column x
+static void window_row_update(window_state * p_state, uint32_t x, uint32_t y, uint32_t count, int32_t add) {
+
+    const uint32_t * p_id;
+
+    p_id = p_state->p_ids + ((size_t)y * p_state->stride) + x;
+
+    if (add)
+        for (; count; count--, p_id++)
+            window_ref_add(p_state, *p_id);
+    else
+        for (; count; count--, p_id++)
+            window_ref_remove(p_state, *p_id);
+}
+
+
+
+// Fold one window position into the peak and heat strips
+//
+// Ties keep the topmost, then leftmost, position so the result
+// doesn't depend on the direction the row was walked in
+static void window_position_record(tile_window_data * p_window, uint32_t unique, uint32_t x, uint32_t y) {
+
+    if (unique > p_window->p_heat_x[x])
+        p_window->p_heat_x[x] = unique;
+
+    if (unique > p_window->p_heat_y[y])
+        p_window->p_heat_y[y] = unique;
+
+    if ((unique > p_window->peak_count)
+        || ((unique == p_window->peak_count) && (y == p_window->peak_y) && (x < p_window->peak_x))) {
+        p_window->peak_count = unique;
+        p_window->peak_x     = x;
+        p_window->peak_y     = y;
+    }
+}
+
+
+
+// Find the most unique tiles visible in any view_width x view_height
+// window of a map, where it is and the per column / row peaks
+//
+// * Reads tile_id_list when present (before packing),
+//   otherwise decodes the packed or RLE entries first
+// * A viewport larger than the map gets clipped to it
+// * view_width or view_height WINDOW_VIEW_NONE: clears any previous result
+int32_t tilemap_window_calc(tile_map_data * p_map, uint16_t view_width, uint16_t view_height) {
+
+    tile_window_data * p_window;
+    window_state       state;
+    uint32_t         * p_ids_decoded;
+    uint32_t           c, x, y, id_max;
+
+    p_window = &p_map->window;
+    tilemap_window_free(p_window);
+
+    if ((view_width == WINDOW_VIEW_NONE) || (view_height == WINDOW_VIEW_NONE)
+        || (p_map->width_in_tiles == 0) || (p_map->height_in_tiles == 0))
+        return true;
+
+    printf("Window: Start -> %d x %d view over %d x %d map  ", view_width, view_height,
+           p_map->width_in_tiles, p_map->height_in_tiles);
+    benchmark_start();
+
+    p_ids_decoded = NULL;
+
+    if (p_map->tile_id_list)
+        state.p_ids = p_map->tile_id_list;
+    else {
+        p_ids_decoded = tilemap_map_decode_ids(p_map);
+        if (!p_ids_decoded)
+            return false;
+
+        state.p_ids = p_ids_decoded;
+    }
+
+    // Reduction can leave gaps, so size the counts by the IDs in use
+    id_max = 0;
+    for (c = 0; c < p_map->size; c++)
+        if (state.p_ids[c] > id_max)
+            id_max = state.p_ids[c];
+
+    p_window->view_width  = (view_width  < p_map->width_in_tiles)  ? view_width  : p_map->width_in_tiles;
+    p_window->view_height = (view_height < p_map->height_in_tiles) ? view_height : p_map->height_in_tiles;
+    p_window->positions_x = p_map->width_in_tiles  - p_window->view_width  + 1;
+    p_window->positions_y = p_map->height_in_tiles - p_window->view_height + 1;
+
+    state.stride = p_map->width_in_tiles;
+    state.unique = 0;
+    state.p_refs = calloc((size_t)id_max + 1, sizeof(uint32_t));
+
+    p_window->p_heat_x = calloc(p_window->positions_x, sizeof(uint32_t));
+    p_window->p_heat_y = calloc(p_window->positions_y, sizeof(uint32_t));
+
+    if (!state.p_refs || !p_window->p_heat_x || !p_window->p_heat_y) {
+        free(state.p_refs);
+        free(p_ids_decoded);
+        tilemap_window_free(p_window);
+        return false;
+    }
+
+    // Fill the first window, then snake across the positions
+    for (y = 0; y < p_window->view_height; y++)
+        window_row_update(&state, 0, y, p_window->view_width, true);
+
+    x = 0;
+    for (y = 0; y < p_window->positions_y; y++) {
+
+        if (y > 0) {
+            window_row_update(&state, x, y - 1,                         p_window->view_width, false);
+            window_row_update(&state, x, y + p_window->view_height - 1, p_window->view_width, true);
+        }
+
+        window_position_record(p_window, state.unique, x, y);
+
+        if ((y & 1) == 0) {
+            // Even rows of positions move right
+            while (x + 1 < p_window->positions_x) {
+                window_column_update(&state, x,                         y, p_window->view_height, false);
+                window_column_update(&state, x + p_window->view_width, y, p_window->view_height, true);
+                x++;
+                window_position_record(p_window, state.unique, x, y);
+            }
+        }
+        else {
+            // Odd rows of positions move left
+            while (x > 0) {
+                window_column_update(&state, x + p_window->view_width - 1, y, p_window->view_height, false);
+                window_column_update(&state, x - 1,                         y, p_window->view_height, true);
+                x--;
+                window_position_record(p_window, state.unique, x, y);
+            }
+        }
+    }
+
+    free(state.p_refs);
+    free(p_ids_decoded);
+
+    benchmark_elapsed();
+    printf("Window: peak %d unique tiles at %d,%d (%d x %d positions)\n", p_window->peak_count,
+           p_window->peak_x, p_window->peak_y, p_window->positions_x, p_window->positions_y);
+
+    return true;
+}
+
+
+
+// Duplicate a window result, p_dst gets its own heat strips
+int32_t tilemap_window_copy(tile_window_data * p_dst, tile_window_data * p_src) {
+
+    memcpy(p_dst, p_src, sizeof(tile_window_data));
+    p_dst->p_heat_x = NULL;
+    p_dst->p_heat_y = NULL;
+
+    if (!p_src->p_heat_x)
+        return true;
+
+    p_dst->p_heat_x = malloc(p_src->positions_x * sizeof(uint32_t));
+    p_dst->p_heat_y = malloc(p_src->positions_y * sizeof(uint32_t));
+
+    if (!p_dst->p_heat_x || !p_dst->p_heat_y) {
+        tilemap_window_free(p_dst);
+        return false;
+    }
+
+    memcpy(p_dst->p_heat_x, p_src->p_heat_x, p_src->positions_x * sizeof(uint32_t));
+    memcpy(p_dst->p_heat_y, p_src->p_heat_y, p_src->positions_y * sizeof(uint32_t));
+    return true;
+}
+
+
+
+void tilemap_window_free(tile_window_data * p_window) {
+
+    if (p_window->p_heat_x)
+        free(p_window->p_heat_x);
+
+    if (p_window->p_heat_y)
+        free(p_window->p_heat_y);
+
+    memset(p_window, 0x00, sizeof(tile_window_data));
+}
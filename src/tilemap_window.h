@@ -0,0 +1,21 @@
+//
+// tilemap_window.h
+//
+
+#ifndef __TILEMAP_WINDOW_H_
+#define __TILEMAP_WINDOW_H_
+
+    #include <stdint.h>
+
+    #include "lib_tilemap.h"
+
+    #define WINDOW_VIEW_NONE            0     // Residency analysis disabled
+    #define WINDOW_VIEW_WIDTH_DEFAULT   20    // Viewport in tiles (Game Boy screen)
+    #define WINDOW_VIEW_HEIGHT_DEFAULT  18
+    #define WINDOW_VIEW_MAX             255   // Largest viewport selectable in the dialog
+
+    int32_t tilemap_window_calc(tile_map_data * p_map, uint16_t view_width, uint16_t view_height);
+    int32_t tilemap_window_copy(tile_window_data * p_dst, tile_window_data * p_src);
+    void    tilemap_window_free(tile_window_data * p_window);
+
+#endif